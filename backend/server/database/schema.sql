@@ -34,7 +34,7 @@ CREATE TABLE IF NOT EXISTS rooms (
     room_id VARCHAR(64) PRIMARY KEY,
     name VARCHAR(100) NOT NULL,
     description TEXT,
-    room_type ENUM('public', 'private', 'dm') DEFAULT 'public',
+    room_type ENUM('public', 'private', 'dm', 'channel') DEFAULT 'public',
     creator_id VARCHAR(64) NOT NULL,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
@@ -62,14 +62,41 @@ CREATE TABLE IF NOT EXISTS messages (
     content TEXT NOT NULL,
     message_type INT DEFAULT 0,
     reply_to_id VARCHAR(64) DEFAULT NULL,
+    reply_count INT UNSIGNED NOT NULL DEFAULT 0,
+    last_reply_at TIMESTAMP NULL,
     metadata JSON DEFAULT NULL,
     is_deleted BOOLEAN DEFAULT FALSE,
     deleted_at TIMESTAMP NULL,
     edited_at TIMESTAMP NULL,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    expires_at TIMESTAMP NULL,
+    compressed TINYINT UNSIGNED NOT NULL DEFAULT 0,  -- 1 = content in content_z, 2 = metadata in metadata_z
+    content_z MEDIUMBLOB NULL,
+    metadata_z MEDIUMBLOB NULL,
     INDEX idx_room (room_id),
     INDEX idx_sender (sender_id),
-    INDEX idx_created (created_at DESC)
+    INDEX idx_created (created_at DESC),
+    INDEX idx_reply_thread (reply_to_id, created_at),
+    INDEX idx_room_created (room_id, created_at, message_id),
+    INDEX idx_expires (expires_at)
+);
+
+-- Disappearing messages: per-room TTL (room_id may be a DM conversation_id)
+CREATE TABLE IF NOT EXISTS room_message_ttl (
+    room_id VARCHAR(128) PRIMARY KEY,
+    ttl_seconds INT UNSIGNED NOT NULL,
+    updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP
+);
+
+-- Outbound webhooks: new messages in room_id are POSTed (batched) to url
+CREATE TABLE IF NOT EXISTS room_webhooks (
+    webhook_id VARCHAR(64) PRIMARY KEY,
+    room_id VARCHAR(128) NOT NULL,
+    url VARCHAR(2048) NOT NULL,
+    secret VARCHAR(128) NOT NULL DEFAULT '',
+    created_by VARCHAR(64) NOT NULL,
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    INDEX idx_room (room_id)
 );
 
 -- Files table
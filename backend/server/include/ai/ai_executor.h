@@ -0,0 +1,66 @@
+#ifndef AI_EXECUTOR_H
+#define AI_EXECUTOR_H
+
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * AI Executor
+ *
+ * Small fixed pool of threads for blocking AI calls (a Gemini request can
+ * take seconds), so they never run on the event loop or a room actor and
+ * never pile up as one thread per request.
+ *
+ * - Bounded queue: submit() returns false when it is full (callers answer
+ *   "busy" instead of queueing without limit)
+ * - Tasks must not touch sockets; hand results back with runOnLoop
+ */
+class AiExecutor {
+public:
+    using Task = std::function<void()>;
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t rejected = 0;   // Queue full or stopped
+        size_t queued = 0;
+        size_t running = 0;
+    };
+
+    AiExecutor(size_t threads, size_t maxQueued);
+    ~AiExecutor();
+
+    AiExecutor(const AiExecutor&) = delete;
+    AiExecutor& operator=(const AiExecutor&) = delete;
+
+    void start();
+    /**
+     * Stop after the running tasks finish; queued tasks are dropped
+     */
+    void stop();
+
+    bool submit(Task task);
+
+    Stats stats() const;
+
+private:
+    size_t threadCount_;
+    size_t maxQueued_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> queue_;
+    Stats stats_;
+
+    void workerLoop();
+};
+
+#endif // AI_EXECUTOR_H
@@ -0,0 +1,46 @@
+#ifndef EMBEDDING_CLIENT_H
+#define EMBEDDING_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <optional>
+
+/**
+ * Embedding Client
+ *
+ * Text -> vectors through a Gemini-compatible batchEmbedContents endpoint:
+ * many texts per HTTP request, vectors returned in request order and
+ * normalized to unit length (so dot product = cosine similarity).
+ *
+ * Blocking; call from a background thread.
+ */
+class EmbeddingClient {
+public:
+    struct Options {
+        std::string apiKey;
+        std::string endpoint;        // Empty = Google's text-embedding-004 batchEmbedContents
+        std::string model = "models/text-embedding-004";
+        size_t dimensions = 256;     // Requested outputDimensionality; longer replies are truncated
+        long timeoutMs = 10000;
+    };
+
+    // Gemini task types: documents are indexed, queries are searched with
+    static constexpr const char* DOCUMENT = "RETRIEVAL_DOCUMENT";
+    static constexpr const char* QUERY = "RETRIEVAL_QUERY";
+
+    explicit EmbeddingClient(Options options);
+
+    /**
+     * One vector per text, same order; nullopt if the request failed or the
+     * reply did not have a usable vector for every text
+     */
+    std::optional<std::vector<std::vector<float>>> embed(const std::vector<std::string>& texts,
+                                                         const char* taskType);
+
+    size_t dimensions() const { return options_.dimensions; }
+
+private:
+    Options options_;
+};
+
+#endif // EMBEDDING_CLIENT_H
@@ -15,7 +15,11 @@
  */
 class GeminiClient {
 public:
-    GeminiClient(const std::string& apiKey);
+    /**
+     * @param apiEndpoint generateContent URL; empty for Google's (a local
+     *                    stand-in speaking the same JSON works for tests)
+     */
+    GeminiClient(const std::string& apiKey, const std::string& apiEndpoint = "");
     ~GeminiClient();
     
     /**
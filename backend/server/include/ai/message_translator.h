@@ -0,0 +1,124 @@
+#ifndef MESSAGE_TRANSLATOR_H
+#define MESSAGE_TRANSLATOR_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "utils/lru_cache.h"
+
+class AiExecutor;
+
+/**
+ * Message Translator
+ *
+ * On-demand AI translation of chat messages, shared by everyone who asks:
+ *
+ * - Cache per message: every language translated so far, tagged with a hash
+ *   of the source text, so an edit (or a translation that raced one) is
+ *   never served; invalidate() drops a message outright
+ * - Single-flight: a (message, language) already being translated is
+ *   joined, not requested again
+ * - Micro-batching: misses go into an open batch per language until the AI
+ *   executor picks it up, so a history page (and whatever other users ask
+ *   for meanwhile) is one AI call of up to maxBatch messages
+ *
+ * Thread-safe. Callbacks run on the AI executor, or inline when every
+ * message was cached.
+ */
+class MessageTranslator {
+public:
+    struct Options {
+        size_t maxBatch = 20;          // Messages per AI call
+        size_t maxBatchBytes = 8000;   // Source text per AI call
+        size_t maxTextBytes = 4000;    // Longer messages are not translated
+        size_t cacheMessages = 20000;
+    };
+
+    struct Item {
+        std::string messageId;
+        std::string text;
+    };
+
+    struct Result {
+        std::string messageId;
+        std::optional<std::string> text;   // nullopt if it could not be translated
+        bool cached = false;
+    };
+
+    struct Stats {
+        uint64_t requested = 0;        // Messages asked for
+        uint64_t cacheHits = 0;
+        uint64_t coalesced = 0;        // Joined a translation in flight
+        uint64_t aiCalls = 0;
+        uint64_t translated = 0;
+        uint64_t failed = 0;
+        uint64_t rejected = 0;         // AI executor queue full
+        uint64_t invalidated = 0;
+    };
+
+    // (prompt, message) -> text, e.g. GeminiClient::generateResponse
+    using Generate = std::function<std::optional<std::string>(const std::string& prompt, const std::string& message)>;
+    // Results in the order of the items
+    using Callback = std::function<void(std::vector<Result> results)>;
+
+    MessageTranslator(Options options, AiExecutor& executor, Generate generate);
+
+    /**
+     * Translate items (plain text) into language, e.g. "vi" or "Brazilian
+     * Portuguese"; callback is called exactly once
+     */
+    void translate(const std::vector<Item>& items, const std::string& language, Callback callback);
+
+    /**
+     * Forget every translation of a message (edited or deleted)
+     */
+    void invalidate(const std::string& messageId);
+
+    Stats stats() const;
+
+    /**
+     * Usable language name or code: letters, spaces and '-', up to 32 chars
+     */
+    static bool isValidLanguage(const std::string& language);
+
+    /**
+     * Translations from a batch reply (a JSON array of strings, possibly in a
+     * code fence); nullopt unless there is exactly one per source text
+     */
+    static std::optional<std::vector<std::string>> parseReply(const std::string& reply, size_t expected);
+
+private:
+    struct Request;
+    struct Batch;
+
+    struct Translations {
+        uint64_t sourceHash = 0;
+        std::unordered_map<std::string, std::string> byLanguage;
+    };
+
+    struct Flight {
+        std::vector<std::pair<std::shared_ptr<Request>, size_t>> waiters;   // (request, item index)
+    };
+
+    Options options_;
+    AiExecutor& executor_;
+    Generate generate_;
+    LRUCache<std::string, Translations> cache_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Flight> inFlight_;                 // flightKey -> waiters
+    std::unordered_map<std::string, std::shared_ptr<Batch>> open_;     // Language -> batch not started yet
+    Stats stats_;
+
+    void run(const std::shared_ptr<Batch>& batch);
+    void finish(const std::shared_ptr<Batch>& batch, const std::optional<std::vector<std::string>>& texts);
+    static std::string flightKey(const std::string& messageId, const std::string& language, uint64_t sourceHash);
+    static void complete(const std::shared_ptr<Request>& request, size_t index, const std::optional<std::string>& text);
+};
+
+#endif // MESSAGE_TRANSLATOR_H
@@ -0,0 +1,135 @@
+#ifndef ROOM_SUMMARIZER_H
+#define ROOM_SUMMARIZER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+#include "database/types.h"
+
+class AiExecutor;
+
+/**
+ * Room Summarizer ("catch me up")
+ *
+ * Keeps a rolling AI summary per room, updated incrementally: every
+ * blockSize new messages are folded into the previous summary by one AI call
+ * on the AI executor, so the model only ever sees summary + one block and a
+ * summarize request is answered from memory (summary + unsummarized tail).
+ *
+ * - At most one fold in flight per room; messages arriving meanwhile wait
+ *   for the next block
+ * - A failed fold keeps its messages and is retried after a pause
+ * - A room seen for the first time is seeded from its recent history; a
+ *   request whose tail does not cover everything unsummarized starts a fold
+ *   early and the requester is told when it lands
+ * - Bounded: maxPending lines per room (oldest dropped), maxRooms rooms
+ *   (least recently active evicted)
+ *
+ * Thread-safe; append() is called wherever messages are saved.
+ */
+class RoomSummarizer {
+public:
+    struct Options {
+        size_t blockSize = 50;       // Messages folded into the summary per AI call
+        size_t tailSize = 20;        // Newest unsummarized messages returned with the summary
+        size_t maxPending = 500;     // Unsummarized messages kept per room
+        size_t maxRooms = 2000;
+        size_t maxLineBytes = 500;   // Longer messages are cut before they reach the model
+        uint32_t retryDelaySeconds = 30;
+    };
+
+    struct Line {
+        std::string messageId;
+        std::string senderName;
+        std::string text;
+        uint64_t timestamp = 0;
+    };
+
+    struct Snapshot {
+        bool known = false;          // Seeded from history (see seed())
+        std::string summary;         // Empty until the first fold lands
+        uint64_t summarizedMessages = 0;
+        uint64_t updatedAt = 0;      // Unix seconds of the last fold
+        std::vector<Line> tail;      // Oldest first
+        bool updating = false;       // A fold is in flight
+    };
+
+    struct Waiter {
+        std::string userId;
+        std::string roomId;          // As the client addresses it (dm_<other> for DMs)
+    };
+
+    struct Stats {
+        uint64_t folds = 0;
+        uint64_t foldFailures = 0;
+        uint64_t foldsRejected = 0;  // AI executor queue full
+        uint64_t messagesFolded = 0;
+        uint64_t messagesDropped = 0;
+        size_t rooms = 0;
+    };
+
+    // (prompt, message) -> text, e.g. GeminiClient::generateResponse
+    using Generate = std::function<std::optional<std::string>(const std::string& prompt, const std::string& message)>;
+    // A fold finished (or failed) for a room someone is waiting on; called on the executor thread
+    using Updated = std::function<void(const std::string& roomId, const std::vector<Waiter>& waiters)>;
+
+    RoomSummarizer(Options options, AiExecutor& executor, Generate generate);
+
+    void setOnUpdated(Updated onUpdated) { onUpdated_ = std::move(onUpdated); }
+
+    /**
+     * Record a saved message (storage room ID); content may be compressed
+     */
+    void append(const Message& message);
+
+    bool isKnown(const std::string& roomId) const;
+
+    /**
+     * First request for a room: its recent history (any order). Ignored once
+     * a summary exists, since older messages can no longer be folded in order.
+     */
+    void seed(const std::string& roomId, std::vector<Message> history);
+
+    /**
+     * Current summary and tail. If the tail leaves messages out, a fold is
+     * started and waiter (if given) is passed to onUpdated when it ends.
+     */
+    Snapshot snapshot(const std::string& roomId, const std::optional<Waiter>& waiter = std::nullopt);
+
+    Stats stats() const;
+
+private:
+    struct RoomState {
+        std::string summary;
+        uint64_t summarizedMessages = 0;
+        uint64_t updatedAt = 0;
+        std::deque<Line> pending;    // Not in the summary yet, oldest first
+        std::vector<Line> folding;   // Block currently being folded
+        uint64_t retryAfter = 0;
+        uint64_t lastActive = 0;
+        std::vector<Waiter> waiters;
+        bool seeded = false;
+    };
+
+    Options options_;
+    AiExecutor& executor_;
+    Generate generate_;
+    Updated onUpdated_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, RoomState> rooms_;
+    Stats stats_;
+
+    RoomState& roomLocked(const std::string& roomId, uint64_t now);
+    void pushLocked(RoomState& state, Line line);
+    void maybeFoldLocked(const std::string& roomId, RoomState& state, bool force, uint64_t now);
+    void fold(const std::string& roomId, const std::string& previous, const std::vector<Line>& block);
+    Line toLine(const Message& message) const;
+};
+
+#endif // ROOM_SUMMARIZER_H
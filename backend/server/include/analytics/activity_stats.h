@@ -0,0 +1,97 @@
+#ifndef ACTIVITY_STATS_H
+#define ACTIVITY_STATS_H
+
+#include <string>
+#include <memory>
+#include <array>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "analytics/sketches.h"
+
+/**
+ * Activity Statistics
+ *
+ * Per-server and per-room message activity, updated at ingestion so the
+ * admin endpoint never queries the messages table.
+ *
+ * Features:
+ * - Messages per minute (last hour) and per hour (last 48 hours)
+ * - Unique active senders (HyperLogLog) over the last hour / day
+ * - Busiest rooms and top posters: count-min sketch + top-k heap over a
+ *   rolling window of the current and previous hour
+ * - Per-room minute series and unique senders, dropped after 2 idle hours
+ *   (each room shard is swept by record() every 10 minutes)
+ * - record() is lock-free apart from a per-shard room lookup
+ */
+class ActivityStats {
+public:
+    static constexpr size_t TOP_K = 20;
+
+    ActivityStats();
+
+    /**
+     * Count one message (any thread)
+     */
+    void record(const std::string& roomId, const std::string& senderId, uint64_t timestamp);
+
+    /**
+     * Server-wide summary for the admin endpoint
+     */
+    nlohmann::json serverSnapshot(uint64_t now, size_t topN = 10);
+
+    /**
+     * One room's activity, null if the room has been idle
+     */
+    nlohmann::json roomSnapshot(const std::string& roomId, uint64_t now);
+
+private:
+    // Heavy-hitter tracking for one hour; two alternate so reports cover 1-2 hours
+    struct HitterWindow {
+        HitterWindow() : roomCounts(4096), posterCounts(8192), rooms(TOP_K * 2), posters(TOP_K * 2) {}
+        std::atomic<uint64_t> hour{0};
+        sketch::CountMinSketch roomCounts;
+        sketch::CountMinSketch posterCounts;
+        sketch::TopK rooms;
+        sketch::TopK posters;
+        std::mutex rotateMutex;
+    };
+
+    struct RoomActivity {
+        RoomActivity() : minutes(60, 60), senders(6, 600, 8) {}
+        sketch::RingSeries minutes;           // 60 x 1 minute
+        sketch::WindowedHyperLogLog senders;  // 6 x 10 minutes
+        std::atomic<uint64_t> lastActive{0};
+        std::atomic<uint64_t> total{0};
+    };
+
+    static constexpr size_t ROOM_SHARDS = 16;
+    static constexpr uint64_t ROOM_IDLE_SECONDS = 2 * 3600;
+    static constexpr uint64_t PRUNE_INTERVAL_SECONDS = 600;
+
+    struct RoomShard {
+        std::unordered_map<std::string, std::shared_ptr<RoomActivity>> rooms;
+        uint64_t nextPruneAt = 0;
+        std::mutex mutex;
+    };
+
+    std::atomic<uint64_t> totalMessages_{0};
+    uint64_t startedAt_;
+    sketch::RingSeries minuteSeries_;             // 60 x 1 minute
+    sketch::RingSeries hourSeries_;               // 48 x 1 hour
+    sketch::WindowedHyperLogLog minuteSenders_;   // 60 x 1 minute
+    sketch::WindowedHyperLogLog hourSenders_;     // 24 x 1 hour
+    std::array<HitterWindow, 2> hitters_;
+    std::array<RoomShard, ROOM_SHARDS> roomShards_;
+
+    HitterWindow& hitterWindow(uint64_t hour);
+    // create: record() at timestamp, which also sweeps the shard when it is due
+    std::shared_ptr<RoomActivity> roomActivity(const std::string& roomId, uint64_t roomHash,
+                                               bool create, uint64_t timestamp = 0);
+    void pruneIdleRooms(uint64_t now);
+    static void pruneShard(RoomShard& shard, uint64_t now);   // Shard lock held
+};
+
+#endif // ACTIVITY_STATS_H
@@ -0,0 +1,150 @@
+#ifndef SKETCHES_H
+#define SKETCHES_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+/**
+ * Streaming sketches for activity analytics
+ *
+ * Fixed-size summaries updated once per message. Hot paths are lock-free
+ * (relaxed atomics); only window rotation and top-k membership take a lock.
+ * Results are approximate by design.
+ */
+namespace sketch {
+
+/**
+ * 64-bit hash of a key (std::hash finished with a splitmix64 mix so the
+ * low and high halves are independent enough for the sketches below)
+ */
+uint64_t hashKey(const std::string& key);
+
+/**
+ * HyperLogLog distinct counter, 2^precision one-byte registers
+ * (standard error ~1.04 / sqrt(2^precision))
+ */
+class HyperLogLog {
+public:
+    explicit HyperLogLog(uint8_t precision = 12);
+
+    void add(uint64_t hash);
+    double estimate() const;
+    void clear();
+
+    /**
+     * Distinct count of the union (all sketches must share a precision)
+     */
+    static double estimateUnion(const std::vector<const HyperLogLog*>& sketches);
+
+private:
+    uint8_t precision_;
+    size_t size_;
+    std::unique_ptr<std::atomic<uint8_t>[]> registers_;
+
+    static double estimateRegisters(const std::vector<uint8_t>& registers);
+};
+
+/**
+ * Count-min sketch (conservative update): per-key counts that never
+ * under-estimate
+ */
+class CountMinSketch {
+public:
+    CountMinSketch(size_t width = 2048, size_t depth = 4);  // width rounded up to a power of two
+
+    /**
+     * Add n to the key's counters, returns the key's new estimate
+     */
+    uint64_t add(uint64_t hash, uint32_t n = 1);
+    uint64_t estimate(uint64_t hash) const;
+    void clear();
+
+private:
+    size_t width_;
+    size_t depth_;
+    std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+
+    size_t cell(uint64_t hash, size_t row) const;
+};
+
+/**
+ * The k keys with the highest counts seen so far (min-heap on count).
+ * Offers below the current minimum return without locking.
+ */
+class TopK {
+public:
+    explicit TopK(size_t k);
+
+    void offer(const std::string& key, uint64_t count);
+    std::vector<std::pair<std::string, uint64_t>> items() const;  // Highest first
+    void clear();
+
+private:
+    size_t k_;
+    std::vector<std::pair<uint64_t, std::string>> heap_;  // (count, key), min at front
+    std::atomic<uint64_t> floor_{0};                      // Count to beat once full
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Ring of fixed-width time slots with a counter each (e.g. 60 x 1 minute).
+ * Each slot packs (slot number, count) into one word so a rollover and an
+ * increment never race.
+ */
+class RingSeries {
+public:
+    RingSeries(size_t slots, uint64_t slotSeconds);
+
+    void add(uint64_t now, uint32_t n = 1);
+
+    /**
+     * Last `slots` slots up to and including now, oldest first:
+     * (slot start unix time, count)
+     */
+    std::vector<std::pair<uint64_t, uint64_t>> snapshot(uint64_t now) const;
+    uint64_t total(uint64_t now, size_t lastSlots) const;
+
+private:
+    size_t slots_;
+    uint64_t slotSeconds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;  // (slot number << 32) | count
+
+    uint64_t countAt(uint64_t slot) const;
+};
+
+/**
+ * Distinct counts over a sliding window: one HyperLogLog per time slot,
+ * unioned on read
+ */
+class WindowedHyperLogLog {
+public:
+    WindowedHyperLogLog(size_t slots, uint64_t slotSeconds, uint8_t precision);
+
+    void add(uint64_t now, uint64_t hash);
+
+    /**
+     * Distinct keys in the last `lastSlots` slots (including the current one)
+     */
+    double estimate(uint64_t now, size_t lastSlots) const;
+
+private:
+    struct Slot {
+        explicit Slot(uint8_t precision) : hll(precision) {}
+        std::atomic<uint64_t> number{0};
+        HyperLogLog hll;
+        std::mutex rotateMutex;
+    };
+
+    size_t slots_;
+    uint64_t slotSeconds_;
+    std::vector<std::unique_ptr<Slot>> ring_;
+};
+
+} // namespace sketch
+
+#endif // SKETCHES_H
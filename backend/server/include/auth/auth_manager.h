@@ -5,6 +5,7 @@
 #include <memory>
 #include <optional>
 #include "../database/mysql_client.h"
+#include "../database/user_directory.h"
 
 struct UserRegistration {
     std::string username;
@@ -66,10 +67,17 @@ public:
      */
     std::shared_ptr<MySQLClient> getDatabase() { return db_; }
     
+    /**
+     * Directory kept in sync with registrations; its username filter lets
+     * registerUser skip the database lookup for unused names
+     */
+    void setUserDirectory(std::shared_ptr<UserDirectory> directory) { directory_ = directory; }
+    
 private:
     std::shared_ptr<MySQLClient> db_;
     std::string jwtSecret_;
     int jwtExpiry_;
+    std::shared_ptr<UserDirectory> directory_;
     
     std::string hashPassword(const std::string& password);
     bool verifyPassword(const std::string& password, const std::string& hash);
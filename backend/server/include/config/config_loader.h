@@ -11,6 +11,7 @@ struct Config {
     std::string mysqlUser;
     std::string mysqlPassword;
     std::string mysqlDatabase;
+    std::string messageShards;   // "host[:port][/db],..." - room messages sharded over these (empty = all here)
     
     // AWS Configuration (optional - for future)
     std::string awsAccessKey;
@@ -22,6 +23,27 @@ struct Config {
     std::string serverIP;
     int serverPort;
     std::string serverHost;
+    int roomWorkers;  // Room actor worker threads (0 = hardware concurrency)
+    std::string ioBackend;  // File I/O backend: posix | io_uring
+    std::string adminToken;  // Bearer token for /admin/* endpoints (empty = disabled)
+    int uploadMaxActive;     // Concurrent uploads server-wide
+    int uploadMaxPerUser;    // Concurrent uploads per user (or IP)
+    int uploadDiskMBps;      // Upload disk write budget, MB/s (0 = unlimited)
+    int webhookBatchMax;     // Events per webhook POST
+    int webhookBatchDelayMs; // Max wait before a partial batch is sent
+    int webhookMaxAttempts;  // Delivery attempts per batch before dead-lettering
+    std::string webhookDeadLetterPath;  // JSON Lines file for undeliverable batches
+    int warmupRooms;         // Most active rooms preloaded at startup (0 = no warm-up)
+    std::string cpuLoop;         // CPU lists ("0-3,8" or "node0"); empty = not pinned
+    std::string cpuRoomWorkers;
+    std::string cpuBackground;
+    bool lockProfiling;          // Record mutex wait/hold times (needs a CHATBOX_LOCK_PROFILING build)
+    bool loadShedding;           // Degrade optional work when the event loop lags
+    std::string loadLagMs;       // Loop lag thresholds for the three degradation levels, "50,150,400"
+    bool linkPreviews;           // Fetch a preview card for the first link of a message
+    int linkPreviewTimeoutMs;    // Whole fetch, redirects included
+    int linkPreviewMaxBytes;     // HTML read per page (reading stops at </head>)
+    bool linkPreviewAllowPrivate;  // Allow private/loopback hosts (local testing only)
     
     // JWT Configuration
     std::string jwtSecret;
@@ -29,6 +51,14 @@ struct Config {
     
     // Gemini AI
     std::string geminiApiKey;
+    std::string geminiApiEndpoint;  // generateContent URL; empty = Google's (override for a local stand-in)
+    int aiWorkers;                  // Threads for AI calls (ai_request, room summaries)
+    int aiSummaryBlock;             // New messages folded into a room summary per AI call
+    bool semanticSearch;            // Embedding index for semantic_search (needs the API key)
+    std::string embeddingApiEndpoint;  // batchEmbedContents URL; empty = Google's
+    int embeddingDimensions;        // Vector size; changing it rebuilds the index
+    std::string semanticIndexDir;   // One HNSW file per message shard
+    int semanticBackfillDays;       // How far back an empty index is filled
     
     // Debug
     bool debug;
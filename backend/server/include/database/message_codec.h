@@ -0,0 +1,60 @@
+#ifndef MESSAGE_CODEC_H
+#define MESSAGE_CODEC_H
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include "types.h"
+
+/**
+ * Message Codec
+ *
+ * Transparent zlib compression of large messages.content / metadata values.
+ *
+ * - Values of MIN_BYTES or more are compressed on write into content_z /
+ *   metadata_z, with a bit in messages.compressed; smaller values, and values
+ *   that do not shrink by at least 10%, are stored as before
+ * - Blobs use MySQL's COMPRESS() layout (4-byte little-endian length + zlib
+ *   stream), so SQL can still UNCOMPRESS() them, e.g. for LIKE search
+ * - Reads keep the compressed bytes (Message::compressed says which fields);
+ *   inflate() runs only when a message is actually serialized for a client,
+ *   so cached history stays small
+ * - Process-wide counters of bytes saved and inflate time for /admin/stats
+ */
+namespace message_codec {
+
+constexpr size_t MIN_BYTES = 1024;
+
+/**
+ * Compressed blob for value, or nullopt if it is below MIN_BYTES or does not
+ * compress well enough to be worth storing compressed
+ */
+std::optional<std::string> compress(const std::string& value);
+
+/**
+ * Original value of a compress() blob, or nullopt if the blob is corrupt
+ */
+std::optional<std::string> decompress(const std::string& blob);
+
+/**
+ * Replace compressed fields of message with their original text (no-op for
+ * uncompressed messages). A corrupt field becomes empty and is logged.
+ */
+void inflate(Message& message);
+
+/**
+ * Running totals since start: write-side savings and read-side cost
+ */
+struct Stats {
+    uint64_t valuesCompressed = 0;  // Fields stored compressed
+    uint64_t valuesSkipped = 0;     // Large enough but did not shrink 10%
+    uint64_t rawBytes = 0;          // Original size of compressed fields
+    uint64_t storedBytes = 0;       // Their size on disk
+    uint64_t valuesInflated = 0;
+    uint64_t inflateMicros = 0;     // Total time spent in inflate()
+};
+Stats stats();
+
+} // namespace message_codec
+
+#endif // MESSAGE_CODEC_H
@@ -0,0 +1,79 @@
+#ifndef MESSAGE_EXPIRY_INDEX_H
+#define MESSAGE_EXPIRY_INDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * Message Expiry Index (disappearing messages)
+ *
+ * Upcoming expiries grouped into fixed-width time buckets, so the purge job
+ * pops whole due buckets instead of scanning the messages table or running
+ * one timer per message.
+ *
+ * - Only expiries before the horizon are held in memory; the purge job
+ *   extends the horizon from messages.idx_expires as time advances
+ * - Per-room TTL settings (storage roomId -> seconds)
+ * - Thread-safe: fed from room actors, drained by the purge thread
+ */
+class MessageExpiryIndex {
+public:
+    struct Entry {
+        std::string messageId;
+        std::string roomId;
+        uint64_t expiresAt = 0;
+    };
+
+    explicit MessageExpiryIndex(uint64_t bucketSeconds = 60);
+
+    // ---- Room TTLs ----
+    void setRoomTtl(const std::string& roomId, uint32_t ttlSeconds);  // 0 = off
+    uint32_t roomTtl(const std::string& roomId) const;
+
+    /**
+     * Expiry time for a message created now in roomId, 0 if the room has no TTL
+     */
+    uint64_t deadlineFor(const std::string& roomId, uint64_t createdAt) const;
+
+    // ---- Expiry buckets ----
+    /**
+     * Track a message; ignored if it expires past the horizon (loaded later)
+     */
+    void add(const std::string& messageId, const std::string& roomId, uint64_t expiresAt);
+
+    /**
+     * Set the horizon; returns the previous one. Callers then load
+     * [previous, newHorizon) from the database and add() it, or set it
+     * back to the previous value if that load fails.
+     */
+    uint64_t setHorizon(uint64_t newHorizon);
+    uint64_t horizon() const;
+
+    /**
+     * Remove and return up to maxEntries entries with expiresAt <= now
+     */
+    std::vector<Entry> takeDue(uint64_t now, size_t maxEntries);
+
+    /**
+     * Put entries back (purge failed; retried on the next pass)
+     */
+    void restore(const std::vector<Entry>& entries);
+
+    size_t size() const;
+
+private:
+    uint64_t bucketSeconds_;
+    uint64_t horizon_ = 0;
+    size_t size_ = 0;
+    std::map<uint64_t, std::vector<Entry>> buckets_;  // bucket start -> entries
+    std::unordered_map<std::string, uint32_t> roomTtls_;
+    mutable std::mutex mutex_;
+
+    void insertLocked(Entry entry);
+};
+
+#endif // MESSAGE_EXPIRY_INDEX_H
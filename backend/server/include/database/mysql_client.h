@@ -4,8 +4,12 @@
 #include <optional>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <unordered_map>
 #include <mysqlx/xdevapi.h>  // Full include needed for templates
 #include "types.h"
+#include "database/shard_map.h"
+#include "utils/lru_cache.h"
 
 class MySQLClient {
 public:
@@ -15,10 +19,22 @@ public:
                 const std::string& database,
                 int port = 33060);  // mysqlx port
     ~MySQLClient();
-    bool connect();
+    bool connect(bool runMigrations = true);
     void disconnect();
     bool isConnected() const;
     
+    // New connection with the same credentials (sessions are not thread-safe,
+    // so each worker thread gets its own)
+    std::unique_ptr<MySQLClient> createWorkerConnection() const;
+    
+    // Message shards (MESSAGE_SHARDS): after this, messages, reads, pins and polls
+    // live on the shard that owns their room; users, rooms and DMs stay here.
+    // Each shard must already have schema.sql applied; migrations run on connect.
+    bool connectShards(const std::vector<ShardEndpoint>& shards, bool runMigrations = true);
+    size_t shardCount() const { return shards_.size(); }
+    // Shard index owning a room (0 when not sharded)
+    size_t shardForRoom(const std::string& roomId) const;
+    
     // Users
     bool createUser(const User& user);
     std::optional<User> getUser(const std::string& username);
@@ -36,22 +52,83 @@ public:
     bool deleteSession(const std::string& sessionId);
     
     // Messages
-    bool createMessage(const Message& message);
+    bool createMessage(const Message& message);  // False if the message ID already exists
+    // Several new messages (no replies) in one multi-row INSERT IGNORE; created_at defaults to now.
+    // Like createMessage, false if any message ID already existed
+    bool createMessages(const std::vector<Message>& messages);
     std::optional<Message> getMessage(const std::string& messageId);
+    // Several messages by ID in one query per shard, any order; missing and soft-deleted ones left out
+    std::vector<Message> getMessagesByIds(const std::vector<std::string>& messageIds);
+    // Visit live messages created at or after fromTimestamp, oldest first, in keyset batches
+    // (shards one after another). onRow returns false to stop. False on a database error.
+    bool forEachMessageSince(uint64_t fromTimestamp,
+                             const std::function<bool(const Message&)>& onRow,
+                             int batchSize = 1000);
     std::vector<Message> getMessagesByRoom(const std::string& roomId, int limit = 50);
+    // getMessagesByRoom for several rooms in one query; every requested room gets an entry
+    std::unordered_map<std::string, std::vector<Message>> getMessagesByRooms(const std::vector<std::string>& roomIds,
+                                                                             int limitPerRoom = 50);
+    // Stored room IDs (DM conversation IDs included) with the most messages in the last withinDays
+    std::vector<std::string> getActiveRoomIds(size_t limit, int withinDays = 7);
     std::vector<Message> getRecentMessages(const std::string& roomId, int limit = 50, int offset = 0);
     std::vector<Message> getMessageReplies(const std::string& messageId, int limit = 50);
+    // Keyset-paginated thread replies (oldest first), strictly after (afterTimestamp, afterMessageId)
+    std::vector<Message> getThreadReplies(const std::string& parentId,
+                                          uint64_t afterTimestamp,
+                                          const std::string& afterMessageId,
+                                          int limit = 50);
+    // Visit every message of a room oldest-first, fetched in keyset batches of batchSize
+    // (memory stays flat for any room size). onRow returns false to stop early.
+    // Returns false on a database error.
+    bool forEachRoomMessage(const std::string& roomId,
+                            const std::function<bool(const Message&)>& onRow,
+                            int batchSize = 1000);
+    uint64_t countRoomMessages(const std::string& roomId);
+    
+    // Bulk import: one multi-row INSERT IGNORE, created_at taken from each message's timestamp.
+    // Returns rows inserted (duplicates skipped), or -1 on error. Reply counts are not touched;
+    // call recomputeReplyCounts() for the affected rooms afterwards.
+    int64_t insertMessagesBulk(const std::vector<Message>& messages);
+    bool recomputeReplyCounts(const std::string& roomId);
+    // Drop (false) / rebuild (true) the messages secondary indexes around an offline bulk load
+    bool setMessageSecondaryIndexes(bool enabled);
+    // Disappearing messages: visit (messageId, roomId, expiresAt) with expires_at in
+    // [fromTimestamp, toTimestamp), oldest first; hard-delete a batch (and its pins)
+    bool forEachExpiringMessage(uint64_t fromTimestamp, uint64_t toTimestamp,
+                                const std::function<void(const std::string&, const std::string&, uint64_t)>& onRow,
+                                int batchSize = 1000);
+    int64_t deleteMessagesByIds(const std::vector<std::string>& messageIds);
+    // Read receipts: one multi-row upsert into message_reads
+    bool markMessagesRead(const std::string& userId, const std::vector<std::string>& messageIds);
     std::vector<Message> searchMessages(const std::string& query, const std::string& roomId = "", int limit = 50);
     bool deleteMessage(const std::string& messageId);
+    // Keep the row but flag it deleted (roomId routes to the shard)
+    bool softDeleteMessage(const std::string& messageId, const std::string& roomId);
+    // Edit: new content (compressed if large), only if senderId wrote the message
+    bool updateMessageContent(const std::string& messageId, const std::string& senderId, const std::string& content);
+    // Replace the metadata JSON (compressed if large), e.g. to attach a link preview
+    bool updateMessageMetadata(const std::string& messageId, const std::string& metadata);
+    // Set one top-level metadata key (an identifier; valueJson is JSON) in place, leaving the other keys
+    // alone; returns the new metadata, nullopt if not found or metadata is stored compressed
+    std::optional<std::string> setMessageMetadataKey(const std::string& messageId, const std::string& key,
+                                                     const std::string& valueJson);
     
     // Rooms
     bool createRoom(const Room& room);
     std::optional<Room> getRoom(const std::string& roomId);
+    std::vector<std::string> getChannelRoomIds();
+    std::vector<std::string> getAllRoomIds();  // Rooms + DM conversation IDs
     bool updateRoom(const Room& room);
     bool deleteRoom(const std::string& roomId);
     bool addRoomMember(const std::string& roomId, const std::string& userId);
     bool removeRoomMember(const std::string& roomId, const std::string& userId);
     std::vector<std::string> getRoomMembers(const std::string& roomId);
+    // Rooms the user is a member of plus their DM conversation IDs
+    std::vector<std::string> getUserRoomIds(const std::string& userId);
+    // Members with profile fields in one query (avoids getUserById per member)
+    std::vector<User> getRoomMemberProfiles(const std::string& roomId);
+    // getRoomMemberProfiles for several rooms in one query; every requested room gets an entry
+    std::unordered_map<std::string, std::vector<User>> getRoomMemberProfilesByRooms(const std::vector<std::string>& roomIds);
     
     // Room Roles & Permissions
     bool setMemberRole(const std::string& roomId, const std::string& userId, const std::string& role);
@@ -84,9 +161,22 @@ public:
     bool closePoll(const std::string& pollId);
     bool deletePoll(const std::string& pollId);
     
+    // Disappearing messages: per-room TTL, 0 = off (room_id may be a DM conversation_id)
+    bool setRoomMessageTtl(const std::string& roomId, uint32_t ttlSeconds);
+    std::vector<std::pair<std::string, uint32_t>> getRoomMessageTtls();
+    
+    // Outbound webhooks
+    bool createRoomWebhook(const RoomWebhook& webhook);
+    bool deleteRoomWebhook(const std::string& webhookId, const std::string& roomId);
+    std::vector<RoomWebhook> getRoomWebhooks();
+    
     // DM Conversations (Discord/Telegram style)
     // Returns existing conversation_id or creates a new one
     std::string getOrCreateDmConversation(const std::string& userId1, const std::string& userId2);
+    std::optional<std::pair<std::string, std::string>> getDmParticipants(const std::string& conversationId);
+    // conversation_id -> (user1_id, user2_id) for the conversations found
+    std::unordered_map<std::string, std::pair<std::string, std::string>> getDmParticipantsByIds(
+        const std::vector<std::string>& conversationIds);
     
     // Direct session access for custom queries
     std::shared_ptr<mysqlx::Session> getSession() { return session_; }
@@ -100,5 +190,20 @@ private:
     
     std::shared_ptr<mysqlx::Session> session_;
     
+    // Message shards; each is an unsharded client with its own session
+    std::vector<ShardEndpoint> shardEndpoints_;
+    std::vector<std::unique_ptr<MySQLClient>> shards_;
+    std::shared_ptr<const ShardRing> ring_;
+    // "messages:<id>" / "polls:<id>" -> shard, shared with worker connections
+    std::shared_ptr<LRUCache<std::string, size_t>> rowShards_;
+    
+    MySQLClient& shardFor(const std::string& roomId);
+    // Shards holding the given message/poll IDs (cached, else one parallel lookup); unknown IDs are left out
+    std::unordered_map<size_t, std::vector<std::string>> locateRows(const char* table, const char* idColumn,
+                                                                    const std::vector<std::string>& ids);
+    std::optional<size_t> locateRow(const char* table, const char* idColumn, const std::string& id);
+    std::vector<std::string> existingIds(const char* table, const char* idColumn, const std::vector<std::string>& ids);
+    std::vector<std::pair<std::string, uint64_t>> getActiveRoomCounts(size_t limit, int withinDays);
+    
     void handleException(const std::exception& e, const std::string& context);
 };
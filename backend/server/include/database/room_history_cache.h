@@ -0,0 +1,114 @@
+#ifndef ROOM_HISTORY_CACHE_H
+#define ROOM_HISTORY_CACHE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <optional>
+#include <array>
+#include <cstdint>
+#include "types.h"
+
+/**
+ * Room History Cache
+ *
+ * Keeps the most recent messages of hot rooms in memory so that
+ * room joins do not hit MySQL for every user.
+ *
+ * - Keyed by storage roomId (DM conversation_id for DMs)
+ * - LRU eviction over rooms, fixed window of messages per room
+ * - Updated in place on ingestion (new messages, replies, edits)
+ * - Every update bumps the room's version, cached or not, so a database
+ *   read that raced an update is not stored (see version() / put())
+ */
+class RoomHistoryCache {
+public:
+    explicit RoomHistoryCache(size_t maxRooms = 256, size_t maxMessagesPerRoom = 50);
+
+    /**
+     * Get cached history (oldest first), or nullopt on miss
+     */
+    std::optional<std::vector<Message>> get(const std::string& roomId);
+
+    /**
+     * Store history loaded from the database (oldest first)
+     */
+    void put(const std::string& roomId, const std::vector<Message>& messages);
+
+    /**
+     * Version to pass to put() when loading a room: read it before the
+     * database query
+     */
+    uint64_t version(const std::string& roomId) const;
+
+    /**
+     * Store history only if the room was not updated since version() was read
+     * @return false if the load raced an update and was dropped
+     */
+    bool put(const std::string& roomId, const std::vector<Message>& messages, uint64_t expectedVersion);
+
+    /**
+     * Append a newly ingested message (no-op if room is not cached)
+     */
+    void append(const Message& message);
+
+    /**
+     * Bump the materialized reply count of a cached parent message
+     * @return new reply count if the parent is cached
+     */
+    std::optional<uint32_t> recordReply(const std::string& roomId,
+                                        const std::string& parentId,
+                                        uint64_t timestamp);
+
+    /**
+     * Update content of a cached message after an edit
+     */
+    void updateContent(const std::string& roomId,
+                       const std::string& messageId,
+                       const std::string& content);
+
+    /**
+     * Update metadata of a cached message (e.g. an attached link preview)
+     */
+    void updateMetadata(const std::string& roomId,
+                        const std::string& messageId,
+                        const std::string& metadata);
+
+    /**
+     * Remove expired / purged messages from a cached room
+     */
+    void removeMessages(const std::string& roomId, const std::vector<std::string>& messageIds);
+
+    /**
+     * Drop a room from the cache (next read reloads from database)
+     */
+    void invalidate(const std::string& roomId);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::deque<Message> messages;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    // Rooms share version stripes; a collision only costs a skipped put
+    static constexpr size_t VERSION_STRIPES = 1024;
+
+    size_t maxRooms_;
+    size_t maxMessagesPerRoom_;
+    std::array<uint64_t, VERSION_STRIPES> versions_{};
+    std::unordered_map<std::string, Entry> rooms_;
+    std::list<std::string> lru_;  // Front = most recently used
+    mutable std::mutex mutex_;
+
+    uint64_t& versionOf(const std::string& roomId);
+    void store(const std::string& roomId, const std::vector<Message>& messages);
+    void touch(Entry& entry);
+    Message* findMessage(Entry& entry, const std::string& messageId);
+};
+
+#endif // ROOM_HISTORY_CACHE_H
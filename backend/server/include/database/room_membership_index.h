@@ -0,0 +1,110 @@
+#ifndef ROOM_MEMBERSHIP_INDEX_H
+#define ROOM_MEMBERSHIP_INDEX_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <utility>
+#include "types.h"
+
+/**
+ * Room Membership Index
+ *
+ * In-memory view of room_members joined with user profiles, so member
+ * counts and member pages never touch MySQL once a room is loaded.
+ *
+ * - Rooms are loaded lazily from the database on first use; at most
+ *   maxRooms stay loaded, the least recently used is dropped beyond that
+ * - Members kept sorted by (lowercase username, userId), split online/offline
+ * - Online state is per user (reference counted over connections)
+ * - Cursor-based pages, online members first, optional username prefix
+ */
+class RoomMembershipIndex {
+public:
+    struct Member {
+        std::string userId;
+        std::string username;
+        std::string avatar;
+        bool online = false;
+    };
+
+    struct Page {
+        std::vector<Member> members;
+        std::string nextCursor;  // Empty when there are no more members
+    };
+
+    static constexpr size_t DEFAULT_MAX_ROOMS = 20000;
+
+    explicit RoomMembershipIndex(size_t maxRooms = DEFAULT_MAX_ROOMS);
+
+    bool hasRoom(const std::string& roomId) const;
+    size_t roomCount() const;
+
+    /**
+     * Replace a room's members with rows loaded from the database
+     */
+    void loadRoom(const std::string& roomId, const std::vector<User>& members);
+
+    void addMember(const std::string& roomId, const User& user);
+    void removeMember(const std::string& roomId, const std::string& userId);
+
+    /**
+     * Update profile fields of a user in every loaded room
+     */
+    void updateProfile(const std::string& userId, const std::string& username, const std::string& avatar);
+
+    /**
+     * Track connections per user; a user is online while at least one is open
+     */
+    void userConnected(const std::string& userId);
+    void userDisconnected(const std::string& userId);
+    bool isOnline(const std::string& userId) const;
+
+    size_t memberCount(const std::string& roomId) const;
+    size_t onlineCount(const std::string& roomId) const;
+    bool isMember(const std::string& roomId, const std::string& userId) const;
+
+    /**
+     * User IDs of a loaded room's members (empty if the room is not loaded)
+     */
+    std::unordered_set<std::string> memberIds(const std::string& roomId) const;
+
+    /**
+     * Page through members, online first, each group sorted by username
+     * @param cursor nextCursor of the previous page (empty for first page)
+     * @param prefix case-insensitive username prefix (empty for all)
+     */
+    Page getPage(const std::string& roomId, const std::string& cursor,
+                 size_t limit, const std::string& prefix = "") const;
+
+private:
+    using Key = std::pair<std::string, std::string>;  // (lowercase username, userId)
+
+    struct RoomEntry {
+        std::unordered_map<std::string, Member> members;  // userId -> member
+        std::set<Key> online;
+        std::set<Key> offline;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    size_t maxRooms_;
+    std::unordered_map<std::string, RoomEntry> rooms_;
+    mutable std::list<std::string> lru_;  // Loaded room IDs, most recently used first
+    std::unordered_map<std::string, std::unordered_set<std::string>> userRooms_;  // userId -> loaded rooms
+    std::unordered_map<std::string, int> connectionCounts_;                        // userId -> open sockets
+    mutable std::mutex mutex_;
+
+    static std::string toLower(const std::string& s);
+    static Key keyOf(const Member& member);
+    void insertLocked(RoomEntry& room, const std::string& roomId, Member member);
+    void eraseLocked(RoomEntry& room, const std::string& roomId, const std::string& userId);
+    void setOnlineLocked(const std::string& userId, bool online);
+    void touchLocked(const RoomEntry& room) const;
+    void evictLocked();
+};
+
+#endif // ROOM_MEMBERSHIP_INDEX_H
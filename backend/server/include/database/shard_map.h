@@ -0,0 +1,55 @@
+#ifndef SHARD_MAP_H
+#define SHARD_MAP_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+ * Message shard map
+ *
+ * Places each room's messages (and its reads, pins and polls) on one of N
+ * MySQL instances by consistent hashing of the storage room ID. Users, rooms,
+ * members, DMs and other metadata stay on the directory database.
+ *
+ * Every shard owns VNODES points on a 64-bit ring; a room belongs to the
+ * first point at or after its hash. Points are derived from the shard's
+ * position in the list (not its host), so a shard can move to a new host
+ * without moving rooms, and appending a shard moves only ~1/N of them.
+ * Never reorder or remove entries of a live list.
+ */
+struct ShardEndpoint {
+    std::string host;
+    int port = 33060;
+    std::string database;
+
+    std::string label() const { return host + ":" + std::to_string(port) + "/" + database; }
+};
+
+/**
+ * Parse "host[:port][/database],..." (MESSAGE_SHARDS); missing parts take the
+ * directory's port and database. Returns an empty list on a malformed entry.
+ */
+std::vector<ShardEndpoint> parseShardList(const std::string& spec, int defaultPort,
+                                          const std::string& defaultDatabase);
+
+class ShardRing {
+public:
+    static constexpr size_t VNODES = 128;
+
+    explicit ShardRing(size_t shardCount);
+
+    size_t shardFor(std::string_view roomId) const;
+    size_t size() const { return shardCount_; }
+
+    // Stable across builds and platforms (std::hash is not), so placement survives upgrades
+    static uint64_t hash(std::string_view key);
+
+private:
+    size_t shardCount_;
+    std::vector<std::pair<uint64_t, size_t>> points_;  // (ring position, shard), sorted
+};
+
+#endif // SHARD_MAP_H
@@ -12,6 +12,7 @@ struct User {
     std::string email;
     std::string passwordHash;
     std::string avatarUrl; // New field for local avatar
+    std::string displayName;
     uint64_t createdAt;
     UserStatus status;  // From protocol_chatbox1.h
     std::string statusMessage;
@@ -37,6 +38,14 @@ struct Message {
     std::string replyToId;
     uint64_t timestamp;
     std::string metadata;  // JSON string for file attachments, voice, etc.
+    uint32_t replyCount = 0;   // Materialized thread size (maintained at ingestion)
+    uint64_t lastReplyAt = 0;  // Unix timestamp of the newest reply, 0 if none
+    uint64_t expiresAt = 0;    // Unix timestamp when the room TTL removes it, 0 = never
+    
+    // Fields still holding zlib bytes as read from storage (see database/message_codec.h)
+    static constexpr uint8_t CONTENT_COMPRESSED = 1;
+    static constexpr uint8_t METADATA_COMPRESSED = 2;
+    uint8_t compressed = 0;
 };
 
 // Room structure
@@ -44,6 +53,7 @@ struct Room {
     std::string roomId;
     std::string name;
     std::string creatorId;
+    std::string roomType = "public";  // public | private | dm | channel
     std::vector<std::string> memberIds;
 };
 
@@ -87,3 +97,12 @@ struct PollVote {
     std::string userId;
     std::string username;
 };
+
+// Outbound webhook subscription (new messages in roomId are POSTed to url)
+struct RoomWebhook {
+    std::string webhookId;
+    std::string roomId;
+    std::string url;
+    std::string secret;     // HMAC-SHA256 signing key, empty = unsigned
+    std::string createdBy;
+};
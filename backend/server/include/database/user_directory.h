@@ -0,0 +1,91 @@
+#ifndef USER_DIRECTORY_H
+#define USER_DIRECTORY_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include "types.h"
+#include "utils/bloom_filter.h"
+
+/**
+ * User Directory
+ *
+ * In-memory index of all users for search_users, so lookups never scan the
+ * users table.
+ *
+ * - Sorted (lowercase name, userId) index over usernames and display names;
+ *   a prefix match is one ordered range
+ * - Top-K search: exact username first, then online users, then shorter names
+ * - Cursor-based alphabetical listing when no query is given
+ * - Bloom filter on lowercase usernames: registration skips the database
+ *   lookup when a name is definitely unused
+ */
+class UserDirectory {
+public:
+    struct Entry {
+        std::string userId;
+        std::string username;
+        std::string displayName;
+        std::string avatar;
+        std::string statusMessage;
+        bool online = false;
+    };
+
+    struct Page {
+        std::vector<Entry> users;
+        std::string nextCursor;  // Empty when there are no more users
+    };
+
+    using OnlineCheck = std::function<bool(const std::string& userId)>;
+
+    /**
+     * Replace the directory with users loaded from the database
+     */
+    void load(const std::vector<User>& users);
+    bool isLoaded() const;
+
+    void addUser(const User& user);
+    void updateProfile(const std::string& userId, const std::string& displayName,
+                       const std::string& avatar, const std::string& statusMessage);
+
+    /**
+     * False only if no user has this username (case-insensitive). Before
+     * load() every name is reported as possibly taken.
+     */
+    bool mayHaveUsername(const std::string& username) const;
+
+    /**
+     * Best `limit` users whose username or display name starts with query
+     */
+    std::vector<Entry> search(const std::string& query, size_t limit,
+                              const std::string& excludeUserId, const OnlineCheck& isOnline) const;
+
+    /**
+     * All users by username
+     * @param cursor nextCursor of the previous page (empty for first page)
+     */
+    Page list(const std::string& cursor, size_t limit, const OnlineCheck& isOnline) const;
+
+    size_t size() const;
+
+private:
+    using Key = std::pair<std::string, std::string>;  // (lowercase name, userId)
+
+    static constexpr size_t MAX_SEARCH_CANDIDATES = 2000;  // Range scanned before ranking
+
+    std::unordered_map<std::string, Entry> users_;  // userId -> entry
+    std::set<Key> usernames_;
+    std::set<Key> displayNames_;
+    BloomFilter usernameFilter_;
+    bool loaded_ = false;
+    mutable std::mutex mutex_;
+
+    static std::string toLower(const std::string& s);
+    void insertLocked(Entry entry);
+};
+
+#endif // USER_DIRECTORY_H
@@ -7,6 +7,7 @@
 #include <vector>
 #include <mutex>
 #include <functional>
+#include "utils/lock_profiler.h"
 
 class PubSubBroker;
 
@@ -132,7 +133,7 @@ private:
     SignalCallback sendToUserCallback_;  // Direct WebSocket delivery
     std::unordered_map<std::string, CallSession> calls_;     // callId -> session
     std::unordered_map<std::string, std::string> userCalls_; // userId -> callId
-    std::mutex mutex_;
+    ProfiledMutex mutex_{"webrtc"};
     
     std::string generateCallId();
     void broadcastToParticipants(const CallSession& session, 
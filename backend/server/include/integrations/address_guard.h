@@ -0,0 +1,44 @@
+#ifndef ADDRESS_GUARD_H
+#define ADDRESS_GUARD_H
+
+#include <string>
+
+struct sockaddr;
+
+/**
+ * Address Guard
+ *
+ * Keeps server-side requests to user-supplied URLs (link previews, webhooks)
+ * away from internal addresses: loopback, RFC 1918, CGNAT, link-local (cloud
+ * metadata at 169.254.169.254), unique-local, multicast and reserved ranges.
+ *
+ * - restrictToPublic() makes curl check every address it connects to, after
+ *   DNS and on every redirect, so a public name that resolves to a private
+ *   address is refused too
+ * - isPrivateHost() is the cheap up-front check when a URL is registered:
+ *   IP literals in those ranges and "localhost"
+ */
+namespace address_guard {
+
+bool isPrivateAddress(const struct sockaddr* addr);
+
+/**
+ * Host of an http(s) URL, lower-case, without port or IPv6 brackets ("" if none)
+ */
+std::string hostOf(const std::string& url);
+
+/**
+ * True for private IP literals and localhost; other names are only known to
+ * be safe once resolved (restrictToPublic)
+ */
+bool isPrivateHost(const std::string& host);
+
+/**
+ * Refuse connections to private addresses on a curl easy handle (CURL*);
+ * such requests fail with CURLE_COULDNT_CONNECT
+ */
+void restrictToPublic(void* easy);
+
+} // namespace address_guard
+
+#endif // ADDRESS_GUARD_H
@@ -0,0 +1,140 @@
+#ifndef LINK_UNFURLER_H
+#define LINK_UNFURLER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "utils/lru_cache.h"
+
+struct LinkPreview {
+    std::string url;          // Final URL after redirects
+    std::string title;
+    std::string description;
+    std::string image;        // Absolute URL
+    std::string siteName;
+};
+
+/**
+ * Link Unfurler
+ *
+ * Fetches link previews once on the server instead of once per client. One
+ * background thread drives all fetches through a curl multi handle.
+ *
+ * Features:
+ * - Shared cache keyed by normalized URL (lower-case scheme/host, default
+ *   port, fragment and utm_* / fbclid / gclid dropped); failures are cached
+ *   for a shorter time so a dead link is not retried for every message
+ * - Single-flight: concurrent requests for one URL share a single fetch
+ * - Bounded: at most maxConcurrent fetches, maxQueued waiting, beyond that
+ *   requests are dropped (no preview)
+ * - Strict limits: connect/total timeouts, maxBytes of body (reading stops
+ *   at </head>), maxRedirects, http/https only, HTML only
+ * - Private, loopback and link-local addresses are refused at connect time
+ *   (after DNS and on every redirect) unless allowPrivateHosts is set, e.g.
+ *   for a local test server
+ *
+ * Preview fields come from Open Graph / Twitter meta tags, then <title> and
+ * <meta name="description">.
+ */
+class LinkUnfurler {
+public:
+    struct Options {
+        size_t maxConcurrent = 16;
+        size_t maxQueued = 1000;
+        uint32_t connectTimeoutMs = 2000;
+        uint32_t requestTimeoutMs = 5000;
+        size_t maxBytes = 256 * 1024;
+        long maxRedirects = 3;
+        size_t cacheEntries = 10000;
+        uint32_t cacheTtlSeconds = 6 * 3600;
+        uint32_t failureTtlSeconds = 600;
+        bool allowPrivateHosts = false;
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t cacheHits = 0;
+        uint64_t coalesced = 0;   // Joined a fetch already in flight
+        uint64_t fetched = 0;     // Fetches that produced a preview
+        uint64_t failed = 0;      // Errors, timeouts, non-HTML, nothing to show
+        uint64_t dropped = 0;     // Queue full
+        size_t inFlight = 0;
+        size_t queued = 0;
+    };
+
+    // Called once per request, from the worker thread (or inline on a cache hit)
+    using Callback = std::function<void(const std::optional<LinkPreview>& preview)>;
+
+    explicit LinkUnfurler(Options options);
+    ~LinkUnfurler();
+
+    LinkUnfurler(const LinkUnfurler&) = delete;
+    LinkUnfurler& operator=(const LinkUnfurler&) = delete;
+
+    void start();
+    /**
+     * Stop the worker; pending callbacks are dropped
+     */
+    void stop();
+
+    /**
+     * Preview for url, from cache or fetched. Returns false (and never calls
+     * back) if the URL is not fetchable or the queue is full.
+     */
+    bool unfurl(const std::string& url, Callback callback);
+
+    Stats stats() const;
+
+    // ---- Helpers (public for reuse) ----
+
+    /**
+     * http(s) URLs in message text, in order, at most maxUrls
+     */
+    static std::vector<std::string> extractUrls(const std::string& text, size_t maxUrls);
+
+    /**
+     * Cache key form of a URL; empty if it is not an http(s) URL
+     */
+    static std::string normalizeUrl(const std::string& url);
+
+    /**
+     * Preview from an HTML document fetched from url; nullopt if it has neither title nor description
+     */
+    static std::optional<LinkPreview> parseHtml(const std::string& html, const std::string& url);
+
+private:
+    struct Fetch;
+    struct CacheEntry {
+        std::optional<LinkPreview> preview;
+        uint64_t expiresAtMs = 0;
+    };
+
+    Options options_;
+    void* multi_ = nullptr;  // CURLM*, owned by the worker once started
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    LRUCache<std::string, CacheEntry> cache_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<Callback>> waiting_;  // Normalized URL -> callers
+    std::deque<std::string> queue_;                                   // Not started yet
+    std::unordered_map<void*, std::unique_ptr<Fetch>> active_;        // CURL* -> fetch, worker thread only
+    Stats stats_;
+
+    void run();
+    void launchQueued();
+    void collectFinished();
+    void complete(const std::string& key, const std::optional<LinkPreview>& preview);
+    static uint64_t nowMs();
+};
+
+#endif // LINK_UNFURLER_H
@@ -0,0 +1,123 @@
+#ifndef WEBHOOK_DISPATCHER_H
+#define WEBHOOK_DISPATCHER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "database/types.h"
+
+/**
+ * Webhook Dispatcher
+ *
+ * Delivers room events to subscribed HTTP endpoints without ever blocking
+ * the message path: publish() only queues, one background thread drives all
+ * requests through a curl multi handle.
+ *
+ * Features:
+ * - Per-room subscriptions (RoomWebhook), each endpoint with its own queue
+ * - Batching per endpoint: a POST goes out when maxBatchEvents are queued or
+ *   the oldest event has waited maxBatchDelayMs
+ * - One request in flight per endpoint, so events arrive in order
+ * - Bounded retries with exponential backoff and jitter for network errors,
+ *   408, 429 and 5xx; other 4xx fail immediately
+ * - Dead-letter file (JSON Lines) for batches that exhaust their retries,
+ *   events dropped from a full queue, and anything undelivered at shutdown
+ * - X-ChatBox-Signature: sha256=<HMAC of the body> when the webhook has a secret
+ * - Private, loopback and link-local addresses are refused at connect time
+ *   (after DNS) unless allowPrivateHosts is set; redirects are not followed
+ *
+ * Request body:
+ *   {"webhookId": "...", "roomId": "...", "deliveryId": "...", "events": [ ... ]}
+ * deliveryId stays the same across retries of one batch.
+ */
+class WebhookDispatcher {
+public:
+    struct Options {
+        size_t maxBatchEvents = 50;
+        uint32_t maxBatchDelayMs = 1000;
+        uint32_t maxAttempts = 5;              // Per batch, including the first
+        uint32_t baseBackoffMs = 1000;         // Doubles per failed attempt
+        uint32_t maxBackoffMs = 60000;
+        uint32_t requestTimeoutMs = 10000;
+        size_t maxPendingPerEndpoint = 10000;  // Oldest events are dead-lettered beyond this
+        size_t maxConcurrentRequests = 32;
+        std::string deadLetterPath = "./data/webhooks-dead-letter.jsonl";
+        bool allowPrivateHosts = false;        // Only for local receivers, e.g. tests
+    };
+
+    struct Stats {
+        uint64_t eventsDelivered = 0;
+        uint64_t batchesDelivered = 0;
+        uint64_t retries = 0;
+        uint64_t eventsDeadLettered = 0;
+        size_t eventsPending = 0;
+        size_t endpoints = 0;
+    };
+
+    explicit WebhookDispatcher(Options options);
+    ~WebhookDispatcher();
+
+    WebhookDispatcher(const WebhookDispatcher&) = delete;
+    WebhookDispatcher& operator=(const WebhookDispatcher&) = delete;
+
+    void start();
+    /**
+     * Stop the worker; queued and in-flight events go to the dead-letter file
+     */
+    void stop();
+
+    // ---- Subscriptions ----
+    void setSubscriptions(const std::vector<RoomWebhook>& webhooks);
+    void addSubscription(const RoomWebhook& webhook);
+    void removeSubscription(const std::string& webhookId);
+    std::vector<RoomWebhook> subscriptions(const std::string& roomId) const;
+    bool hasSubscribers(const std::string& roomId) const;
+
+    /**
+     * Queue one serialized event (JSON object) for every webhook of roomId.
+     * Cheap and non-blocking; safe from any thread.
+     */
+    void publish(const std::string& roomId, const std::string& eventJson);
+
+    Stats stats() const;
+
+private:
+    struct Endpoint;
+    struct Request;
+
+    Options options_;
+    void* multi_ = nullptr;  // CURLM*, owned by the worker once started
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Endpoint>> endpoints_;                // webhookId ->
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Endpoint>>> roomIndex_;  // roomId ->
+    std::vector<std::string> deadLetters_;  // Lines waiting to be written by the worker
+    std::unordered_map<void*, std::unique_ptr<Request>> active_;  // CURL* -> request, worker thread only
+    uint64_t nextDeliveryId_ = 1;
+    Stats stats_;
+
+    void run();
+    int startDueBatches(uint64_t nowMs);
+    void launch(const std::shared_ptr<Endpoint>& endpoint);
+    void failLaunch(Endpoint& endpoint, const std::string& error);
+    void collectFinished();
+    void finish(Endpoint& endpoint, bool delivered, bool retryable, const std::string& error, uint64_t nowMs);
+    void abandonAll(const std::string& reason);
+    void writeDeadLetters();
+    void indexLocked(const std::shared_ptr<Endpoint>& endpoint);
+    void unindexLocked(const std::shared_ptr<Endpoint>& endpoint);
+    std::string deadLetterLine(const Endpoint& endpoint, const std::string& payload,
+                               size_t events, const std::string& error) const;
+    uint64_t backoffMs(uint32_t attempts) const;
+    static uint64_t nowMs();
+};
+
+#endif // WEBHOOK_DISPATCHER_H
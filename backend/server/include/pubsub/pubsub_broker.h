@@ -8,6 +8,7 @@
 #include <mutex>
 #include <memory>
 #include <vector>
+#include "utils/lock_profiler.h"
 
 // Message callback type
 // Args: (topic, message data, sender ID)
@@ -121,7 +122,7 @@ private:
     std::unordered_map<std::string, std::unordered_set<std::string>> subscriberTopics_;
     
     // Thread safety
-    mutable std::mutex mutex_;
+    mutable ProfiledMutex mutex_{"pubsub"};
     
     // Helper functions
     std::string makeRoomTopic(const std::string& roomId) const;
@@ -0,0 +1,138 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <shared_mutex>
+#include <random>
+#include <utility>
+#include <cstdint>
+
+/**
+ * HNSW Index
+ *
+ * Approximate nearest-neighbor index (Hierarchical Navigable Small World
+ * graph) over unit-length vectors, scored by cosine similarity, for one
+ * message shard.
+ *
+ * Persistence: the whole graph lives in a memory-mapped file of fixed-size
+ * node records (message ID, room key, timestamp, links per level, vector),
+ * so a restart maps the file and is ready at once instead of re-embedding
+ * every message. The file doubles in size as it fills. A file written with
+ * other dimensions or M is discarded and rebuilt.
+ *
+ * - Removal leaves a tombstone: the node still routes searches but is never
+ *   returned (re-adding an ID tombstones the old node); compact() rewrites
+ *   the file without them
+ * - Searches take a filter on the room key; traversal continues through
+ *   filtered-out nodes, bounded by maxVisits
+ * - Concurrent searches; add/remove take an exclusive lock
+ */
+class HnswIndex {
+public:
+    struct Params {
+        uint32_t dimensions = 256;
+        uint32_t M = 16;                // Links per node on upper levels, 2*M on level 0
+        uint32_t efConstruction = 100;
+    };
+
+    struct Hit {
+        std::string messageId;
+        uint64_t roomKey = 0;
+        uint64_t timestamp = 0;
+        float score = 0;                // Cosine similarity
+    };
+
+    using Filter = std::function<bool(uint64_t roomKey)>;
+
+    static constexpr size_t MAX_ID_BYTES = 63;
+    static constexpr int MAX_LEVEL = 4;
+
+    HnswIndex(std::string path, Params params);
+    ~HnswIndex();
+
+    HnswIndex(const HnswIndex&) = delete;
+    HnswIndex& operator=(const HnswIndex&) = delete;
+
+    /**
+     * Map the file, creating (or resetting) it if missing or incompatible
+     */
+    bool open();
+
+    /**
+     * Insert a unit-length vector; false if the ID is too long, the vector
+     * has the wrong size or the file cannot grow
+     */
+    bool add(const std::string& messageId, uint64_t roomKey, uint64_t timestamp, const std::vector<float>& vector);
+    bool remove(const std::string& messageId);
+    bool contains(const std::string& messageId) const;
+
+    /**
+     * Rebuild the graph from live nodes into a new file and swap it in, so
+     * removed vectors leave the disk; returns the tombstones dropped.
+     * Blocks searches while it runs.
+     */
+    size_t compact();
+
+    std::vector<Hit> search(const std::vector<float>& query, size_t k, size_t ef,
+                            const Filter& filter, size_t maxVisits) const;
+
+    /**
+     * Newest message timestamp fully indexed; the backfill resumes from it
+     */
+    uint64_t watermark() const;
+    void advanceWatermark(uint64_t timestamp);
+
+    /**
+     * Schedule dirty pages for writing (asynchronous)
+     */
+    void flush();
+
+    size_t size() const;       // Live vectors
+    size_t nodes() const;      // Including tombstones
+    size_t tombstones() const;
+    size_t fileBytes() const;
+
+private:
+    struct FileHeader;
+    struct NodeHeader;
+    using Scored = std::pair<float, uint32_t>;   // (distance, node)
+
+    std::string path_;
+    Params params_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+
+    size_t level0Offset_ = 0;
+    size_t upperOffset_ = 0;
+    size_t vectorOffset_ = 0;
+    size_t recordBytes_ = 0;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, uint32_t> ids_;   // Live message ID -> node
+    std::mt19937_64 rng_{std::random_device{}()};
+
+    FileHeader& header() const;
+    NodeHeader& node(uint32_t id) const;
+    uint32_t* links(uint32_t id, int level) const;  // [count, ids...]
+    const float* vector(uint32_t id) const;
+    uint32_t maxLinks(int level) const { return level == 0 ? 2 * params_.M : params_.M; }
+    float distance(const float* a, const float* b) const;
+
+    bool map(size_t bytes);
+    void unmap();
+    bool reset();
+    bool grow();
+    int randomLevel();
+
+    uint32_t greedyClosest(const float* query, uint32_t entry, int level) const;
+    std::vector<Scored> searchLayer(const float* query, uint32_t entry, size_t ef, int level,
+                                    const std::function<bool(uint32_t)>& accept, size_t maxVisits) const;
+    std::vector<uint32_t> selectNeighbors(const std::vector<Scored>& candidates, size_t m) const;
+    void connect(uint32_t from, uint32_t to, int level);
+};
+
+#endif // HNSW_INDEX_H
@@ -0,0 +1,163 @@
+#ifndef SEMANTIC_INDEX_H
+#define SEMANTIC_INDEX_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include "ai/embedding_client.h"
+#include "search/hnsw_index.h"
+#include "database/types.h"
+#include "utils/lru_cache.h"
+
+class MySQLClient;
+
+/**
+ * Semantic Index
+ *
+ * Meaning-based message search: text messages are embedded in batches on a
+ * background thread and stored in one HNSW index per message shard (files
+ * under indexDir), so a query is one embedding call plus an in-memory
+ * nearest-neighbor search instead of a full-text scan.
+ *
+ * - Live messages are queued as they are saved; edits re-embed, deletes and
+ *   expiries drop the vector, and compact() later drops it from disk
+ * - On start a backfill walks the messages table from the index watermark
+ *   (newest message already indexed), so a restart only embeds what it
+ *   missed; an empty index starts backfillDays back
+ * - Failed embedding batches are retried with backoff; beyond maxQueued new
+ *   messages are dropped and counted
+ * - Query vectors are cached, so repeating a search skips the embedding call
+ * - Searches are filtered to the caller's rooms inside the graph walk
+ *
+ * search() blocks on the embedding API; call it off the event loop.
+ */
+class SemanticIndex {
+public:
+    struct Options {
+        EmbeddingClient::Options embedding;
+        std::string indexDir = "./data/semantic";
+        uint32_t backfillDays = 30;
+        size_t batchSize = 32;           // Texts per embedding request
+        uint32_t batchDelayMs = 500;     // Wait this long for a batch to fill
+        size_t maxQueued = 10000;
+        size_t minTextBytes = 8;         // Shorter messages ("ok", "lol") are not indexed
+        size_t maxTextBytes = 2000;      // Longer ones are cut before embedding
+        uint32_t M = 16;
+        uint32_t efConstruction = 100;
+        size_t efSearch = 64;
+        size_t maxVisits = 20000;        // Nodes a filtered search may touch per shard
+        size_t queryCacheEntries = 1000;
+        size_t compactMinTombstones = 1000;  // Rewrite a shard file once removed vectors reach this and outnumber live ones
+    };
+
+    struct Hit {
+        std::string messageId;
+        uint64_t timestamp = 0;
+        float score = 0;
+    };
+
+    struct Stats {
+        uint64_t indexed = 0;
+        uint64_t removed = 0;
+        uint64_t compacted = 0;          // Removed vectors dropped from disk by compact()
+        uint64_t skipped = 0;            // Too short or not text
+        uint64_t dropped = 0;            // Queue full
+        uint64_t embedBatches = 0;
+        uint64_t embedFailures = 0;
+        uint64_t embedMicros = 0;        // Document batches
+        uint64_t backfilled = 0;
+        bool backfilling = false;
+        uint64_t queries = 0;
+        uint64_t queryCacheHits = 0;
+        uint64_t queryEmbedMicros = 0;
+        uint64_t searchMicros = 0;       // Graph walks
+        size_t queued = 0;
+        size_t vectors = 0;
+        size_t fileBytes = 0;
+    };
+
+    // Shard index owning a room (MySQLClient::shardForRoom)
+    using ShardFor = std::function<size_t(const std::string& roomId)>;
+
+    /**
+     * @param shards Number of message shards (at least one index is kept)
+     * @param backfillDb Connection for the startup backfill, owned by the
+     *                   worker; null skips the backfill
+     */
+    SemanticIndex(Options options, size_t shards, ShardFor shardFor, std::unique_ptr<MySQLClient> backfillDb);
+    ~SemanticIndex();
+
+    SemanticIndex(const SemanticIndex&) = delete;
+    SemanticIndex& operator=(const SemanticIndex&) = delete;
+
+    /**
+     * Open the index files and start the worker; false if no file could be opened
+     */
+    bool start();
+    void stop();
+
+    /**
+     * Queue a saved or edited message (storage room ID; content may be compressed)
+     */
+    void enqueue(const Message& message);
+    void remove(const std::string& messageId);
+
+    /**
+     * Rewrite shard files dominated by removed vectors (compactMinTombstones);
+     * blocks searches on a shard while it is rewritten. Returns vectors dropped.
+     */
+    size_t compact();
+
+    /**
+     * Best matches for text among the given storage rooms, best first;
+     * nullopt if the query could not be embedded
+     */
+    std::optional<std::vector<Hit>> search(const std::string& text, const std::vector<std::string>& roomIds,
+                                           size_t limit);
+
+    Stats stats() const;
+
+private:
+    struct Pending {
+        std::string messageId;
+        std::string roomId;
+        uint64_t timestamp = 0;
+        std::string text;
+    };
+
+    Options options_;
+    ShardFor shardFor_;
+    std::unique_ptr<MySQLClient> backfillDb_;
+    EmbeddingClient embedder_;
+    std::vector<std::unique_ptr<HnswIndex>> indexes_;
+    LRUCache<std::string, std::vector<float>> queryCache_;
+
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Pending> queue_;
+    bool batchInFlight_ = false;
+    std::unordered_set<std::string> removedDuringBatch_;  // Must not be re-added by the batch in flight
+    Stats stats_;
+
+    void run();
+    void backfill();
+    // Embed and insert, retrying with backoff; false only if stopped first
+    bool indexBatch(const std::vector<Pending>& batch);
+    bool tryIndex(const std::vector<Pending>& batch);
+    std::optional<Pending> toPending(const Message& message);
+    HnswIndex& indexFor(const std::string& roomId);
+    static uint64_t nowMicros();
+};
+
+#endif // SEMANTIC_INDEX_H
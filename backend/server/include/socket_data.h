@@ -10,6 +10,7 @@ struct PerSocketData {
     std::string username;
     std::string currentRoom;  // Currently joined room
     bool authenticated = false;
+    size_t bufferedBytes = 0;  // Backpressure as of the last send or drain
 };
 
 #endif // SOCKET_DATA_H
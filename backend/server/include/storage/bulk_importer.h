@@ -0,0 +1,108 @@
+#ifndef BULK_IMPORTER_H
+#define BULK_IMPORTER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+class MySQLClient;
+struct Message;
+
+/**
+ * Bulk Message Importer
+ *
+ * Loads message history exported from other chat systems (or by
+ * RoomExporter) without going through createMessage: one multi-row INSERT
+ * per batch instead of two round trips and a dozen log lines per row.
+ *
+ * Features:
+ * - JSON Lines or CSV (with header row), plain or gzip-compressed
+ * - Parallel workers validate, map external user/room IDs and insert,
+ *   each on its own connection
+ * - Bounded batch queue: memory independent of input size
+ * - Checkpoint file with the input offset of the last fully-loaded batch;
+ *   re-running resumes there (INSERT IGNORE makes overlap harmless)
+ * - Optional deferred secondary indexes for offline loads
+ * - Rejected rows go to a side file with the reason
+ */
+class BulkImporter {
+public:
+    enum class Format {
+        Auto,       // By extension: .csv / .csv.gz => Csv, otherwise JsonLines
+        JsonLines,
+        Csv
+    };
+
+    struct Options {
+        Format format = Format::Auto;
+        size_t workers = 4;
+        size_t batchSize = 1000;      // Rows per multi-row INSERT
+        bool deferIndexes = false;    // Drop secondary indexes during the load (server must be offline)
+        bool resume = true;           // Continue from the checkpoint file if present
+        std::string checkpointPath;   // Default: <input>.checkpoint
+        std::string rejectPath;       // Default: <input>.rejects
+    };
+
+    struct Stats {
+        uint64_t rowsRead = 0;
+        uint64_t rowsImported = 0;
+        uint64_t rowsDuplicate = 0;   // Already present (message_id)
+        uint64_t rowsRejected = 0;
+        uint64_t resumedFromOffset = 0;
+        double elapsedSeconds = 0;
+        double rowsPerSecond = 0;
+    };
+
+    using ProgressCallback = std::function<void(const Stats&)>;
+
+    BulkImporter(const MySQLClient& dbTemplate, Options options);
+
+    /**
+     * External -> internal ID mapping, JSON: {"users": {...}, "rooms": {...}}
+     * Senders not in the map are matched by user ID, then by username.
+     */
+    bool loadIdMap(const std::string& path);
+
+    /**
+     * Run the import (blocking)
+     * @param onProgress called from the reader thread about every 2 seconds
+     * @return final stats, or nullopt if the import failed / was cancelled
+     *         (the checkpoint is kept so a re-run resumes)
+     */
+    std::optional<Stats> run(const std::string& inputPath, ProgressCallback onProgress = nullptr);
+
+    void cancel() { cancelled_ = true; }
+
+private:
+    // Raw input records of one batch, parsed by a worker
+    struct Batch {
+        uint64_t seq = 0;
+        uint64_t endOffset = 0;  // Input offset just after the last record
+        std::vector<std::pair<uint64_t, std::string>> records;  // (offset, text)
+    };
+
+    // Resolved directory, read-only while workers run
+    struct Directory {
+        std::unordered_map<std::string, std::string> userNames;    // userId -> username
+        std::unordered_map<std::string, std::string> usernameIds;  // lowercase username -> userId
+        std::unordered_set<std::string> roomIds;
+    };
+
+    const MySQLClient& dbTemplate_;
+    Options options_;
+    std::unordered_map<std::string, std::string> userMap_;
+    std::unordered_map<std::string, std::string> roomMap_;
+    std::atomic<bool> cancelled_{false};
+
+    std::optional<Message> parseRecord(const std::string& text, Format format,
+                                       const std::vector<std::string>& csvHeader,
+                                       const Directory& directory, std::string& reason) const;
+    static std::vector<std::string> splitCsv(const std::string& record);
+};
+
+#endif // BULK_IMPORTER_H
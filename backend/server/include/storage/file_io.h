@@ -0,0 +1,60 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <memory>
+
+/**
+ * File I/O backend selection
+ *
+ * Upload writes and download reads go through this layer so the server can
+ * use io_uring (batched submissions, no per-chunk write syscall) when built
+ * with CHATBOX_IO_URING=ON, and plain POSIX I/O otherwise.
+ *
+ * - Backend chosen at runtime (IO_BACKEND=io_uring|posix)
+ * - Falls back to POSIX if io_uring is not compiled in or the kernel refuses it
+ */
+enum class IoBackend {
+    Posix,
+    IoUring
+};
+
+namespace FileIO {
+
+/**
+ * Select backend; returns the backend actually in effect
+ */
+IoBackend setBackend(IoBackend requested);
+IoBackend backend();
+const char* backendName(IoBackend backend);
+
+// True if the binary was built with io_uring support
+bool ioUringCompiled();
+
+// Name of the event-loop backend uSockets was built with (socket I/O)
+const char* socketBackendName();
+
+/**
+ * Sequential writer for streaming uploads. Chunks may be queued
+ * asynchronously; close() waits for everything to reach the file.
+ */
+class Writer {
+public:
+    virtual ~Writer() = default;
+    virtual bool write(std::string_view chunk) = 0;
+    virtual bool close() = 0;
+    virtual bool isOpen() const = 0;
+};
+
+std::unique_ptr<Writer> openWriter(const std::string& path);
+
+/**
+ * Read a whole file (downloads)
+ */
+std::optional<std::string> readFile(const std::string& path);
+
+} // namespace FileIO
+
+#endif // FILE_IO_H
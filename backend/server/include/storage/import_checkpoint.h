@@ -0,0 +1,88 @@
+#ifndef IMPORT_CHECKPOINT_H
+#define IMPORT_CHECKPOINT_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+
+typedef struct gzFile_s* gzFile;
+
+/**
+ * Import Checkpoint
+ *
+ * Resume support for BulkImporter, kept apart from the database side.
+ *
+ * - ImportReader reads records from plain or gzip input and reports the
+ *   input offset after each one; seek() returns to such an offset
+ * - ImportCheckpoint tracks batches that workers finish out of order and
+ *   advances the committed offset only over the contiguous prefix, so a
+ *   resume neither skips an unloaded batch nor double-counts a loaded one
+ * - load()/save() keep the committed offset and counters in a small JSON
+ *   file (written to a temp file and renamed, never torn)
+ */
+class ImportReader {
+public:
+    explicit ImportReader(const std::string& path);
+    ~ImportReader();
+
+    ImportReader(const ImportReader&) = delete;
+    ImportReader& operator=(const ImportReader&) = delete;
+
+    bool isOpen() const { return file_ != nullptr; }
+    uint64_t offset() const;
+    bool seek(uint64_t offset);
+
+    // One record: a line, or for CSV a line plus continuations while a quote is open
+    bool next(std::string& record, bool csv);
+
+private:
+    gzFile file_ = nullptr;
+
+    bool readLine(std::string& line);
+};
+
+class ImportCheckpoint {
+public:
+    struct Counts {
+        uint64_t rowsRead = 0;
+        uint64_t rowsImported = 0;
+        uint64_t rowsDuplicate = 0;
+        uint64_t rowsRejected = 0;
+    };
+
+    struct Saved {
+        uint64_t offset = 0;       // Input offset after the last committed batch
+        Counts totals;
+        bool complete = false;
+    };
+
+    static std::optional<Saved> load(const std::string& path);
+    static bool save(const std::string& path, const Saved& saved);
+
+    ImportCheckpoint(uint64_t startOffset, Counts totals);
+
+    /**
+     * Batch seq (0, 1, 2... in input order) fully loaded, ending at endOffset;
+     * thread-safe
+     */
+    void finished(uint64_t seq, uint64_t endOffset, const Counts& batch);
+
+    // Offset and counters of the same contiguous prefix
+    Saved committed() const;
+    size_t waiting() const;        // Finished batches held back by an earlier one
+
+private:
+    struct Pending {
+        uint64_t endOffset = 0;
+        Counts counts;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<uint64_t, Pending> finished_;  // seq -> result, waiting for earlier batches
+    uint64_t nextSeq_ = 0;
+    Saved committed_;
+};
+
+#endif // IMPORT_CHECKPOINT_H
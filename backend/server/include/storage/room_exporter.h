@@ -0,0 +1,148 @@
+#ifndef ROOM_EXPORTER_H
+#define ROOM_EXPORTER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <zlib.h>
+
+class MySQLClient;
+struct Message;
+
+/**
+ * Streaming gzip compressor: bytes in, compressed chunks handed to a sink.
+ * Only one output buffer is held, regardless of how much is written.
+ */
+class GzipStream {
+public:
+    using Sink = std::function<bool(std::string_view)>;  // false = abort
+
+    explicit GzipStream(Sink sink, int level = Z_DEFAULT_COMPRESSION);
+    ~GzipStream();
+
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    bool write(std::string_view data);
+    bool finish();  // Flush trailer; the stream is done afterwards
+
+    uint64_t bytesIn() const { return bytesIn_; }
+    uint64_t bytesOut() const { return bytesOut_; }
+
+private:
+    static constexpr size_t OUT_CHUNK = 64 * 1024;
+
+    Sink sink_;
+    z_stream zs_{};
+    bool ready_ = false;
+    bool finished_ = false;
+    uint64_t bytesIn_ = 0;
+    uint64_t bytesOut_ = 0;
+
+    bool deflateInto(const unsigned char* data, size_t size, int flush);
+};
+
+/**
+ * Room Exporter
+ *
+ * Exports a room's full history as gzip-compressed JSON Lines (one message
+ * per line). Rows are read in keyset batches on a dedicated connection and
+ * compressed as they arrive, so memory use does not depend on room size.
+ *
+ * Features:
+ * - Background jobs, one thread + DB connection each
+ * - Output to a file under exportDir, or to any chunk sink (HTTP streaming)
+ * - Progress: rows written / total rows / compressed bytes
+ * - Bounded number of concurrently running jobs
+ */
+class RoomExporter {
+public:
+    enum class JobState {
+        Running,
+        Completed,
+        Failed
+    };
+
+    struct JobStatus {
+        std::string jobId;
+        std::string roomId;
+        std::string requestedBy;
+        std::string path;            // Empty for streamed (HTTP) exports
+        JobState state = JobState::Running;
+        uint64_t rowsWritten = 0;
+        uint64_t totalRows = 0;
+        uint64_t bytesWritten = 0;   // Compressed
+        uint64_t startedAt = 0;
+        uint64_t finishedAt = 0;
+        std::string error;
+    };
+
+    using ChunkSink = GzipStream::Sink;
+    using ProgressCallback = std::function<void(const JobStatus&)>;
+
+    static constexpr size_t MAX_RUNNING_JOBS = 2;
+    static constexpr size_t MAX_RETAINED_JOBS = 100;
+    static constexpr int BATCH_SIZE = 1000;
+    static constexpr uint64_t PROGRESS_EVERY_ROWS = 10000;
+
+    RoomExporter(const MySQLClient& dbTemplate, std::string exportDir = "exports");
+    ~RoomExporter();
+
+    /**
+     * Export to <exportDir>/<jobId>.jsonl.gz in the background
+     * @param onProgress called from the job thread every PROGRESS_EVERY_ROWS
+     *                   rows and once when the job finishes
+     * @return jobId, or nullopt if MAX_RUNNING_JOBS are already running
+     */
+    std::optional<std::string> startFileExport(const std::string& roomId,
+                                               const std::string& requestedBy,
+                                               ProgressCallback onProgress = nullptr);
+
+    /**
+     * Export into a caller-provided sink (e.g. a chunked HTTP response).
+     * The sink runs on the job thread and may block to apply backpressure.
+     */
+    std::optional<std::string> startStreamExport(const std::string& roomId,
+                                                 const std::string& requestedBy,
+                                                 ChunkSink sink,
+                                                 ProgressCallback onProgress = nullptr);
+
+    std::optional<JobStatus> getJob(const std::string& jobId) const;
+
+    // Ask running jobs to stop and wait for them
+    void stop();
+    bool isStopping() const { return stopping_; }
+
+    static const char* stateName(JobState state);
+
+private:
+    struct Job {
+        JobStatus status;
+        std::thread thread;
+    };
+
+    const MySQLClient& dbTemplate_;
+    std::string exportDir_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Job>> jobs_;
+    size_t running_ = 0;
+    std::atomic<bool> stopping_{false};
+
+    std::optional<std::string> launch(const std::string& roomId, const std::string& requestedBy,
+                                      const std::string& path, ChunkSink sink,
+                                      ProgressCallback onProgress);
+    void runJob(Job& job, ChunkSink sink, ProgressCallback onProgress);
+    void reapFinishedLocked();
+
+    static std::string toJsonLine(const Message& msg);
+};
+
+#endif // ROOM_EXPORTER_H
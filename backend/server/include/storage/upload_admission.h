@@ -0,0 +1,143 @@
+#ifndef UPLOAD_ADMISSION_H
+#define UPLOAD_ADMISSION_H
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Upload Admission Control
+ *
+ * Keeps bulk uploads (/upload and chunked upload_*) from starving chat
+ * traffic of disk and socket time.
+ *
+ * Features:
+ * - Global and per-user limits on concurrent uploads
+ * - Bounded FIFO wait queue; beyond it uploads are rejected with a
+ *   Retry-After hint based on recent upload durations. An upload whose
+ *   owner is under its limit starts at once even behind queued uploads of
+ *   owners at theirs
+ * - Token bucket on disk write bandwidth: an upload that overdraws it is
+ *   paused and resumed in round-robin order as tokens refill, so active
+ *   uploads share the bandwidth evenly
+ * - Caps on data held in memory while it waits (for admission or for
+ *   bandwidth), per upload and in total; beyond them the caller rejects
+ *   the data with a Retry-After hint
+ *
+ * Event loop thread only (no locking). The owner drives refill() from a
+ * timer while hasBandwidthWaiters() is true.
+ */
+class UploadAdmission {
+public:
+    struct Limits {
+        size_t maxActive = 8;                              // Uploads writing at once
+        size_t maxPerUser = 2;                             // Active uploads per user/IP
+        size_t maxQueued = 32;                             // Waiting uploads before rejecting
+        uint64_t diskBytesPerSecond = 64ULL * 1024 * 1024; // 0 = unlimited
+        uint64_t burstBytes = 4ULL * 1024 * 1024;          // Bucket capacity
+        uint64_t maxHeldPerUpload = 8ULL * 1024 * 1024;    // Waiting in memory, one upload
+        uint64_t maxHeldBytes = 64ULL * 1024 * 1024;       // Waiting in memory, all uploads
+    };
+
+    enum class Decision {
+        Admitted,  // Start now
+        Queued,    // onAdmitted runs when a slot frees up
+        Rejected   // Retry after retryAfterSeconds
+    };
+
+    struct Ticket {
+        Decision decision = Decision::Rejected;
+        uint64_t id = 0;               // Pass to release(); 0 when rejected
+        size_t queuePosition = 0;      // 1-based, when queued
+        uint32_t retryAfterSeconds = 0;
+    };
+
+    using Callback = std::function<void()>;
+
+    explicit UploadAdmission(Limits limits);
+
+    /**
+     * Ask to start an upload for owner (user ID, or client IP when anonymous)
+     */
+    Ticket request(const std::string& owner, Callback onAdmitted);
+
+    /**
+     * Upload finished, failed or was aborted (active or still queued). Refunds
+     * its bandwidth reserve and held bytes, then admits queued uploads that
+     * now fit; their callbacks run before this returns.
+     */
+    void release(uint64_t id);
+
+    // Admitted and not yet released (queued uploads must not write or resume)
+    bool isActive(uint64_t id) const;
+
+    // ---- Disk bandwidth ----
+
+    /**
+     * Charge bytes just written by an active upload. Returns false when the
+     * bucket is overdrawn: the caller should stop reading and call
+     * waitForBandwidth(). Uploads that are not active are not charged.
+     */
+    bool consume(uint64_t id, size_t bytes, uint64_t nowMs);
+
+    /**
+     * Resume callback for a paused active upload, run in round-robin order by
+     * refill(); ignored for uploads that are not active
+     */
+    void waitForBandwidth(uint64_t id, Callback onResume);
+
+    // ---- Data held in memory ----
+
+    /**
+     * Account bytes kept in memory for upload id until it can write them.
+     * False (nothing accounted) if that would pass either cap: reject the
+     * data and have the client retry after retryAfterHeld() seconds.
+     */
+    bool hold(uint64_t id, size_t bytes);
+    void unhold(uint64_t id, size_t bytes);
+    uint32_t retryAfterHeld() const;
+    uint64_t heldBytes() const { return heldBytes_; }
+
+    /**
+     * Add tokens for the time elapsed and resume waiting uploads while the
+     * bucket is positive
+     */
+    void refill(uint64_t nowMs);
+    bool hasBandwidthWaiters() const { return !bandwidthWaiters_.empty(); }
+
+    size_t activeCount() const { return activeCount_; }
+    size_t queuedCount() const { return queue_.size(); }
+
+private:
+    struct Slot {
+        std::string owner;
+        bool active = false;
+        uint64_t startedAtMs = 0;
+        int64_t reservedBytes = 0;  // Held back for the chunk expected after a resume
+        uint64_t heldBytes = 0;     // In memory, waiting to be written
+        Callback onAdmitted;
+    };
+
+    static constexpr int64_t RESUME_RESERVE_BYTES = 64 * 1024;
+
+    Limits limits_;
+    uint64_t nextId_ = 1;
+    size_t activeCount_ = 0;
+    std::unordered_map<uint64_t, Slot> slots_;
+    std::unordered_map<std::string, size_t> activePerOwner_;
+    std::deque<uint64_t> queue_;                                 // Waiting slot IDs, FIFO
+    std::deque<std::pair<uint64_t, Callback>> bandwidthWaiters_; // Paused uploads, round-robin
+    int64_t tokens_;
+    uint64_t heldBytes_ = 0;
+    uint64_t lastRefillMs_ = 0;
+    double avgUploadSeconds_ = 10.0;  // EWMA of completed upload durations, for Retry-After
+
+    bool canStart(const std::string& owner) const;
+    void start(Slot& slot);
+    uint32_t retryAfter() const;
+    static uint64_t nowMs();
+};
+
+#endif // UPLOAD_ADMISSION_H
@@ -0,0 +1,63 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Bloom filter over strings: "definitely absent" or "maybe present".
+ * Not thread-safe; callers hold their own lock.
+ */
+class BloomFilter {
+public:
+    /**
+     * Size for expectedItems at the given false-positive rate
+     */
+    explicit BloomFilter(size_t expectedItems = 1024, double falsePositiveRate = 0.01) {
+        double n = static_cast<double>(expectedItems < 64 ? 64 : expectedItems);
+        double bits = -n * std::log(falsePositiveRate) / (std::log(2.0) * std::log(2.0));
+        bitCount_ = static_cast<size_t>(bits) | 63;
+        hashCount_ = static_cast<size_t>(std::round(bits / n * std::log(2.0)));
+        if (hashCount_ < 1) hashCount_ = 1;
+        words_.assign(bitCount_ / 64 + 1, 0);
+    }
+
+    void add(const std::string& key) {
+        forEachBit(key, [this](size_t bit) { words_[bit / 64] |= uint64_t{1} << (bit % 64); });
+    }
+
+    bool mightContain(const std::string& key) const {
+        bool all = true;
+        forEachBit(key, [this, &all](size_t bit) {
+            if (!(words_[bit / 64] & (uint64_t{1} << (bit % 64)))) all = false;
+        });
+        return all;
+    }
+
+    void clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+private:
+    size_t bitCount_;
+    size_t hashCount_;
+    std::vector<uint64_t> words_;
+
+    template<typename Fn>
+    void forEachBit(const std::string& key, Fn fn) const {
+        // Double hashing (Kirsch-Mitzenmacher): bit_i = h1 + i * h2
+        uint64_t h = std::hash<std::string>{}(key);
+        h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+        h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        uint64_t h1 = h & 0xffffffffULL;
+        uint64_t h2 = (h >> 32) | 1;
+        for (size_t i = 0; i < hashCount_; ++i) {
+            fn(static_cast<size_t>((h1 + i * h2) % bitCount_));
+        }
+    }
+};
+
+#endif // BLOOM_FILTER_H
@@ -0,0 +1,59 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * CPU Affinity
+ *
+ * Optional pinning of each thread class to its own set of cores, so the
+ * scheduler stops migrating the event loop and workers across cores and
+ * sockets.
+ *
+ * - CPU lists use the kernel cpulist syntax ("0-3,8,10-11"); "nodeN" stands
+ *   for every CPU of NUMA node N (read from /sys)
+ * - Workers and background threads left unset get the process' CPUs minus the
+ *   event-loop CPUs, so the loop's cores stay isolated
+ * - Memory follows the thread: Linux allocates pages on the node of the CPU
+ *   that first touches them, so a thread that pins itself before building its
+ *   state (loop caches, room actor state) gets NUMA-local memory
+ *
+ * configure() once at startup, before any thread is started. Linux only;
+ * elsewhere pinning is a no-op.
+ */
+namespace cpu_affinity {
+
+enum class ThreadClass {
+    EventLoop,    // uWebSockets loop (main thread)
+    RoomWorker,   // Room actor workers, one core each (round-robin)
+    Background    // DB jobs, exports, webhooks, AI requests, warm-up, shard fan-out
+};
+
+/**
+ * Parse a cpulist; returns empty (and logs) on a malformed list
+ */
+std::vector<int> parseCpuList(const std::string& spec);
+
+/**
+ * Set the CPUs of each class; empty specs mean "not pinned" unless the loop is
+ * pinned, in which case they default to the remaining CPUs
+ */
+void configure(const std::string& loopSpec, const std::string& workerSpec, const std::string& backgroundSpec);
+
+bool enabled();
+
+/**
+ * Pin the calling thread to its class. index >= 0 picks one CPU of the set
+ * (index modulo size); -1 allows the whole set. Also names the thread.
+ */
+void pinCurrentThread(ThreadClass threadClass, int index = -1, const std::string& name = "");
+
+/**
+ * One-line summary of the plan for the startup log
+ */
+std::string describe();
+
+} // namespace cpu_affinity
+
+#endif // CPU_AFFINITY_H
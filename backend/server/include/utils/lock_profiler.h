@@ -0,0 +1,154 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <source_location>
+
+/**
+ * Lock Profiler
+ *
+ * ProfiledMutex is a drop-in std::mutex with a name. With profiling on, every
+ * acquisition records:
+ * - acquisitions and how many found the lock already held (contended)
+ * - wait time and hold time, as log2 histograms in microseconds
+ * - hold time per call site, for "who holds this lock the longest"
+ *
+ * Use ProfiledLock instead of std::lock_guard to get call sites; plain
+ * lock()/unlock() (std::unique_lock, ...) still works and counts as "unknown".
+ *
+ * Compiled in with -DCHATBOX_LOCK_PROFILING (CMake option of the same name),
+ * then switched on at runtime with setEnabled() (LOCK_PROFILING=true). Without
+ * the build flag the wrapper is a plain std::mutex.
+ */
+namespace lock_profiler {
+
+constexpr size_t HISTOGRAM_BUCKETS = 24;  // Bucket i: < 2^i us; the last one is open-ended
+constexpr size_t MAX_SITES = 32;          // Call sites tracked per lock; the rest count as "other"
+
+struct SiteReport {
+    std::string site;  // file:line
+    uint64_t acquisitions = 0;
+    uint64_t holdTotalUs = 0;
+    uint64_t holdMaxUs = 0;
+};
+
+struct LockReport {
+    std::string name;
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t waitTotalUs = 0;
+    uint64_t waitMaxUs = 0;
+    uint64_t holdTotalUs = 0;
+    uint64_t holdMaxUs = 0;
+    std::array<uint64_t, HISTOGRAM_BUCKETS> waitHistogram{};
+    std::array<uint64_t, HISTOGRAM_BUCKETS> holdHistogram{};
+    std::vector<SiteReport> topHolders;  // By total hold time, longest first
+};
+
+bool compiledIn();
+bool enabled();
+void setEnabled(bool on);
+
+/**
+ * Snapshot of every live ProfiledMutex, sorted by total wait time
+ * @param topSites holders kept per lock
+ */
+std::vector<LockReport> report(size_t topSites = 5);
+
+/**
+ * Zero all counters (e.g. before a load test)
+ */
+void reset();
+
+#ifdef CHATBOX_LOCK_PROFILING
+
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char* name);
+    ~ProfiledMutex();
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    void lock(const std::source_location& site = {});
+    bool try_lock();
+    void unlock();
+
+private:
+    friend std::vector<LockReport> report(size_t);
+    friend void reset();
+
+    struct Site {
+        std::atomic<uint64_t> key{0};  // Hash of file/line, 0 = free slot
+        std::atomic<const char*> file{nullptr};
+        std::atomic<uint32_t> line{0};
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> holdTotalUs{0};
+        std::atomic<uint64_t> holdMaxUs{0};
+    };
+
+    std::mutex mutex_;
+    const char* name_;
+
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> waitTotalUs_{0};
+    std::atomic<uint64_t> waitMaxUs_{0};
+    std::atomic<uint64_t> holdTotalUs_{0};
+    std::atomic<uint64_t> holdMaxUs_{0};
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> waitHistogram_{};
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> holdHistogram_{};
+    std::array<Site, MAX_SITES + 1> sites_;  // Last slot = "other" / "unknown"
+
+    // Written by the current holder only
+    uint64_t heldSinceNs_ = 0;
+    Site* holder_ = nullptr;
+
+    Site* siteFor(const std::source_location& site);
+};
+
+#else
+
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char*) {}
+
+    void lock(const std::source_location& = {}) { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+
+private:
+    std::mutex mutex_;
+};
+
+#endif
+
+/**
+ * std::lock_guard for ProfiledMutex that records the caller's file:line
+ */
+class ProfiledLock {
+public:
+    explicit ProfiledLock(ProfiledMutex& mutex, const std::source_location& site = std::source_location::current())
+        : mutex_(mutex) {
+        mutex_.lock(site);
+    }
+    ~ProfiledLock() { mutex_.unlock(); }
+
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+private:
+    ProfiledMutex& mutex_;
+};
+
+} // namespace lock_profiler
+
+using lock_profiler::ProfiledMutex;
+using lock_profiler::ProfiledLock;
+
+#endif // LOCK_PROFILER_H
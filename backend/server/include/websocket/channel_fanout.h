@@ -0,0 +1,53 @@
+#ifndef CHANNEL_FANOUT_H
+#define CHANNEL_FANOUT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+
+/**
+ * Channel Fan-out Registry
+ *
+ * Broadcast channels (RoomType::ROOM_CHANNEL) have admins with room_members
+ * rows and readers that are only in-memory subscriptions of a socket.
+ *
+ * Features:
+ * - Set of known channel room IDs (loaded at startup, updated on create)
+ * - Per-channel subscriber list (socket + userId), no DB rows
+ * - Snapshots for paced, pre-serialized fan-out by the server
+ */
+class ChannelFanout {
+public:
+    struct Subscription {
+        void* ws;
+        std::string userId;
+    };
+
+    void registerChannel(const std::string& channelId);
+    bool isChannel(const std::string& roomId) const;
+
+    void subscribe(const std::string& channelId, void* ws, const std::string& userId);
+    void unsubscribe(const std::string& channelId, void* ws);
+
+    /**
+     * Drop every subscription held by a socket (on disconnect)
+     */
+    void unsubscribeAll(void* ws);
+
+    size_t subscriberCount(const std::string& channelId) const;
+
+    /**
+     * Copy of current subscribers, safe to iterate across loop iterations
+     */
+    std::vector<Subscription> snapshot(const std::string& channelId) const;
+
+private:
+    std::unordered_set<std::string> channels_;
+    std::unordered_map<std::string, std::unordered_map<void*, std::string>> subscribers_;  // channel -> ws -> userId
+    std::unordered_map<void*, std::unordered_set<std::string>> socketChannels_;           // ws -> channels
+    mutable std::mutex mutex_;
+};
+
+#endif // CHANNEL_FANOUT_H
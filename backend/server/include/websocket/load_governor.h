@@ -0,0 +1,99 @@
+#ifndef LOAD_GOVERNOR_H
+#define LOAD_GOVERNOR_H
+
+#include <array>
+#include <string>
+#include <cstdint>
+
+/**
+ * Load Governor
+ *
+ * Turns overload signals into a degradation level so that chat messages keep
+ * flowing while optional work is shed, cheapest-to-lose first:
+ *
+ *   0 normal
+ *   1 shed_presence   - typing and presence fan-out dropped, online-user scans refused
+ *   2 defer_heavy     - search and AI requests queued until the level drops
+ *   3 throttle_logins - login/register/auth rate-limited
+ *
+ * Signals (sampled by a loop timer): event-loop lag, room actor queue depth
+ * (DB work waiting) and bytes buffered on client sockets. Each has a threshold
+ * per level; the level is the highest one any signal reaches.
+ *
+ * Hysteresis: the level rises on the first sample over a threshold, but only
+ * drops one step after recoverSamples consecutive samples below
+ * recoverFactor x the current level's thresholds.
+ *
+ * Event loop thread only (no locking).
+ */
+class LoadGovernor {
+public:
+    enum class Level { Normal = 0, ShedPresence = 1, DeferHeavy = 2, ThrottleLogins = 3 };
+
+    struct Thresholds {
+        std::array<uint64_t, 3> loopLagMs = {50, 150, 400};                 // For levels 1..3
+        std::array<uint64_t, 3> dbQueueDepth = {500, 2000, 8000};
+        std::array<uint64_t, 3> bufferedBytes = {32ULL << 20, 128ULL << 20, 512ULL << 20};
+        uint32_t recoverSamples = 20;   // At the 250ms tick: 5 s of calm per step down
+        double recoverFactor = 0.6;
+        double loginsPerSecond = 20;    // Login budget at level 3
+    };
+
+    struct Sample {
+        uint64_t loopLagMs = 0;
+        uint64_t dbQueueDepth = 0;
+        uint64_t bufferedBytes = 0;
+    };
+
+    struct Stats {
+        uint64_t loopLagMs = 0;        // Smoothed
+        uint64_t maxLoopLagMs = 0;     // Since start
+        uint64_t dbQueueDepth = 0;
+        uint64_t bufferedBytes = 0;
+        uint64_t transitions = 0;
+        uint64_t typingDropped = 0;
+        uint64_t presenceDropped = 0;
+        uint64_t deferred = 0;
+        uint64_t rejected = 0;         // Refused outright (busy replies)
+        uint64_t loginsThrottled = 0;
+    };
+
+    LoadGovernor() = default;
+    explicit LoadGovernor(Thresholds thresholds) : thresholds_(thresholds) {}
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+
+    /**
+     * Feed one sample; returns the (possibly changed) level
+     */
+    Level update(const Sample& sample);
+
+    Level level() const { return level_; }
+    static const char* levelName(Level level);
+
+    // ---- Decisions (also count what was shed) ----
+    bool allowTyping();
+    bool allowPresence();
+    bool allowOnlineScan();
+    bool allowHeavy() const { return level_ < Level::DeferHeavy; }
+    bool admitLogin(uint64_t nowMs);
+
+    void recordDeferred() { stats_.deferred++; }
+    void recordRejected() { stats_.rejected++; }
+
+    Stats stats() const { return stats_; }
+
+private:
+    Thresholds thresholds_;
+    bool enabled_ = true;
+    Level level_ = Level::Normal;
+    double lagEwmaMs_ = 0;
+    uint32_t calmSamples_ = 0;
+    double loginTokens_ = 0;
+    uint64_t lastLoginRefillMs_ = 0;
+    Stats stats_;
+
+    int pressureLevel(const Sample& sample, double factor) const;
+};
+
+#endif // LOAD_GOVERNOR_H
@@ -0,0 +1,105 @@
+#ifndef ROOM_ACTOR_POOL_H
+#define ROOM_ACTOR_POOL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+class MySQLClient;
+
+/**
+ * Room Actor Pool
+ *
+ * Every room is owned by exactly one actor (mailbox + RoomState). Rooms are
+ * hashed onto a fixed pool of worker threads, so work for one room runs
+ * serialized without locks while different rooms run in parallel.
+ *
+ * Features:
+ * - Per-room FIFO ordering (a room always lands on the same worker)
+ * - Worker-local RoomState and MySQL connection (no shared DB session)
+ * - Cross-room operations are just post() calls to the other room's actor
+ * - Socket I/O stays on the event loop: tasks hand results back via defer
+ * - RoomState of a room idle for ROOM_IDLE_SECONDS is dropped; the next task
+ *   for it starts a fresh state
+ *
+ * Sequence numbers: a new RoomState starts nextSeq at the current time in
+ * microseconds, so a room's seq keeps increasing across evictions and
+ * restarts (unless the clock steps back). Gaps are normal; seq only orders
+ * messages within one room.
+ */
+class RoomActorPool {
+public:
+    struct RoomState {
+        uint64_t nextSeq = 1;        // Per-room message sequence number (seeded from the clock)
+        uint64_t lastActivity = 0;   // Unix seconds of last handled task
+        uint64_t tasksHandled = 0;
+    };
+
+    using Task = std::function<void(RoomState& state, MySQLClient& db)>;
+    // States in the order of the posted roomIds
+    using BatchTask = std::function<void(const std::vector<RoomState*>& states, MySQLClient& db)>;
+
+    RoomActorPool() = default;
+    ~RoomActorPool();
+
+    /**
+     * Start workers; each opens its own connection from the template client
+     * @param workerCount 0 = hardware concurrency
+     * @return false if no worker could connect (callers fall back to inline)
+     */
+    bool start(size_t workerCount, const MySQLClient& dbTemplate);
+    void stop();
+
+    bool isRunning() const { return running_; }
+    size_t workerCount() const { return workers_.size(); }
+
+    /**
+     * Enqueue a task on the actor that owns roomId; false (task dropped) if
+     * the pool is not running
+     */
+    bool post(const std::string& roomId, Task task);
+
+    /**
+     * Enqueue one task for several rooms owned by the same actor (group them
+     * with workerFor); false if the pool is not running or they are not
+     */
+    bool postBatch(const std::vector<std::string>& roomIds, BatchTask task);
+
+    // Worker owning roomId (0 when the pool is not running)
+    size_t workerFor(const std::string& roomId) const;
+    size_t pendingTasks() const;
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<std::vector<std::string>, BatchTask>> mailbox;   // (roomIds, task)
+        std::unordered_map<std::string, RoomState> rooms;  // Only touched by this worker's thread
+        std::unique_ptr<MySQLClient> db;
+    };
+
+    static constexpr uint64_t ROOM_IDLE_SECONDS = 600;
+    static constexpr uint64_t SWEEP_INTERVAL_SECONDS = 60;
+
+    // Shared by post(); exclusive while stop() flips running_ and clears workers_
+    mutable std::shared_mutex poolMutex_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{false};
+
+    bool enqueue(std::vector<std::string> roomIds, BatchTask task);
+    void workerLoop(Worker& worker, size_t index);
+    static void evictIdleRooms(Worker& worker, uint64_t now);
+    static uint64_t seedSeq();
+};
+
+#endif // ROOM_ACTOR_POOL_H
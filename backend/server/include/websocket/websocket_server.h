@@ -2,16 +2,44 @@
 #define WEBSOCKET_SERVER_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <deque>
+#include <tuple>
 #include "pubsub/pubsub_broker.h"
 #include "auth/auth_manager.h"
 #include "handlers/webrtc_handler.h"
 #include "handlers/file_handler.h"
 #include "database/mysql_client.h"
+#include "database/room_history_cache.h"
+#include "database/room_membership_index.h"
+#include "database/message_expiry_index.h"
+#include "analytics/activity_stats.h"
+#include "storage/upload_admission.h"
+#include "websocket/channel_fanout.h"
+#include "websocket/room_actor_pool.h"
+#include "websocket/load_governor.h"
+#include "storage/room_exporter.h"
+#include "integrations/webhook_dispatcher.h"
+#include "integrations/link_unfurler.h"
+#include "ai/ai_executor.h"
+#include "ai/room_summarizer.h"
+#include "ai/message_translator.h"
+#include "search/semantic_index.h"
+#include "utils/lru_cache.h"
+#include "utils/lock_profiler.h"
 #include "../protocol_chatbox1.h"
 
+namespace uWS { struct Loop; }
+
 // Forward declarations
 class GeminiClient;
 
@@ -45,6 +73,31 @@ public:
      */
     void stop();
     
+    /**
+     * Number of room actor worker threads (0 = hardware concurrency)
+     * Must be called before run()
+     */
+    void setRoomWorkerCount(size_t count) { roomWorkerCount_ = count; }
+    void setAdminToken(const std::string& token) { adminToken_ = token; }
+    void setUploadLimits(const UploadAdmission::Limits& limits) { uploads_ = std::make_unique<UploadAdmission>(limits); }
+    void setWebhookOptions(const WebhookDispatcher::Options& options) { webhooks_ = std::make_unique<WebhookDispatcher>(options); }
+    // AI executor threads and room summary tuning; summaries and translations need a Gemini client
+    void setAiOptions(size_t workers, const RoomSummarizer::Options& summaryOptions);
+    void setLinkPreviewOptions(bool enabled, const LinkUnfurler::Options& options) {
+        linkPreviews_ = enabled ? std::make_unique<LinkUnfurler>(options) : nullptr;
+    }
+    // Meaning-based search (semantic_search); only starts with an embedding API key and a database
+    void setSemanticSearch(bool enabled, const SemanticIndex::Options& options) {
+        semanticEnabled_ = enabled;
+        semanticOptions_ = options;
+    }
+    // Most active rooms preloaded into the caches at startup (0 = skip warm-up)
+    void setWarmupRooms(size_t rooms) { warmupRooms_ = rooms; }
+    void setLoadShedding(bool enabled, const LoadGovernor::Thresholds& thresholds) {
+        loadGovernor_ = LoadGovernor(thresholds);
+        loadGovernor_.setEnabled(enabled);
+    }
+    
     /**
      * Get connection count
      */
@@ -98,7 +151,106 @@ private:
     // WebSocket connections
     // Store connections by void* since we use lambdas
     std::unordered_map<void*, ConnectionState> connections_;
-    mutable std::mutex connectionsMutex_;
+    mutable ProfiledMutex connectionsMutex_{"connections"};
+    
+    // Recent history of hot rooms (keyed by storage roomId)
+    RoomHistoryCache historyCache_;
+    
+    // Room members + online state, loaded lazily per room
+    RoomMembershipIndex membershipIndex_;
+    
+    // All users, prefix-indexed for search_users (shared with AuthManager)
+    std::shared_ptr<UserDirectory> userDirectory_;
+    
+    // Broadcast channels: known channel IDs + in-memory reader subscriptions
+    ChannelFanout channelFanout_;
+    static constexpr size_t CHANNEL_FANOUT_BATCH = 1000;  // Sends per loop iteration
+    
+    // Per-room actors: room state changes run serialized on the room's worker
+    RoomActorPool roomActors_;
+    size_t roomWorkerCount_ = 0;
+    std::string adminToken_;
+    
+    // Message activity counters for /admin/stats (updated in saveMessage)
+    ActivityStats activityStats_;
+    
+    // Upload admission control (/upload and chunked upload_*), event loop only
+    std::unique_ptr<UploadAdmission> uploads_;
+    std::unordered_map<std::string, std::pair<uint64_t, void*>> chunkedUploads_;  // uploadId -> (ticket, ws)
+    struct us_timer_t* uploadTimer_ = nullptr;  // Bandwidth refill tick while uploads are paused
+    bool uploadTimerArmed_ = false;
+    static constexpr int UPLOAD_REFILL_MS = 10;
+    
+    // Load shedding: a loop timer samples lag / actor queues / socket buffers;
+    // heavy ops wait in deferredOps_ (ws, userId, raw op) while the level is high
+    LoadGovernor loadGovernor_;
+    struct us_timer_t* loadTimer_ = nullptr;
+    uint64_t lastLoadTickMs_ = 0;
+    std::atomic<int64_t> bufferedBytes_{0};   // Sum of PerSocketData::bufferedBytes
+    std::deque<std::tuple<void*, std::string, std::string>> deferredOps_;
+    static constexpr int LOAD_SAMPLE_MS = 250;
+    static constexpr size_t MAX_DEFERRED_OPS = 1000;
+    static constexpr size_t DEFERRED_OPS_PER_TICK = 50;
+    
+    uWS::Loop* loop_ = nullptr;  // Event loop that owns all sockets
+    
+    // Background room exports (gzip JSONL); declared after dbClient_ so it stops first
+    std::unique_ptr<RoomExporter> exporter_;
+    
+    // Single-use links for finished exports: token -> (jobId, userId, expiry), so
+    // session tokens never travel in a download URL
+    struct DownloadToken {
+        std::string jobId;
+        std::string userId;
+        uint64_t expiresAt = 0;
+    };
+    std::mutex downloadTokensMutex_;
+    std::unordered_map<std::string, DownloadToken> downloadTokens_;
+    static constexpr uint64_t DOWNLOAD_TOKEN_TTL_SECONDS = 300;
+    
+    // Disappearing messages: expiry buckets drained by a purge thread
+    MessageExpiryIndex expiryIndex_;
+    std::thread expiryThread_;
+    std::mutex expiryMutex_;
+    std::condition_variable expiryCv_;
+    std::atomic<bool> expiryRunning_{false};
+    static constexpr size_t EXPIRY_PURGE_BATCH = 500;          // Rows per DELETE
+    static constexpr uint64_t EXPIRY_HORIZON_SECONDS = 3600;   // Expiries held in memory ahead of now
+    
+    // Batch envelope: while a batch runs, replies to its socket are collected here
+    void* batchSocket_ = nullptr;
+    std::vector<std::string>* batchReplies_ = nullptr;
+    static constexpr size_t MAX_BATCH_OPS = 50;
+    static constexpr size_t MAX_FORWARD_TARGETS = 50;  // Rooms per forward_message
+    
+    // Outbound webhooks: new messages are queued from saveMessage, delivered off-thread
+    std::unique_ptr<WebhookDispatcher> webhooks_;
+    static constexpr size_t MAX_WEBHOOKS_PER_ROOM = 10;
+    
+    // Link previews: first URL of a text message, fetched off-thread, attached as metadata
+    std::unique_ptr<LinkUnfurler> linkPreviews_;
+    
+    // AI: blocking Gemini calls run on the executor; room summaries are folded there as messages arrive
+    std::unique_ptr<AiExecutor> aiExecutor_;
+    std::unique_ptr<RoomSummarizer> summarizer_;
+    std::unique_ptr<MessageTranslator> translator_;
+    static constexpr size_t AI_MAX_QUEUED = 64;
+    static constexpr size_t MAX_TRANSLATE_MESSAGES = 50;  // Per translate_message (a history page)
+    
+    // Semantic search: embeddings in one HNSW file per message shard, indexed off-thread as messages
+    // are saved; queries are embedded and searched on the AI executor
+    bool semanticEnabled_ = true;
+    SemanticIndex::Options semanticOptions_;
+    std::unique_ptr<SemanticIndex> semanticIndex_;
+    static constexpr size_t MAX_SEMANTIC_RESULTS = 50;
+    
+    // DM storage IDs: "smallerUserId|largerUserId" -> conversation_id
+    LRUCache<std::string, std::string> dmConversations_{8192};
+    
+    // Startup warm-up: /health reports "starting" and upgrades are refused until warm_
+    std::thread warmupThread_;
+    std::atomic<bool> warm_{false};
+    size_t warmupRooms_ = 200;
     
     // Protocol message handlers (templates need to be in header or explicit instantiation)
     // We'll use type-erased helpers instead
@@ -107,16 +259,120 @@ private:
     void handleChatMessageJson(void* ws, const std::string& jsonStr);
     void handleTypingJson(void* ws, const std::string& jsonStr);
     void handleGetOnlineUsersJson(void* ws);
+    void handleSearchUsersJson(void* ws, const std::string& jsonStr);
     void handleEditMessageJson(void* ws, const std::string& jsonStr);
     void handleDeleteMessageJson(void* ws, const std::string& jsonStr);
     void handleCreateRoomJson(void* ws, const std::string& jsonStr);
     void handleJoinRoomJson(void* ws, const std::string& jsonStr);
     void handleLeaveRoomJson(void* ws, const std::string& jsonStr);
+    void handleGetMembersJson(void* ws, const std::string& jsonStr);
     void handleGetRoomsJson(void* ws);
     void handleSearchMessagesJson(void* ws, const std::string& jsonStr);
     void handleMarkReadJson(void* ws, const std::string& jsonStr);
+    void broadcastReadReceipt(const std::string& messageId, const std::string& roomId,
+                              const std::string& userId, const std::string& username);
+    void handleReplyMessageJson(void* ws, const std::string& jsonStr);
+    void handleGetThreadJson(void* ws, const std::string& jsonStr);
+    
+    // Message ingestion / history helpers
+    bool saveMessage(const Message& message, MySQLClient* db = nullptr);  // Persist + keep history cache and reply counts in sync
+    bool saveMessages(std::vector<Message>& messages, MySQLClient* db = nullptr);  // Multi-row saveMessage (no replies); stamps expiresAt
+    void recordSavedMessage(const Message& message);
+    std::vector<Message> loadRoomHistory(const std::string& storageRoomId);
+    std::string resolveStorageRoomId(const std::string& userId, const std::string& roomId);
+    // Save on the room's actor (seq stamped), then echo + broadcast response on the loop
+    void postRoomMessage(void* ws, Message message, nlohmann::json response, const std::string& roomId,
+                         const std::string& failure, const std::string& sentLog);
+    // Run a change to a stored message on its room's actor; the message is nullopt if
+    // it is not found (or not in roomId), seq is 0 and db the shared client without the pool
+    using MessageTask = std::function<void(std::optional<Message> message, uint64_t seq, MySQLClient* db)>;
+    void postToMessageRoom(const std::string& messageId, const std::string& userId,
+                           const std::string& roomId, MessageTask task);
+    
+    bool ensureMembershipLoaded(const std::string& roomId);  // false: no members (not cached)
+    
+    // Room actors -> event loop hand-off
+    void runOnLoop(std::function<void()> fn);
+    bool isConnectionAlive(void* ws);
+    void handleForwardMessageJson(void* ws, const std::string& jsonStr);
+    
+    // Room export
+    void handleExportRoomJson(void* ws, const std::string& jsonStr);
+    void handleExportStatusJson(void* ws, const std::string& jsonStr);
+    std::optional<std::string> resolveExportRoom(const std::string& userId, const std::string& roomId);
+    std::string issueDownloadToken(const std::string& jobId, const std::string& userId);
+    std::optional<std::string> redeemDownloadToken(const std::string& token, const std::string& jobId);
+    
+    // Upload admission
+    void handleUploadInitJson(void* ws, const std::string& jsonStr);
+    void handleUploadChunkJson(void* ws, const std::string& jsonStr);
+    void handleUploadFinalizeJson(void* ws, const std::string& jsonStr);
+    void releaseChunkedUploads(void* ws);
+    void armUploadTimer();
+    static void onUploadTimer(struct us_timer_t* timer);
+    static uint64_t steadyNowMs();
+    
+    // Load shedding
+    static void onLoadTimer(struct us_timer_t* timer);
+    void sampleLoad();
+    bool shedOrDefer(void* ws, const std::string& type, const std::string& jsonStr);
+    void sendServerBusy(void* ws, const std::string& op, uint32_t retryAfterSeconds);
+    
+    // Outbound webhooks
+    void handleAddWebhookJson(void* ws, const std::string& jsonStr);
+    void handleRemoveWebhookJson(void* ws, const std::string& jsonStr);
+    void handleListWebhooksJson(void* ws, const std::string& jsonStr);
+    void publishWebhookEvent(const Message& message);
+    
+    // Link previews
+    void requestLinkPreview(const Message& message);
+    void attachLinkPreview(const std::string& messageId, const std::string& roomId, const LinkPreview& preview);
+    // Catch-me-up summaries
+    void handleSummarizeJson(void* ws, const std::string& jsonStr);
+    // Semantic search
+    void startSemanticIndex();
+    void handleSemanticSearchJson(void* ws, const std::string& jsonStr);
+    void sendSemanticResults(void* ws, const std::string& userId, const std::string& query,
+                             const std::vector<std::string>& roomIds, const std::vector<SemanticIndex::Hit>& hits,
+                             uint64_t startedMs);
+    void deliverToStorageRoom(const std::string& roomId, nlohmann::json frame, MySQLClient& db);  // Any thread; DMs split per side
+    // Translations
+    void handleTranslateMessageJson(void* ws, const std::string& jsonStr);
+    
+    // Disappearing messages
+    void handleSetRoomTtlJson(void* ws, const std::string& jsonStr);
+    void startExpiryPurger();
+    void stopExpiryPurger();
+    void runExpiryPurger(MySQLClient& db);
+    
+    // Startup cache warming
+    void startWarmup();
+    void warmCaches();
+    void notifyMessagesExpired(const std::map<std::string, std::vector<std::string>>& byRoom, MySQLClient& db);
+    
+    // Broadcast channels
+    bool canPostToRoom(const std::string& roomId, const std::string& userId);
+    void publishToChannel(const std::string& channelId, const std::string& message, const std::string& excludeUserId = "");
+    void sendChannelBatch(std::shared_ptr<std::vector<ChannelFanout::Subscription>> targets,
+                          std::shared_ptr<const std::string> payload,
+                          const std::string& excludeUserId, size_t offset);
+    
+    // Progressive join: polls follow the room_joined ack as a separate frame
+    void sendRoomDetails(void* ws, const std::string& userId,
+                         const std::string& roomId, const std::string& queryRoomId,
+                         std::chrono::steady_clock::time_point joinStart);
+    bool isConnectionInRoom(void* ws, const std::string& userId, const std::string& roomId);
+    
+    // Client frame routing; batch runs several frames through it in one round trip
+    void dispatchMessage(void* ws, const std::string& msgStr);
+    void handleBatchJson(void* ws, const std::string& jsonStr);
+    
     void sendErrorJson(void* ws, const std::string& error);
     void sendJsonMessage(void* ws, const std::string& jsonStr);
+    
+    // Every socket write goes through here so bufferedBytes_ follows backpressure
+    void sendTracked(void* ws, std::string_view payload);
+    void noteBuffered(void* ws);
 };
 
 #endif // WEBSOCKET_SERVER_H
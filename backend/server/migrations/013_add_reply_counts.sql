@@ -0,0 +1,19 @@
+-- Migration: Materialized reply counts for threads
+-- Date: 2026-10-18
+
+ALTER TABLE messages
+ADD COLUMN IF NOT EXISTS reply_count INT UNSIGNED NOT NULL DEFAULT 0 AFTER reply_to_id,
+ADD COLUMN IF NOT EXISTS last_reply_at TIMESTAMP NULL AFTER reply_count;
+
+-- Thread pagination: WHERE reply_to_id = ? ORDER BY created_at
+CREATE INDEX idx_reply_thread ON messages (reply_to_id, created_at);
+
+-- Backfill counts for existing threads
+UPDATE messages m
+JOIN (
+    SELECT reply_to_id, COUNT(*) AS cnt, MAX(created_at) AS last_at
+    FROM messages
+    WHERE reply_to_id IS NOT NULL
+    GROUP BY reply_to_id
+) r ON r.reply_to_id = m.message_id
+SET m.reply_count = r.cnt, m.last_reply_at = r.last_at;
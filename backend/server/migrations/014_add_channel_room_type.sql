@@ -0,0 +1,6 @@
+-- Migration: Broadcast channel rooms
+-- Date: 2026-10-18
+-- Channel readers are in-memory subscriptions; only owners/admins get room_members rows.
+
+ALTER TABLE rooms
+MODIFY room_type ENUM('public', 'private', 'dm', 'channel') DEFAULT 'public';
@@ -0,0 +1,5 @@
+-- Migration: Keyset index for full-room scans (room export)
+-- Date: 2026-10-18
+
+-- WHERE room_id = ? AND (created_at, message_id) > (?, ?) ORDER BY created_at, message_id
+CREATE INDEX idx_room_created ON messages (room_id, created_at, message_id);
@@ -0,0 +1,14 @@
+-- Migration: Disappearing messages (per-room TTL)
+-- Date: 2026-10-18
+
+ALTER TABLE messages
+ADD COLUMN IF NOT EXISTS expires_at TIMESTAMP NULL;
+
+-- Purge job scans upcoming expiries by time window
+CREATE INDEX idx_expires ON messages (expires_at);
+
+CREATE TABLE IF NOT EXISTS room_message_ttl (
+    room_id VARCHAR(128) PRIMARY KEY,
+    ttl_seconds INT UNSIGNED NOT NULL,
+    updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP
+);
@@ -0,0 +1,23 @@
+-- Migration: Compressed storage for large message content/metadata
+-- Date: 2026-10-18
+--
+-- Values of 1 KB or more are written zlib-compressed (MySQL COMPRESS() layout)
+-- into content_z / metadata_z; the compressed bits say which. content is left
+-- empty and metadata NULL for those rows.
+
+ALTER TABLE messages
+ADD COLUMN IF NOT EXISTS compressed TINYINT UNSIGNED NOT NULL DEFAULT 0,
+ADD COLUMN IF NOT EXISTS content_z MEDIUMBLOB NULL,
+ADD COLUMN IF NOT EXISTS metadata_z MEDIUMBLOB NULL;
+
+-- Expected savings on existing data (run before the backfill):
+--   SELECT COUNT(*) AS large_rows,
+--          SUM(LENGTH(content)) AS raw_bytes,
+--          SUM(LENGTH(COMPRESS(content))) AS compressed_bytes
+--   FROM messages WHERE compressed = 0 AND LENGTH(content) >= 1024;
+--
+-- Optional backfill of existing rows (off-peak; new rows are compressed on write):
+--   UPDATE messages
+--   SET content_z = COMPRESS(content), content = '', compressed = compressed | 1
+--   WHERE compressed & 1 = 0 AND LENGTH(content) >= 1024
+--     AND LENGTH(COMPRESS(content)) * 10 <= LENGTH(content) * 9;
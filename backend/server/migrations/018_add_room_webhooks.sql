@@ -0,0 +1,12 @@
+-- Migration: Outbound webhook subscriptions per room
+-- Date: 2026-10-19
+
+CREATE TABLE IF NOT EXISTS room_webhooks (
+    webhook_id VARCHAR(64) PRIMARY KEY,
+    room_id VARCHAR(128) NOT NULL,
+    url VARCHAR(2048) NOT NULL,
+    secret VARCHAR(128) NOT NULL DEFAULT '',
+    created_by VARCHAR(64) NOT NULL,
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    INDEX idx_room (room_id)
+);
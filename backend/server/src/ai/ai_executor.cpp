@@ -0,0 +1,89 @@
+#include "ai/ai_executor.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <algorithm>
+
+AiExecutor::AiExecutor(size_t threads, size_t maxQueued)
+    : threadCount_(std::max<size_t>(threads, 1)), maxQueued_(std::max<size_t>(maxQueued, 1)) {}
+
+AiExecutor::~AiExecutor() {
+    stop();
+}
+
+void AiExecutor::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    for (size_t i = 0; i < threadCount_; ++i) {
+        threads_.emplace_back([this]() { workerLoop(); });
+    }
+    Logger::info("🤖 AI executor started (" + std::to_string(threadCount_) + " threads)");
+}
+
+void AiExecutor::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        queue_.clear();
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+bool AiExecutor::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || queue_.size() >= maxQueued_) {
+            stats_.rejected++;
+            return false;
+        }
+        queue_.push_back(std::move(task));
+        stats_.submitted++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+AiExecutor::Stats AiExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.queued = queue_.size();
+    return s;
+}
+
+void AiExecutor::workerLoop() {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "ai-executor");
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return !running_ || !queue_.empty(); });
+            if (!running_) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            stats_.running++;
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            Logger::error("AI task error: " + std::string(e.what()));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.running--;
+        stats_.completed++;
+    }
+}
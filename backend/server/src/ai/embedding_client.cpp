@@ -0,0 +1,113 @@
+#include "ai/embedding_client.h"
+#include "utils/logger.h"
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include <cmath>
+
+using json = nlohmann::json;
+
+static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* output) {
+    size_t totalSize = size * nmemb;
+    output->append(static_cast<char*>(contents), totalSize);
+    return totalSize;
+}
+
+EmbeddingClient::EmbeddingClient(Options options) : options_(std::move(options)) {
+    if (options_.endpoint.empty()) {
+        options_.endpoint = "https://generativelanguage.googleapis.com/v1beta/models/text-embedding-004:batchEmbedContents";
+    }
+}
+
+std::optional<std::vector<std::vector<float>>> EmbeddingClient::embed(const std::vector<std::string>& texts,
+                                                                      const char* taskType) {
+    if (texts.empty()) {
+        return std::vector<std::vector<float>>{};
+    }
+
+    json requests = json::array();
+    for (const auto& text : texts) {
+        requests.push_back({
+            {"model", options_.model},
+            {"content", {{"parts", json::array({{{"text", text}}})}}},
+            {"taskType", taskType},
+            {"outputDimensionality", options_.dimensions}
+        });
+    }
+    std::string payload = json{{"requests", requests}}.dump(-1, ' ', false, json::error_handler_t::replace);
+
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        Logger::error("Failed to initialize CURL");
+        return std::nullopt;
+    }
+
+    std::string responseData;
+    std::string url = options_.endpoint + "?key=" + options_.apiKey;
+    struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(payload.size()));
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseData);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, options_.timeoutMs);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    CURLcode res = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK) {
+        Logger::error("Embedding request failed: " + std::string(curl_easy_strerror(res)));
+        return std::nullopt;
+    }
+    if (status != 200) {
+        Logger::error("Embedding request failed: HTTP " + std::to_string(status) + " " + responseData.substr(0, 300));
+        return std::nullopt;
+    }
+
+    try {
+        auto reply = json::parse(responseData);
+        const auto& embeddings = reply.at("embeddings");
+        if (!embeddings.is_array() || embeddings.size() != texts.size()) {
+            Logger::error("Embedding reply has " + std::to_string(embeddings.size()) + " vectors for " +
+                          std::to_string(texts.size()) + " texts");
+            return std::nullopt;
+        }
+
+        std::vector<std::vector<float>> vectors;
+        vectors.reserve(texts.size());
+        for (const auto& embedding : embeddings) {
+            const auto& values = embedding.at("values");
+            if (values.size() < options_.dimensions) {
+                Logger::error("Embedding has " + std::to_string(values.size()) + " dimensions, expected " +
+                              std::to_string(options_.dimensions));
+                return std::nullopt;
+            }
+
+            std::vector<float> vector(options_.dimensions);
+            double norm = 0;
+            for (size_t i = 0; i < options_.dimensions; ++i) {
+                vector[i] = values[i].get<float>();
+                norm += static_cast<double>(vector[i]) * vector[i];
+            }
+            if (norm <= 0) {
+                return std::nullopt;
+            }
+            float scale = static_cast<float>(1.0 / std::sqrt(norm));
+            for (auto& v : vector) {
+                v *= scale;
+            }
+            vectors.push_back(std::move(vector));
+        }
+        return vectors;
+
+    } catch (const std::exception& e) {
+        Logger::error("Failed to parse embedding reply: " + std::string(e.what()));
+        return std::nullopt;
+    }
+}
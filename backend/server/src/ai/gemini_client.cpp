@@ -13,9 +13,11 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::stri
     return totalSize;
 }
 
-GeminiClient::GeminiClient(const std::string& apiKey)
+GeminiClient::GeminiClient(const std::string& apiKey, const std::string& apiEndpoint)
     : apiKey_(apiKey)
-    , apiEndpoint_("https://generativelanguage.googleapis.com/v1beta/models/gemini-1.5-flash:generateContent") {
+    , apiEndpoint_(apiEndpoint.empty()
+          ? "https://generativelanguage.googleapis.com/v1beta/models/gemini-1.5-flash:generateContent"
+          : apiEndpoint) {
     Logger::info("Gemini AI client initialized");
 }
 
@@ -0,0 +1,268 @@
+#include "ai/message_translator.h"
+#include "ai/ai_executor.h"
+#include "utils/logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string batchPrompt(const std::string& language) {
+    return "Translate each chat message in the JSON array below into " + language + ". "
+           "Keep names, @mentions, URLs, code and emoji unchanged and keep the tone. "
+           "Reply with only a JSON array of the translated strings, same length and order.";
+}
+
+} // namespace
+
+struct MessageTranslator::Request {
+    std::mutex mutex;
+    std::vector<Result> results;
+    size_t remaining = 0;
+    Callback callback;
+};
+
+struct MessageTranslator::Batch {
+    std::string language;
+    std::vector<std::string> messageIds;
+    std::vector<std::string> texts;
+    std::vector<uint64_t> sourceHashes;
+    size_t bytes = 0;
+};
+
+MessageTranslator::MessageTranslator(Options options, AiExecutor& executor, Generate generate)
+    : options_(std::move(options))
+    , executor_(executor)
+    , generate_(std::move(generate))
+    , cache_(std::max<size_t>(options_.cacheMessages, 1)) {
+    options_.maxBatch = std::max<size_t>(options_.maxBatch, 1);
+    options_.maxBatchBytes = std::max(options_.maxBatchBytes, options_.maxTextBytes);
+}
+
+void MessageTranslator::translate(const std::vector<Item>& items, const std::string& language, Callback callback) {
+    auto request = std::make_shared<Request>();
+    request->results.resize(items.size());
+    request->remaining = items.size();
+    request->callback = std::move(callback);
+    if (items.empty()) {
+        request->callback({});
+        return;
+    }
+
+    std::vector<std::pair<size_t, std::optional<std::string>>> ready;   // Answered without the AI
+    std::vector<std::shared_ptr<Batch>> opened;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < items.size(); ++i) {
+            const Item& item = items[i];
+            request->results[i].messageId = item.messageId;
+            stats_.requested++;
+
+            if (item.text.empty() || item.text.size() > options_.maxTextBytes) {
+                stats_.failed++;
+                ready.emplace_back(i, std::nullopt);
+                continue;
+            }
+
+            uint64_t sourceHash = std::hash<std::string>{}(item.text);
+            auto cached = cache_.get(item.messageId);
+            if (cached && cached->sourceHash == sourceHash) {
+                auto it = cached->byLanguage.find(language);
+                if (it != cached->byLanguage.end()) {
+                    stats_.cacheHits++;
+                    request->results[i].cached = true;
+                    ready.emplace_back(i, it->second);
+                    continue;
+                }
+            }
+
+            std::string key = flightKey(item.messageId, language, sourceHash);
+            auto flight = inFlight_.find(key);
+            if (flight != inFlight_.end()) {
+                stats_.coalesced++;
+                flight->second.waiters.emplace_back(request, i);
+                continue;
+            }
+            inFlight_[key].waiters.emplace_back(request, i);
+
+            // Join the language's open batch, or open one if it is full
+            auto& batch = open_[language];
+            if (!batch || batch->messageIds.size() >= options_.maxBatch ||
+                batch->bytes + item.text.size() > options_.maxBatchBytes) {
+                batch = std::make_shared<Batch>();
+                batch->language = language;
+                opened.push_back(batch);
+            }
+            batch->messageIds.push_back(item.messageId);
+            batch->texts.push_back(item.text);
+            batch->sourceHashes.push_back(sourceHash);
+            batch->bytes += item.text.size();
+        }
+    }
+
+    for (const auto& batch : opened) {
+        if (!executor_.submit([this, batch]() { run(batch); })) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = open_.find(batch->language);
+                if (it != open_.end() && it->second == batch) {
+                    open_.erase(it);
+                }
+                stats_.rejected++;
+            }
+            finish(batch, std::nullopt);
+        }
+    }
+    for (const auto& [index, text] : ready) {
+        complete(request, index, text);
+    }
+}
+
+void MessageTranslator::invalidate(const std::string& messageId) {
+    if (!cache_.get(messageId)) {
+        return;
+    }
+    cache_.remove(messageId);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.invalidated++;
+}
+
+MessageTranslator::Stats MessageTranslator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// Internals
+// ============================================================================
+
+void MessageTranslator::run(const std::shared_ptr<Batch>& batch) {
+    {
+        // Close the batch: later misses start a new one
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = open_.find(batch->language);
+        if (it != open_.end() && it->second == batch) {
+            open_.erase(it);
+        }
+        stats_.aiCalls++;
+    }
+
+    std::optional<std::vector<std::string>> texts;
+    try {
+        auto reply = generate_(batchPrompt(batch->language), json(batch->texts).dump());
+        if (reply) {
+            texts = parseReply(*reply, batch->texts.size());
+            if (!texts && batch->texts.size() == 1) {
+                // A single message sometimes comes back as plain text
+                std::string text = *reply;
+                text.erase(0, text.find_first_not_of(" \t\r\n"));
+                text.erase(text.find_last_not_of(" \t\r\n") + 1);
+                if (!text.empty()) {
+                    texts = std::vector<std::string>{text};
+                }
+            }
+            if (!texts) {
+                Logger::warning("Translation reply did not match " + std::to_string(batch->texts.size()) + " messages");
+            }
+        }
+    } catch (const std::exception& e) {
+        Logger::error("Translation error: " + std::string(e.what()));
+    }
+    finish(batch, texts);
+}
+
+void MessageTranslator::finish(const std::shared_ptr<Batch>& batch,
+                               const std::optional<std::vector<std::string>>& texts) {
+    std::vector<std::pair<Flight, std::optional<std::string>>> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < batch->messageIds.size(); ++i) {
+            const std::string& messageId = batch->messageIds[i];
+            uint64_t sourceHash = batch->sourceHashes[i];
+            auto flight = inFlight_.find(flightKey(messageId, batch->language, sourceHash));
+            if (flight == inFlight_.end()) {
+                continue;
+            }
+
+            std::optional<std::string> text;
+            if (texts) {
+                text = (*texts)[i];
+                stats_.translated++;
+                // Keep a newer source text's translations if an edit won the race
+                auto entry = cache_.get(messageId).value_or(Translations{sourceHash, {}});
+                if (entry.sourceHash == sourceHash) {
+                    entry.byLanguage[batch->language] = *text;
+                    cache_.put(messageId, entry);
+                }
+            } else {
+                stats_.failed++;
+            }
+            done.emplace_back(std::move(flight->second), std::move(text));
+            inFlight_.erase(flight);
+        }
+    }
+
+    for (const auto& [flight, text] : done) {
+        for (const auto& [request, index] : flight.waiters) {
+            complete(request, index, text);
+        }
+    }
+}
+
+void MessageTranslator::complete(const std::shared_ptr<Request>& request, size_t index,
+                                 const std::optional<std::string>& text) {
+    Callback callback;
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        request->results[index].text = text;
+        if (--request->remaining > 0) {
+            return;
+        }
+        callback = std::move(request->callback);
+        results = std::move(request->results);
+    }
+    callback(std::move(results));
+}
+
+std::string MessageTranslator::flightKey(const std::string& messageId, const std::string& language, uint64_t sourceHash) {
+    return messageId + '\n' + language + '\n' + std::to_string(sourceHash);
+}
+
+bool MessageTranslator::isValidLanguage(const std::string& language) {
+    if (language.size() < 2 || language.size() > 32) {
+        return false;
+    }
+    return std::all_of(language.begin(), language.end(), [](unsigned char c) {
+        return std::isalpha(c) || c == ' ' || c == '-';
+    });
+}
+
+std::optional<std::vector<std::string>> MessageTranslator::parseReply(const std::string& reply, size_t expected) {
+    // Models like to wrap JSON in ```json fences or add a sentence around it
+    size_t start = reply.find('[');
+    size_t end = reply.rfind(']');
+    if (start == std::string::npos || end == std::string::npos || end < start) {
+        return std::nullopt;
+    }
+
+    try {
+        auto parsed = json::parse(reply.substr(start, end - start + 1));
+        if (!parsed.is_array() || parsed.size() != expected) {
+            return std::nullopt;
+        }
+        std::vector<std::string> texts;
+        texts.reserve(expected);
+        for (const auto& item : parsed) {
+            if (!item.is_string()) {
+                return std::nullopt;
+            }
+            texts.push_back(item.get<std::string>());
+        }
+        return texts;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,275 @@
+#include "ai/room_summarizer.h"
+#include "ai/ai_executor.h"
+#include "database/message_codec.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <ctime>
+#include <unordered_set>
+
+namespace {
+
+const char* FOLD_PROMPT =
+    "You maintain a running summary of a group chat for people who were away. "
+    "Update the current summary with the new messages. Keep it under 200 words as short "
+    "bullet points: topics, decisions, who asked for what, open questions. Drop details "
+    "that no longer matter. Reply with the updated summary only.";
+
+uint64_t nowSeconds() {
+    return static_cast<uint64_t>(std::time(nullptr));
+}
+
+} // namespace
+
+RoomSummarizer::RoomSummarizer(Options options, AiExecutor& executor, Generate generate)
+    : options_(std::move(options)), executor_(executor), generate_(std::move(generate)) {
+    options_.blockSize = std::max<size_t>(options_.blockSize, 1);
+    options_.maxPending = std::max(options_.maxPending, options_.blockSize);
+}
+
+void RoomSummarizer::append(const Message& message) {
+    Line line = toLine(message);
+    if (line.text.empty()) {
+        return;
+    }
+    uint64_t now = nowSeconds();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    RoomState& state = roomLocked(message.roomId, now);
+    pushLocked(state, std::move(line));
+    maybeFoldLocked(message.roomId, state, false, now);
+}
+
+bool RoomSummarizer::isKnown(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    return it != rooms_.end() && it->second.seeded;
+}
+
+void RoomSummarizer::seed(const std::string& roomId, std::vector<Message> history) {
+    std::sort(history.begin(), history.end(), [](const Message& a, const Message& b) {
+        return a.timestamp < b.timestamp;
+    });
+    uint64_t now = nowSeconds();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    RoomState& state = roomLocked(roomId, now);
+    if (state.seeded) {
+        return;
+    }
+    state.seeded = true;
+    if (state.summarizedMessages > 0 || !state.folding.empty()) {
+        return;
+    }
+
+    // Messages saved since start are already pending; history fills in before them
+    std::unordered_set<std::string> seen;
+    for (const auto& line : state.pending) {
+        seen.insert(line.messageId);
+    }
+    std::deque<Line> older;
+    for (const auto& message : history) {
+        if (seen.count(message.messageId) == 0) {
+            Line line = toLine(message);
+            if (!line.text.empty()) {
+                older.push_back(std::move(line));
+            }
+        }
+    }
+    state.pending.insert(state.pending.begin(), older.begin(), older.end());
+    while (state.pending.size() > options_.maxPending) {
+        state.pending.pop_front();
+        stats_.messagesDropped++;
+    }
+}
+
+RoomSummarizer::Snapshot RoomSummarizer::snapshot(const std::string& roomId, const std::optional<Waiter>& waiter) {
+    uint64_t now = nowSeconds();
+    Snapshot snap;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return snap;
+    }
+    RoomState& state = it->second;
+
+    // Catching up needs more than the tail shows: fold now instead of at the next full block
+    if (state.folding.size() + state.pending.size() > options_.tailSize) {
+        maybeFoldLocked(roomId, state, true, now);
+    }
+
+    snap.known = state.seeded;
+    snap.summary = state.summary;
+    snap.summarizedMessages = state.summarizedMessages;
+    snap.updatedAt = state.updatedAt;
+    snap.updating = !state.folding.empty();
+
+    size_t unsummarized = state.folding.size() + state.pending.size();
+    size_t skip = unsummarized > options_.tailSize ? unsummarized - options_.tailSize : 0;
+    for (size_t i = skip; i < unsummarized; ++i) {
+        snap.tail.push_back(i < state.folding.size() ? state.folding[i] : state.pending[i - state.folding.size()]);
+    }
+
+    if (snap.updating && waiter) {
+        bool waiting = std::any_of(state.waiters.begin(), state.waiters.end(), [&](const Waiter& w) {
+            return w.userId == waiter->userId && w.roomId == waiter->roomId;
+        });
+        if (!waiting) {
+            state.waiters.push_back(*waiter);
+        }
+    }
+    return snap;
+}
+
+RoomSummarizer::Stats RoomSummarizer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.rooms = rooms_.size();
+    return s;
+}
+
+// ============================================================================
+// Internals
+// ============================================================================
+
+RoomSummarizer::RoomState& RoomSummarizer::roomLocked(const std::string& roomId, uint64_t now) {
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        if (rooms_.size() >= options_.maxRooms) {
+            // Evict the quietest room that has no fold in flight
+            auto victim = rooms_.end();
+            for (auto candidate = rooms_.begin(); candidate != rooms_.end(); ++candidate) {
+                if (candidate->second.folding.empty() &&
+                    (victim == rooms_.end() || candidate->second.lastActive < victim->second.lastActive)) {
+                    victim = candidate;
+                }
+            }
+            if (victim != rooms_.end()) {
+                rooms_.erase(victim);
+            }
+        }
+        it = rooms_.emplace(roomId, RoomState{}).first;
+    }
+    it->second.lastActive = now;
+    return it->second;
+}
+
+void RoomSummarizer::pushLocked(RoomState& state, Line line) {
+    state.pending.push_back(std::move(line));
+    while (state.pending.size() > options_.maxPending) {
+        state.pending.pop_front();
+        stats_.messagesDropped++;
+    }
+}
+
+void RoomSummarizer::maybeFoldLocked(const std::string& roomId, RoomState& state, bool force, uint64_t now) {
+    if (!state.folding.empty() || state.pending.empty() || now < state.retryAfter) {
+        return;
+    }
+    if (!force && state.pending.size() < options_.blockSize) {
+        return;
+    }
+
+    size_t count = std::min(options_.blockSize, state.pending.size());
+    state.folding.assign(std::make_move_iterator(state.pending.begin()),
+                         std::make_move_iterator(state.pending.begin() + count));
+    state.pending.erase(state.pending.begin(), state.pending.begin() + count);
+
+    bool submitted = executor_.submit([this, roomId, previous = state.summary, block = state.folding]() {
+        fold(roomId, previous, block);
+    });
+    if (!submitted) {
+        state.pending.insert(state.pending.begin(), std::make_move_iterator(state.folding.begin()),
+                             std::make_move_iterator(state.folding.end()));
+        state.folding.clear();
+        state.retryAfter = now + options_.retryDelaySeconds;
+        stats_.foldsRejected++;
+    }
+}
+
+void RoomSummarizer::fold(const std::string& roomId, const std::string& previous, const std::vector<Line>& block) {
+    std::string message = "Current summary:\n" + (previous.empty() ? std::string("(none yet)") : previous) +
+                          "\n\nNew messages:\n";
+    for (const auto& line : block) {
+        message += line.senderName + ": " + line.text + "\n";
+    }
+
+    std::optional<std::string> result;
+    try {
+        result = generate_(FOLD_PROMPT, message);
+    } catch (const std::exception& e) {
+        Logger::error("Room summary error: " + std::string(e.what()));
+    }
+    if (result) {
+        result->erase(0, result->find_first_not_of(" \t\r\n"));
+        result->erase(result->find_last_not_of(" \t\r\n") + 1);
+        if (result->empty()) {
+            result.reset();
+        }
+    }
+
+    std::vector<Waiter> waiters;
+    {
+        uint64_t now = nowSeconds();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = rooms_.find(roomId);
+        if (it == rooms_.end()) {
+            return;
+        }
+        RoomState& state = it->second;
+
+        if (result) {
+            state.summary = std::move(*result);
+            state.summarizedMessages += state.folding.size();
+            state.updatedAt = now;
+            stats_.folds++;
+            stats_.messagesFolded += state.folding.size();
+        } else {
+            // Keep the block for the next attempt
+            state.pending.insert(state.pending.begin(), std::make_move_iterator(state.folding.begin()),
+                                 std::make_move_iterator(state.folding.end()));
+            while (state.pending.size() > options_.maxPending) {
+                state.pending.pop_front();
+                stats_.messagesDropped++;
+            }
+            state.retryAfter = now + options_.retryDelaySeconds;
+            stats_.foldFailures++;
+            Logger::warning("⚠️ Room summary update failed for " + roomId + ", retrying later");
+        }
+        state.folding.clear();
+
+        // Someone is waiting to catch up: keep folding until the tail covers the rest
+        bool catchingUp = !state.waiters.empty() && state.pending.size() > options_.tailSize;
+        maybeFoldLocked(roomId, state, catchingUp, now);
+        if (state.folding.empty()) {
+            waiters = std::move(state.waiters);
+            state.waiters.clear();
+        }
+    }
+
+    if (!waiters.empty() && onUpdated_) {
+        onUpdated_(roomId, waiters);
+    }
+}
+
+RoomSummarizer::Line RoomSummarizer::toLine(const Message& message) const {
+    Message plain = message;
+    message_codec::inflate(plain);
+
+    Line line;
+    line.messageId = plain.messageId;
+    line.senderName = plain.senderName.empty() ? plain.senderId : plain.senderName;
+    line.timestamp = plain.timestamp;
+    line.text = plain.messageType == 0 ? plain.content : "[attachment] " + plain.content;
+
+    std::replace(line.text.begin(), line.text.end(), '\n', ' ');
+    if (line.text.size() > options_.maxLineBytes) {
+        size_t cut = options_.maxLineBytes;
+        while (cut > 0 && (static_cast<unsigned char>(line.text[cut]) & 0xC0) == 0x80) {
+            --cut;
+        }
+        line.text.resize(cut);
+        line.text += "…";
+    }
+    return line;
+}
@@ -0,0 +1,182 @@
+#include "analytics/activity_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <unordered_set>
+#include <vector>
+
+using json = nlohmann::json;
+
+ActivityStats::ActivityStats()
+    : startedAt_(static_cast<uint64_t>(std::time(nullptr))),
+      minuteSeries_(60, 60),
+      hourSeries_(48, 3600),
+      minuteSenders_(60, 60, 10),
+      hourSenders_(24, 3600, 12) {}
+
+ActivityStats::HitterWindow& ActivityStats::hitterWindow(uint64_t hour) {
+    HitterWindow& window = hitters_[hour % hitters_.size()];
+    if (window.hour.load(std::memory_order_acquire) < hour) {
+        std::lock_guard<std::mutex> lock(window.rotateMutex);
+        if (window.hour.load(std::memory_order_relaxed) < hour) {
+            window.roomCounts.clear();
+            window.posterCounts.clear();
+            window.rooms.clear();
+            window.posters.clear();
+            window.hour.store(hour, std::memory_order_release);
+        }
+    }
+    return window;
+}
+
+std::shared_ptr<ActivityStats::RoomActivity> ActivityStats::roomActivity(const std::string& roomId,
+                                                                         uint64_t roomHash, bool create,
+                                                                         uint64_t timestamp) {
+    RoomShard& shard = roomShards_[roomHash % ROOM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (create && timestamp >= shard.nextPruneAt) {
+        // Amortized: rooms that went idle are dropped even if nobody reads the stats
+        pruneShard(shard, timestamp);
+        shard.nextPruneAt = timestamp + PRUNE_INTERVAL_SECONDS;
+    }
+    auto it = shard.rooms.find(roomId);
+    if (it != shard.rooms.end()) {
+        return it->second;
+    }
+    if (!create) {
+        return nullptr;
+    }
+    auto activity = std::make_shared<RoomActivity>();
+    shard.rooms.emplace(roomId, activity);
+    return activity;
+}
+
+void ActivityStats::record(const std::string& roomId, const std::string& senderId, uint64_t timestamp) {
+    uint64_t roomHash = sketch::hashKey(roomId);
+    uint64_t senderHash = sketch::hashKey(senderId);
+
+    totalMessages_.fetch_add(1, std::memory_order_relaxed);
+    minuteSeries_.add(timestamp);
+    hourSeries_.add(timestamp);
+    minuteSenders_.add(timestamp, senderHash);
+    hourSenders_.add(timestamp, senderHash);
+
+    HitterWindow& window = hitterWindow(timestamp / 3600);
+    window.rooms.offer(roomId, window.roomCounts.add(roomHash));
+    window.posters.offer(senderId, window.posterCounts.add(senderHash));
+
+    auto room = roomActivity(roomId, roomHash, true, timestamp);
+    room->minutes.add(timestamp);
+    room->senders.add(timestamp, senderHash);
+    room->total.fetch_add(1, std::memory_order_relaxed);
+    room->lastActive.store(timestamp, std::memory_order_relaxed);
+}
+
+json ActivityStats::serverSnapshot(uint64_t now, size_t topN) {
+    pruneIdleRooms(now);
+
+    json minutes = json::array();
+    for (const auto& [start, count] : minuteSeries_.snapshot(now)) {
+        minutes.push_back({start * 1000, count});
+    }
+    json hours = json::array();
+    for (const auto& [start, count] : hourSeries_.snapshot(now)) {
+        hours.push_back({start * 1000, count});
+    }
+
+    // Heavy hitters: candidates from both windows, counts summed across them
+    uint64_t hour = now / 3600;
+    std::vector<const HitterWindow*> windows;
+    for (const auto& window : hitters_) {
+        uint64_t windowHour = window.hour.load(std::memory_order_acquire);
+        if (windowHour == hour || windowHour + 1 == hour) {
+            windows.push_back(&window);
+        }
+    }
+
+    auto topList = [&](bool rooms) {
+        std::unordered_set<std::string> candidates;
+        for (const auto* window : windows) {
+            for (const auto& [key, count] : (rooms ? window->rooms : window->posters).items()) {
+                candidates.insert(key);
+            }
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> ranked;
+        for (const auto& key : candidates) {
+            uint64_t hash = sketch::hashKey(key);
+            uint64_t count = 0;
+            for (const auto* window : windows) {
+                count += (rooms ? window->roomCounts : window->posterCounts).estimate(hash);
+            }
+            ranked.emplace_back(key, count);
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        if (ranked.size() > topN) ranked.resize(topN);
+
+        json list = json::array();
+        for (const auto& [key, count] : ranked) {
+            list.push_back({{rooms ? "roomId" : "userId", key}, {"messages", count}});
+        }
+        return list;
+    };
+
+    size_t activeRooms = 0;
+    for (auto& shard : roomShards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        activeRooms += shard.rooms.size();
+    }
+
+    return {
+        {"now", now * 1000},
+        {"uptimeSeconds", now > startedAt_ ? now - startedAt_ : 0},
+        {"totalMessages", totalMessages_.load(std::memory_order_relaxed)},
+        {"messagesLastMinute", minuteSeries_.total(now, 1)},
+        {"messagesLastHour", minuteSeries_.total(now, 60)},
+        {"uniqueSendersLastHour", std::llround(minuteSenders_.estimate(now, 60))},
+        {"uniqueSendersLastDay", std::llround(hourSenders_.estimate(now, 24))},
+        {"activeRooms", activeRooms},
+        {"busiestRooms", topList(true)},
+        {"topPosters", topList(false)},
+        {"perMinute", minutes},
+        {"perHour", hours}
+    };
+}
+
+json ActivityStats::roomSnapshot(const std::string& roomId, uint64_t now) {
+    auto room = roomActivity(roomId, sketch::hashKey(roomId), false);
+    if (!room) {
+        return nullptr;
+    }
+
+    json minutes = json::array();
+    for (const auto& [start, count] : room->minutes.snapshot(now)) {
+        minutes.push_back({start * 1000, count});
+    }
+
+    return {
+        {"roomId", roomId},
+        {"totalMessages", room->total.load(std::memory_order_relaxed)},
+        {"lastActive", room->lastActive.load(std::memory_order_relaxed) * 1000},
+        {"messagesLastHour", room->minutes.total(now, 60)},
+        {"uniqueSendersLastHour", std::llround(room->senders.estimate(now, 6))},
+        {"perMinute", minutes}
+    };
+}
+
+void ActivityStats::pruneIdleRooms(uint64_t now) {
+    for (auto& shard : roomShards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        pruneShard(shard, now);
+    }
+}
+
+void ActivityStats::pruneShard(RoomShard& shard, uint64_t now) {
+    for (auto it = shard.rooms.begin(); it != shard.rooms.end();) {
+        if (it->second->lastActive.load(std::memory_order_relaxed) + ROOM_IDLE_SECONDS < now) {
+            it = shard.rooms.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,334 @@
+#include "analytics/sketches.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace sketch {
+
+uint64_t hashKey(const std::string& key) {
+    uint64_t h = std::hash<std::string>{}(key);
+    h += 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// ============================================================================
+// HYPERLOGLOG
+// ============================================================================
+
+HyperLogLog::HyperLogLog(uint8_t precision)
+    : precision_(std::clamp<uint8_t>(precision, 4, 16)),
+      size_(size_t{1} << precision_),
+      registers_(new std::atomic<uint8_t>[size_]) {
+    clear();
+}
+
+void HyperLogLog::add(uint64_t hash) {
+    size_t index = static_cast<size_t>(hash >> (64 - precision_));
+    // Rank of the first set bit in the remaining bits (sentinel bit caps it)
+    uint64_t rest = (hash << precision_) | (uint64_t{1} << (precision_ - 1));
+    uint8_t rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+
+    auto& reg = registers_[index];
+    uint8_t current = reg.load(std::memory_order_relaxed);
+    while (rank > current && !reg.compare_exchange_weak(current, rank, std::memory_order_relaxed)) {
+    }
+}
+
+double HyperLogLog::estimate() const {
+    std::vector<uint8_t> registers(size_);
+    for (size_t i = 0; i < size_; ++i) {
+        registers[i] = registers_[i].load(std::memory_order_relaxed);
+    }
+    return estimateRegisters(registers);
+}
+
+void HyperLogLog::clear() {
+    for (size_t i = 0; i < size_; ++i) {
+        registers_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+double HyperLogLog::estimateUnion(const std::vector<const HyperLogLog*>& sketches) {
+    if (sketches.empty()) {
+        return 0;
+    }
+    size_t size = sketches.front()->size_;
+    std::vector<uint8_t> registers(size, 0);
+    for (const auto* s : sketches) {
+        if (s->size_ != size) continue;
+        for (size_t i = 0; i < size; ++i) {
+            registers[i] = std::max(registers[i], s->registers_[i].load(std::memory_order_relaxed));
+        }
+    }
+    return estimateRegisters(registers);
+}
+
+double HyperLogLog::estimateRegisters(const std::vector<uint8_t>& registers) {
+    // Ertl's improved estimator ("New cardinality estimation algorithms for
+    // HyperLogLog sketches", 2017): one formula over the register histogram,
+    // without the bias of the classic raw estimate just above the switch to
+    // linear counting (around 2.5m, several percent off)
+    double m = static_cast<double>(registers.size());
+    int q = 64 - std::countr_zero(registers.size());  // Bits left after the index
+    std::vector<double> histogram(q + 2, 0.0);
+    for (uint8_t r : registers) {
+        histogram[std::min<int>(r, q + 1)] += 1;
+    }
+
+    // sigma(x) = x + sum_k x^(2^k) 2^(k-1), for the empty registers
+    auto sigma = [](double x) {
+        if (x == 1) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double y = 1;
+        double z = x;
+        double previous;
+        do {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        } while (z != previous);
+        return z;
+    };
+    // tau(x) = (1 - x - sum_k (1 - x^(2^-k))^2 2^-k) / 3, for the saturated registers
+    auto tau = [](double x) {
+        if (x == 0 || x == 1) {
+            return 0.0;
+        }
+        double y = 1;
+        double z = 1 - x;
+        double previous;
+        do {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= (1 - x) * (1 - x) * y;
+        } while (z != previous);
+        return z / 3;
+    };
+
+    double z = m * tau(1 - histogram[q + 1] / m);
+    for (int k = q; k >= 1; --k) {
+        z = 0.5 * (z + histogram[k]);
+    }
+    z += m * sigma(histogram[0] / m);
+    if (std::isinf(z)) {
+        return 0;  // Nothing added
+    }
+    return m * m / (2 * std::log(2.0)) / z;
+}
+
+// ============================================================================
+// COUNT-MIN SKETCH
+// ============================================================================
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width_(std::bit_ceil(std::max<size_t>(width, 16))),
+      depth_(std::max<size_t>(depth, 1)),
+      counters_(new std::atomic<uint32_t>[width_ * depth_]) {
+    clear();
+}
+
+size_t CountMinSketch::cell(uint64_t hash, size_t row) const {
+    // Double hashing: row i uses h1 + i * h2
+    uint64_t h1 = hash & 0xffffffffULL;
+    uint64_t h2 = (hash >> 32) | 1;
+    return row * width_ + static_cast<size_t>((h1 + row * h2) & (width_ - 1));
+}
+
+uint64_t CountMinSketch::add(uint64_t hash, uint32_t n) {
+    // Conservative update: only raise counters below the new estimate, which
+    // keeps collisions from inflating heavy hitters
+    uint64_t updated = estimate(hash) + n;
+    uint32_t target = static_cast<uint32_t>(std::min<uint64_t>(updated, UINT32_MAX));
+    for (size_t row = 0; row < depth_; ++row) {
+        auto& counter = counters_[cell(hash, row)];
+        uint32_t current = counter.load(std::memory_order_relaxed);
+        while (current < target && !counter.compare_exchange_weak(current, target, std::memory_order_relaxed)) {
+        }
+    }
+    return target;
+}
+
+uint64_t CountMinSketch::estimate(uint64_t hash) const {
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < depth_; ++row) {
+        estimate = std::min<uint64_t>(estimate, counters_[cell(hash, row)].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+void CountMinSketch::clear() {
+    for (size_t i = 0; i < width_ * depth_; ++i) {
+        counters_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// ============================================================================
+// TOP-K
+// ============================================================================
+
+TopK::TopK(size_t k) : k_(std::max<size_t>(k, 1)) {
+    heap_.reserve(k_);
+}
+
+void TopK::offer(const std::string& key, uint64_t count) {
+    if (count <= floor_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto byCount = std::greater<>();  // Min-heap
+    auto existing = std::find_if(heap_.begin(), heap_.end(),
+                                 [&key](const auto& entry) { return entry.second == key; });
+    if (existing != heap_.end()) {
+        if (count <= existing->first) return;
+        existing->first = count;
+        std::make_heap(heap_.begin(), heap_.end(), byCount);  // k is small
+    } else if (heap_.size() < k_) {
+        heap_.emplace_back(count, key);
+        std::push_heap(heap_.begin(), heap_.end(), byCount);
+    } else if (count > heap_.front().first) {
+        std::pop_heap(heap_.begin(), heap_.end(), byCount);
+        heap_.back() = {count, key};
+        std::push_heap(heap_.begin(), heap_.end(), byCount);
+    } else {
+        return;
+    }
+
+    floor_.store(heap_.size() == k_ ? heap_.front().first : 0, std::memory_order_relaxed);
+}
+
+std::vector<std::pair<std::string, uint64_t>> TopK::items() const {
+    std::vector<std::pair<std::string, uint64_t>> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.reserve(heap_.size());
+        for (const auto& [count, key] : heap_) {
+            result.emplace_back(key, count);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    return result;
+}
+
+void TopK::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heap_.clear();
+    floor_.store(0, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// RING SERIES
+// ============================================================================
+
+RingSeries::RingSeries(size_t slots, uint64_t slotSeconds)
+    : slots_(std::max<size_t>(slots, 1)),
+      slotSeconds_(std::max<uint64_t>(slotSeconds, 1)),
+      words_(new std::atomic<uint64_t>[slots_]) {
+    for (size_t i = 0; i < slots_; ++i) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void RingSeries::add(uint64_t now, uint32_t n) {
+    uint64_t slot = now / slotSeconds_;
+    uint64_t tag = slot & 0xffffffffULL;
+    auto& word = words_[slot % slots_];
+
+    uint64_t current = word.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t currentTag = current >> 32;
+        uint64_t desired;
+        if (currentTag == tag) {
+            desired = current + n;
+        } else if (currentTag < tag) {
+            desired = (tag << 32) | n;  // Slot rolled over: start a fresh count
+        } else {
+            return;  // Late update for a slot that has already been reused
+        }
+        if (word.compare_exchange_weak(current, desired, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+uint64_t RingSeries::countAt(uint64_t slot) const {
+    uint64_t word = words_[slot % slots_].load(std::memory_order_relaxed);
+    return (word >> 32) == (slot & 0xffffffffULL) ? (word & 0xffffffffULL) : 0;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> RingSeries::snapshot(uint64_t now) const {
+    uint64_t last = now / slotSeconds_;
+    uint64_t first = last + 1 >= slots_ ? last + 1 - slots_ : 0;
+
+    std::vector<std::pair<uint64_t, uint64_t>> result;
+    result.reserve(slots_);
+    for (uint64_t slot = first; slot <= last; ++slot) {
+        result.emplace_back(slot * slotSeconds_, countAt(slot));
+    }
+    return result;
+}
+
+uint64_t RingSeries::total(uint64_t now, size_t lastSlots) const {
+    uint64_t last = now / slotSeconds_;
+    lastSlots = std::min(lastSlots, slots_);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < lastSlots && i <= last; ++i) {
+        sum += countAt(last - i);
+    }
+    return sum;
+}
+
+// ============================================================================
+// WINDOWED HYPERLOGLOG
+// ============================================================================
+
+WindowedHyperLogLog::WindowedHyperLogLog(size_t slots, uint64_t slotSeconds, uint8_t precision)
+    : slots_(std::max<size_t>(slots, 1)),
+      slotSeconds_(std::max<uint64_t>(slotSeconds, 1)) {
+    ring_.reserve(slots_);
+    for (size_t i = 0; i < slots_; ++i) {
+        ring_.push_back(std::make_unique<Slot>(precision));
+    }
+}
+
+void WindowedHyperLogLog::add(uint64_t now, uint64_t hash) {
+    uint64_t number = now / slotSeconds_;
+    Slot& slot = *ring_[number % slots_];
+
+    uint64_t current = slot.number.load(std::memory_order_acquire);
+    if (current != number) {
+        if (current > number) {
+            return;  // Late update for a reused slot
+        }
+        // First add in a new slot: clear it before publishing the slot number
+        std::lock_guard<std::mutex> lock(slot.rotateMutex);
+        if (slot.number.load(std::memory_order_relaxed) < number) {
+            slot.hll.clear();
+            slot.number.store(number, std::memory_order_release);
+        }
+    }
+    slot.hll.add(hash);
+}
+
+double WindowedHyperLogLog::estimate(uint64_t now, size_t lastSlots) const {
+    uint64_t last = now / slotSeconds_;
+    lastSlots = std::min(lastSlots, slots_);
+
+    std::vector<const HyperLogLog*> live;
+    for (size_t i = 0; i < lastSlots && i <= last; ++i) {
+        const Slot& slot = *ring_[(last - i) % slots_];
+        if (slot.number.load(std::memory_order_acquire) == last - i) {
+            live.push_back(&slot.hll);
+        }
+    }
+    return HyperLogLog::estimateUnion(live);
+}
+
+} // namespace sketch
@@ -18,11 +18,13 @@ AuthManager::AuthManager(std::shared_ptr<MySQLClient> db,
 
 bool AuthManager::registerUser(const UserRegistration& reg) {
     try {
-        // Check if username exists
-        auto existing = db_->getUser(reg.username);
-        if (existing) {
-            Logger::warning("Register failed: username đã tồn tại: " + reg.username);
-            return false;
+        // Check if username exists (Bloom filter first; the UNIQUE key still guards races)
+        if (!directory_ || directory_->mayHaveUsername(reg.username)) {
+            auto existing = db_->getUser(reg.username);
+            if (existing) {
+                Logger::warning("Register failed: username đã tồn tại: " + reg.username);
+                return false;
+            }
         }
         
         // Hash password với SHA256
@@ -41,6 +43,9 @@ bool AuthManager::registerUser(const UserRegistration& reg) {
         bool created = db_->createUser(newUser);
         if (created) {
             Logger::info("✓ User đăng ký thành công: " + reg.username);
+            if (directory_) {
+                directory_->addUser(newUser);
+            }
         }
         
         return created;
@@ -16,6 +16,7 @@ Config ConfigLoader::load(const std::string& envFile) {
     config.mysqlUser = getEnv(env, "MYSQL_USER", "chatbox");
     config.mysqlPassword = getEnv(env, "MYSQL_PASSWORD");
     config.mysqlDatabase = getEnv(env, "MYSQL_DATABASE", "chatbox_db");
+    config.messageShards = getEnv(env, "MESSAGE_SHARDS", "");
     
     // AWS Configuration (optional)
     config.awsAccessKey = getEnv(env, "AWS_ACCESS_KEY_ID");
@@ -27,6 +28,27 @@ Config ConfigLoader::load(const std::string& envFile) {
     config.serverIP = getEnv(env, "SERVER_IP", "0.0.0.0");
     config.serverPort = getEnvInt(env, "SERVER_PORT", 8080);
     config.serverHost = getEnv(env, "SERVER_HOST", "0.0.0.0");
+    config.roomWorkers = getEnvInt(env, "ROOM_WORKERS", 0);
+    config.ioBackend = getEnv(env, "IO_BACKEND", "posix");
+    config.adminToken = getEnv(env, "ADMIN_TOKEN");
+    config.uploadMaxActive = getEnvInt(env, "UPLOAD_MAX_ACTIVE", 8);
+    config.uploadMaxPerUser = getEnvInt(env, "UPLOAD_MAX_PER_USER", 2);
+    config.uploadDiskMBps = getEnvInt(env, "UPLOAD_DISK_MBPS", 64);
+    config.webhookBatchMax = getEnvInt(env, "WEBHOOK_BATCH_MAX", 50);
+    config.webhookBatchDelayMs = getEnvInt(env, "WEBHOOK_BATCH_DELAY_MS", 1000);
+    config.webhookMaxAttempts = getEnvInt(env, "WEBHOOK_MAX_ATTEMPTS", 5);
+    config.webhookDeadLetterPath = getEnv(env, "WEBHOOK_DEAD_LETTER_PATH", "./data/webhooks-dead-letter.jsonl");
+    config.warmupRooms = getEnvInt(env, "WARMUP_ROOMS", 200);
+    config.cpuLoop = getEnv(env, "CPU_LOOP");
+    config.cpuRoomWorkers = getEnv(env, "CPU_ROOM_WORKERS");
+    config.cpuBackground = getEnv(env, "CPU_BACKGROUND");
+    config.lockProfiling = getEnvBool(env, "LOCK_PROFILING", false);
+    config.loadShedding = getEnvBool(env, "LOAD_SHEDDING", true);
+    config.loadLagMs = getEnv(env, "LOAD_LAG_MS", "50,150,400");
+    config.linkPreviews = getEnvBool(env, "LINK_PREVIEWS", true);
+    config.linkPreviewTimeoutMs = getEnvInt(env, "LINK_PREVIEW_TIMEOUT_MS", 5000);
+    config.linkPreviewMaxBytes = getEnvInt(env, "LINK_PREVIEW_MAX_BYTES", 262144);
+    config.linkPreviewAllowPrivate = getEnvBool(env, "LINK_PREVIEW_ALLOW_PRIVATE", false);
     
     // JWT Configuration
     config.jwtSecret = getEnv(env, "JWT_SECRET");
@@ -34,6 +56,14 @@ Config ConfigLoader::load(const std::string& envFile) {
     
     // Gemini AI
     config.geminiApiKey = getEnv(env, "GEMINI_API_KEY");
+    config.geminiApiEndpoint = getEnv(env, "GEMINI_API_ENDPOINT");
+    config.aiWorkers = getEnvInt(env, "AI_WORKERS", 2);
+    config.aiSummaryBlock = getEnvInt(env, "AI_SUMMARY_BLOCK", 50);
+    config.semanticSearch = getEnvBool(env, "SEMANTIC_SEARCH", true);
+    config.embeddingApiEndpoint = getEnv(env, "EMBEDDING_API_ENDPOINT");
+    config.embeddingDimensions = getEnvInt(env, "EMBEDDING_DIMENSIONS", 256);
+    config.semanticIndexDir = getEnv(env, "SEMANTIC_INDEX_DIR", "./data/semantic");
+    config.semanticBackfillDays = getEnvInt(env, "SEMANTIC_BACKFILL_DAYS", 30);
     
     // Debug
     config.debug = getEnvBool(env, "DEBUG", false);
@@ -81,11 +111,17 @@ std::map<std::string, std::string> ConfigLoader::parseEnvFile(const std::string&
     
     // Override with environment variables if they exist
     const char* envVars[] = {
-        "MYSQL_HOST", "MYSQL_PORT", "MYSQL_USER", "MYSQL_PASSWORD", "MYSQL_DATABASE",
+        "MYSQL_HOST", "MYSQL_PORT", "MYSQL_USER", "MYSQL_PASSWORD", "MYSQL_DATABASE", "MESSAGE_SHARDS",
         "AWS_ACCESS_KEY_ID", "AWS_SECRET_ACCESS_KEY", "AWS_REGION", "S3_BUCKET",
-        "SERVER_IP", "SERVER_PORT", "SERVER_HOST", "WS_PORT",
+        "SERVER_IP", "SERVER_PORT", "SERVER_HOST", "WS_PORT", "ADMIN_TOKEN",
+        "UPLOAD_MAX_ACTIVE", "UPLOAD_MAX_PER_USER", "UPLOAD_DISK_MBPS",
+        "WEBHOOK_BATCH_MAX", "WEBHOOK_BATCH_DELAY_MS", "WEBHOOK_MAX_ATTEMPTS", "WEBHOOK_DEAD_LETTER_PATH",
+        "WARMUP_ROOMS", "CPU_LOOP", "CPU_ROOM_WORKERS", "CPU_BACKGROUND",
+        "LOCK_PROFILING", "LOAD_SHEDDING", "LOAD_LAG_MS",
+        "LINK_PREVIEWS", "LINK_PREVIEW_TIMEOUT_MS", "LINK_PREVIEW_MAX_BYTES", "LINK_PREVIEW_ALLOW_PRIVATE",
         "JWT_SECRET", "JWT_EXPIRY",
-        "GEMINI_API_KEY",
+        "GEMINI_API_KEY", "GEMINI_API_ENDPOINT", "AI_WORKERS", "AI_SUMMARY_BLOCK",
+        "SEMANTIC_SEARCH", "EMBEDDING_API_ENDPOINT", "EMBEDDING_DIMENSIONS", "SEMANTIC_INDEX_DIR", "SEMANTIC_BACKFILL_DAYS",
         "DEBUG", "LOG_LEVEL"
     };
     
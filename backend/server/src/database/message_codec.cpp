@@ -0,0 +1,121 @@
+#include "database/message_codec.h"
+#include "utils/logger.h"
+#include <zlib.h>
+#include <atomic>
+#include <chrono>
+
+namespace message_codec {
+
+namespace {
+
+constexpr size_t HEADER_BYTES = 4;                 // Little-endian uncompressed length
+constexpr size_t MAX_INFLATED_BYTES = 1u << 30;    // COMPRESS() keeps 30 length bits
+constexpr size_t MAX_DEFLATE_RATIO = 1032;         // Best case for deflate
+
+std::atomic<uint64_t> valuesCompressed{0};
+std::atomic<uint64_t> valuesSkipped{0};
+std::atomic<uint64_t> rawBytes{0};
+std::atomic<uint64_t> storedBytes{0};
+std::atomic<uint64_t> valuesInflated{0};
+std::atomic<uint64_t> inflateMicros{0};
+
+bool inflateField(std::string& field, const char* name, const std::string& messageId) {
+    auto value = decompress(field);
+    if (!value) {
+        Logger::error("❌ Corrupt compressed " + std::string(name) + " in message " + messageId);
+        field.clear();
+        return false;
+    }
+    field = std::move(*value);
+    return true;
+}
+
+} // namespace
+
+std::optional<std::string> compress(const std::string& value) {
+    if (value.size() < MIN_BYTES || value.size() >= MAX_INFLATED_BYTES) {
+        return std::nullopt;
+    }
+
+    uLongf bound = compressBound(static_cast<uLong>(value.size()));
+    std::string blob(HEADER_BYTES + bound, '\0');
+    uint32_t length = static_cast<uint32_t>(value.size());
+    for (size_t i = 0; i < HEADER_BYTES; ++i) {
+        blob[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+
+    uLongf written = bound;
+    int rc = compress2(reinterpret_cast<Bytef*>(&blob[HEADER_BYTES]), &written,
+                       reinterpret_cast<const Bytef*>(value.data()), static_cast<uLong>(value.size()),
+                       Z_DEFAULT_COMPRESSION);
+    blob.resize(HEADER_BYTES + written);
+
+    if (rc != Z_OK || blob.size() * 10 > value.size() * 9) {
+        valuesSkipped.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    valuesCompressed.fetch_add(1, std::memory_order_relaxed);
+    rawBytes.fetch_add(value.size(), std::memory_order_relaxed);
+    storedBytes.fetch_add(blob.size(), std::memory_order_relaxed);
+    return blob;
+}
+
+std::optional<std::string> decompress(const std::string& blob) {
+    if (blob.size() <= HEADER_BYTES) {
+        return std::nullopt;
+    }
+
+    uint32_t length = 0;
+    for (size_t i = 0; i < HEADER_BYTES; ++i) {
+        length |= static_cast<uint32_t>(static_cast<unsigned char>(blob[i])) << (8 * i);
+    }
+    length &= 0x3FFFFFFF;
+    if (length > (blob.size() - HEADER_BYTES) * MAX_DEFLATE_RATIO) {
+        return std::nullopt;  // Corrupt header: no zlib stream inflates this far
+    }
+
+    std::string value(length, '\0');
+    uLongf written = length;
+    int rc = uncompress(reinterpret_cast<Bytef*>(value.data()), &written,
+                        reinterpret_cast<const Bytef*>(blob.data() + HEADER_BYTES),
+                        static_cast<uLong>(blob.size() - HEADER_BYTES));
+    if (rc != Z_OK || written != length) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+void inflate(Message& message) {
+    if (!message.compressed) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (message.compressed & Message::CONTENT_COMPRESSED) {
+        inflateField(message.content, "content", message.messageId);
+        valuesInflated.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (message.compressed & Message::METADATA_COMPRESSED) {
+        inflateField(message.metadata, "metadata", message.messageId);
+        valuesInflated.fetch_add(1, std::memory_order_relaxed);
+    }
+    message.compressed = 0;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    inflateMicros.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+}
+
+Stats stats() {
+    Stats s;
+    s.valuesCompressed = valuesCompressed.load(std::memory_order_relaxed);
+    s.valuesSkipped = valuesSkipped.load(std::memory_order_relaxed);
+    s.rawBytes = rawBytes.load(std::memory_order_relaxed);
+    s.storedBytes = storedBytes.load(std::memory_order_relaxed);
+    s.valuesInflated = valuesInflated.load(std::memory_order_relaxed);
+    s.inflateMicros = inflateMicros.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace message_codec
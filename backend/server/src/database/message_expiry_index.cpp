@@ -0,0 +1,94 @@
+#include "database/message_expiry_index.h"
+#include <algorithm>
+
+MessageExpiryIndex::MessageExpiryIndex(uint64_t bucketSeconds)
+    : bucketSeconds_(std::max<uint64_t>(1, bucketSeconds)) {}
+
+void MessageExpiryIndex::setRoomTtl(const std::string& roomId, uint32_t ttlSeconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ttlSeconds == 0) {
+        roomTtls_.erase(roomId);
+    } else {
+        roomTtls_[roomId] = ttlSeconds;
+    }
+}
+
+uint32_t MessageExpiryIndex::roomTtl(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = roomTtls_.find(roomId);
+    return it == roomTtls_.end() ? 0 : it->second;
+}
+
+uint64_t MessageExpiryIndex::deadlineFor(const std::string& roomId, uint64_t createdAt) const {
+    uint32_t ttl = roomTtl(roomId);
+    return ttl == 0 ? 0 : createdAt + ttl;
+}
+
+void MessageExpiryIndex::add(const std::string& messageId, const std::string& roomId, uint64_t expiresAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (expiresAt >= horizon_) {
+        return;  // Picked up from the database when the horizon gets there
+    }
+    insertLocked({messageId, roomId, expiresAt});
+}
+
+uint64_t MessageExpiryIndex::setHorizon(uint64_t newHorizon) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t previous = horizon_;
+    horizon_ = newHorizon;
+    return previous;
+}
+
+uint64_t MessageExpiryIndex::horizon() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return horizon_;
+}
+
+std::vector<MessageExpiryIndex::Entry> MessageExpiryIndex::takeDue(uint64_t now, size_t maxEntries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entry> due;
+
+    auto it = buckets_.begin();
+    while (it != buckets_.end() && it->first <= now && due.size() < maxEntries) {
+        auto& entries = it->second;
+
+        // Whole bucket is due unless it straddles `now`; move due entries to the back
+        size_t keep = 0;
+        if (it->first + bucketSeconds_ > now) {
+            auto split = std::partition(entries.begin(), entries.end(),
+                                        [now](const Entry& e) { return e.expiresAt > now; });
+            keep = static_cast<size_t>(split - entries.begin());
+        }
+
+        while (entries.size() > keep && due.size() < maxEntries) {
+            due.push_back(std::move(entries.back()));
+            entries.pop_back();
+            size_--;
+        }
+
+        if (entries.empty()) {
+            it = buckets_.erase(it);
+        } else {
+            break;  // Hit maxEntries, or the rest of this bucket is in the future
+        }
+    }
+    return due;
+}
+
+void MessageExpiryIndex::restore(const std::vector<Entry>& entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries) {
+        insertLocked(entry);
+    }
+}
+
+size_t MessageExpiryIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void MessageExpiryIndex::insertLocked(Entry entry) {
+    uint64_t bucket = entry.expiresAt - entry.expiresAt % bucketSeconds_;
+    buckets_[bucket].push_back(std::move(entry));
+    size_++;
+}
@@ -1,11 +1,15 @@
 #include "database/mysql_client.h"
 #include "utils/logger.h"
+#include "database/message_codec.h"
+#include "utils/cpu_affinity.h"
 #include <mysqlx/xdevapi.h>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <functional>
 #include <algorithm>
+#include <future>
+#include <numeric>
 
 // Real MySQL implementation using UserSession.sql() - cleaner than Table API
 
@@ -23,7 +27,7 @@ MySQLClient::~MySQLClient() {
     disconnect();
 }
 
-bool MySQLClient::connect() {
+bool MySQLClient::connect(bool runMigrations) {
     try {
         // Create session using SessionSettings (proper mysqlx way)
         mysqlx::SessionSettings settings(
@@ -36,6 +40,12 @@ bool MySQLClient::connect() {
         session_ = std::make_shared<mysqlx::Session>(settings);
         session_->sql("USE " + database_).execute();
         
+        // Extra connections (worker threads) share the already-migrated schema
+        if (!runMigrations) {
+            Logger::debug("✓ MySQL worker connection opened: " + database_);
+            return true;
+        }
+        
         // Migration: Check if avatar_url column exists
         try {
             session_->sql("SELECT avatar_url FROM users LIMIT 1").execute();
@@ -275,6 +285,140 @@ bool MySQLClient::connect() {
             Logger::error("Migration (status_message) failed: " + std::string(e.what()));
         }
 
+        // Migration: Add materialized reply_count / last_reply_at columns and thread index
+        try {
+            auto result = session_->sql(
+                "SELECT COUNT(*) FROM INFORMATION_SCHEMA.COLUMNS "
+                "WHERE table_schema = ? AND table_name = 'messages' AND column_name = 'reply_count'"
+            ).bind(database_).execute();
+            auto row = result.fetchOne();
+            int count = row[0].get<int>();
+            
+            if (count == 0) {
+                Logger::info("Migration: Adding reply_count and last_reply_at columns to messages table");
+                session_->sql("ALTER TABLE messages ADD COLUMN reply_count INT UNSIGNED NOT NULL DEFAULT 0").execute();
+                session_->sql("ALTER TABLE messages ADD COLUMN last_reply_at TIMESTAMP NULL").execute();
+                session_->sql("ALTER TABLE messages ADD INDEX idx_reply_thread (reply_to_id, created_at)").execute();
+                
+                // Backfill counts for existing threads
+                session_->sql(
+                    "UPDATE messages p JOIN ("
+                    "  SELECT reply_to_id, COUNT(*) AS cnt, MAX(created_at) AS last_at "
+                    "  FROM messages WHERE reply_to_id IS NOT NULL AND reply_to_id <> '' "
+                    "  GROUP BY reply_to_id"
+                    ") r ON p.message_id = r.reply_to_id "
+                    "SET p.reply_count = r.cnt, p.last_reply_at = r.last_at"
+                ).execute();
+                Logger::info("✓ reply_count, last_reply_at and idx_reply_thread added to messages table");
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Migration (reply_count) failed: " + std::string(e.what()));
+        }
+
+        // Migration: Allow 'channel' room type (broadcast channels)
+        try {
+            auto result = session_->sql(
+                "SELECT COUNT(*) FROM INFORMATION_SCHEMA.COLUMNS "
+                "WHERE table_schema = ? AND table_name = 'rooms' AND column_name = 'room_type' "
+                "AND column_type LIKE '%channel%'"
+            ).bind(database_).execute();
+            auto row = result.fetchOne();
+            int count = row[0].get<int>();
+            
+            if (count == 0) {
+                Logger::info("Migration: Adding 'channel' to rooms.room_type");
+                session_->sql(
+                    "ALTER TABLE rooms MODIFY room_type ENUM('public', 'private', 'dm', 'channel') DEFAULT 'public'"
+                ).execute();
+                Logger::info("✓ rooms.room_type now supports channels");
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Migration (room_type channel) failed: " + std::string(e.what()));
+        }
+
+        // Migration: Composite (room_id, created_at, message_id) index for keyset room scans (exports)
+        try {
+            auto result = session_->sql(
+                "SELECT COUNT(*) FROM INFORMATION_SCHEMA.STATISTICS "
+                "WHERE table_schema = ? AND table_name = 'messages' AND index_name = 'idx_room_created'"
+            ).bind(database_).execute();
+            auto row = result.fetchOne();
+            int count = row[0].get<int>();
+            
+            if (count == 0) {
+                Logger::info("Migration: Adding idx_room_created to messages table");
+                session_->sql("ALTER TABLE messages ADD INDEX idx_room_created (room_id, created_at, message_id)").execute();
+                Logger::info("✓ idx_room_created added to messages table");
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Migration (idx_room_created) failed: " + std::string(e.what()));
+        }
+
+        // Migration: Disappearing messages (messages.expires_at + per-room TTL table)
+        try {
+            auto result = session_->sql(
+                "SELECT COUNT(*) FROM INFORMATION_SCHEMA.COLUMNS "
+                "WHERE table_schema = ? AND table_name = 'messages' AND column_name = 'expires_at'"
+            ).bind(database_).execute();
+            auto row = result.fetchOne();
+            int count = row[0].get<int>();
+            
+            if (count == 0) {
+                Logger::info("Migration: Adding expires_at column to messages table");
+                session_->sql("ALTER TABLE messages ADD COLUMN expires_at TIMESTAMP NULL, ADD INDEX idx_expires (expires_at)").execute();
+                Logger::info("✓ expires_at and idx_expires added to messages table");
+            }
+            session_->sql(
+                "CREATE TABLE IF NOT EXISTS room_message_ttl ("
+                "  room_id VARCHAR(128) PRIMARY KEY,"
+                "  ttl_seconds INT UNSIGNED NOT NULL,"
+                "  updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP"
+                ")"
+            ).execute();
+        } catch (const std::exception& e) {
+            Logger::error("Migration (expires_at) failed: " + std::string(e.what()));
+        }
+
+        // Migration: Compressed storage for large content/metadata (see message_codec.h)
+        try {
+            auto result = session_->sql(
+                "SELECT COUNT(*) FROM INFORMATION_SCHEMA.COLUMNS "
+                "WHERE table_schema = ? AND table_name = 'messages' AND column_name = 'compressed'"
+            ).bind(database_).execute();
+            auto row = result.fetchOne();
+            int count = row[0].get<int>();
+            
+            if (count == 0) {
+                Logger::info("Migration: Adding compressed, content_z and metadata_z columns to messages table");
+                session_->sql(
+                    "ALTER TABLE messages "
+                    "ADD COLUMN compressed TINYINT UNSIGNED NOT NULL DEFAULT 0, "
+                    "ADD COLUMN content_z MEDIUMBLOB NULL, "
+                    "ADD COLUMN metadata_z MEDIUMBLOB NULL"
+                ).execute();
+                Logger::info("✓ message compression columns added");
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Migration (compressed) failed: " + std::string(e.what()));
+        }
+
+        // Migration: Outbound webhook subscriptions
+        try {
+            session_->sql(
+                "CREATE TABLE IF NOT EXISTS room_webhooks ("
+                "  webhook_id VARCHAR(64) PRIMARY KEY,"
+                "  room_id VARCHAR(128) NOT NULL,"
+                "  url VARCHAR(2048) NOT NULL,"
+                "  secret VARCHAR(128) NOT NULL DEFAULT '',"
+                "  created_by VARCHAR(64) NOT NULL,"
+                "  created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                "  INDEX idx_room (room_id)"
+                ")"
+            ).execute();
+        } catch (const std::exception& e) {
+            Logger::error("Migration (room_webhooks) failed: " + std::string(e.what()));
+        }
+
         Logger::info("✓ MySQL connected: " + database_);
         return true;
     } catch (const std::exception& e) {
@@ -283,6 +427,151 @@ bool MySQLClient::connect() {
     }
 }
 
+std::unique_ptr<MySQLClient> MySQLClient::createWorkerConnection() const {
+    auto client = std::make_unique<MySQLClient>(host_, user_, password_, database_, port_);
+    if (!client->connect(false)) {
+        return nullptr;
+    }
+    if (!shardEndpoints_.empty()) {
+        client->ring_ = ring_;
+        client->rowShards_ = rowShards_;
+        if (!client->connectShards(shardEndpoints_, false)) {
+            return nullptr;
+        }
+    }
+    return client;
+}
+
+// ============================================================================
+// MESSAGE SHARDS
+// ============================================================================
+
+// Helper: fn(shard, index) on every shard at once (each shard has its own session),
+// results in shard order. Used for lookups and cross-shard reads that must merge.
+// The helper threads would inherit the caller's CPUs (the event loop's, when called
+// from the loop), so they pin themselves to the background set.
+template <typename Fn>
+static auto fanOut(const std::vector<std::unique_ptr<MySQLClient>>& shards, Fn fn) {
+    using Result = decltype(fn(*shards.front(), size_t{0}));
+    std::vector<std::future<Result>> pending;
+    pending.reserve(shards.size());
+    for (size_t i = 1; i < shards.size(); ++i) {
+        pending.push_back(std::async(std::launch::async, [&fn, &shards, i] {
+            cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "shard-query");
+            return fn(*shards[i], i);
+        }));
+    }
+    
+    std::vector<Result> results;
+    results.reserve(shards.size());
+    results.push_back(fn(*shards.front(), 0));
+    for (auto& f : pending) {
+        results.push_back(f.get());
+    }
+    return results;
+}
+
+bool MySQLClient::connectShards(const std::vector<ShardEndpoint>& shards, bool runMigrations) {
+    std::vector<std::unique_ptr<MySQLClient>> clients;
+    for (const auto& endpoint : shards) {
+        auto client = std::make_unique<MySQLClient>(endpoint.host, user_, password_, endpoint.database, endpoint.port);
+        if (!client->connect(runMigrations)) {
+            Logger::error("Failed to connect to message shard " + endpoint.label());
+            return false;
+        }
+        clients.push_back(std::move(client));
+    }
+    
+    shardEndpoints_ = shards;
+    shards_ = std::move(clients);
+    if (!ring_ || ring_->size() != shards_.size()) {
+        ring_ = std::make_shared<const ShardRing>(shards_.size());
+    }
+    if (!rowShards_) {
+        rowShards_ = std::make_shared<LRUCache<std::string, size_t>>(100000);
+    }
+    
+    if (runMigrations) {
+        for (size_t i = 0; i < shardEndpoints_.size(); ++i) {
+            Logger::info("✓ Message shard " + std::to_string(i) + ": " + shardEndpoints_[i].label());
+        }
+    }
+    return true;
+}
+
+size_t MySQLClient::shardForRoom(const std::string& roomId) const {
+    return ring_ ? ring_->shardFor(roomId) : 0;
+}
+
+MySQLClient& MySQLClient::shardFor(const std::string& roomId) {
+    return *shards_[shardForRoom(roomId)];
+}
+
+std::vector<std::string> MySQLClient::existingIds(const char* table, const char* idColumn,
+                                                  const std::vector<std::string>& ids) {
+    std::vector<std::string> found;
+    if (ids.empty()) {
+        return found;
+    }
+    
+    try {
+        std::string placeholders;
+        placeholders.reserve(ids.size() * 2);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ",?");
+        }
+        
+        auto stmt = session_->sql(std::string("SELECT ") + idColumn + " FROM " + table +
+                                  " WHERE " + idColumn + " IN (" + placeholders + ")");
+        for (const auto& id : ids) {
+            stmt.bind(id);
+        }
+        auto result = stmt.execute();
+        for (auto row : result) {
+            found.push_back(row[0].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "existingIds");
+    }
+    return found;
+}
+
+std::unordered_map<size_t, std::vector<std::string>> MySQLClient::locateRows(const char* table, const char* idColumn,
+                                                                             const std::vector<std::string>& ids) {
+    std::unordered_map<size_t, std::vector<std::string>> byShard;
+    std::vector<std::string> missing;
+    for (const auto& id : ids) {
+        if (auto shard = rowShards_->get(std::string(table) + ":" + id)) {
+            byShard[*shard].push_back(id);
+        } else {
+            missing.push_back(id);
+        }
+    }
+    if (missing.empty()) {
+        return byShard;
+    }
+    
+    // Primary key lookups, so asking every shard costs one round trip
+    auto found = fanOut(shards_, [&](MySQLClient& shard, size_t) {
+        return shard.existingIds(table, idColumn, missing);
+    });
+    for (size_t i = 0; i < found.size(); ++i) {
+        for (auto& id : found[i]) {
+            rowShards_->put(std::string(table) + ":" + id, i);
+            byShard[i].push_back(std::move(id));
+        }
+    }
+    return byShard;
+}
+
+std::optional<size_t> MySQLClient::locateRow(const char* table, const char* idColumn, const std::string& id) {
+    auto byShard = locateRows(table, idColumn, {id});
+    if (byShard.empty()) {
+        return std::nullopt;
+    }
+    return byShard.begin()->first;
+}
+
 void MySQLClient::disconnect() {
     if (session_) {
         session_->close();
@@ -307,6 +596,100 @@ std::string userStatusToString(UserStatus status) {
     }
 }
 
+// Helper: Column list shared by all message SELECTs (order matches parseMessageRow)
+static const std::string MESSAGE_COLUMNS =
+    "message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, "
+    "UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR), COALESCE(reply_count, 0), UNIX_TIMESTAMP(last_reply_at), "
+    "UNIX_TIMESTAMP(expires_at), COALESCE(compressed, 0), content_z, metadata_z";
+
+// Helper: BLOB column value as a byte string
+static std::string blobString(const mysqlx::Value& value) {
+    auto raw = value.getRawBytes();
+    return std::string(reinterpret_cast<const char*>(raw.begin()), raw.size());
+}
+
+// Helper: BLOB parameter, NULL when there is no blob
+static mysqlx::Value blobParam(const std::optional<std::string>& blob) {
+    if (!blob) {
+        return mysqlx::nullvalue;
+    }
+    return mysqlx::Value(mysqlx::bytes(reinterpret_cast<const mysqlx::byte*>(blob->data()), blob->size()));
+}
+
+// Helper: content/metadata as stored, with large values moved to the compressed columns.
+// Messages read back still compressed (e.g. a forwarded original) keep their blobs as-is.
+struct StoredBody {
+    std::string content;
+    mysqlx::Value metadata;
+    std::optional<std::string> contentZ;
+    std::optional<std::string> metadataZ;
+    int compressed = 0;
+};
+
+static StoredBody encodeBody(const Message& message) {
+    StoredBody body;
+    
+    if (message.compressed & Message::CONTENT_COMPRESSED) {
+        body.contentZ = message.content;
+    } else {
+        body.contentZ = message_codec::compress(message.content);
+    }
+    if (body.contentZ) {
+        body.compressed |= Message::CONTENT_COMPRESSED;
+    } else {
+        body.content = message.content;
+    }
+    
+    if (message.compressed & Message::METADATA_COMPRESSED) {
+        body.metadataZ = message.metadata;
+    } else {
+        body.metadataZ = message_codec::compress(message.metadata);
+    }
+    if (body.metadataZ) {
+        body.compressed |= Message::METADATA_COMPRESSED;
+        body.metadata = mysqlx::nullvalue;
+    } else {
+        body.metadata = message.metadata.empty() ? mysqlx::nullvalue : mysqlx::Value(message.metadata);
+    }
+    return body;
+}
+
+// Helper: Convert a row selected with MESSAGE_COLUMNS to a Message
+static Message parseMessageRow(mysqlx::Row& row) {
+    Message msg;
+    msg.messageId = row[0].get<std::string>();
+    msg.roomId = row[1].get<std::string>();
+    msg.senderId = row[2].get<std::string>();
+    msg.senderName = row[3].get<std::string>();
+    msg.content = row[4].get<std::string>();
+    // Handle possible NULL or invalid message_type
+    try {
+        msg.messageType = row[5].isNull() ? 0 : static_cast<int>(row[5].get<int64_t>());
+    } catch (...) {
+        msg.messageType = 0;
+    }
+    msg.replyToId = row[6].isNull() ? "" : row[6].get<std::string>();
+    msg.timestamp = row[7].get<uint64_t>();
+    // JSON metadata - cast to string
+    try {
+        msg.metadata = row[8].isNull() ? "" : row[8].get<std::string>();
+    } catch (...) {
+        msg.metadata = "";
+    }
+    msg.replyCount = static_cast<uint32_t>(row[9].get<uint64_t>());
+    msg.lastReplyAt = row[10].isNull() ? 0 : row[10].get<uint64_t>();
+    msg.expiresAt = row[11].isNull() ? 0 : row[11].get<uint64_t>();
+    // Compressed fields stay compressed until message_codec::inflate() at serve time
+    msg.compressed = static_cast<uint8_t>(row[12].get<int>());
+    if (msg.compressed & Message::CONTENT_COMPRESSED) {
+        msg.content = blobString(row[13]);
+    }
+    if (msg.compressed & Message::METADATA_COMPRESSED) {
+        msg.metadata = blobString(row[14]);
+    }
+    return msg;
+}
+
 // Users
 bool MySQLClient::createUser(const User& user) {
     try {
@@ -389,7 +772,7 @@ std::optional<User> MySQLClient::getUserById(const std::string& userId) {
 std::vector<User> MySQLClient::getAllUsers() {
     std::vector<User> users;
     try {
-        auto result = session_->sql("SELECT user_id, username, email, status, status_message, avatar_url FROM users ORDER BY username")
+        auto result = session_->sql("SELECT user_id, username, email, status, status_message, avatar_url, display_name FROM users ORDER BY username")
             .execute();
         
         for (auto row : result) {
@@ -407,6 +790,7 @@ std::vector<User> MySQLClient::getAllUsers() {
             
             user.statusMessage = row[4].isNull() ? "" : row[4].get<std::string>();
             user.avatarUrl = row[5].isNull() ? "" : row[5].get<std::string>();
+            user.displayName = row[6].isNull() ? "" : row[6].get<std::string>();
             users.push_back(user);
         }
         
@@ -537,6 +921,15 @@ bool MySQLClient::deleteSession(const std::string& sessionId) {
 
 // Messages
 bool MySQLClient::createMessage(const Message& message) {
+    if (!shards_.empty()) {
+        size_t shard = shardForRoom(message.roomId);
+        if (!shards_[shard]->createMessage(message)) {
+            return false;
+        }
+        rowShards_->put("messages:" + message.messageId, shard);
+        return true;
+    }
+    
     Logger::info("📝 START createMessage");
     
     if (!session_) {
@@ -559,19 +952,36 @@ bool MySQLClient::createMessage(const Message& message) {
         
         // Database has DEFAULT CURRENT_TIMESTAMP for created_at, so don't need to specify it
         // Include metadata column for file attachments
-        // Use INSERT IGNORE to silently skip duplicate message IDs (can happen with frontend retries)
-        auto statement = session_->sql("INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, metadata) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+        // INSERT IGNORE: a duplicate message ID inserts nothing and is reported as a failure below
+        auto statement = session_->sql("INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, metadata, expires_at, compressed, content_z, metadata_z) VALUES (?, ?, ?, ?, ?, ?, ?, ?, FROM_UNIXTIME(?), ?, ?, ?)");
         
         Logger::info("📝 Binding parameters...");
+        StoredBody body = encodeBody(message);
         statement.bind(message.messageId, message.roomId, message.senderId, message.senderName, 
-                      message.content, message.messageType, message.replyToId.empty() ? "" : message.replyToId,
-                      message.metadata.empty() ? mysqlx::nullvalue : mysqlx::Value(message.metadata));
+                      body.content, message.messageType, message.replyToId.empty() ? "" : message.replyToId,
+                      body.metadata,
+                      message.expiresAt == 0 ? mysqlx::nullvalue : mysqlx::Value(message.expiresAt),
+                      body.compressed, blobParam(body.contentZ), blobParam(body.metadataZ));
         
         Logger::info("📝 Executing INSERT...");
-        statement.execute();
+        auto insertResult = statement.execute();
         
         Logger::info("✓ Message SQL executed successfully");
         
+        // Nothing inserted: another message already has this ID. Not a success, or the caller
+        // would cache, broadcast and count a row that does not exist.
+        if (insertResult.getAffectedItemsCount() == 0) {
+            Logger::error("✗ Message ID already exists, nothing inserted: " + message.messageId);
+            return false;
+        }
+        
+        // Maintain the parent's materialized reply count at ingestion time
+        if (!message.replyToId.empty()) {
+            session_->sql(
+                "UPDATE messages SET reply_count = reply_count + 1, last_reply_at = NOW() WHERE message_id = ?"
+            ).bind(message.replyToId).execute();
+        }
+        
         // Verify it was inserted
         Logger::info("📝 Verifying insert...");
         auto result = session_->sql("SELECT COUNT(*) FROM messages WHERE message_id = ?")
@@ -601,66 +1011,177 @@ bool MySQLClient::createMessage(const Message& message) {
     }
 }
 
+bool MySQLClient::createMessages(const std::vector<Message>& messages) {
+    if (messages.empty()) {
+        return true;
+    }
+    
+    if (!shards_.empty()) {
+        std::vector<std::vector<Message>> byShard(shards_.size());
+        for (const auto& m : messages) {
+            byShard[shardForRoom(m.roomId)].push_back(m);
+        }
+        auto results = fanOut(shards_, [&byShard](MySQLClient& shard, size_t i) {
+            return shard.createMessages(byShard[i]);
+        });
+        return std::all_of(results.begin(), results.end(), [](bool ok) { return ok; });
+    }
+    
+    try {
+        std::string sql =
+            "INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, "
+            "message_type, reply_to_id, metadata, expires_at, compressed, content_z, metadata_z) VALUES ";
+        sql.reserve(sql.size() + messages.size() * 48);
+        for (size_t i = 0; i < messages.size(); ++i) {
+            sql += (i == 0 ? "" : ",");
+            sql += "(?, ?, ?, ?, ?, ?, '', ?, FROM_UNIXTIME(?), ?, ?, ?)";
+        }
+        
+        auto statement = session_->sql(sql);
+        for (const auto& m : messages) {
+            StoredBody body = encodeBody(m);
+            statement.bind(m.messageId, m.roomId, m.senderId, m.senderName, body.content, m.messageType,
+                           body.metadata,
+                           m.expiresAt == 0 ? mysqlx::nullvalue : mysqlx::Value(m.expiresAt),
+                           body.compressed, blobParam(body.contentZ), blobParam(body.metadataZ));
+        }
+        auto inserted = statement.execute().getAffectedItemsCount();
+        if (inserted != messages.size()) {
+            Logger::error("createMessages: " + std::to_string(messages.size() - inserted) +
+                          " message IDs already existed");
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "createMessages");
+        return false;
+    }
+}
+
 std::optional<Message> MySQLClient::getMessage(const std::string& messageId) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", messageId);
+        return shard ? shards_[*shard]->getMessage(messageId) : std::nullopt;
+    }
+    
     try {
-        auto result = session_->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE message_id = ?")
+        auto result = session_->sql("SELECT " + MESSAGE_COLUMNS + " FROM messages WHERE message_id = ?")
             .bind(messageId).execute();
         auto row = result.fetchOne();
         if (!row) return std::nullopt;
         
-        Message msg;
-        msg.messageId = row[0].get<std::string>();
-        msg.roomId = row[1].get<std::string>();
-        msg.senderId = row[2].get<std::string>();
-        msg.senderName = row[3].get<std::string>();
-        msg.content = row[4].get<std::string>();
-        // Handle possible NULL or invalid message_type
-        try {
-            msg.messageType = row[5].isNull() ? 0 : static_cast<int>(row[5].get<int64_t>());
-        } catch (...) {
-            msg.messageType = 0;
-        }
-        msg.replyToId = row[6].isNull() ? "" : row[6].get<std::string>();
-        msg.timestamp = row[7].get<uint64_t>();
-        try {
-            msg.metadata = row[8].isNull() ? "" : row[8].get<std::string>();
-        } catch (...) {
-            msg.metadata = "";
-        }
-        return msg;
+        return parseMessageRow(row);
     } catch (const std::exception& e) {
         handleException(e, "getMessage");
         return std::nullopt;
     }
 }
 
+std::vector<Message> MySQLClient::getMessagesByIds(const std::vector<std::string>& messageIds) {
+    if (messageIds.empty()) {
+        return {};
+    }
+    
+    if (!shards_.empty()) {
+        auto byShard = locateRows("messages", "message_id", messageIds);
+        auto results = fanOut(shards_, [&byShard](MySQLClient& shard, size_t i) {
+            auto it = byShard.find(i);
+            return it == byShard.end() ? std::vector<Message>{} : shard.getMessagesByIds(it->second);
+        });
+        std::vector<Message> messages;
+        for (auto& part : results) {
+            std::move(part.begin(), part.end(), std::back_inserter(messages));
+        }
+        return messages;
+    }
+    
+    std::vector<Message> messages;
+    try {
+        std::string placeholders;
+        for (size_t i = 0; i < messageIds.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ", ?");
+        }
+        auto stmt = session_->sql("SELECT " + MESSAGE_COLUMNS + " FROM messages WHERE message_id IN (" +
+                                  placeholders + ") AND COALESCE(is_deleted, 0) = 0");
+        for (const auto& id : messageIds) {
+            stmt.bind(id);
+        }
+        for (auto row : stmt.execute()) {
+            messages.push_back(parseMessageRow(row));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getMessagesByIds");
+    }
+    return messages;
+}
+
+bool MySQLClient::forEachMessageSince(uint64_t fromTimestamp,
+                                      const std::function<bool(const Message&)>& onRow,
+                                      int batchSize) {
+    if (!shards_.empty()) {
+        // One shard after another: onRow is not required to be thread-safe
+        bool stopped = false;
+        for (auto& shard : shards_) {
+            bool ok = shard->forEachMessageSince(fromTimestamp, [&](const Message& m) {
+                stopped = !onRow(m);
+                return !stopped;
+            }, batchSize);
+            if (!ok) {
+                return false;
+            }
+            if (stopped) {
+                break;
+            }
+        }
+        return true;
+    }
+    
+    uint64_t afterTimestamp = fromTimestamp;
+    std::string afterMessageId;
+    
+    try {
+        // Keyset scan over idx_created (the PK is the index suffix)
+        while (true) {
+            auto result = session_->sql(
+                "SELECT " + MESSAGE_COLUMNS + " FROM messages "
+                "WHERE (created_at > FROM_UNIXTIME(?) OR (created_at = FROM_UNIXTIME(?) AND message_id > ?)) "
+                "AND is_deleted = 0 ORDER BY created_at ASC, message_id ASC LIMIT ?")
+                .bind(afterTimestamp, afterTimestamp, afterMessageId, batchSize)
+                .execute();
+            
+            int rows = 0;
+            for (auto row : result) {
+                Message message = parseMessageRow(row);
+                afterTimestamp = message.timestamp;
+                afterMessageId = message.messageId;
+                rows++;
+                if (!onRow(message)) {
+                    return true;
+                }
+            }
+            
+            if (rows < batchSize) {
+                return true;
+            }
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "forEachMessageSince");
+        return false;
+    }
+}
+
 std::vector<Message> MySQLClient::getMessagesByRoom(const std::string& roomId, int limit) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).getMessagesByRoom(roomId, limit);
+    }
+    
     std::vector<Message> messages;
     try {
-        auto result = session_->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ?")
+        auto result = session_->sql("SELECT " + MESSAGE_COLUMNS + " FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ?")
             .bind(roomId, limit).execute();
         
         for (auto row : result) {
-            Message msg;
-            msg.messageId = row[0].get<std::string>();
-            msg.roomId = row[1].get<std::string>();
-            msg.senderId = row[2].get<std::string>();
-            msg.senderName = row[3].get<std::string>();
-            msg.content = row[4].get<std::string>();
-            // Handle possible NULL or invalid message_type
-            try {
-                msg.messageType = row[5].isNull() ? 0 : static_cast<int>(row[5].get<int64_t>());
-            } catch (...) {
-                msg.messageType = 0;
-            }
-            msg.replyToId = row[6].isNull() ? "" : row[6].get<std::string>();
-            msg.timestamp = row[7].get<uint64_t>();
-            try {
-                msg.metadata = row[8].isNull() ? "" : row[8].get<std::string>();
-            } catch (...) {
-                msg.metadata = "";
-            }
-            messages.push_back(msg);
+            messages.push_back(parseMessageRow(row));
         }
         // Reverse to get oldest first (for chat display - old on top, new on bottom)
         std::reverse(messages.begin(), messages.end());
@@ -670,95 +1191,522 @@ std::vector<Message> MySQLClient::getMessagesByRoom(const std::string& roomId, i
     return messages;
 }
 
+std::unordered_map<std::string, std::vector<Message>> MySQLClient::getMessagesByRooms(
+    const std::vector<std::string>& roomIds, int limitPerRoom) {
+    std::unordered_map<std::string, std::vector<Message>> byRoom;
+    if (roomIds.empty()) {
+        return byRoom;
+    }
+    
+    if (!shards_.empty()) {
+        std::vector<std::vector<std::string>> byShard(shards_.size());
+        for (const auto& roomId : roomIds) {
+            byShard[shardForRoom(roomId)].push_back(roomId);
+        }
+        auto results = fanOut(shards_, [&byShard, limitPerRoom](MySQLClient& shard, size_t i) {
+            return shard.getMessagesByRooms(byShard[i], limitPerRoom);
+        });
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (!byShard[i].empty() && results[i].empty()) {
+                return {};  // That shard failed; same as a failed query when unsharded
+            }
+            for (auto& [roomId, messages] : results[i]) {
+                byRoom[roomId] = std::move(messages);
+            }
+        }
+        return byRoom;
+    }
+    
+    try {
+        std::string placeholders;
+        placeholders.reserve(roomIds.size() * 2);
+        for (size_t i = 0; i < roomIds.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ",?");
+        }
+        
+        // Newest limitPerRoom rows of each room, returned oldest first like getMessagesByRoom
+        auto stmt = session_->sql(
+            "SELECT " + MESSAGE_COLUMNS + " FROM ("
+            "SELECT m.*, ROW_NUMBER() OVER (PARTITION BY room_id ORDER BY created_at DESC) AS rn "
+            "FROM messages m WHERE room_id IN (" + placeholders + ")"
+            ") ranked WHERE rn <= ? ORDER BY room_id, created_at ASC");
+        for (const auto& roomId : roomIds) {
+            stmt.bind(roomId);
+            byRoom[roomId];
+        }
+        stmt.bind(limitPerRoom);
+        
+        auto result = stmt.execute();
+        for (auto row : result) {
+            Message message = parseMessageRow(row);
+            byRoom[message.roomId].push_back(std::move(message));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getMessagesByRooms");
+        byRoom.clear();
+    }
+    return byRoom;
+}
+
+std::vector<std::string> MySQLClient::getActiveRoomIds(size_t limit, int withinDays) {
+    std::vector<std::pair<std::string, uint64_t>> counts;
+    if (shards_.empty()) {
+        counts = getActiveRoomCounts(limit, withinDays);
+    } else {
+        // Each shard's top rooms, merged by message count
+        auto results = fanOut(shards_, [limit, withinDays](MySQLClient& shard, size_t) {
+            return shard.getActiveRoomCounts(limit, withinDays);
+        });
+        for (auto& shardCounts : results) {
+            counts.insert(counts.end(), shardCounts.begin(), shardCounts.end());
+        }
+        std::sort(counts.begin(), counts.end(),
+                  [](const auto& a, const auto& b) { return a.second > b.second; });
+        if (counts.size() > limit) {
+            counts.resize(limit);
+        }
+    }
+    
+    std::vector<std::string> roomIds;
+    roomIds.reserve(counts.size());
+    for (auto& [roomId, count] : counts) {
+        roomIds.push_back(std::move(roomId));
+    }
+    return roomIds;
+}
+
+std::vector<std::pair<std::string, uint64_t>> MySQLClient::getActiveRoomCounts(size_t limit, int withinDays) {
+    std::vector<std::pair<std::string, uint64_t>> counts;
+    try {
+        auto result = session_->sql(
+            "SELECT room_id, COUNT(*) AS cnt FROM messages WHERE created_at >= NOW() - INTERVAL ? DAY "
+            "GROUP BY room_id ORDER BY cnt DESC LIMIT ?"
+        ).bind(withinDays, static_cast<int>(limit)).execute();
+        
+        for (auto row : result) {
+            counts.emplace_back(row[0].get<std::string>(), row[1].get<uint64_t>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getActiveRoomIds");
+    }
+    return counts;
+}
+
 std::vector<Message> MySQLClient::getRecentMessages(const std::string& roomId, int limit, int offset) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).getRecentMessages(roomId, limit, offset);
+    }
+    
     std::vector<Message> messages;
     try {
         Logger::info("📚 Loading recent messages for room: " + roomId + " (limit=" + std::to_string(limit) + ", offset=" + std::to_string(offset) + ")");
         
         auto result = session_->sql(
-            "SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) "
+            "SELECT " + MESSAGE_COLUMNS + " "
             "FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ? OFFSET ?")
             .bind(roomId, limit, offset).execute();
         
         for (auto row : result) {
-            Message msg;
-            msg.messageId = row[0].get<std::string>();
-            msg.roomId = row[1].get<std::string>();
-            msg.senderId = row[2].get<std::string>();
-            msg.senderName = row[3].get<std::string>();
-            msg.content = row[4].get<std::string>();
-            // Handle possible NULL or invalid message_type
-            try {
-                msg.messageType = row[5].isNull() ? 0 : static_cast<int>(row[5].get<int64_t>());
-            } catch (...) {
-                msg.messageType = 0;
+            messages.push_back(parseMessageRow(row));
+        }
+        
+        Logger::info("✓ Loaded " + std::to_string(messages.size()) + " messages");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Error loading messages: " + std::string(e.what()));
+        handleException(e, "getRecentMessages");
+    }
+    
+    // Reverse to get chronological order (oldest first)
+    std::reverse(messages.begin(), messages.end());
+    return messages;
+}
+
+std::vector<Message> MySQLClient::getMessageReplies(const std::string& messageId, int limit) {
+    if (!shards_.empty()) {
+        // Replies live in the parent's room, so on the parent's shard
+        auto shard = locateRow("messages", "message_id", messageId);
+        return shard ? shards_[*shard]->getMessageReplies(messageId, limit) : std::vector<Message>{};
+    }
+    
+    std::vector<Message> replies;
+    try {
+        Logger::info("Loading replies for message: " + messageId);
+        
+        auto result = session_->sql(
+            "SELECT " + MESSAGE_COLUMNS + " "
+            "FROM messages WHERE reply_to_id = ? ORDER BY created_at ASC LIMIT ?")
+            .bind(messageId, limit).execute();
+        
+        for (auto row : result) {
+            replies.push_back(parseMessageRow(row));
+        }
+        
+        Logger::info("✓ Loaded " + std::to_string(replies.size()) + " replies");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Error loading replies: " + std::string(e.what()));
+        handleException(e, "getMessageReplies");
+    }
+    
+    return replies;
+}
+
+std::vector<Message> MySQLClient::getThreadReplies(const std::string& parentId,
+                                                   uint64_t afterTimestamp,
+                                                   const std::string& afterMessageId,
+                                                   int limit) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", parentId);
+        return shard ? shards_[*shard]->getThreadReplies(parentId, afterTimestamp, afterMessageId, limit)
+                     : std::vector<Message>{};
+    }
+    
+    std::vector<Message> replies;
+    try {
+        // Keyset pagination on (created_at, message_id) - served by idx_reply_thread
+        auto result = session_->sql(
+            "SELECT " + MESSAGE_COLUMNS + " "
+            "FROM messages WHERE reply_to_id = ? "
+            "AND (created_at > FROM_UNIXTIME(?) OR (created_at = FROM_UNIXTIME(?) AND message_id > ?)) "
+            "ORDER BY created_at ASC, message_id ASC LIMIT ?")
+            .bind(parentId, afterTimestamp, afterTimestamp, afterMessageId, limit).execute();
+        
+        for (auto row : result) {
+            replies.push_back(parseMessageRow(row));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getThreadReplies");
+    }
+    
+    return replies;
+}
+
+bool MySQLClient::forEachRoomMessage(const std::string& roomId,
+                                     const std::function<bool(const Message&)>& onRow,
+                                     int batchSize) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).forEachRoomMessage(roomId, onRow, batchSize);
+    }
+    
+    uint64_t afterTimestamp = 0;
+    std::string afterMessageId;
+    
+    try {
+        // Keyset scan on (created_at, message_id) - served by idx_room_created.
+        // Each batch is a short statement, so no snapshot or locks are held
+        // across the whole room and at most one batch is in flight.
+        while (true) {
+            auto result = session_->sql(
+                "SELECT " + MESSAGE_COLUMNS + " "
+                "FROM messages WHERE room_id = ? "
+                "AND (created_at > FROM_UNIXTIME(?) OR (created_at = FROM_UNIXTIME(?) AND message_id > ?)) "
+                "ORDER BY created_at ASC, message_id ASC LIMIT ?")
+                .bind(roomId, afterTimestamp, afterTimestamp, afterMessageId, batchSize).execute();
+            
+            int rows = 0;
+            for (auto row : result) {
+                Message msg = parseMessageRow(row);
+                afterTimestamp = msg.timestamp;
+                afterMessageId = msg.messageId;
+                rows++;
+                if (!onRow(msg)) {
+                    return true;  // Stopped by caller
+                }
+            }
+            
+            if (rows < batchSize) {
+                return true;
+            }
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "forEachRoomMessage");
+        return false;
+    }
+}
+
+uint64_t MySQLClient::countRoomMessages(const std::string& roomId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).countRoomMessages(roomId);
+    }
+    
+    try {
+        auto result = session_->sql("SELECT COUNT(*) FROM messages WHERE room_id = ?")
+            .bind(roomId).execute();
+        auto row = result.fetchOne();
+        return row ? row[0].get<uint64_t>() : 0;
+    } catch (const std::exception& e) {
+        handleException(e, "countRoomMessages");
+        return 0;
+    }
+}
+
+int64_t MySQLClient::insertMessagesBulk(const std::vector<Message>& messages) {
+    if (messages.empty()) {
+        return 0;
+    }
+    
+    if (!shards_.empty()) {
+        std::vector<std::vector<Message>> byShard(shards_.size());
+        for (const auto& m : messages) {
+            byShard[shardForRoom(m.roomId)].push_back(m);
+        }
+        auto results = fanOut(shards_, [&byShard](MySQLClient& shard, size_t i) {
+            return shard.insertMessagesBulk(byShard[i]);
+        });
+        if (std::any_of(results.begin(), results.end(), [](int64_t rows) { return rows < 0; })) {
+            return -1;
+        }
+        return std::accumulate(results.begin(), results.end(), int64_t{0});
+    }
+    
+    try {
+        std::string sql =
+            "INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, "
+            "message_type, reply_to_id, metadata, created_at, compressed, content_z, metadata_z) VALUES ";
+        sql.reserve(sql.size() + messages.size() * 48);
+        for (size_t i = 0; i < messages.size(); ++i) {
+            sql += (i == 0 ? "" : ",");
+            sql += "(?, ?, ?, ?, ?, ?, ?, ?, FROM_UNIXTIME(?), ?, ?, ?)";
+        }
+        
+        auto statement = session_->sql(sql);
+        for (const auto& m : messages) {
+            StoredBody body = encodeBody(m);
+            statement.bind(m.messageId, m.roomId, m.senderId, m.senderName, body.content, m.messageType,
+                           m.replyToId.empty() ? mysqlx::nullvalue : mysqlx::Value(m.replyToId),
+                           body.metadata,
+                           m.timestamp,
+                           body.compressed, blobParam(body.contentZ), blobParam(body.metadataZ));
+        }
+        
+        auto result = statement.execute();
+        return static_cast<int64_t>(result.getAffectedItemsCount());
+    } catch (const std::exception& e) {
+        handleException(e, "insertMessagesBulk");
+        return -1;
+    }
+}
+
+bool MySQLClient::recomputeReplyCounts(const std::string& roomId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).recomputeReplyCounts(roomId);
+    }
+    
+    try {
+        session_->sql(
+            "UPDATE messages p "
+            "JOIN (SELECT reply_to_id, COUNT(*) AS cnt, MAX(created_at) AS last_at "
+            "      FROM messages WHERE room_id = ? AND reply_to_id IS NOT NULL AND reply_to_id <> '' "
+            "      GROUP BY reply_to_id) r ON r.reply_to_id = p.message_id "
+            "SET p.reply_count = r.cnt, p.last_reply_at = r.last_at"
+        ).bind(roomId).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "recomputeReplyCounts");
+        return false;
+    }
+}
+
+bool MySQLClient::setMessageSecondaryIndexes(bool enabled) {
+    if (!shards_.empty()) {
+        auto results = fanOut(shards_, [enabled](MySQLClient& shard, size_t) {
+            return shard.setMessageSecondaryIndexes(enabled);
+        });
+        return std::all_of(results.begin(), results.end(), [](bool ok) { return ok; });
+    }
+    
+    // Keep in sync with the messages table in schema.sql and the migrations in connect()
+    static const std::vector<std::pair<std::string, std::string>> indexes = {
+        {"idx_room", "(room_id)"},
+        {"idx_sender", "(sender_id)"},
+        {"idx_created", "(created_at DESC)"},
+        {"idx_reply_thread", "(reply_to_id, created_at)"},
+        {"idx_room_created", "(room_id, created_at, message_id)"},
+        {"idx_expires", "(expires_at)"}
+    };
+    
+    try {
+        std::vector<std::string> existing;
+        auto result = session_->sql(
+            "SELECT DISTINCT index_name FROM INFORMATION_SCHEMA.STATISTICS "
+            "WHERE table_schema = ? AND table_name = 'messages'"
+        ).bind(database_).execute();
+        for (auto row : result) {
+            existing.push_back(row[0].get<std::string>());
+        }
+        auto exists = [&](const std::string& name) {
+            return std::find(existing.begin(), existing.end(), name) != existing.end();
+        };
+        
+        // One ALTER so the table is rebuilt / scanned once
+        std::string clauses;
+        for (const auto& [name, columns] : indexes) {
+            if (enabled && !exists(name)) {
+                clauses += (clauses.empty() ? "" : ", ") + std::string("ADD INDEX ") + name + " " + columns;
+            } else if (!enabled && exists(name)) {
+                clauses += (clauses.empty() ? "" : ", ") + std::string("DROP INDEX ") + name;
+            }
+        }
+        if (clauses.empty()) {
+            return true;
+        }
+        
+        Logger::info(std::string(enabled ? "Rebuilding" : "Dropping") + " messages secondary indexes");
+        session_->sql("ALTER TABLE messages " + clauses).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "setMessageSecondaryIndexes");
+        return false;
+    }
+}
+
+bool MySQLClient::forEachExpiringMessage(uint64_t fromTimestamp, uint64_t toTimestamp,
+                                         const std::function<void(const std::string&, const std::string&, uint64_t)>& onRow,
+                                         int batchSize) {
+    if (!shards_.empty()) {
+        // One shard after another: onRow is not required to be thread-safe
+        for (auto& shard : shards_) {
+            if (!shard->forEachExpiringMessage(fromTimestamp, toTimestamp, onRow, batchSize)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    uint64_t afterTimestamp = fromTimestamp;
+    std::string afterMessageId;
+    
+    try {
+        // Keyset scan over idx_expires (the PK is the index suffix)
+        while (true) {
+            auto result = session_->sql(
+                "SELECT message_id, room_id, UNIX_TIMESTAMP(expires_at) FROM messages "
+                "WHERE expires_at < FROM_UNIXTIME(?) "
+                "AND (expires_at > FROM_UNIXTIME(?) OR (expires_at = FROM_UNIXTIME(?) AND message_id > ?)) "
+                "ORDER BY expires_at ASC, message_id ASC LIMIT ?")
+                .bind(toTimestamp, afterTimestamp, afterTimestamp, afterMessageId, batchSize)
+                .execute();
+            
+            int rows = 0;
+            for (auto row : result) {
+                afterMessageId = row[0].get<std::string>();
+                std::string roomId = row[1].get<std::string>();
+                afterTimestamp = row[2].get<uint64_t>();
+                onRow(afterMessageId, roomId, afterTimestamp);
+                rows++;
             }
-            msg.replyToId = row[6].isNull() ? "" : row[6].get<std::string>();
-            msg.timestamp = row[7].get<uint64_t>();
-            // JSON metadata - cast to string
-            try {
-                msg.metadata = row[8].isNull() ? "" : row[8].get<std::string>();
-            } catch (...) {
-                msg.metadata = "";
+            
+            if (rows < batchSize) {
+                return true;
             }
-            messages.push_back(msg);
         }
-        
-        Logger::info("✓ Loaded " + std::to_string(messages.size()) + " messages");
-        
     } catch (const std::exception& e) {
-        Logger::error("Error loading messages: " + std::string(e.what()));
-        handleException(e, "getRecentMessages");
+        handleException(e, "forEachExpiringMessage");
+        return false;
     }
-    
-    // Reverse to get chronological order (oldest first)
-    std::reverse(messages.begin(), messages.end());
-    return messages;
 }
 
-std::vector<Message> MySQLClient::getMessageReplies(const std::string& messageId, int limit) {
-    std::vector<Message> replies;
+int64_t MySQLClient::deleteMessagesByIds(const std::vector<std::string>& messageIds) {
+    if (messageIds.empty()) {
+        return 0;
+    }
+    
+    if (!shards_.empty()) {
+        auto byShard = locateRows("messages", "message_id", messageIds);
+        auto results = fanOut(shards_, [&byShard](MySQLClient& shard, size_t i) {
+            auto it = byShard.find(i);
+            return it == byShard.end() ? int64_t{0} : shard.deleteMessagesByIds(it->second);
+        });
+        for (const auto& id : messageIds) {
+            rowShards_->remove("messages:" + id);
+        }
+        if (std::any_of(results.begin(), results.end(), [](int64_t rows) { return rows < 0; })) {
+            return -1;
+        }
+        return std::accumulate(results.begin(), results.end(), int64_t{0});
+    }
+    
     try {
-        Logger::info("Loading replies for message: " + messageId);
-        
-        auto result = session_->sql(
-            "SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) "
-            "FROM messages WHERE reply_to_id = ? ORDER BY created_at ASC LIMIT ?")
-            .bind(messageId, limit).execute();
-        
-        for (auto row : result) {
-            Message msg;
-            msg.messageId = row[0].get<std::string>();
-            msg.roomId = row[1].get<std::string>();
-            msg.senderId = row[2].get<std::string>();
-            msg.senderName = row[3].get<std::string>();
-            msg.content = row[4].get<std::string>();
-            try {
-                msg.messageType = row[5].isNull() ? 0 : static_cast<int>(row[5].get<int64_t>());
-            } catch (...) {
-                msg.messageType = 0;
-            }
-            msg.replyToId = row[6].isNull() ? "" : row[6].get<std::string>();
-            msg.timestamp = row[7].get<uint64_t>();
-            try {
-                msg.metadata = row[8].isNull() ? "" : row[8].get<std::string>();
-            } catch (...) {
-                msg.metadata = "";
-            }
-            replies.push_back(msg);
+        std::string placeholders;
+        placeholders.reserve(messageIds.size() * 3);
+        for (size_t i = 0; i < messageIds.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ",?");
         }
         
-        Logger::info("✓ Loaded " + std::to_string(replies.size()) + " replies");
-        
+        auto pins = session_->sql("DELETE FROM pinned_messages WHERE message_id IN (" + placeholders + ")");
+        auto messages = session_->sql("DELETE FROM messages WHERE message_id IN (" + placeholders + ")");
+        for (const auto& id : messageIds) {
+            pins.bind(id);
+            messages.bind(id);
+        }
+        pins.execute();
+        auto result = messages.execute();
+        return static_cast<int64_t>(result.getAffectedItemsCount());
     } catch (const std::exception& e) {
-        Logger::error("Error loading replies: " + std::string(e.what()));
-        handleException(e, "getMessageReplies");
+        handleException(e, "deleteMessagesByIds");
+        return -1;
+    }
+}
+
+bool MySQLClient::markMessagesRead(const std::string& userId, const std::vector<std::string>& messageIds) {
+    if (messageIds.empty()) {
+        return true;
     }
     
-    return replies;
+    if (!shards_.empty()) {
+        // Reads sit next to their message; IDs that no longer exist are dropped
+        auto byShard = locateRows("messages", "message_id", messageIds);
+        auto results = fanOut(shards_, [&byShard, &userId](MySQLClient& shard, size_t i) {
+            auto it = byShard.find(i);
+            return it == byShard.end() || shard.markMessagesRead(userId, it->second);
+        });
+        return std::all_of(results.begin(), results.end(), [](bool ok) { return ok; });
+    }
+    
+    try {
+        std::string values;
+        values.reserve(messageIds.size() * 16);
+        for (size_t i = 0; i < messageIds.size(); ++i) {
+            values += (i == 0 ? "(?, ?, NOW())" : ", (?, ?, NOW())");
+        }
+        
+        auto stmt = session_->sql(
+            "INSERT INTO message_reads (message_id, user_id, read_at) VALUES " + values +
+            " ON DUPLICATE KEY UPDATE read_at = NOW()");
+        for (const auto& messageId : messageIds) {
+            stmt.bind(messageId, userId);
+        }
+        stmt.execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "markMessagesRead");
+        return false;
+    }
 }
 
 std::vector<Message> MySQLClient::searchMessages(const std::string& query, const std::string& roomId, int limit) {
+    if (!shards_.empty()) {
+        if (!roomId.empty()) {
+            return shardFor(roomId).searchMessages(query, roomId, limit);
+        }
+        
+        // Every shard's newest `limit` hits, merged newest first
+        auto perShard = fanOut(shards_, [&query, limit](MySQLClient& shard, size_t) {
+            return shard.searchMessages(query, "", limit);
+        });
+        std::vector<Message> merged;
+        for (auto& hits : perShard) {
+            std::move(hits.begin(), hits.end(), std::back_inserter(merged));
+        }
+        std::sort(merged.begin(), merged.end(),
+                  [](const Message& a, const Message& b) { return a.timestamp > b.timestamp; });
+        if (merged.size() > static_cast<size_t>(std::max(limit, 0))) {
+            merged.resize(static_cast<size_t>(std::max(limit, 0)));
+        }
+        return merged;
+    }
+    
     std::vector<Message> results;
     try {
         Logger::info("Searching messages: '" + query + "' in room: " + (roomId.empty() ? "all" : roomId));
@@ -767,18 +1715,22 @@ std::vector<Message> MySQLClient::searchMessages(const std::string& query, const
         // For production, consider FULLTEXT search or external search engine
         std::string searchPattern = "%" + query + "%";
         
+        // Compressed rows are matched and returned via UNCOMPRESS() (blobs use the COMPRESS() layout)
+        static const std::string SEARCH_CONTENT =
+            "IF(compressed & 1, CONVERT(UNCOMPRESS(content_z) USING utf8mb4), content)";
+        
         mysqlx::SqlResult result;
         if (roomId.empty()) {
             // Search all rooms
             result = session_->sql(
-                "SELECT message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
-                "FROM messages WHERE content LIKE ? ORDER BY created_at DESC LIMIT ?"
+                "SELECT message_id, room_id, sender_id, sender_name, " + SEARCH_CONTENT + ", message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
+                "FROM messages WHERE " + SEARCH_CONTENT + " LIKE ? ORDER BY created_at DESC LIMIT ?"
             ).bind(searchPattern, limit).execute();
         } else {
             // Search specific room
             result = session_->sql(
-                "SELECT message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
-                "FROM messages WHERE room_id = ? AND content LIKE ? ORDER BY created_at DESC LIMIT ?"
+                "SELECT message_id, room_id, sender_id, sender_name, " + SEARCH_CONTENT + ", message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
+                "FROM messages WHERE room_id = ? AND " + SEARCH_CONTENT + " LIKE ? ORDER BY created_at DESC LIMIT ?"
             ).bind(roomId, searchPattern, limit).execute();
         }
         
@@ -805,7 +1757,85 @@ std::vector<Message> MySQLClient::searchMessages(const std::string& query, const
     return results;
 }
 
+bool MySQLClient::updateMessageContent(const std::string& messageId, const std::string& senderId,
+                                       const std::string& content) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", messageId);
+        return shard && shards_[*shard]->updateMessageContent(messageId, senderId, content);
+    }
+    
+    try {
+        auto contentZ = message_codec::compress(content);
+        session_->sql(
+            "UPDATE messages SET content = ?, content_z = ?, "
+            "compressed = (compressed & ~1) | ?, edited_at = NOW() "
+            "WHERE message_id = ? AND sender_id = ?"
+        ).bind(contentZ ? std::string() : content, blobParam(contentZ),
+               contentZ ? Message::CONTENT_COMPRESSED : 0, messageId, senderId).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "updateMessageContent");
+        return false;
+    }
+}
+
+bool MySQLClient::updateMessageMetadata(const std::string& messageId, const std::string& metadata) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", messageId);
+        return shard && shards_[*shard]->updateMessageMetadata(messageId, metadata);
+    }
+    
+    try {
+        auto metadataZ = message_codec::compress(metadata);
+        session_->sql(
+            "UPDATE messages SET metadata = ?, metadata_z = ?, "
+            "compressed = (compressed & ~2) | ? "
+            "WHERE message_id = ?"
+        ).bind(metadataZ || metadata.empty() ? mysqlx::Value(mysqlx::nullvalue) : mysqlx::Value(metadata),
+               blobParam(metadataZ), metadataZ ? Message::METADATA_COMPRESSED : 0, messageId).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "updateMessageMetadata");
+        return false;
+    }
+}
+
+std::optional<std::string> MySQLClient::setMessageMetadataKey(const std::string& messageId, const std::string& key,
+                                                              const std::string& valueJson) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", messageId);
+        return shard ? shards_[*shard]->setMessageMetadataKey(messageId, key, valueJson) : std::nullopt;
+    }
+    
+    try {
+        // Compressed metadata cannot be edited in SQL; the caller rewrites it instead
+        auto updated = session_->sql(
+            "UPDATE messages SET metadata = JSON_SET(COALESCE(metadata, JSON_OBJECT()), ?, CAST(? AS JSON)) "
+            "WHERE message_id = ? AND (compressed & 2) = 0"
+        ).bind("$." + key, valueJson, messageId).execute().getAffectedItemsCount();
+        if (updated == 0) {
+            return std::nullopt;
+        }
+        
+        auto row = session_->sql("SELECT metadata FROM messages WHERE message_id = ?")
+            .bind(messageId).execute().fetchOne();
+        if (!row || row[0].isNull()) {
+            return std::nullopt;
+        }
+        return row[0].get<std::string>();
+    } catch (const std::exception& e) {
+        handleException(e, "setMessageMetadataKey");
+        return std::nullopt;
+    }
+}
+
 bool MySQLClient::deleteMessage(const std::string& messageId) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("messages", "message_id", messageId);
+        rowShards_->remove("messages:" + messageId);
+        return shard && shards_[*shard]->deleteMessage(messageId);
+    }
+    
     try {
         session_->sql("DELETE FROM messages WHERE message_id = ?")
             .bind(messageId).execute();
@@ -816,6 +1846,21 @@ bool MySQLClient::deleteMessage(const std::string& messageId) {
     }
 }
 
+bool MySQLClient::softDeleteMessage(const std::string& messageId, const std::string& roomId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).softDeleteMessage(messageId, roomId);
+    }
+    
+    try {
+        session_->sql("UPDATE messages SET is_deleted = 1, deleted_at = NOW() WHERE message_id = ?")
+            .bind(messageId).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "softDeleteMessage");
+        return false;
+    }
+}
+
 // ============================================================================
 // ROOMS
 // ============================================================================
@@ -824,8 +1869,8 @@ bool MySQLClient::createRoom(const Room& room) {
     try {
         session_->sql(
             "INSERT INTO rooms (room_id, name, creator_id, room_type, description) "
-            "VALUES (?, ?, ?, 'public', '')"
-        ).bind(room.roomId, room.name, room.creatorId).execute();
+            "VALUES (?, ?, ?, ?, '')"
+        ).bind(room.roomId, room.name, room.creatorId, room.roomType).execute();
         
         // Also add creator as owner member
         session_->sql(
@@ -843,7 +1888,7 @@ bool MySQLClient::createRoom(const Room& room) {
 std::optional<Room> MySQLClient::getRoom(const std::string& roomId) {
     try {
         auto result = session_->sql(
-            "SELECT room_id, name, creator_id FROM rooms WHERE room_id = ?"
+            "SELECT room_id, name, creator_id, room_type FROM rooms WHERE room_id = ?"
         ).bind(roomId).execute();
         
         auto row = result.fetchOne();
@@ -853,6 +1898,7 @@ std::optional<Room> MySQLClient::getRoom(const std::string& roomId) {
         room.roomId = row[0].get<std::string>();
         room.name = row[1].get<std::string>();
         room.creatorId = row[2].get<std::string>();
+        room.roomType = row[3].isNull() ? "public" : row[3].get<std::string>();
         
         // Get members
         auto members = getRoomMembers(roomId);
@@ -865,6 +1911,37 @@ std::optional<Room> MySQLClient::getRoom(const std::string& roomId) {
     }
 }
 
+std::vector<std::string> MySQLClient::getAllRoomIds() {
+    std::vector<std::string> roomIds;
+    try {
+        auto result = session_->sql(
+            "SELECT room_id FROM rooms UNION ALL SELECT conversation_id FROM dm_conversations"
+        ).execute();
+        for (auto row : result) {
+            roomIds.push_back(row[0].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getAllRoomIds");
+    }
+    return roomIds;
+}
+
+std::vector<std::string> MySQLClient::getChannelRoomIds() {
+    std::vector<std::string> channels;
+    try {
+        auto result = session_->sql(
+            "SELECT room_id FROM rooms WHERE room_type = 'channel'"
+        ).execute();
+        
+        for (auto row : result) {
+            channels.push_back(row[0].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getChannelRoomIds");
+    }
+    return channels;
+}
+
 bool MySQLClient::updateRoom(const Room& room) {
     try {
         session_->sql(
@@ -881,8 +1958,9 @@ bool MySQLClient::deleteRoom(const std::string& roomId) {
     try {
         // Delete members first (cascade should handle this, but being explicit)
         session_->sql("DELETE FROM room_members WHERE room_id = ?").bind(roomId).execute();
-        // Delete messages in room
-        session_->sql("DELETE FROM messages WHERE room_id = ?").bind(roomId).execute();
+        // Delete messages in room (on its shard when sharded)
+        auto& messageSession = shards_.empty() ? *session_ : *shardFor(roomId).session_;
+        messageSession.sql("DELETE FROM messages WHERE room_id = ?").bind(roomId).execute();
         // Delete room
         session_->sql("DELETE FROM rooms WHERE room_id = ?").bind(roomId).execute();
         Logger::info("✓ Room deleted: " + roomId);
@@ -935,6 +2013,85 @@ std::vector<std::string> MySQLClient::getRoomMembers(const std::string& roomId)
     return members;
 }
 
+std::vector<std::string> MySQLClient::getUserRoomIds(const std::string& userId) {
+    std::vector<std::string> roomIds;
+    try {
+        auto result = session_->sql(
+            "SELECT room_id FROM room_members WHERE user_id = ? "
+            "UNION ALL SELECT conversation_id FROM dm_conversations WHERE user1_id = ? OR user2_id = ?"
+        ).bind(userId, userId, userId).execute();
+        
+        for (auto row : result) {
+            roomIds.push_back(row[0].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getUserRoomIds");
+    }
+    return roomIds;
+}
+
+std::vector<User> MySQLClient::getRoomMemberProfiles(const std::string& roomId) {
+    std::vector<User> members;
+    try {
+        auto result = session_->sql(
+            "SELECT u.user_id, u.username, u.avatar_url FROM room_members rm "
+            "JOIN users u ON u.user_id = rm.user_id WHERE rm.room_id = ?"
+        ).bind(roomId).execute();
+        
+        for (auto row : result) {
+            User user;
+            user.userId = row[0].get<std::string>();
+            user.username = row[1].get<std::string>();
+            user.avatarUrl = row[2].isNull() ? "" : row[2].get<std::string>();
+            user.createdAt = 0;
+            user.status = UserStatus::STATUS_OFFLINE;
+            members.push_back(user);
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getRoomMemberProfiles");
+    }
+    return members;
+}
+
+std::unordered_map<std::string, std::vector<User>> MySQLClient::getRoomMemberProfilesByRooms(
+    const std::vector<std::string>& roomIds) {
+    std::unordered_map<std::string, std::vector<User>> byRoom;
+    if (roomIds.empty()) {
+        return byRoom;
+    }
+    
+    try {
+        std::string placeholders;
+        placeholders.reserve(roomIds.size() * 2);
+        for (size_t i = 0; i < roomIds.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ",?");
+        }
+        
+        auto stmt = session_->sql(
+            "SELECT rm.room_id, u.user_id, u.username, u.avatar_url FROM room_members rm "
+            "JOIN users u ON u.user_id = rm.user_id WHERE rm.room_id IN (" + placeholders + ")");
+        for (const auto& roomId : roomIds) {
+            stmt.bind(roomId);
+            byRoom[roomId];
+        }
+        
+        auto result = stmt.execute();
+        for (auto row : result) {
+            User user;
+            user.userId = row[1].get<std::string>();
+            user.username = row[2].get<std::string>();
+            user.avatarUrl = row[3].isNull() ? "" : row[3].get<std::string>();
+            user.createdAt = 0;
+            user.status = UserStatus::STATUS_OFFLINE;
+            byRoom[row[0].get<std::string>()].push_back(std::move(user));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getRoomMemberProfilesByRooms");
+        byRoom.clear();
+    }
+    return byRoom;
+}
+
 // ============================================================================
 // FILES
 // ============================================================================
@@ -1057,7 +2214,7 @@ bool MySQLClient::hasMemberPermission(const std::string& roomId, const std::stri
     
     // Permission matrix
     // owner: all actions
-    // admin: kick, mute, pin
+    // admin: kick, mute, pin, export
     // moderator: mute, pin
     // member: send messages only
     
@@ -1065,7 +2222,7 @@ bool MySQLClient::hasMemberPermission(const std::string& roomId, const std::stri
         return true; // Owner can do everything
     }
     
-    if (action == "kick" || action == "ban" || action == "delete_room") {
+    if (action == "kick" || action == "ban" || action == "delete_room" || action == "export") {
         return role == "owner" || role == "admin";
     }
     
@@ -1089,6 +2246,10 @@ bool MySQLClient::isRoomOwner(const std::string& roomId, const std::string& user
 // ============================================================================
 
 bool MySQLClient::pinMessage(const std::string& roomId, const std::string& messageId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).pinMessage(roomId, messageId);
+    }
+    
     try {
         session_->sql(
             "INSERT INTO pinned_messages (room_id, message_id, pinned_by) VALUES (?, ?, 'system') "
@@ -1104,6 +2265,10 @@ bool MySQLClient::pinMessage(const std::string& roomId, const std::string& messa
 }
 
 bool MySQLClient::unpinMessage(const std::string& roomId, const std::string& messageId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).unpinMessage(roomId, messageId);
+    }
+    
     try {
         session_->sql(
             "DELETE FROM pinned_messages WHERE room_id = ? AND message_id = ?"
@@ -1118,6 +2283,10 @@ bool MySQLClient::unpinMessage(const std::string& roomId, const std::string& mes
 }
 
 std::vector<std::string> MySQLClient::getPinnedMessages(const std::string& roomId) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).getPinnedMessages(roomId);
+    }
+    
     std::vector<std::string> pinnedIds;
     try {
         auto result = session_->sql(
@@ -1202,6 +2371,15 @@ std::vector<std::string> MySQLClient::getBlockedUsers(const std::string& userId)
 // ============== Polls ==============
 
 bool MySQLClient::createPoll(const Poll& poll) {
+    if (!shards_.empty()) {
+        size_t shard = shardForRoom(poll.roomId);
+        if (!shards_[shard]->createPoll(poll)) {
+            return false;
+        }
+        rowShards_->put("polls:" + poll.pollId, shard);
+        return true;
+    }
+    
     try {
         // Insert poll
         session_->sql(
@@ -1227,6 +2405,11 @@ bool MySQLClient::createPoll(const Poll& poll) {
 }
 
 std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("polls", "poll_id", pollId);
+        return shard ? shards_[*shard]->getPoll(pollId) : std::nullopt;
+    }
+    
     try {
         auto pollResult = session_->sql(
             "SELECT poll_id, room_id, question, created_by, created_at, is_closed "
@@ -1287,6 +2470,10 @@ std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
 }
 
 std::vector<Poll> MySQLClient::getRoomPolls(const std::string& roomId, bool activeOnly) {
+    if (!shards_.empty()) {
+        return shardFor(roomId).getRoomPolls(roomId, activeOnly);
+    }
+    
     std::vector<Poll> polls;
     try {
         std::string sql = "SELECT poll_id FROM polls WHERE room_id = ?";
@@ -1314,6 +2501,15 @@ std::vector<Poll> MySQLClient::getRoomPolls(const std::string& roomId, bool acti
 }
 
 bool MySQLClient::votePoll(const PollVote& vote) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("polls", "poll_id", vote.pollId);
+        if (!shard) {
+            Logger::warning("Poll not found: " + vote.pollId);
+            return false;
+        }
+        return shards_[*shard]->votePoll(vote);
+    }
+    
     try {
         // Check if poll is closed
         auto pollResult = session_->sql(
@@ -1345,6 +2541,11 @@ bool MySQLClient::votePoll(const PollVote& vote) {
 }
 
 bool MySQLClient::closePoll(const std::string& pollId) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("polls", "poll_id", pollId);
+        return shard && shards_[*shard]->closePoll(pollId);
+    }
+    
     try {
         auto result = session_->sql(
             "UPDATE polls SET is_closed = 1 WHERE poll_id = ?"
@@ -1359,6 +2560,12 @@ bool MySQLClient::closePoll(const std::string& pollId) {
 }
 
 bool MySQLClient::deletePoll(const std::string& pollId) {
+    if (!shards_.empty()) {
+        auto shard = locateRow("polls", "poll_id", pollId);
+        rowShards_->remove("polls:" + pollId);
+        return shard && shards_[*shard]->deletePoll(pollId);
+    }
+    
     try {
         // CASCADE will delete options and votes
         auto result = session_->sql(
@@ -1373,6 +2580,127 @@ bool MySQLClient::deletePoll(const std::string& pollId) {
     }
 }
 
+// Disappearing messages - per-room TTL (rooms and DM conversations)
+bool MySQLClient::setRoomMessageTtl(const std::string& roomId, uint32_t ttlSeconds) {
+    try {
+        if (ttlSeconds == 0) {
+            session_->sql("DELETE FROM room_message_ttl WHERE room_id = ?").bind(roomId).execute();
+        } else {
+            session_->sql(
+                "INSERT INTO room_message_ttl (room_id, ttl_seconds) VALUES (?, ?) "
+                "ON DUPLICATE KEY UPDATE ttl_seconds = VALUES(ttl_seconds)"
+            ).bind(roomId, ttlSeconds).execute();
+        }
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "setRoomMessageTtl");
+        return false;
+    }
+}
+
+std::vector<std::pair<std::string, uint32_t>> MySQLClient::getRoomMessageTtls() {
+    std::vector<std::pair<std::string, uint32_t>> ttls;
+    try {
+        auto result = session_->sql("SELECT room_id, ttl_seconds FROM room_message_ttl").execute();
+        for (auto row : result) {
+            ttls.emplace_back(row[0].get<std::string>(), static_cast<uint32_t>(row[1].get<uint64_t>()));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getRoomMessageTtls");
+    }
+    return ttls;
+}
+
+// Outbound webhooks
+bool MySQLClient::createRoomWebhook(const RoomWebhook& webhook) {
+    try {
+        session_->sql(
+            "INSERT INTO room_webhooks (webhook_id, room_id, url, secret, created_by) VALUES (?, ?, ?, ?, ?)"
+        ).bind(webhook.webhookId, webhook.roomId, webhook.url, webhook.secret, webhook.createdBy).execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "createRoomWebhook");
+        return false;
+    }
+}
+
+bool MySQLClient::deleteRoomWebhook(const std::string& webhookId, const std::string& roomId) {
+    try {
+        auto result = session_->sql("DELETE FROM room_webhooks WHERE webhook_id = ? AND room_id = ?")
+            .bind(webhookId, roomId).execute();
+        return result.getAffectedItemsCount() > 0;
+    } catch (const std::exception& e) {
+        handleException(e, "deleteRoomWebhook");
+        return false;
+    }
+}
+
+std::vector<RoomWebhook> MySQLClient::getRoomWebhooks() {
+    std::vector<RoomWebhook> webhooks;
+    try {
+        auto result = session_->sql("SELECT webhook_id, room_id, url, secret, created_by FROM room_webhooks").execute();
+        for (auto row : result) {
+            RoomWebhook webhook;
+            webhook.webhookId = row[0].get<std::string>();
+            webhook.roomId = row[1].get<std::string>();
+            webhook.url = row[2].get<std::string>();
+            webhook.secret = row[3].get<std::string>();
+            webhook.createdBy = row[4].get<std::string>();
+            webhooks.push_back(std::move(webhook));
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getRoomWebhooks");
+    }
+    return webhooks;
+}
+
+std::optional<std::pair<std::string, std::string>> MySQLClient::getDmParticipants(const std::string& conversationId) {
+    try {
+        auto result = session_->sql(
+            "SELECT user1_id, user2_id FROM dm_conversations WHERE conversation_id = ?"
+        ).bind(conversationId).execute();
+        auto row = result.fetchOne();
+        if (row) {
+            return std::make_pair(row[0].get<std::string>(), row[1].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getDmParticipants");
+    }
+    return std::nullopt;
+}
+
+std::unordered_map<std::string, std::pair<std::string, std::string>> MySQLClient::getDmParticipantsByIds(
+    const std::vector<std::string>& conversationIds) {
+    std::unordered_map<std::string, std::pair<std::string, std::string>> participants;
+    if (conversationIds.empty()) {
+        return participants;
+    }
+    
+    try {
+        std::string placeholders;
+        placeholders.reserve(conversationIds.size() * 2);
+        for (size_t i = 0; i < conversationIds.size(); ++i) {
+            placeholders += (i == 0 ? "?" : ",?");
+        }
+        
+        auto stmt = session_->sql(
+            "SELECT conversation_id, user1_id, user2_id FROM dm_conversations "
+            "WHERE conversation_id IN (" + placeholders + ")");
+        for (const auto& conversationId : conversationIds) {
+            stmt.bind(conversationId);
+        }
+        
+        auto result = stmt.execute();
+        for (auto row : result) {
+            participants[row[0].get<std::string>()] = {row[1].get<std::string>(), row[2].get<std::string>()};
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getDmParticipantsByIds");
+        participants.clear();
+    }
+    return participants;
+}
+
 // DM Conversations - Discord/Telegram style
 // Returns existing conversation_id or creates a new one
 std::string MySQLClient::getOrCreateDmConversation(const std::string& userId1, const std::string& userId2) {
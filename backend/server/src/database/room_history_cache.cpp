@@ -0,0 +1,180 @@
+#include "database/room_history_cache.h"
+#include <algorithm>
+
+RoomHistoryCache::RoomHistoryCache(size_t maxRooms, size_t maxMessagesPerRoom)
+    : maxRooms_(maxRooms), maxMessagesPerRoom_(maxMessagesPerRoom) {}
+
+std::optional<std::vector<Message>> RoomHistoryCache::get(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return std::nullopt;
+    }
+
+    touch(it->second);
+    return std::vector<Message>(it->second.messages.begin(), it->second.messages.end());
+}
+
+void RoomHistoryCache::put(const std::string& roomId, const std::vector<Message>& messages) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    store(roomId, messages);
+}
+
+uint64_t RoomHistoryCache::version(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return versions_[std::hash<std::string>{}(roomId) % VERSION_STRIPES];
+}
+
+bool RoomHistoryCache::put(const std::string& roomId, const std::vector<Message>& messages,
+                           uint64_t expectedVersion) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (versionOf(roomId) != expectedVersion) {
+        return false;  // Updated while the caller read the database
+    }
+    store(roomId, messages);
+    return true;
+}
+
+void RoomHistoryCache::store(const std::string& roomId, const std::vector<Message>& messages) {
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        lru_.push_front(roomId);
+        it = rooms_.emplace(roomId, Entry{{}, lru_.begin()}).first;
+    } else {
+        touch(it->second);
+    }
+
+    // Keep only the newest window
+    size_t start = messages.size() > maxMessagesPerRoom_ ? messages.size() - maxMessagesPerRoom_ : 0;
+    it->second.messages.assign(messages.begin() + start, messages.end());
+
+    // Evict least recently used rooms
+    while (rooms_.size() > maxRooms_) {
+        rooms_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
+
+void RoomHistoryCache::append(const Message& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(message.roomId)++;
+
+    auto it = rooms_.find(message.roomId);
+    if (it == rooms_.end()) {
+        return;  // Not cached - will be loaded from DB on next read
+    }
+
+    auto& messages = it->second.messages;
+    messages.push_back(message);
+    while (messages.size() > maxMessagesPerRoom_) {
+        messages.pop_front();
+    }
+}
+
+std::optional<uint32_t> RoomHistoryCache::recordReply(const std::string& roomId,
+                                                      const std::string& parentId,
+                                                      uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(roomId)++;
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return std::nullopt;
+    }
+
+    Message* parent = findMessage(it->second, parentId);
+    if (!parent) {
+        return std::nullopt;
+    }
+
+    parent->replyCount++;
+    parent->lastReplyAt = timestamp;
+    return parent->replyCount;
+}
+
+void RoomHistoryCache::updateContent(const std::string& roomId,
+                                     const std::string& messageId,
+                                     const std::string& content) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(roomId)++;
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;
+    }
+
+    Message* message = findMessage(it->second, messageId);
+    if (message) {
+        message->content = content;
+        message->compressed &= ~Message::CONTENT_COMPRESSED;
+    }
+}
+
+void RoomHistoryCache::updateMetadata(const std::string& roomId,
+                                      const std::string& messageId,
+                                      const std::string& metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(roomId)++;
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;
+    }
+
+    Message* message = findMessage(it->second, messageId);
+    if (message) {
+        message->metadata = metadata;
+        message->compressed &= ~Message::METADATA_COMPRESSED;
+    }
+}
+
+void RoomHistoryCache::removeMessages(const std::string& roomId,
+                                      const std::vector<std::string>& messageIds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(roomId)++;
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;
+    }
+
+    auto& messages = it->second.messages;
+    messages.erase(std::remove_if(messages.begin(), messages.end(), [&](const Message& m) {
+        return std::find(messageIds.begin(), messageIds.end(), m.messageId) != messageIds.end();
+    }), messages.end());
+}
+
+void RoomHistoryCache::invalidate(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionOf(roomId)++;
+
+    auto it = rooms_.find(roomId);
+    if (it != rooms_.end()) {
+        lru_.erase(it->second.lruIt);
+        rooms_.erase(it);
+    }
+}
+
+size_t RoomHistoryCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rooms_.size();
+}
+
+uint64_t& RoomHistoryCache::versionOf(const std::string& roomId) {
+    return versions_[std::hash<std::string>{}(roomId) % VERSION_STRIPES];
+}
+
+void RoomHistoryCache::touch(Entry& entry) {
+    lru_.splice(lru_.begin(), lru_, entry.lruIt);
+}
+
+Message* RoomHistoryCache::findMessage(Entry& entry, const std::string& messageId) {
+    // Newest messages are the most likely targets
+    for (auto it = entry.messages.rbegin(); it != entry.messages.rend(); ++it) {
+        if (it->messageId == messageId) {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,280 @@
+#include "database/room_membership_index.h"
+#include <algorithm>
+#include <cctype>
+
+RoomMembershipIndex::RoomMembershipIndex(size_t maxRooms)
+    : maxRooms_(std::max<size_t>(maxRooms, 1)) {}
+
+bool RoomMembershipIndex::hasRoom(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return false;
+    }
+    touchLocked(it->second);
+    return true;
+}
+
+size_t RoomMembershipIndex::roomCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rooms_.size();
+}
+
+void RoomMembershipIndex::loadRoom(const std::string& roomId, const std::vector<User>& members) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto [it, created] = rooms_.try_emplace(roomId);
+    RoomEntry& room = it->second;
+    if (created) {
+        lru_.push_front(roomId);
+        room.lruPos = lru_.begin();
+    } else {
+        std::vector<std::string> userIds;
+        for (const auto& [userId, member] : room.members) {
+            userIds.push_back(userId);
+        }
+        for (const auto& userId : userIds) {
+            eraseLocked(room, roomId, userId);
+        }
+        touchLocked(room);
+    }
+    for (const auto& user : members) {
+        insertLocked(room, roomId, Member{user.userId, user.username, user.avatarUrl, false});
+    }
+    evictLocked();
+}
+
+void RoomMembershipIndex::addMember(const std::string& roomId, const User& user) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;  // Not loaded - will come from DB on first use
+    }
+    eraseLocked(it->second, roomId, user.userId);
+    insertLocked(it->second, roomId, Member{user.userId, user.username, user.avatarUrl, false});
+}
+
+void RoomMembershipIndex::removeMember(const std::string& roomId, const std::string& userId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = rooms_.find(roomId);
+    if (it != rooms_.end()) {
+        eraseLocked(it->second, roomId, userId);
+    }
+}
+
+void RoomMembershipIndex::updateProfile(const std::string& userId, const std::string& username, const std::string& avatar) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto roomsIt = userRooms_.find(userId);
+    if (roomsIt == userRooms_.end()) {
+        return;
+    }
+
+    std::vector<std::string> roomIds(roomsIt->second.begin(), roomsIt->second.end());
+    for (const auto& roomId : roomIds) {
+        RoomEntry& room = rooms_[roomId];
+        auto memberIt = room.members.find(userId);
+        if (memberIt == room.members.end()) continue;
+
+        Member updated = memberIt->second;
+        if (!username.empty()) updated.username = username;
+        if (!avatar.empty()) updated.avatar = avatar;
+        eraseLocked(room, roomId, userId);
+        insertLocked(room, roomId, updated);
+    }
+}
+
+void RoomMembershipIndex::userConnected(const std::string& userId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (++connectionCounts_[userId] == 1) {
+        setOnlineLocked(userId, true);
+    }
+}
+
+bool RoomMembershipIndex::isOnline(const std::string& userId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connectionCounts_.count(userId) > 0;
+}
+
+void RoomMembershipIndex::userDisconnected(const std::string& userId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = connectionCounts_.find(userId);
+    if (it == connectionCounts_.end()) {
+        return;
+    }
+    if (--it->second <= 0) {
+        connectionCounts_.erase(it);
+        setOnlineLocked(userId, false);
+    }
+}
+
+size_t RoomMembershipIndex::memberCount(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    return it == rooms_.end() ? 0 : it->second.members.size();
+}
+
+size_t RoomMembershipIndex::onlineCount(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    return it == rooms_.end() ? 0 : it->second.online.size();
+}
+
+bool RoomMembershipIndex::isMember(const std::string& roomId, const std::string& userId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return false;
+    }
+    touchLocked(it->second);
+    return it->second.members.count(userId) > 0;
+}
+
+std::unordered_set<std::string> RoomMembershipIndex::memberIds(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_set<std::string> ids;
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return ids;
+    }
+    touchLocked(it->second);
+    ids.reserve(it->second.members.size());
+    for (const auto& [userId, member] : it->second.members) {
+        ids.insert(userId);
+    }
+    return ids;
+}
+
+RoomMembershipIndex::Page RoomMembershipIndex::getPage(const std::string& roomId,
+                                                       const std::string& cursor,
+                                                       size_t limit,
+                                                       const std::string& prefix) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Page page;
+
+    auto roomIt = rooms_.find(roomId);
+    if (roomIt == rooms_.end() || limit == 0) {
+        return page;
+    }
+    const RoomEntry& room = roomIt->second;
+    touchLocked(room);
+
+    // Cursor format: "<o|f>:<userId>:<lowercase username>" of the last member returned
+    int startGroup = 0;
+    bool hasAfter = false;
+    Key after;
+    if (cursor.size() > 2 && cursor[1] == ':') {
+        size_t sep = cursor.find(':', 2);
+        if (sep != std::string::npos) {
+            startGroup = cursor[0] == 'f' ? 1 : 0;
+            after = {cursor.substr(sep + 1), cursor.substr(2, sep - 2)};
+            hasAfter = true;
+        }
+    }
+
+    std::string lowerPrefix = toLower(prefix);
+    const std::set<Key>* groups[2] = {&room.online, &room.offline};
+
+    for (int g = startGroup; g < 2; ++g) {
+        const std::set<Key>& keys = *groups[g];
+        auto it = (g == startGroup && hasAfter) ? keys.upper_bound(after)
+                                                : keys.lower_bound({lowerPrefix, ""});
+        for (; it != keys.end(); ++it) {
+            if (!lowerPrefix.empty() && it->first.compare(0, lowerPrefix.size(), lowerPrefix) != 0) {
+                break;  // Past the prefix range
+            }
+            if (page.members.size() == limit) {
+                const Member& last = page.members.back();
+                page.nextCursor = std::string(last.online ? "o" : "f") + ":" + last.userId + ":" + toLower(last.username);
+                return page;
+            }
+            page.members.push_back(room.members.at(it->second));
+        }
+    }
+    return page;
+}
+
+std::string RoomMembershipIndex::toLower(const std::string& s) {
+    std::string out = s;
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+RoomMembershipIndex::Key RoomMembershipIndex::keyOf(const Member& member) {
+    return {toLower(member.username), member.userId};
+}
+
+void RoomMembershipIndex::insertLocked(RoomEntry& room, const std::string& roomId, Member member) {
+    member.online = connectionCounts_.count(member.userId) > 0;
+    (member.online ? room.online : room.offline).insert(keyOf(member));
+    userRooms_[member.userId].insert(roomId);
+    room.members[member.userId] = std::move(member);
+}
+
+void RoomMembershipIndex::eraseLocked(RoomEntry& room, const std::string& roomId, const std::string& userId) {
+    auto it = room.members.find(userId);
+    if (it == room.members.end()) {
+        return;
+    }
+    Key key = keyOf(it->second);
+    room.online.erase(key);
+    room.offline.erase(key);
+    room.members.erase(it);
+
+    auto roomsIt = userRooms_.find(userId);
+    if (roomsIt != userRooms_.end()) {
+        roomsIt->second.erase(roomId);
+        if (roomsIt->second.empty()) {
+            userRooms_.erase(roomsIt);
+        }
+    }
+}
+
+void RoomMembershipIndex::setOnlineLocked(const std::string& userId, bool online) {
+    auto roomsIt = userRooms_.find(userId);
+    if (roomsIt == userRooms_.end()) {
+        return;
+    }
+
+    for (const auto& roomId : roomsIt->second) {
+        RoomEntry& room = rooms_[roomId];
+        auto memberIt = room.members.find(userId);
+        if (memberIt == room.members.end()) continue;
+
+        Key key = keyOf(memberIt->second);
+        if (online) {
+            room.offline.erase(key);
+            room.online.insert(key);
+        } else {
+            room.online.erase(key);
+            room.offline.insert(key);
+        }
+        memberIt->second.online = online;
+    }
+}
+
+void RoomMembershipIndex::touchLocked(const RoomEntry& room) const {
+    lru_.splice(lru_.begin(), lru_, room.lruPos);
+}
+
+void RoomMembershipIndex::evictLocked() {
+    while (rooms_.size() > maxRooms_) {
+        std::string roomId = lru_.back();
+        lru_.pop_back();
+        auto it = rooms_.find(roomId);
+        for (const auto& [userId, member] : it->second.members) {
+            auto roomsIt = userRooms_.find(userId);
+            if (roomsIt != userRooms_.end()) {
+                roomsIt->second.erase(roomId);
+                if (roomsIt->second.empty()) {
+                    userRooms_.erase(roomsIt);
+                }
+            }
+        }
+        rooms_.erase(it);
+    }
+}
@@ -0,0 +1,85 @@
+#include "database/shard_map.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+std::vector<ShardEndpoint> parseShardList(const std::string& spec, int defaultPort,
+                                          const std::string& defaultDatabase) {
+    std::vector<ShardEndpoint> shards;
+    std::stringstream ss(spec);
+    std::string token;
+
+    try {
+        while (std::getline(ss, token, ',')) {
+            token.erase(std::remove_if(token.begin(), token.end(),
+                                       [](unsigned char c) { return std::isspace(c); }),
+                        token.end());
+            if (token.empty()) {
+                continue;
+            }
+
+            ShardEndpoint shard;
+            shard.port = defaultPort;
+            shard.database = defaultDatabase;
+
+            size_t slash = token.find('/');
+            if (slash != std::string::npos) {
+                shard.database = token.substr(slash + 1);
+                token.resize(slash);
+            }
+            size_t colon = token.find(':');
+            if (colon != std::string::npos) {
+                shard.port = std::stoi(token.substr(colon + 1));
+                token.resize(colon);
+            }
+            shard.host = token;
+
+            if (shard.host.empty() || shard.database.empty() || shard.port <= 0 || shard.port > 65535) {
+                throw std::invalid_argument(token);
+            }
+            shards.push_back(std::move(shard));
+        }
+    } catch (const std::exception&) {
+        Logger::warning("⚠️ Invalid MESSAGE_SHARDS: \"" + spec + "\" (expected e.g. db1:33060/chatbox_db,db2)");
+        return {};
+    }
+    return shards;
+}
+
+uint64_t ShardRing::hash(std::string_view key) {
+    // FNV-1a, then a splitmix64 finalizer so similar keys ("shard-1#7", "shard-1#8") spread over the ring
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+ShardRing::ShardRing(size_t shardCount) : shardCount_(shardCount) {
+    points_.reserve(shardCount * VNODES);
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        for (size_t v = 0; v < VNODES; ++v) {
+            points_.emplace_back(hash("shard-" + std::to_string(shard) + "#" + std::to_string(v)), shard);
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t ShardRing::shardFor(std::string_view roomId) const {
+    if (points_.empty()) {
+        return 0;
+    }
+    uint64_t h = hash(roomId);
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(h, size_t{0}));
+    if (it == points_.end()) {
+        it = points_.begin();  // Wrap around
+    }
+    return it->second;
+}
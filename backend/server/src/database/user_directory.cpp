@@ -0,0 +1,155 @@
+#include "database/user_directory.h"
+#include <algorithm>
+#include <cctype>
+#include <tuple>
+#include <unordered_set>
+
+void UserDirectory::load(const std::vector<User>& users) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    users_.clear();
+    usernames_.clear();
+    displayNames_.clear();
+
+    // Room to double before the false-positive rate degrades noticeably
+    usernameFilter_ = BloomFilter(std::max<size_t>(users.size() * 2, 10000), 0.01);
+
+    for (const auto& user : users) {
+        insertLocked({user.userId, user.username, user.displayName, user.avatarUrl, user.statusMessage});
+    }
+    loaded_ = true;
+}
+
+bool UserDirectory::isLoaded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_;
+}
+
+void UserDirectory::addUser(const User& user) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = users_.find(user.userId);
+    if (it != users_.end()) {
+        usernames_.erase({toLower(it->second.username), user.userId});
+        displayNames_.erase({toLower(it->second.displayName), user.userId});
+        users_.erase(it);
+    }
+    insertLocked({user.userId, user.username, user.displayName, user.avatarUrl, user.statusMessage});
+}
+
+void UserDirectory::updateProfile(const std::string& userId, const std::string& displayName,
+                                  const std::string& avatar, const std::string& statusMessage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = users_.find(userId);
+    if (it == users_.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+
+    // Same semantics as the profile_update SQL: empty name/avatar keep the old value
+    if (!displayName.empty() && displayName != entry.displayName) {
+        displayNames_.erase({toLower(entry.displayName), userId});
+        entry.displayName = displayName;
+        displayNames_.insert({toLower(displayName), userId});
+    }
+    if (!avatar.empty()) {
+        entry.avatar = avatar;
+    }
+    entry.statusMessage = statusMessage;
+}
+
+bool UserDirectory::mayHaveUsername(const std::string& username) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !loaded_ || usernameFilter_.mightContain(toLower(username));
+}
+
+std::vector<UserDirectory::Entry> UserDirectory::search(const std::string& query, size_t limit,
+                                                        const std::string& excludeUserId,
+                                                        const OnlineCheck& isOnline) const {
+    std::string prefix = toLower(query);
+    std::vector<Entry> matches;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unordered_set<std::string> seen;
+
+        // Username range first so exact and near-exact usernames are always candidates
+        for (const auto* index : {&usernames_, &displayNames_}) {
+            for (auto it = index->lower_bound({prefix, ""}); it != index->end(); ++it) {
+                if (it->first.compare(0, prefix.size(), prefix) != 0 || matches.size() >= MAX_SEARCH_CANDIDATES) {
+                    break;
+                }
+                if (it->second == excludeUserId || !seen.insert(it->second).second) {
+                    continue;
+                }
+                matches.push_back(users_.at(it->second));
+            }
+        }
+    }
+
+    for (auto& entry : matches) {
+        entry.online = isOnline && isOnline(entry.userId);
+    }
+
+    // Exact username, then online, then shortest name, then alphabetical
+    auto rank = [&prefix](const Entry& e) {
+        std::string name = toLower(e.username);
+        return std::make_tuple(name != prefix, !e.online, name.size(), name);
+    };
+    size_t k = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + k, matches.end(),
+                      [&rank](const Entry& a, const Entry& b) { return rank(a) < rank(b); });
+    matches.resize(k);
+    return matches;
+}
+
+UserDirectory::Page UserDirectory::list(const std::string& cursor, size_t limit, const OnlineCheck& isOnline) const {
+    Page page;
+    if (limit == 0) {
+        return page;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Cursor format: "<userId>:<lowercase username>" of the last user returned
+        auto it = usernames_.begin();
+        size_t sep = cursor.find(':');
+        if (sep != std::string::npos) {
+            it = usernames_.upper_bound({cursor.substr(sep + 1), cursor.substr(0, sep)});
+        }
+
+        for (; it != usernames_.end(); ++it) {
+            if (page.users.size() == limit) {
+                const Entry& last = page.users.back();
+                page.nextCursor = last.userId + ":" + toLower(last.username);
+                break;
+            }
+            page.users.push_back(users_.at(it->second));
+        }
+    }
+
+    for (auto& entry : page.users) {
+        entry.online = isOnline && isOnline(entry.userId);
+    }
+    return page;
+}
+
+size_t UserDirectory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return users_.size();
+}
+
+std::string UserDirectory::toLower(const std::string& s) {
+    std::string out = s;
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+void UserDirectory::insertLocked(Entry entry) {
+    std::string lowerName = toLower(entry.username);
+    usernames_.insert({lowerName, entry.userId});
+    if (!entry.displayName.empty()) {
+        displayNames_.insert({toLower(entry.displayName), entry.userId});
+    }
+    usernameFilter_.add(lowerName);
+    users_[entry.userId] = std::move(entry);
+}
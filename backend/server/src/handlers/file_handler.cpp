@@ -1,6 +1,7 @@
 #include "handlers/file_handler.h"
 #include "pubsub/pubsub_broker.h"
 #include "utils/logger.h"
+#include "utils/lock_profiler.h"
 #include "socket_data.h"
 #include <uwebsockets/WebSocket.h>
 #include <filesystem>
@@ -34,7 +35,7 @@ struct UploadSession {
 
 // Store active upload sessions
 static std::unordered_map<std::string, UploadSession> activeUploads;
-static std::mutex uploadsMutex;
+static ProfiledMutex uploadsMutex("uploads");
 
 // Local storage directories
 const std::string UPLOADS_DIR = "./uploads";
@@ -177,7 +178,7 @@ void FileHandler::handleUploadInit(void* wsPtr,
 
         // Store session
         {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             activeUploads[uploadId] = session;
         }
 
@@ -228,7 +229,7 @@ void FileHandler::handleUploadChunk(void* wsPtr,
         // Get upload session
         UploadSession* session = nullptr;
         {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             auto it = activeUploads.find(uploadId);
             if (it == activeUploads.end()) {
                 throw std::runtime_error("Upload session not found: " + uploadId);
@@ -255,7 +256,7 @@ void FileHandler::handleUploadChunk(void* wsPtr,
 
         // Update session
         {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             session->chunksReceived++;
         }
 
@@ -307,7 +308,7 @@ void FileHandler::handleUploadFinalize(void* wsPtr,
         // Get upload session
         UploadSession session;
         {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             auto it = activeUploads.find(uploadId);
             if (it == activeUploads.end()) {
                 throw std::runtime_error("Upload session not found");
@@ -360,7 +361,7 @@ void FileHandler::handleUploadFinalize(void* wsPtr,
 
         // Remove from active uploads
         {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             activeUploads.erase(uploadId);
         }
 
@@ -396,7 +397,7 @@ void FileHandler::handleUploadFinalize(void* wsPtr,
         
         // Clean up on error
         try {
-            std::lock_guard<std::mutex> lock(uploadsMutex);
+            ProfiledLock lock(uploadsMutex);
             auto it = activeUploads.find(uploadId);
             if (it != activeUploads.end()) {
                 fs::remove_all(it->second.tempDir);
@@ -61,7 +61,7 @@ std::string WebRTCHandler::initiateCall(const std::string& callerId,
                                          const std::string& targetId,
                                          CallType type,
                                          bool isGroupCall) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     // Check if caller already in a call
     if (userCalls_.count(callerId) > 0) {
@@ -116,7 +116,7 @@ std::string WebRTCHandler::initiateCall(const std::string& callerId,
 
 std::string WebRTCHandler::acceptCall(const std::string& callId,
                                        const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ Call not found!";
@@ -158,7 +158,7 @@ std::string WebRTCHandler::acceptCall(const std::string& callId,
 std::string WebRTCHandler::rejectCall(const std::string& callId,
                                        const std::string& userId,
                                        const std::string& reason) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ Call not found!";
@@ -185,7 +185,7 @@ std::string WebRTCHandler::rejectCall(const std::string& callId,
 
 std::string WebRTCHandler::endCall(const std::string& callId,
                                     const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ No active call!";
@@ -240,7 +240,7 @@ void WebRTCHandler::sendOffer(const std::string& callId,
                                const std::string& fromUserId,
                                const std::string& toUserId,
                                const std::string& sdpOffer) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     // Use nlohmann::json for proper escaping
     json signalData = {
@@ -258,7 +258,7 @@ void WebRTCHandler::sendAnswer(const std::string& callId,
                                 const std::string& fromUserId,
                                 const std::string& toUserId,
                                 const std::string& sdpAnswer) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     // Mark call as connected
     if (calls_.count(callId) > 0) {
@@ -301,7 +301,7 @@ void WebRTCHandler::sendIceCandidate(const std::string& callId,
 // ============================================================================
 
 std::string WebRTCHandler::toggleMute(const std::string& callId, const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ No active call!";
@@ -328,7 +328,7 @@ std::string WebRTCHandler::toggleMute(const std::string& callId, const std::stri
 }
 
 std::string WebRTCHandler::toggleVideo(const std::string& callId, const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ No active call!";
@@ -355,7 +355,7 @@ std::string WebRTCHandler::toggleVideo(const std::string& callId, const std::str
 }
 
 std::string WebRTCHandler::startScreenShare(const std::string& callId, const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ No active call!";
@@ -382,7 +382,7 @@ std::string WebRTCHandler::startScreenShare(const std::string& callId, const std
 }
 
 std::string WebRTCHandler::stopScreenShare(const std::string& callId, const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "❌ No active call!";
@@ -413,12 +413,12 @@ std::string WebRTCHandler::stopScreenShare(const std::string& callId, const std:
 // ============================================================================
 
 bool WebRTCHandler::hasActiveCall(const std::string& userId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     return userCalls_.count(userId) > 0;
 }
 
 std::string WebRTCHandler::getCallStatus(const std::string& callId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     if (calls_.count(callId) == 0) {
         return "No active call.";
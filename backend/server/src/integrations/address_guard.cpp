@@ -0,0 +1,136 @@
+#include "integrations/address_guard.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+namespace {
+
+bool isPrivateV4(uint32_t ip) {
+    return (ip >> 24) == 0 ||                   // 0.0.0.0/8
+           (ip >> 24) == 10 ||                  // 10/8
+           (ip >> 24) == 127 ||                 // loopback
+           (ip & 0xFFC00000) == 0x64400000 ||   // 100.64/10 (CGNAT)
+           (ip >> 16) == 0xA9FE ||              // 169.254/16 (link-local, cloud metadata)
+           (ip & 0xFFF00000) == 0xAC100000 ||   // 172.16/12
+           (ip >> 16) == 0xC0A8 ||              // 192.168/16
+           ip >= 0xE0000000;                    // multicast and reserved
+}
+
+// One to four dot-separated decimal, octal or 0x-hex numbers
+bool isLegacyNumericV4(const std::string& name) {
+    size_t parts = 0;
+    size_t start = 0;
+    while (start <= name.size()) {
+        size_t dot = name.find('.', start);
+        std::string part = name.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+        bool hex = part.size() > 2 && part[0] == '0' && part[1] == 'x';
+        const char* digits = hex ? "0123456789abcdef" : "0123456789";
+        if (part.empty() || part.find_first_not_of(digits, hex ? 2 : 0) != std::string::npos || ++parts > 4) {
+            return false;
+        }
+        if (dot == std::string::npos) {
+            break;
+        }
+        start = dot + 1;
+    }
+    return parts > 0;
+}
+
+curl_socket_t openPublicSocket(void*, curlsocktype purpose, struct curl_sockaddr* address) {
+    if (purpose != CURLSOCKTYPE_IPCXN || address_guard::isPrivateAddress(&address->addr)) {
+        return CURL_SOCKET_BAD;  // Fails the request with CURLE_COULDNT_CONNECT
+    }
+    return socket(address->family, address->socktype, address->protocol);
+}
+
+} // namespace
+
+namespace address_guard {
+
+bool isPrivateAddress(const struct sockaddr* addr) {
+    if (addr->sa_family == AF_INET) {
+        const auto* in = reinterpret_cast<const struct sockaddr_in*>(addr);
+        return isPrivateV4(ntohl(in->sin_addr.s_addr));
+    }
+    if (addr->sa_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(addr);
+        const uint8_t* b = in6->sin6_addr.s6_addr;
+        static const uint8_t v4Mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+        if (std::memcmp(b, v4Mapped, sizeof(v4Mapped)) == 0) {
+            return isPrivateV4((uint32_t(b[12]) << 24) | (uint32_t(b[13]) << 16) | (uint32_t(b[14]) << 8) | b[15]);
+        }
+        bool zeroPrefix = std::all_of(b, b + 15, [](uint8_t x) { return x == 0; });
+        return (zeroPrefix && b[15] <= 1) ||          // :: and ::1
+               (b[0] & 0xFE) == 0xFC ||               // fc00::/7 (unique local)
+               (b[0] == 0xFE && (b[1] & 0xC0) == 0x80) ||  // fe80::/10 (link-local)
+               b[0] == 0xFF;                          // multicast
+    }
+    return true;
+}
+
+std::string hostOf(const std::string& url) {
+    size_t scheme = url.find("://");
+    if (scheme == std::string::npos) {
+        return "";
+    }
+    size_t start = scheme + 3;
+    size_t end = url.find_first_of("/?#", start);
+    std::string authority = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t at = authority.rfind('@');
+    if (at != std::string::npos) {
+        authority = authority.substr(at + 1);
+    }
+
+    std::string host;
+    if (!authority.empty() && authority.front() == '[') {
+        size_t close = authority.find(']');
+        host = authority.substr(1, close == std::string::npos ? std::string::npos : close - 1);
+    } else {
+        host = authority.substr(0, authority.find(':'));
+    }
+    std::transform(host.begin(), host.end(), host.begin(), [](unsigned char c) { return std::tolower(c); });
+    return host;
+}
+
+bool isPrivateHost(const std::string& host) {
+    std::string name = host;
+    while (!name.empty() && name.back() == '.') {
+        name.pop_back();
+    }
+    if (name.empty() || name == "localhost" ||
+        (name.size() > 10 && name.compare(name.size() - 10, 10, ".localhost") == 0)) {
+        return true;
+    }
+
+    struct sockaddr_in in {};
+    if (inet_pton(AF_INET, name.c_str(), &in.sin_addr) == 1) {
+        in.sin_family = AF_INET;
+        return isPrivateAddress(reinterpret_cast<const struct sockaddr*>(&in));
+    }
+    struct sockaddr_in6 in6 {};
+    if (inet_pton(AF_INET6, name.c_str(), &in6.sin6_addr) == 1) {
+        in6.sin6_family = AF_INET6;
+        return isPrivateAddress(reinterpret_cast<const struct sockaddr*>(&in6));
+    }
+
+    // Numeric forms inet_pton does not take but resolvers do ("2130706433", "0x7f.1", "0177.1"):
+    // refused outright rather than decoded
+    return isLegacyNumericV4(name);
+}
+
+void restrictToPublic(void* easy) {
+    curl_easy_setopt(static_cast<CURL*>(easy), CURLOPT_OPENSOCKETFUNCTION, openPublicSocket);
+}
+
+} // namespace address_guard
@@ -0,0 +1,607 @@
+#include "integrations/link_unfurler.h"
+#include "integrations/address_guard.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+constexpr int IDLE_POLL_MS = 1000;
+constexpr size_t MAX_URL_LENGTH = 2048;
+constexpr size_t MAX_TITLE_BYTES = 200;
+constexpr size_t MAX_DESCRIPTION_BYTES = 300;
+
+std::string toLower(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return std::tolower(c); });
+    return out;
+}
+
+bool startsWithNoCase(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && toLower(s.substr(0, prefix.size())) == prefix;
+}
+
+// ---- HTML helpers ----
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x110000) {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Entities decoded, whitespace collapsed, trimmed, cut to maxBytes on a UTF-8 boundary
+std::string cleanText(std::string_view raw, size_t maxBytes) {
+    std::string out;
+    out.reserve(std::min(raw.size(), maxBytes + 4));
+    bool space = false;
+
+    for (size_t i = 0; i < raw.size() && out.size() < maxBytes + 4; ++i) {
+        char c = raw[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) {
+            out.push_back(' ');
+            space = false;
+        }
+        if (c != '&') {
+            out.push_back(c);
+            continue;
+        }
+
+        size_t semi = raw.find(';', i);
+        if (semi == std::string_view::npos || semi - i > 10) {
+            out.push_back(c);
+            continue;
+        }
+        std::string_view entity = raw.substr(i + 1, semi - i - 1);
+        uint32_t cp = 0;
+        if (entity == "amp") cp = '&';
+        else if (entity == "lt") cp = '<';
+        else if (entity == "gt") cp = '>';
+        else if (entity == "quot") cp = '"';
+        else if (entity == "apos") cp = '\'';
+        else if (entity == "nbsp") cp = ' ';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            try {
+                cp = static_cast<uint32_t>(std::stoul(std::string(entity.substr(hex ? 2 : 1)), nullptr, hex ? 16 : 10));
+            } catch (const std::exception&) {
+                cp = 0;
+            }
+        }
+        if (cp == 0) {
+            out.push_back(c);
+            continue;
+        }
+        appendUtf8(out, cp);
+        i = semi;
+    }
+
+    if (out.size() > maxBytes) {
+        size_t cut = maxBytes;
+        while (cut > 0 && (static_cast<unsigned char>(out[cut]) & 0xC0) == 0x80) {
+            --cut;
+        }
+        out.resize(cut);
+        out += "…";
+    }
+    while (!out.empty() && out.back() == ' ') {
+        out.pop_back();
+    }
+    return out;
+}
+
+// Attribute value (raw) from the inside of a tag, e.g. `meta property="og:title" content="..."`
+std::string attribute(std::string_view tag, std::string_view name) {
+    size_t i = 0;
+    while (i < tag.size()) {
+        while (i < tag.size() && (std::isspace(static_cast<unsigned char>(tag[i])) || tag[i] == '/')) ++i;
+        size_t nameStart = i;
+        while (i < tag.size() && tag[i] != '=' && !std::isspace(static_cast<unsigned char>(tag[i])) && tag[i] != '/') ++i;
+        std::string attrName = toLower(tag.substr(nameStart, i - nameStart));
+        while (i < tag.size() && std::isspace(static_cast<unsigned char>(tag[i]))) ++i;
+        if (i >= tag.size() || tag[i] != '=') {
+            if (i == nameStart) ++i;
+            continue;
+        }
+        ++i;
+        while (i < tag.size() && std::isspace(static_cast<unsigned char>(tag[i]))) ++i;
+
+        std::string_view value;
+        if (i < tag.size() && (tag[i] == '"' || tag[i] == '\'')) {
+            char quote = tag[i++];
+            size_t end = tag.find(quote, i);
+            if (end == std::string_view::npos) end = tag.size();
+            value = tag.substr(i, end - i);
+            i = end + 1;
+        } else {
+            size_t start = i;
+            while (i < tag.size() && !std::isspace(static_cast<unsigned char>(tag[i]))) ++i;
+            value = tag.substr(start, i - start);
+        }
+        if (attrName == name) {
+            return std::string(value);
+        }
+    }
+    return "";
+}
+
+// Absolute http(s) URL for ref found on page base; empty if it cannot be made one
+std::string resolveUrl(const std::string& base, const std::string& ref) {
+    if (ref.empty() || ref.size() > MAX_URL_LENGTH) {
+        return "";
+    }
+    if (startsWithNoCase(ref, "http://") || startsWithNoCase(ref, "https://")) {
+        return ref;
+    }
+    size_t schemeEnd = base.find("://");
+    if (schemeEnd == std::string::npos) {
+        return "";
+    }
+    if (ref.rfind("//", 0) == 0) {
+        return base.substr(0, schemeEnd + 1) + ref;
+    }
+    size_t pathStart = base.find('/', schemeEnd + 3);
+    std::string origin = pathStart == std::string::npos ? base : base.substr(0, pathStart);
+    if (ref[0] == '/') {
+        return origin + ref;
+    }
+    if (ref.find(':') != std::string::npos) {
+        return "";  // data:, javascript:, ...
+    }
+    std::string path = pathStart == std::string::npos ? "/" : base.substr(pathStart);
+    path = path.substr(0, path.find_first_of("?#"));
+    return origin + path.substr(0, path.rfind('/') + 1) + ref;
+}
+
+} // namespace
+
+struct LinkUnfurler::Fetch {
+    std::string key;
+    CURL* easy = nullptr;
+    std::string body;
+    size_t maxBytes = 0;
+    bool checkedType = false;
+    bool notHtml = false;
+    bool stoppedEarly = false;  // Saw </head> or reached maxBytes: enough to parse
+    char error[CURL_ERROR_SIZE] = {0};
+
+    ~Fetch() {
+        if (easy) curl_easy_cleanup(easy);
+    }
+};
+
+LinkUnfurler::LinkUnfurler(Options options)
+    : options_(std::move(options)), cache_(std::max<size_t>(options_.cacheEntries, 1)) {
+    options_.maxConcurrent = std::max<size_t>(options_.maxConcurrent, 1);
+    options_.maxBytes = std::max<size_t>(options_.maxBytes, 1024);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    multi_ = curl_multi_init();
+}
+
+LinkUnfurler::~LinkUnfurler() {
+    stop();
+    if (multi_) {
+        curl_multi_cleanup(static_cast<CURLM*>(multi_));
+    }
+    curl_global_cleanup();
+}
+
+void LinkUnfurler::start() {
+    if (running_ || !multi_) {
+        return;
+    }
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+    Logger::info("🔗 Link previews enabled (" + std::to_string(options_.maxConcurrent) + " concurrent fetches)");
+}
+
+void LinkUnfurler::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    curl_multi_wakeup(static_cast<CURLM*>(multi_));
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool LinkUnfurler::unfurl(const std::string& url, Callback callback) {
+    std::string key = normalizeUrl(url);
+    if (key.empty() || !running_) {
+        return false;
+    }
+
+    auto cached = cache_.get(key);
+    if (cached && cached->expiresAtMs > nowMs()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requests++;
+            stats_.cacheHits++;
+        }
+        callback(cached->preview);
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requests++;
+        auto it = waiting_.find(key);
+        if (it != waiting_.end()) {
+            it->second.push_back(std::move(callback));
+            stats_.coalesced++;
+            return true;
+        }
+        if (queue_.size() >= options_.maxQueued) {
+            stats_.dropped++;
+            return false;
+        }
+        waiting_[key].push_back(std::move(callback));
+        queue_.push_back(key);
+    }
+    curl_multi_wakeup(static_cast<CURLM*>(multi_));
+    return true;
+}
+
+LinkUnfurler::Stats LinkUnfurler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.queued = queue_.size();
+    s.inFlight = waiting_.size() - queue_.size();
+    return s;
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+void LinkUnfurler::run() {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "link-previews");
+    auto* multi = static_cast<CURLM*>(multi_);
+
+    while (running_) {
+        launchQueued();
+
+        int stillRunning = 0;
+        curl_multi_perform(multi, &stillRunning);
+        collectFinished();
+
+        curl_multi_poll(multi, nullptr, 0, IDLE_POLL_MS, nullptr);
+    }
+
+    for (auto& [easy, fetch] : active_) {
+        curl_multi_remove_handle(multi, static_cast<CURL*>(easy));
+    }
+    active_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiting_.clear();
+    queue_.clear();
+}
+
+void LinkUnfurler::launchQueued() {
+    auto* multi = static_cast<CURLM*>(multi_);
+    std::vector<std::string> failed;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (active_.size() < options_.maxConcurrent && !queue_.empty()) {
+            auto fetch = std::make_unique<Fetch>();
+            fetch->key = std::move(queue_.front());
+            queue_.pop_front();
+            fetch->maxBytes = options_.maxBytes;
+            fetch->easy = curl_easy_init();
+            if (!fetch->easy) {
+                failed.push_back(fetch->key);
+                continue;
+            }
+
+            CURL* easy = fetch->easy;
+            curl_easy_setopt(easy, CURLOPT_URL, fetch->key.c_str());
+            curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+            curl_easy_setopt(easy, CURLOPT_USERAGENT, "ChatBox-LinkPreview/1.0 (+https://ogp.me)");
+            curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");  // Whatever compression curl supports
+            curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION,
+                             +[](char* data, size_t size, size_t nmemb, void* userdata) -> size_t {
+                auto* f = static_cast<Fetch*>(userdata);
+                size_t n = size * nmemb;
+                if (!f->checkedType) {
+                    f->checkedType = true;
+                    char* contentType = nullptr;
+                    curl_easy_getinfo(f->easy, CURLINFO_CONTENT_TYPE, &contentType);
+                    if (contentType && toLower(contentType).find("html") == std::string::npos) {
+                        f->notHtml = true;
+                        return 0;
+                    }
+                }
+                size_t before = f->body.size();
+                f->body.append(data, std::min(n, f->maxBytes - before));
+                std::string tail = toLower(std::string_view(f->body).substr(before >= 6 ? before - 6 : 0));
+                if (f->body.size() >= f->maxBytes || tail.find("</head") != std::string::npos) {
+                    f->stoppedEarly = true;
+                    return 0;  // Aborts the transfer; what we have is parsed
+                }
+                return n;
+            });
+            curl_easy_setopt(easy, CURLOPT_WRITEDATA, fetch.get());
+            curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, fetch->error);
+            curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(options_.connectTimeoutMs));
+            curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(options_.requestTimeoutMs));
+            curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(easy, CURLOPT_MAXREDIRS, options_.maxRedirects);
+            curl_easy_setopt(easy, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(options_.maxBytes) * 8);
+            curl_easy_setopt(easy, CURLOPT_PROXY, "");  // Ignore *_proxy env: fetches must go out directly
+            curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+#if LIBCURL_VERSION_NUM >= 0x075500
+            curl_easy_setopt(easy, CURLOPT_PROTOCOLS_STR, "http,https");
+            curl_easy_setopt(easy, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
+#else
+            curl_easy_setopt(easy, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+            curl_easy_setopt(easy, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+#endif
+            if (!options_.allowPrivateHosts) {
+                address_guard::restrictToPublic(easy);
+            }
+
+            if (curl_multi_add_handle(multi, easy) != CURLM_OK) {
+                failed.push_back(fetch->key);
+                continue;
+            }
+            active_[easy] = std::move(fetch);
+        }
+    }
+
+    for (const auto& key : failed) {
+        complete(key, std::nullopt);
+    }
+}
+
+void LinkUnfurler::collectFinished() {
+    auto* multi = static_cast<CURLM*>(multi_);
+    CURLMsg* msg;
+    int left = 0;
+
+    while ((msg = curl_multi_info_read(multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL* easy = msg->easy_handle;
+        CURLcode result = msg->data.result;
+
+        auto it = active_.find(easy);
+        if (it == active_.end()) {
+            curl_multi_remove_handle(multi, easy);
+            continue;
+        }
+        std::unique_ptr<Fetch> fetch = std::move(it->second);
+        active_.erase(it);
+
+        long status = 0;
+        char* effectiveUrl = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+        std::string finalUrl = effectiveUrl ? effectiveUrl : fetch->key;
+        curl_multi_remove_handle(multi, easy);
+
+        bool bodyOk = result == CURLE_OK || (result == CURLE_WRITE_ERROR && fetch->stoppedEarly);
+        std::optional<LinkPreview> preview;
+        if (bodyOk && !fetch->notHtml && status >= 200 && status < 300) {
+            preview = parseHtml(fetch->body, finalUrl);
+        } else if (!bodyOk && !fetch->notHtml) {
+            Logger::debug("🔗 Preview fetch failed for " + fetch->key + ": " +
+                          (fetch->error[0] ? fetch->error : curl_easy_strerror(result)));
+        }
+        complete(fetch->key, preview);
+    }
+}
+
+void LinkUnfurler::complete(const std::string& key, const std::optional<LinkPreview>& preview) {
+    uint32_t ttl = preview ? options_.cacheTtlSeconds : options_.failureTtlSeconds;
+    cache_.put(key, CacheEntry{preview, nowMs() + static_cast<uint64_t>(ttl) * 1000});
+
+    std::vector<Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = waiting_.find(key);
+        if (it != waiting_.end()) {
+            callbacks = std::move(it->second);
+            waiting_.erase(it);
+        }
+        if (preview) {
+            stats_.fetched++;
+        } else {
+            stats_.failed++;
+        }
+    }
+
+    for (auto& callback : callbacks) {
+        try {
+            callback(preview);
+        } catch (const std::exception& e) {
+            Logger::error("Link preview callback error: " + std::string(e.what()));
+        }
+    }
+}
+
+uint64_t LinkUnfurler::nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+std::vector<std::string> LinkUnfurler::extractUrls(const std::string& text, size_t maxUrls) {
+    std::vector<std::string> urls;
+    size_t pos = 0;
+
+    while (urls.size() < maxUrls) {
+        size_t http = text.find("http://", pos);
+        size_t https = text.find("https://", pos);
+        size_t start = std::min(http, https);
+        if (start == std::string::npos) {
+            break;
+        }
+        // Only at a word boundary ("xhttp://" is not a link)
+        if (start > 0 && std::isalnum(static_cast<unsigned char>(text[start - 1]))) {
+            pos = start + 4;
+            continue;
+        }
+
+        size_t end = start;
+        while (end < text.size()) {
+            unsigned char c = static_cast<unsigned char>(text[end]);
+            if (std::isspace(c) || c < 0x20 || c == '<' || c == '>' || c == '"' || c == '\'' || c == '`') {
+                break;
+            }
+            ++end;
+        }
+
+        std::string url = text.substr(start, end - start);
+        // Trailing punctuation belongs to the sentence, not the link (unless it closes a bracket in it)
+        while (!url.empty()) {
+            char last = url.back();
+            if (std::strchr(".,;:!?*", last) ||
+                (last == ')' && std::count(url.begin(), url.end(), '(') < std::count(url.begin(), url.end(), ')')) ||
+                (last == ']' && url.find('[') == std::string::npos)) {
+                url.pop_back();
+            } else {
+                break;
+            }
+        }
+
+        if (url.size() > std::strlen("https://") && url.size() <= MAX_URL_LENGTH &&
+            std::find(urls.begin(), urls.end(), url) == urls.end()) {
+            urls.push_back(url);
+        }
+        pos = end;
+    }
+    return urls;
+}
+
+std::string LinkUnfurler::normalizeUrl(const std::string& url) {
+    if (url.size() > MAX_URL_LENGTH) {
+        return "";
+    }
+    size_t schemeEnd = url.find("://");
+    if (schemeEnd == std::string::npos) {
+        return "";
+    }
+    std::string scheme = toLower(std::string_view(url).substr(0, schemeEnd));
+    if (scheme != "http" && scheme != "https") {
+        return "";
+    }
+
+    size_t authorityStart = schemeEnd + 3;
+    size_t authorityEnd = url.find_first_of("/?#", authorityStart);
+    if (authorityEnd == std::string::npos) authorityEnd = url.size();
+    std::string authority = toLower(std::string_view(url).substr(authorityStart, authorityEnd - authorityStart));
+    if (authority.empty() || authority.find('@') != std::string::npos) {
+        return "";  // No credentials in fetched URLs
+    }
+    if ((scheme == "http" && authority.size() > 3 && authority.compare(authority.size() - 3, 3, ":80") == 0) ||
+        (scheme == "https" && authority.size() > 4 && authority.compare(authority.size() - 4, 4, ":443") == 0)) {
+        authority.resize(authority.rfind(':'));
+    }
+
+    std::string rest = url.substr(authorityEnd);
+    rest = rest.substr(0, rest.find('#'));
+    size_t queryStart = rest.find('?');
+    std::string path = rest.substr(0, queryStart);
+    if (path.empty()) {
+        path = "/";
+    }
+
+    // Tracking parameters do not change the page
+    std::string query;
+    if (queryStart != std::string::npos) {
+        std::string_view params = std::string_view(rest).substr(queryStart + 1);
+        while (!params.empty()) {
+            size_t amp = params.find('&');
+            std::string_view param = params.substr(0, amp);
+            std::string key = toLower(param.substr(0, param.find('=')));
+            if (!param.empty() && key.rfind("utm_", 0) != 0 && key != "fbclid" && key != "gclid") {
+                query += (query.empty() ? "?" : "&") + std::string(param);
+            }
+            if (amp == std::string_view::npos) break;
+            params.remove_prefix(amp + 1);
+        }
+    }
+
+    return scheme + "://" + authority + path + query;
+}
+
+std::optional<LinkPreview> LinkUnfurler::parseHtml(const std::string& html, const std::string& url) {
+    std::string lower = toLower(html);
+    LinkPreview preview;
+    preview.url = url;
+
+    // Open Graph beats Twitter cards beats plain HTML; lower rank wins
+    int titleRank = 9, descriptionRank = 9, imageRank = 9;
+    auto take = [](std::string& field, int& current, int rank, const std::string& value) {
+        if (!value.empty() && rank < current) {
+            field = value;
+            current = rank;
+        }
+    };
+
+    for (size_t pos = lower.find("<meta"); pos != std::string::npos; pos = lower.find("<meta", pos + 5)) {
+        size_t end = lower.find('>', pos);
+        if (end == std::string::npos) {
+            break;
+        }
+        std::string_view tag = std::string_view(html).substr(pos + 5, end - pos - 5);
+        std::string key = toLower(attribute(tag, "property"));
+        if (key.empty()) {
+            key = toLower(attribute(tag, "name"));
+        }
+        if (key.empty()) {
+            continue;
+        }
+        std::string content = attribute(tag, "content");
+
+        if (key == "og:title") take(preview.title, titleRank, 0, cleanText(content, MAX_TITLE_BYTES));
+        else if (key == "twitter:title") take(preview.title, titleRank, 1, cleanText(content, MAX_TITLE_BYTES));
+        else if (key == "og:description") take(preview.description, descriptionRank, 0, cleanText(content, MAX_DESCRIPTION_BYTES));
+        else if (key == "twitter:description") take(preview.description, descriptionRank, 1, cleanText(content, MAX_DESCRIPTION_BYTES));
+        else if (key == "description") take(preview.description, descriptionRank, 2, cleanText(content, MAX_DESCRIPTION_BYTES));
+        else if (key == "og:image" || key == "og:image:url" || key == "og:image:secure_url") take(preview.image, imageRank, 0, resolveUrl(url, cleanText(content, MAX_URL_LENGTH)));
+        else if (key == "twitter:image") take(preview.image, imageRank, 1, resolveUrl(url, cleanText(content, MAX_URL_LENGTH)));
+        else if (key == "og:site_name" && preview.siteName.empty()) preview.siteName = cleanText(content, MAX_TITLE_BYTES);
+    }
+
+    if (preview.title.empty()) {
+        size_t open = lower.find("<title");
+        size_t start = open == std::string::npos ? open : lower.find('>', open);
+        size_t close = start == std::string::npos ? start : lower.find("</title", start);
+        if (close != std::string::npos) {
+            preview.title = cleanText(std::string_view(html).substr(start + 1, close - start - 1), MAX_TITLE_BYTES);
+        }
+    }
+
+    if (preview.title.empty() && preview.description.empty()) {
+        return std::nullopt;
+    }
+    return preview;
+}
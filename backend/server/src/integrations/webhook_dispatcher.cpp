@@ -0,0 +1,517 @@
+#include "integrations/webhook_dispatcher.h"
+#include "integrations/address_guard.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <curl/curl.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int IDLE_POLL_MS = 1000;
+
+size_t discardResponse(char*, size_t size, size_t nmemb, void*) {
+    return size * nmemb;
+}
+
+std::string hmacSha256Hex(const std::string& key, const std::string& data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()),
+         reinterpret_cast<const unsigned char*>(data.data()), data.size(), digest, &length);
+
+    static const char* hex = "0123456789abcdef";
+    std::string out;
+    out.reserve(length * 2);
+    for (unsigned int i = 0; i < length; ++i) {
+        out.push_back(hex[digest[i] >> 4]);
+        out.push_back(hex[digest[i] & 0x0F]);
+    }
+    return out;
+}
+
+} // namespace
+
+struct WebhookDispatcher::Endpoint {
+    RoomWebhook webhook;
+    std::deque<std::pair<uint64_t, std::shared_ptr<const std::string>>> pending;  // (queued at ms, event)
+
+    // Batch being delivered; fixed across retries, empty when there is none
+    std::string body;
+    size_t bodyEvents = 0;
+    std::string deliveryId;
+    bool inFlight = false;
+    uint32_t attempts = 0;
+    uint64_t nextAttemptMs = 0;
+
+    bool removed = false;  // Unsubscribed while a request was in flight
+};
+
+struct WebhookDispatcher::Request {
+    std::shared_ptr<Endpoint> endpoint;
+    CURL* easy = nullptr;
+    curl_slist* headers = nullptr;
+    char error[CURL_ERROR_SIZE] = {0};
+
+    ~Request() {
+        if (headers) curl_slist_free_all(headers);
+        if (easy) curl_easy_cleanup(easy);
+    }
+};
+
+// Body of a batch made of the first `count` pending events
+static std::string batchBody(const RoomWebhook& webhook, const std::string& deliveryId,
+                             const std::deque<std::pair<uint64_t, std::shared_ptr<const std::string>>>& pending,
+                             size_t count) {
+    std::string body = json({
+        {"webhookId", webhook.webhookId},
+        {"roomId", webhook.roomId},
+        {"deliveryId", deliveryId}
+    }).dump();
+    body.pop_back();
+    body += ",\"events\":[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) body += ",";
+        body += *pending[i].second;
+    }
+    body += "]}";
+    return body;
+}
+
+WebhookDispatcher::WebhookDispatcher(Options options) : options_(std::move(options)) {
+    options_.maxBatchEvents = std::max<size_t>(options_.maxBatchEvents, 1);
+    options_.maxAttempts = std::max<uint32_t>(options_.maxAttempts, 1);
+    options_.maxConcurrentRequests = std::max<size_t>(options_.maxConcurrentRequests, 1);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    multi_ = curl_multi_init();
+}
+
+WebhookDispatcher::~WebhookDispatcher() {
+    stop();
+    if (multi_) {
+        curl_multi_cleanup(static_cast<CURLM*>(multi_));
+    }
+    curl_global_cleanup();
+}
+
+void WebhookDispatcher::start() {
+    if (running_ || !multi_) {
+        return;
+    }
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+    Logger::info("🪝 Webhook dispatcher started (" + std::to_string(stats().endpoints) + " webhooks)");
+}
+
+void WebhookDispatcher::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    curl_multi_wakeup(static_cast<CURLM*>(multi_));
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    Logger::info("🪝 Webhook dispatcher stopped");
+}
+
+// ============================================================================
+// Subscriptions
+// ============================================================================
+
+void WebhookDispatcher::setSubscriptions(const std::vector<RoomWebhook>& webhooks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [id, endpoint] : endpoints_) {
+        endpoint->removed = true;
+    }
+    endpoints_.clear();
+    roomIndex_.clear();
+    for (const auto& webhook : webhooks) {
+        auto endpoint = std::make_shared<Endpoint>();
+        endpoint->webhook = webhook;
+        endpoints_[webhook.webhookId] = endpoint;
+        indexLocked(endpoint);
+    }
+}
+
+void WebhookDispatcher::addSubscription(const RoomWebhook& webhook) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = endpoints_.find(webhook.webhookId);
+    if (it != endpoints_.end()) {
+        unindexLocked(it->second);
+        it->second->removed = true;
+    }
+    auto endpoint = std::make_shared<Endpoint>();
+    endpoint->webhook = webhook;
+    endpoints_[webhook.webhookId] = endpoint;
+    indexLocked(endpoint);
+}
+
+void WebhookDispatcher::removeSubscription(const std::string& webhookId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = endpoints_.find(webhookId);
+    if (it == endpoints_.end()) {
+        return;
+    }
+    // Queued events are discarded with the subscription; an in-flight batch finishes once
+    it->second->removed = true;
+    unindexLocked(it->second);
+    endpoints_.erase(it);
+}
+
+std::vector<RoomWebhook> WebhookDispatcher::subscriptions(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<RoomWebhook> result;
+    auto it = roomIndex_.find(roomId);
+    if (it != roomIndex_.end()) {
+        for (const auto& endpoint : it->second) {
+            result.push_back(endpoint->webhook);
+        }
+    }
+    return result;
+}
+
+bool WebhookDispatcher::hasSubscribers(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return roomIndex_.count(roomId) > 0;
+}
+
+void WebhookDispatcher::indexLocked(const std::shared_ptr<Endpoint>& endpoint) {
+    roomIndex_[endpoint->webhook.roomId].push_back(endpoint);
+}
+
+void WebhookDispatcher::unindexLocked(const std::shared_ptr<Endpoint>& endpoint) {
+    auto it = roomIndex_.find(endpoint->webhook.roomId);
+    if (it == roomIndex_.end()) {
+        return;
+    }
+    auto& list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), endpoint), list.end());
+    if (list.empty()) {
+        roomIndex_.erase(it);
+    }
+}
+
+// ============================================================================
+// Publishing
+// ============================================================================
+
+void WebhookDispatcher::publish(const std::string& roomId, const std::string& eventJson) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = roomIndex_.find(roomId);
+        if (it == roomIndex_.end()) {
+            return;
+        }
+
+        // One copy of the event shared by every endpoint's queue
+        auto event = std::make_shared<const std::string>(eventJson);
+        uint64_t now = nowMs();
+        for (const auto& endpoint : it->second) {
+            if (endpoint->pending.size() >= options_.maxPendingPerEndpoint) {
+                deadLetters_.push_back(deadLetterLine(*endpoint, batchBody(endpoint->webhook, "", endpoint->pending, 1),
+                                                      1, "queue full"));
+                endpoint->pending.pop_front();
+                stats_.eventsDeadLettered++;
+            }
+            endpoint->pending.emplace_back(now, event);
+
+            // First event starts the delay clock; a full batch can go right away
+            size_t queued = endpoint->pending.size();
+            wake = wake || queued == 1 || queued == options_.maxBatchEvents;
+        }
+    }
+    if (wake && running_) {
+        curl_multi_wakeup(static_cast<CURLM*>(multi_));
+    }
+}
+
+WebhookDispatcher::Stats WebhookDispatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.endpoints = endpoints_.size();
+    s.eventsPending = 0;
+    for (const auto& [id, endpoint] : endpoints_) {
+        s.eventsPending += endpoint->pending.size() + endpoint->bodyEvents;
+    }
+    return s;
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+void WebhookDispatcher::run() {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "webhooks");
+    auto* multi = static_cast<CURLM*>(multi_);
+
+    while (running_) {
+        int waitMs = startDueBatches(nowMs());
+
+        int stillRunning = 0;
+        curl_multi_perform(multi, &stillRunning);
+        collectFinished();
+        writeDeadLetters();
+
+        curl_multi_poll(multi, nullptr, 0, waitMs, nullptr);
+    }
+
+    abandonAll("shutdown");
+    writeDeadLetters();
+}
+
+int WebhookDispatcher::startDueBatches(uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t waitMs = IDLE_POLL_MS;
+
+    for (auto& [id, endpoint] : endpoints_) {
+        Endpoint& ep = *endpoint;
+        if (ep.inFlight) {
+            continue;
+        }
+
+        uint64_t dueAt;
+        if (ep.bodyEvents > 0) {
+            dueAt = ep.nextAttemptMs;  // Retry of the current batch
+        } else if (ep.pending.empty()) {
+            continue;
+        } else if (ep.pending.size() >= options_.maxBatchEvents) {
+            dueAt = now;
+        } else {
+            dueAt = ep.pending.front().first + options_.maxBatchDelayMs;
+        }
+
+        if (dueAt > now) {
+            waitMs = std::min(waitMs, dueAt - now);
+            continue;
+        }
+        if (active_.size() >= options_.maxConcurrentRequests) {
+            continue;  // A finishing request wakes the poll
+        }
+
+        if (ep.bodyEvents == 0) {
+            size_t count = std::min(ep.pending.size(), options_.maxBatchEvents);
+            ep.deliveryId = ep.webhook.webhookId + "-" + std::to_string(nextDeliveryId_++);
+            ep.body = batchBody(ep.webhook, ep.deliveryId, ep.pending, count);
+            ep.bodyEvents = count;
+            ep.pending.erase(ep.pending.begin(), ep.pending.begin() + static_cast<std::ptrdiff_t>(count));
+            ep.attempts = 0;
+        }
+        launch(endpoint);
+    }
+    return static_cast<int>(waitMs);
+}
+
+void WebhookDispatcher::launch(const std::shared_ptr<Endpoint>& endpoint) {
+    auto request = std::make_unique<Request>();
+    request->endpoint = endpoint;
+    request->easy = curl_easy_init();
+    if (!request->easy) {
+        failLaunch(*endpoint, "curl_easy_init failed");
+        return;
+    }
+
+    const Endpoint& ep = *endpoint;
+    request->headers = curl_slist_append(request->headers, "Content-Type: application/json");
+    request->headers = curl_slist_append(request->headers, ("X-ChatBox-Delivery: " + ep.deliveryId).c_str());
+    if (!ep.webhook.secret.empty()) {
+        request->headers = curl_slist_append(request->headers,
+            ("X-ChatBox-Signature: sha256=" + hmacSha256Hex(ep.webhook.secret, ep.body)).c_str());
+    }
+
+    CURL* easy = request->easy;
+    curl_easy_setopt(easy, CURLOPT_URL, ep.webhook.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_POST, 1L);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, ep.body.c_str());  // Not modified while in flight
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(ep.body.size()));
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request->headers);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, "ChatBox-Webhooks/1.0");
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, discardResponse);
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, request->error);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(options_.requestTimeoutMs));
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(std::min<uint32_t>(options_.requestTimeoutMs, 5000)));
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+#if LIBCURL_VERSION_NUM >= 0x075500
+    curl_easy_setopt(easy, CURLOPT_PROTOCOLS_STR, "http,https");
+#else
+    curl_easy_setopt(easy, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+#endif
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 0L);  // A 3xx is a failed delivery, not a new target
+    curl_easy_setopt(easy, CURLOPT_PROXY, "");  // Ignore *_proxy env, so the address check sees the real target
+    if (!options_.allowPrivateHosts) {
+        address_guard::restrictToPublic(easy);
+    }
+
+    if (curl_multi_add_handle(static_cast<CURLM*>(multi_), easy) != CURLM_OK) {
+        failLaunch(*endpoint, "curl_multi_add_handle failed");
+        return;
+    }
+    endpoint->inFlight = true;
+    endpoint->attempts++;
+    active_[easy] = std::move(request);
+}
+
+void WebhookDispatcher::failLaunch(Endpoint& endpoint, const std::string& error) {
+    // Counts as an attempt, so a handle that never starts ends in the dead-letter file
+    endpoint.attempts++;
+    finish(endpoint, false, true, error, nowMs());
+}
+
+void WebhookDispatcher::collectFinished() {
+    auto* multi = static_cast<CURLM*>(multi_);
+    CURLMsg* msg;
+    int left = 0;
+
+    while ((msg = curl_multi_info_read(multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL* easy = msg->easy_handle;
+        CURLcode result = msg->data.result;
+
+        auto it = active_.find(easy);
+        if (it == active_.end()) {
+            curl_multi_remove_handle(multi, easy);
+            continue;
+        }
+        std::unique_ptr<Request> request = std::move(it->second);
+        active_.erase(it);
+
+        long status = 0;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle(multi, easy);
+
+        bool delivered = result == CURLE_OK && status >= 200 && status < 300;
+        bool retryable = result != CURLE_OK || status == 408 || status == 429 || status >= 500;
+        std::string error;
+        if (result != CURLE_OK) {
+            error = request->error[0] ? request->error : curl_easy_strerror(result);
+        } else if (!delivered) {
+            error = "HTTP " + std::to_string(status);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        finish(*request->endpoint, delivered, retryable, error, nowMs());
+    }
+}
+
+void WebhookDispatcher::finish(Endpoint& ep, bool delivered, bool retryable, const std::string& error, uint64_t now) {
+    ep.inFlight = false;
+
+    if (delivered) {
+        stats_.eventsDelivered += ep.bodyEvents;
+        stats_.batchesDelivered++;
+    } else if (retryable && ep.attempts < options_.maxAttempts && !ep.removed) {
+        stats_.retries++;
+        ep.nextAttemptMs = now + backoffMs(ep.attempts);
+        Logger::warning("🪝 Webhook " + ep.webhook.webhookId + " failed (" + error + "), attempt " +
+                        std::to_string(ep.attempts) + "/" + std::to_string(options_.maxAttempts));
+        return;
+    } else {
+        Logger::error("❌ Webhook " + ep.webhook.webhookId + " gave up on " + ep.deliveryId + ": " + error);
+        deadLetters_.push_back(deadLetterLine(ep, ep.body, ep.bodyEvents, error));
+        stats_.eventsDeadLettered += ep.bodyEvents;
+    }
+
+    ep.body.clear();
+    ep.body.shrink_to_fit();
+    ep.bodyEvents = 0;
+    ep.attempts = 0;
+}
+
+void WebhookDispatcher::abandonAll(const std::string& reason) {
+    auto* multi = static_cast<CURLM*>(multi_);
+    for (auto& [easy, request] : active_) {
+        curl_multi_remove_handle(multi, static_cast<CURL*>(easy));
+    }
+    active_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [id, endpoint] : endpoints_) {
+        Endpoint& ep = *endpoint;
+        if (ep.bodyEvents > 0) {
+            deadLetters_.push_back(deadLetterLine(ep, ep.body, ep.bodyEvents, reason));
+            stats_.eventsDeadLettered += ep.bodyEvents;
+            ep.body.clear();
+            ep.bodyEvents = 0;
+            ep.inFlight = false;
+        }
+        while (!ep.pending.empty()) {
+            size_t count = std::min(ep.pending.size(), options_.maxBatchEvents);
+            deadLetters_.push_back(deadLetterLine(ep, batchBody(ep.webhook, "", ep.pending, count), count, reason));
+            stats_.eventsDeadLettered += count;
+            ep.pending.erase(ep.pending.begin(), ep.pending.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+    }
+}
+
+void WebhookDispatcher::writeDeadLetters() {
+    std::vector<std::string> lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lines.swap(deadLetters_);
+    }
+    if (lines.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    auto parent = std::filesystem::path(options_.deadLetterPath).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+    std::ofstream out(options_.deadLetterPath, std::ios::app);
+    if (!out) {
+        Logger::error("❌ Cannot open webhook dead-letter file " + options_.deadLetterPath + ", " +
+                      std::to_string(lines.size()) + " batches lost");
+        return;
+    }
+    for (const auto& line : lines) {
+        out << line << '\n';
+    }
+}
+
+std::string WebhookDispatcher::deadLetterLine(const Endpoint& ep, const std::string& payload,
+                                              size_t events, const std::string& error) const {
+    std::string line = json({
+        {"failedAt", static_cast<uint64_t>(std::time(nullptr))},
+        {"webhookId", ep.webhook.webhookId},
+        {"roomId", ep.webhook.roomId},
+        {"url", ep.webhook.url},
+        {"attempts", ep.attempts},
+        {"events", events},
+        {"error", error}
+    }).dump();
+    line.pop_back();
+    line += ",\"request\":" + payload + "}";
+    return line;
+}
+
+uint64_t WebhookDispatcher::backoffMs(uint32_t attempts) const {
+    uint64_t delay = options_.baseBackoffMs;
+    for (uint32_t i = 1; i < attempts && delay < options_.maxBackoffMs; ++i) {
+        delay *= 2;
+    }
+    delay = std::min<uint64_t>(delay, options_.maxBackoffMs);
+
+    // +/-20% jitter so endpoints that failed together don't retry together
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::uniform_int_distribution<uint64_t> jitter(0, delay * 2 / 5);
+    return delay - delay / 5 + jitter(rng);
+}
+
+uint64_t WebhookDispatcher::nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -2,6 +2,8 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <sstream>
 #include <signal.h>
 #include "config/config_loader.h"
 #include "websocket/websocket_server.h"  // Re-enabled!
@@ -9,7 +11,10 @@
 #include "ai/gemini_client.h"
 #include "pubsub/pubsub_broker.h"
 #include "database/mysql_client.h"
+#include "storage/file_io.h"
 #include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include "utils/lock_profiler.h"
 
 using namespace std;
 
@@ -33,6 +38,22 @@ int main(int argc, char* argv[]) {
         Logger::info("Loading configuration...");
         Config config = ConfigLoader::load("../../config/.env");
         
+        // File I/O backend (io_uring only if compiled in and allowed by the kernel)
+        FileIO::setBackend(config.ioBackend == "io_uring" ? IoBackend::IoUring : IoBackend::Posix);
+        
+        // CPU pinning per thread class; this thread runs the event loop, so pin it
+        // before the server allocates its caches (NUMA first-touch)
+        cpu_affinity::configure(config.cpuLoop, config.cpuRoomWorkers, config.cpuBackground);
+        if (cpu_affinity::enabled()) {
+            Logger::info("📌 CPU pinning: " + cpu_affinity::describe());
+        }
+        cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::EventLoop, -1, "chatbox-loop");
+        
+        lock_profiler::setEnabled(config.lockProfiling);
+        if (config.lockProfiling && !lock_profiler::compiledIn()) {
+            Logger::warning("⚠️ LOCK_PROFILING is set but the server was built without CHATBOX_LOCK_PROFILING");
+        }
+        
         // Initialize MySQL client
         Logger::info("Initializing MySQL database...");
         Logger::info("DB Config: " + config.mysqlHost + ":" + to_string(config.mysqlPort));
@@ -50,6 +71,14 @@ int main(int argc, char* argv[]) {
         }
         Logger::info("✓ MySQL database connected");
         
+        if (!config.messageShards.empty()) {
+            auto shards = parseShardList(config.messageShards, config.mysqlPort, config.mysqlDatabase);
+            if (shards.empty() || !mysqlClient->connectShards(shards)) {
+                Logger::error("Failed to connect to message shards (MESSAGE_SHARDS)");
+                return 1;
+            }
+        }
+        
         Logger::info("Initializing Auth Manager...");
         auto authManager = make_shared<AuthManager>(
             mysqlClient,
@@ -65,7 +94,7 @@ int main(int argc, char* argv[]) {
         if (!config.geminiApiKey.empty() && config.geminiApiKey != "your_gemini_api_key_here") {
             Logger::info("Initializing Gemini AI client...");
             Logger::info("API Key (first 10 chars): " + config.geminiApiKey.substr(0, 10) + "...");
-            geminiClient = make_shared<GeminiClient>(config.geminiApiKey);
+            geminiClient = make_shared<GeminiClient>(config.geminiApiKey, config.geminiApiEndpoint);
             Logger::info("✓ Gemini AI client initialized");
         } else {
             Logger::warning("⚠️ Gemini API key not configured - AI chatbot disabled");
@@ -74,6 +103,55 @@ int main(int argc, char* argv[]) {
         // Create WebSocket server
         Logger::info("Starting WebSocket server on port " + to_string(config.serverPort) + "...");
         WebSocketServer server(config.serverPort, pubsubBroker, authManager, geminiClient);
+        server.setRoomWorkerCount(static_cast<size_t>(config.roomWorkers));
+        server.setAdminToken(config.adminToken);
+        
+        UploadAdmission::Limits uploadLimits;
+        uploadLimits.maxActive = static_cast<size_t>(std::max(config.uploadMaxActive, 1));
+        uploadLimits.maxPerUser = static_cast<size_t>(std::max(config.uploadMaxPerUser, 1));
+        uploadLimits.diskBytesPerSecond = static_cast<uint64_t>(std::max(config.uploadDiskMBps, 0)) * 1024 * 1024;
+        server.setUploadLimits(uploadLimits);
+        
+        WebhookDispatcher::Options webhookOptions;
+        webhookOptions.maxBatchEvents = static_cast<size_t>(std::max(config.webhookBatchMax, 1));
+        webhookOptions.maxBatchDelayMs = static_cast<uint32_t>(std::max(config.webhookBatchDelayMs, 0));
+        webhookOptions.maxAttempts = static_cast<uint32_t>(std::max(config.webhookMaxAttempts, 1));
+        webhookOptions.deadLetterPath = config.webhookDeadLetterPath;
+        server.setWebhookOptions(webhookOptions);
+        server.setWarmupRooms(static_cast<size_t>(std::max(config.warmupRooms, 0)));
+        
+        RoomSummarizer::Options summaryOptions;
+        summaryOptions.blockSize = static_cast<size_t>(std::max(config.aiSummaryBlock, 5));
+        server.setAiOptions(static_cast<size_t>(std::max(config.aiWorkers, 1)), summaryOptions);
+        
+        SemanticIndex::Options semanticOptions;
+        semanticOptions.embedding.apiKey = geminiClient ? config.geminiApiKey : "";
+        semanticOptions.embedding.endpoint = config.embeddingApiEndpoint;
+        semanticOptions.embedding.dimensions = static_cast<size_t>(std::clamp(config.embeddingDimensions, 16, 768));
+        semanticOptions.indexDir = config.semanticIndexDir;
+        semanticOptions.backfillDays = static_cast<uint32_t>(std::max(config.semanticBackfillDays, 0));
+        server.setSemanticSearch(config.semanticSearch, semanticOptions);
+        
+        LinkUnfurler::Options previewOptions;
+        previewOptions.requestTimeoutMs = static_cast<uint32_t>(std::max(config.linkPreviewTimeoutMs, 500));
+        previewOptions.connectTimeoutMs = std::min<uint32_t>(previewOptions.connectTimeoutMs, previewOptions.requestTimeoutMs);
+        previewOptions.maxBytes = static_cast<size_t>(std::max(config.linkPreviewMaxBytes, 4096));
+        previewOptions.allowPrivateHosts = config.linkPreviewAllowPrivate;
+        server.setLinkPreviewOptions(config.linkPreviews, previewOptions);
+        
+        LoadGovernor::Thresholds loadThresholds;
+        {
+            std::stringstream lags(config.loadLagMs);
+            std::string lag;
+            for (size_t level = 0; level < loadThresholds.loopLagMs.size() && std::getline(lags, lag, ','); ++level) {
+                try {
+                    loadThresholds.loopLagMs[level] = std::stoull(lag);
+                } catch (const std::exception&) {
+                    Logger::warning("Invalid LOAD_LAG_MS entry: " + lag);
+                }
+            }
+        }
+        server.setLoadShedding(config.loadShedding, loadThresholds);
         
         Logger::info("=== ChatBox Server Started Successfully! ===");
         Logger::info("Server IP: " + config.serverIP);
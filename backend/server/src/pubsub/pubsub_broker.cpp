@@ -7,7 +7,7 @@ PubSubBroker::PubSubBroker() {
 }
 
 PubSubBroker::~PubSubBroker() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     topics_.clear();
     subscriberTopics_.clear();
     Logger::info("PubSub broker destroyed");
@@ -20,7 +20,7 @@ PubSubBroker::~PubSubBroker() {
 bool PubSubBroker::subscribe(const std::string& subscriberId,
                               const std::string& topic,
                               MessageCallback callback) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     try {
         // Create subscriber
@@ -42,7 +42,7 @@ bool PubSubBroker::subscribe(const std::string& subscriberId,
 }
 
 bool PubSubBroker::unsubscribe(const std::string& subscriberId, const std::string& topic) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     try {
         // Remove from topic's subscriber list
@@ -85,7 +85,7 @@ bool PubSubBroker::unsubscribe(const std::string& subscriberId, const std::strin
 }
 
 void PubSubBroker::unsubscribeAll(const std::string& subscriberId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     try {
         // Get all topics for this subscriber
@@ -127,7 +127,7 @@ void PubSubBroker::unsubscribeAll(const std::string& subscriberId) {
 }
 
 std::vector<std::string> PubSubBroker::getSubscribers(const std::string& topic) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     std::vector<std::string> result;
     
@@ -142,7 +142,7 @@ std::vector<std::string> PubSubBroker::getSubscribers(const std::string& topic)
 }
 
 std::vector<std::string> PubSubBroker::getSubscribedTopics(const std::string& subscriberId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     std::vector<std::string> result;
     
@@ -164,7 +164,7 @@ void PubSubBroker::publish(const std::string& topic,
     std::vector<std::shared_ptr<Subscriber>> subscribers;
     
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        ProfiledLock lock(mutex_);
         
         auto it = topics_.find(topic);
         if (it != topics_.end()) {
@@ -210,7 +210,7 @@ void PubSubBroker::publishToUser(const std::string& userId,
 }
 
 void PubSubBroker::broadcast(const std::string& message, const std::string& senderId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     // Collect all unique subscribers
     std::unordered_set<std::string> uniqueSubscribers;
@@ -233,17 +233,17 @@ void PubSubBroker::broadcast(const std::string& message, const std::string& send
 // ============================================================================
 
 size_t PubSubBroker::getTopicCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     return topics_.size();
 }
 
 size_t PubSubBroker::getSubscriberCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     return subscriberTopics_.size();
 }
 
 size_t PubSubBroker::getTotalSubscriptions() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     size_t total = 0;
     for (const auto& [topic, subscribers] : topics_) {
@@ -253,7 +253,7 @@ size_t PubSubBroker::getTotalSubscriptions() const {
 }
 
 void PubSubBroker::printStats() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ProfiledLock lock(mutex_);
     
     Logger::info("=== PubSub Broker Stats ===");
     Logger::info("Topics: " + std::to_string(topics_.size()));
@@ -0,0 +1,598 @@
+#include "search/hnsw_index.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <queue>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'C', 'B', 'H', 'N', 'S', 'W', '1', '\0'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_BYTES = 4096;
+constexpr uint32_t INITIAL_CAPACITY = 1024;
+constexpr uint32_t NO_ENTRY = std::numeric_limits<uint32_t>::max();
+
+} // namespace
+
+struct HnswIndex::FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dimensions;
+    uint32_t M;
+    uint32_t maxLevel;
+    uint32_t entryPoint;
+    uint32_t count;       // Nodes written (tombstones included)
+    uint32_t capacity;    // Node records the file has room for
+    uint32_t live;
+    uint64_t watermark;
+};
+
+struct HnswIndex::NodeHeader {
+    uint64_t roomKey;
+    uint64_t timestamp;
+    char messageId[MAX_ID_BYTES + 1];
+    uint8_t level;
+    uint8_t removed;
+    uint8_t reserved[6];
+};
+
+HnswIndex::HnswIndex(std::string path, Params params) : path_(std::move(path)), params_(params) {
+    params_.M = std::max<uint32_t>(params_.M, 2);
+    params_.efConstruction = std::max(params_.efConstruction, params_.M);
+
+    // Record: header | level 0 [count, 2M ids] | levels 1..MAX_LEVEL [count, M ids] | vector
+    level0Offset_ = sizeof(NodeHeader);
+    upperOffset_ = level0Offset_ + (1 + 2 * params_.M) * sizeof(uint32_t);
+    vectorOffset_ = upperOffset_ + MAX_LEVEL * (1 + params_.M) * sizeof(uint32_t);
+    recordBytes_ = (vectorOffset_ + params_.dimensions * sizeof(float) + 7) & ~size_t{7};
+}
+
+HnswIndex::~HnswIndex() {
+    unmap();
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+// ============================================================================
+// File mapping
+// ============================================================================
+
+bool HnswIndex::open() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+#ifndef _WIN32
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        Logger::error("Cannot open semantic index " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+    struct stat st {};
+    fstat(fd_, &st);
+    size_t fileBytes = static_cast<size_t>(st.st_size);
+#else
+    size_t fileBytes = 0;  // No mmap here: kept in memory, rebuilt on every start
+#endif
+
+    bool compatible = false;
+    if (fileBytes >= HEADER_BYTES && map(fileBytes)) {
+        const FileHeader& h = header();
+        compatible = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+                     h.dimensions == params_.dimensions && h.M == params_.M &&
+                     h.count <= h.capacity && HEADER_BYTES + h.capacity * recordBytes_ <= fileBytes &&
+                     (h.entryPoint == NO_ENTRY ? h.count == 0 : h.entryPoint < h.count) &&
+                     h.maxLevel <= MAX_LEVEL;
+        if (!compatible) {
+            Logger::warning("⚠️ Semantic index " + path_ + " was written with other settings, rebuilding");
+        }
+    }
+    if (!compatible && !reset()) {
+        return false;
+    }
+
+    const FileHeader& h = header();
+    ids_.clear();
+    ids_.reserve(h.live);
+    for (uint32_t i = 0; i < h.count; ++i) {
+        NodeHeader& n = node(i);
+        n.messageId[MAX_ID_BYTES] = '\0';
+        if (!n.removed) {
+            ids_[n.messageId] = i;
+        }
+    }
+    Logger::info("🧭 Semantic index " + path_ + ": " + std::to_string(ids_.size()) + " vectors");
+    return true;
+}
+
+bool HnswIndex::map(size_t bytes) {
+    unmap();
+#ifndef _WIN32
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        Logger::error("Cannot map semantic index " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+    base_ = static_cast<char*>(mapped);
+#else
+    base_ = static_cast<char*>(std::calloc(1, bytes));
+    if (!base_) {
+        return false;
+    }
+#endif
+    mappedBytes_ = bytes;
+    return true;
+}
+
+void HnswIndex::unmap() {
+    if (!base_) {
+        return;
+    }
+#ifndef _WIN32
+    msync(base_, mappedBytes_, MS_SYNC);
+    munmap(base_, mappedBytes_);
+#else
+    std::free(base_);
+#endif
+    base_ = nullptr;
+    mappedBytes_ = 0;
+}
+
+bool HnswIndex::reset() {
+    size_t bytes = HEADER_BYTES + INITIAL_CAPACITY * recordBytes_;
+    unmap();
+#ifndef _WIN32
+    if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+        Logger::error("Cannot size semantic index " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+#endif
+    if (!map(bytes)) {
+        return false;
+    }
+
+    FileHeader& h = header();
+    std::memset(&h, 0, sizeof(FileHeader));
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.dimensions = params_.dimensions;
+    h.M = params_.M;
+    h.entryPoint = NO_ENTRY;
+    h.capacity = INITIAL_CAPACITY;
+    return true;
+}
+
+bool HnswIndex::grow() {
+    uint32_t capacity = header().capacity * 2;
+    size_t bytes = HEADER_BYTES + capacity * recordBytes_;
+
+#ifndef _WIN32
+    // The old mapping stays in place until the larger one exists
+    if (ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+        Logger::error("Cannot grow semantic index " + path_ + ": " + std::strerror(errno));
+        return false;
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        Logger::error("Cannot map grown semantic index " + path_ + ": " + std::strerror(errno));
+        if (ftruncate(fd_, static_cast<off_t>(mappedBytes_)) != 0) {
+            Logger::warning("Cannot shrink semantic index " + path_ + " back: " + std::strerror(errno));
+        }
+        return false;
+    }
+    munmap(base_, mappedBytes_);
+    base_ = static_cast<char*>(mapped);
+    mappedBytes_ = bytes;
+#else
+    char* larger = static_cast<char*>(std::realloc(base_, bytes));
+    if (!larger) {
+        return false;
+    }
+    std::memset(larger + mappedBytes_, 0, bytes - mappedBytes_);
+    base_ = larger;
+    mappedBytes_ = bytes;
+#endif
+    header().capacity = capacity;
+    return true;
+}
+
+void HnswIndex::flush() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+#ifndef _WIN32
+    if (base_) {
+        msync(base_, mappedBytes_, MS_ASYNC);
+    }
+#endif
+}
+
+// ============================================================================
+// Records
+// ============================================================================
+
+HnswIndex::FileHeader& HnswIndex::header() const {
+    return *reinterpret_cast<FileHeader*>(base_);
+}
+
+HnswIndex::NodeHeader& HnswIndex::node(uint32_t id) const {
+    return *reinterpret_cast<NodeHeader*>(base_ + HEADER_BYTES + id * recordBytes_);
+}
+
+uint32_t* HnswIndex::links(uint32_t id, int level) const {
+    char* record = base_ + HEADER_BYTES + id * recordBytes_;
+    if (level == 0) {
+        return reinterpret_cast<uint32_t*>(record + level0Offset_);
+    }
+    return reinterpret_cast<uint32_t*>(record + upperOffset_ + (level - 1) * (1 + params_.M) * sizeof(uint32_t));
+}
+
+const float* HnswIndex::vector(uint32_t id) const {
+    return reinterpret_cast<const float*>(base_ + HEADER_BYTES + id * recordBytes_ + vectorOffset_);
+}
+
+float HnswIndex::distance(const float* a, const float* b) const {
+    float dot = 0;
+    for (uint32_t i = 0; i < params_.dimensions; ++i) {
+        dot += a[i] * b[i];
+    }
+    return 1.0f - dot;
+}
+
+int HnswIndex::randomLevel() {
+    // P(level >= l) = M^-l
+    std::uniform_real_distribution<double> uniform(std::numeric_limits<double>::min(), 1.0);
+    int level = static_cast<int>(-std::log(uniform(rng_)) / std::log(static_cast<double>(params_.M)));
+    return std::min(level, MAX_LEVEL);
+}
+
+// ============================================================================
+// Graph
+// ============================================================================
+
+uint32_t HnswIndex::greedyClosest(const float* query, uint32_t entry, int level) const {
+    uint32_t current = entry;
+    float best = distance(query, vector(current));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        const uint32_t* list = links(current, level);
+        for (uint32_t i = 1; i <= list[0]; ++i) {
+            float d = distance(query, vector(list[i]));
+            if (d < best) {
+                best = d;
+                current = list[i];
+                changed = true;
+            }
+        }
+    }
+    return current;
+}
+
+std::vector<HnswIndex::Scored> HnswIndex::searchLayer(const float* query, uint32_t entry, size_t ef, int level,
+                                                      const std::function<bool(uint32_t)>& accept,
+                                                      size_t maxVisits) const {
+    // Visited marks by generation: no clearing between searches
+    thread_local std::vector<uint32_t> visited;
+    thread_local uint32_t generation = 0;
+    uint32_t count = header().count;
+    if (visited.size() < count) {
+        visited.resize(count, 0);
+    }
+    if (++generation == 0) {
+        std::fill(visited.begin(), visited.end(), 0);
+        generation = 1;
+    }
+
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> candidates;  // Nearest first
+    std::priority_queue<Scored> results;                                                // Farthest first
+
+    float d = distance(query, vector(entry));
+    visited[entry] = generation;
+    candidates.emplace(d, entry);
+    if (!accept || accept(entry)) {
+        results.emplace(d, entry);
+    }
+
+    size_t visits = 1;
+    while (!candidates.empty() && visits < maxVisits) {
+        auto [cd, c] = candidates.top();
+        if (results.size() >= ef && cd > results.top().first) {
+            break;
+        }
+        candidates.pop();
+
+        const uint32_t* list = links(c, level);
+        for (uint32_t i = 1; i <= list[0]; ++i) {
+            uint32_t n = list[i];
+            if (visited[n] == generation) {
+                continue;
+            }
+            visited[n] = generation;
+            visits++;
+
+            float dn = distance(query, vector(n));
+            if (results.size() < ef || dn < results.top().first) {
+                candidates.emplace(dn, n);
+                if (!accept || accept(n)) {
+                    results.emplace(dn, n);
+                    if (results.size() > ef) {
+                        results.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<Scored> sorted;
+    sorted.reserve(results.size());
+    while (!results.empty()) {
+        sorted.push_back(results.top());
+        results.pop();
+    }
+    std::reverse(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+std::vector<uint32_t> HnswIndex::selectNeighbors(const std::vector<Scored>& candidates, size_t m) const {
+    // Heuristic from the HNSW paper: skip a candidate closer to an already chosen
+    // neighbor than to the base, so links spread in different directions
+    std::vector<uint32_t> chosen;
+    std::vector<uint32_t> skipped;
+    for (const auto& [d, c] : candidates) {
+        if (chosen.size() >= m) {
+            break;
+        }
+        bool diverse = std::none_of(chosen.begin(), chosen.end(), [&](uint32_t r) {
+            return distance(vector(c), vector(r)) < d;
+        });
+        (diverse ? chosen : skipped).push_back(c);
+    }
+    for (size_t i = 0; i < skipped.size() && chosen.size() < m; ++i) {
+        chosen.push_back(skipped[i]);
+    }
+    return chosen;
+}
+
+void HnswIndex::connect(uint32_t from, uint32_t to, int level) {
+    uint32_t* list = links(from, level);
+    uint32_t limit = maxLinks(level);
+    if (list[0] < limit) {
+        list[list[0] + 1] = to;
+        list[0]++;
+        return;
+    }
+
+    // Full: keep the best spread of the old links plus the new one
+    const float* base = vector(from);
+    std::vector<Scored> candidates;
+    candidates.reserve(limit + 1);
+    for (uint32_t i = 1; i <= list[0]; ++i) {
+        candidates.emplace_back(distance(base, vector(list[i])), list[i]);
+    }
+    candidates.emplace_back(distance(base, vector(to)), to);
+    std::sort(candidates.begin(), candidates.end());
+
+    auto kept = selectNeighbors(candidates, limit);
+    list[0] = static_cast<uint32_t>(kept.size());
+    std::copy(kept.begin(), kept.end(), list + 1);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool HnswIndex::add(const std::string& messageId, uint64_t roomKey, uint64_t timestamp,
+                    const std::vector<float>& values) {
+    if (messageId.empty() || messageId.size() > MAX_ID_BYTES || values.size() != params_.dimensions) {
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!base_) {
+        return false;
+    }
+
+    auto existing = ids_.find(messageId);
+    if (existing != ids_.end()) {
+        node(existing->second).removed = 1;
+        header().live--;
+        ids_.erase(existing);
+    }
+    if (header().count == header().capacity && !grow()) {
+        return false;
+    }
+
+    FileHeader& h = header();
+    uint32_t id = h.count;
+    int level = randomLevel();
+
+    char* record = base_ + HEADER_BYTES + id * recordBytes_;
+    std::memset(record, 0, recordBytes_);
+    NodeHeader& n = node(id);
+    n.roomKey = roomKey;
+    n.timestamp = timestamp;
+    std::memcpy(n.messageId, messageId.data(), messageId.size());
+    n.level = static_cast<uint8_t>(level);
+    std::memcpy(record + vectorOffset_, values.data(), values.size() * sizeof(float));
+    h.count++;
+
+    if (h.entryPoint == NO_ENTRY) {
+        h.entryPoint = id;
+        h.maxLevel = static_cast<uint32_t>(level);
+    } else {
+        const float* query = vector(id);
+        uint32_t entry = h.entryPoint;
+        for (int l = static_cast<int>(h.maxLevel); l > level; --l) {
+            entry = greedyClosest(query, entry, l);
+        }
+        for (int l = std::min(level, static_cast<int>(h.maxLevel)); l >= 0; --l) {
+            auto nearest = searchLayer(query, entry, params_.efConstruction, l, nullptr,
+                                       std::numeric_limits<size_t>::max());
+            auto neighbors = selectNeighbors(nearest, maxLinks(l));
+            uint32_t* list = links(id, l);
+            list[0] = static_cast<uint32_t>(neighbors.size());
+            std::copy(neighbors.begin(), neighbors.end(), list + 1);
+            for (uint32_t neighbor : neighbors) {
+                connect(neighbor, id, l);
+            }
+            entry = nearest.front().second;
+        }
+        if (static_cast<uint32_t>(level) > h.maxLevel) {
+            h.maxLevel = static_cast<uint32_t>(level);
+            h.entryPoint = id;
+        }
+    }
+
+    h.live++;
+    ids_[messageId] = id;
+    return true;
+}
+
+bool HnswIndex::remove(const std::string& messageId) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(messageId);
+    if (it == ids_.end()) {
+        return false;
+    }
+    node(it->second).removed = 1;
+    header().live--;
+    ids_.erase(it);
+    return true;
+}
+
+size_t HnswIndex::compact() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!base_ || header().count == header().live) {
+        return 0;
+    }
+
+    // Live nodes in insertion order, re-added to a fresh file next to this one. The
+    // rename swaps it in whole, so a crash leaves either the old file or the new one.
+    std::vector<uint32_t> live;
+    live.reserve(ids_.size());
+    for (const auto& [messageId, id] : ids_) {
+        live.push_back(id);
+    }
+    std::sort(live.begin(), live.end());
+
+    HnswIndex fresh(path_ + ".compact", params_);
+    std::remove(fresh.path_.c_str());  // Left over from an interrupted compaction
+    if (!fresh.open()) {
+        return 0;
+    }
+    std::vector<float> values(params_.dimensions);
+    for (uint32_t id : live) {
+        const NodeHeader& n = node(id);
+        std::memcpy(values.data(), vector(id), values.size() * sizeof(float));
+        if (!fresh.add(n.messageId, n.roomKey, n.timestamp, values)) {
+            Logger::error("Cannot compact semantic index " + path_ + ": new file is full");
+            fresh.unmap();
+            std::remove(fresh.path_.c_str());
+            return 0;
+        }
+    }
+    fresh.header().watermark = header().watermark;
+
+    size_t dropped = header().count - header().live;
+#ifndef _WIN32
+    msync(fresh.base_, fresh.mappedBytes_, MS_SYNC);
+    if (std::rename(fresh.path_.c_str(), path_.c_str()) != 0) {
+        Logger::error("Cannot replace semantic index " + path_ + ": " + std::strerror(errno));
+        fresh.unmap();
+        std::remove(fresh.path_.c_str());
+        return 0;
+    }
+    unmap();
+    ::close(fd_);
+    fd_ = fresh.fd_;
+    fresh.fd_ = -1;
+#else
+    unmap();
+#endif
+    base_ = fresh.base_;
+    mappedBytes_ = fresh.mappedBytes_;
+    ids_ = std::move(fresh.ids_);
+    fresh.base_ = nullptr;
+    fresh.mappedBytes_ = 0;
+
+    Logger::info("🧭 Compacted semantic index " + path_ + ": " + std::to_string(dropped) + " removed vectors dropped");
+    return dropped;
+}
+
+bool HnswIndex::contains(const std::string& messageId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return ids_.count(messageId) > 0;
+}
+
+std::vector<HnswIndex::Hit> HnswIndex::search(const std::vector<float>& query, size_t k, size_t ef,
+                                              const Filter& filter, size_t maxVisits) const {
+    std::vector<Hit> hits;
+    if (query.size() != params_.dimensions || k == 0) {
+        return hits;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (!base_ || header().entryPoint == NO_ENTRY || header().live == 0) {
+        return hits;
+    }
+
+    const FileHeader& h = header();
+    uint32_t entry = h.entryPoint;
+    for (int l = static_cast<int>(h.maxLevel); l > 0; --l) {
+        entry = greedyClosest(query.data(), entry, l);
+    }
+
+    auto nearest = searchLayer(query.data(), entry, std::max(ef, k), 0, [&](uint32_t id) {
+        const NodeHeader& n = node(id);
+        return !n.removed && (!filter || filter(n.roomKey));
+    }, maxVisits);
+
+    for (size_t i = 0; i < nearest.size() && hits.size() < k; ++i) {
+        const NodeHeader& n = node(nearest[i].second);
+        hits.push_back({n.messageId, n.roomKey, n.timestamp, 1.0f - nearest[i].first});
+    }
+    return hits;
+}
+
+uint64_t HnswIndex::watermark() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return base_ ? header().watermark : 0;
+}
+
+void HnswIndex::advanceWatermark(uint64_t timestamp) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (base_ && timestamp > header().watermark) {
+        header().watermark = timestamp;
+    }
+}
+
+size_t HnswIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return base_ ? header().live : 0;
+}
+
+size_t HnswIndex::nodes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return base_ ? header().count : 0;
+}
+
+size_t HnswIndex::tombstones() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return base_ ? header().count - header().live : 0;
+}
+
+size_t HnswIndex::fileBytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return mappedBytes_;
+}
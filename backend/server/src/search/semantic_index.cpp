@@ -0,0 +1,421 @@
+#include "search/semantic_index.h"
+#include "database/mysql_client.h"
+#include "database/message_codec.h"
+#include "database/shard_map.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t MAX_RETRY_DELAY_MS = 60000;
+constexpr uint64_t BACKFILL_OVERLAP_SECONDS = 60;   // Messages saved while the last run was stopping
+
+// Cut to at most maxBytes without splitting a UTF-8 sequence
+std::string truncateUtf8(const std::string& text, size_t maxBytes) {
+    if (text.size() <= maxBytes) {
+        return text;
+    }
+    size_t end = maxBytes;
+    while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+        end--;
+    }
+    return text.substr(0, end);
+}
+
+// Query cache key: case and surrounding/repeated whitespace do not change the meaning
+std::string normalizeQuery(const std::string& text) {
+    std::string key;
+    key.reserve(text.size());
+    bool space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            space = !key.empty();
+            continue;
+        }
+        if (space) {
+            key += ' ';
+            space = false;
+        }
+        key += static_cast<char>(c < 0x80 ? std::tolower(c) : c);
+    }
+    return key;
+}
+
+} // namespace
+
+SemanticIndex::SemanticIndex(Options options, size_t shards, ShardFor shardFor, std::unique_ptr<MySQLClient> backfillDb)
+    : options_(std::move(options))
+    , shardFor_(std::move(shardFor))
+    , backfillDb_(std::move(backfillDb))
+    , embedder_(options_.embedding)
+    , queryCache_(std::max<size_t>(options_.queryCacheEntries, 1)) {
+    options_.batchSize = std::max<size_t>(options_.batchSize, 1);
+
+    HnswIndex::Params params;
+    params.dimensions = static_cast<uint32_t>(options_.embedding.dimensions);
+    params.M = options_.M;
+    params.efConstruction = options_.efConstruction;
+    for (size_t i = 0; i < std::max<size_t>(shards, 1); ++i) {
+        std::string path = (std::filesystem::path(options_.indexDir) / ("shard-" + std::to_string(i) + ".hnsw")).string();
+        indexes_.push_back(std::make_unique<HnswIndex>(path, params));
+    }
+}
+
+SemanticIndex::~SemanticIndex() {
+    stop();
+}
+
+bool SemanticIndex::start() {
+    if (running_) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(options_.indexDir, ec);
+    if (ec) {
+        Logger::error("Cannot create semantic index directory " + options_.indexDir + ": " + ec.message());
+        return false;
+    }
+    for (auto& index : indexes_) {
+        if (!index->open()) {
+            return false;
+        }
+    }
+
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+    Logger::info("🧭 Semantic search started (" + std::to_string(indexes_.size()) + " index files in " +
+                 options_.indexDir + ")");
+    return true;
+}
+
+void SemanticIndex::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    for (auto& index : indexes_) {
+        index->flush();
+    }
+}
+
+// ============================================================================
+// Ingestion
+// ============================================================================
+
+std::optional<SemanticIndex::Pending> SemanticIndex::toPending(const Message& message) {
+    if (message.messageType != 0 || message.messageId.size() > HnswIndex::MAX_ID_BYTES) {
+        return std::nullopt;
+    }
+    Message plain = message;
+    message_codec::inflate(plain);
+    if (plain.content.size() < options_.minTextBytes) {
+        return std::nullopt;
+    }
+    return Pending{plain.messageId, plain.roomId, plain.timestamp, truncateUtf8(plain.content, options_.maxTextBytes)};
+}
+
+void SemanticIndex::enqueue(const Message& message) {
+    if (!running_) {
+        return;
+    }
+    auto pending = toPending(message);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!pending) {
+            stats_.skipped++;
+            return;
+        }
+        if (queue_.size() >= options_.maxQueued) {
+            stats_.dropped++;
+            return;
+        }
+        removedDuringBatch_.erase(pending->messageId);
+        queue_.push_back(std::move(*pending));
+    }
+    cv_.notify_one();
+}
+
+void SemanticIndex::remove(const std::string& messageId) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.erase(std::remove_if(queue_.begin(), queue_.end(), [&](const Pending& p) {
+            return p.messageId == messageId;
+        }), queue_.end());
+        if (batchInFlight_) {
+            removedDuringBatch_.insert(messageId);
+        }
+    }
+
+    bool removed = false;
+    for (auto& index : indexes_) {
+        removed = index->remove(messageId) || removed;
+    }
+    if (removed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.removed++;
+    }
+}
+
+size_t SemanticIndex::compact() {
+    size_t dropped = 0;
+    for (auto& index : indexes_) {
+        size_t tombstones = index->tombstones();
+        if (tombstones >= std::max<size_t>(options_.compactMinTombstones, 1) && tombstones >= index->size()) {
+            dropped += index->compact();
+        }
+    }
+    if (dropped > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.compacted += dropped;
+    }
+    return dropped;
+}
+
+void SemanticIndex::run() {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "semantic-index");
+
+    if (backfillDb_) {
+        backfill();
+        backfillDb_.reset();
+    }
+
+    while (running_) {
+        std::vector<Pending> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return !running_ || !queue_.empty(); });
+            // Give a burst the chance to fill one request
+            cv_.wait_for(lock, std::chrono::milliseconds(options_.batchDelayMs), [this]() {
+                return !running_ || queue_.size() >= options_.batchSize;
+            });
+            if (!running_) {
+                return;
+            }
+            size_t n = std::min(queue_.size(), options_.batchSize);
+            batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + n));
+            queue_.erase(queue_.begin(), queue_.begin() + n);
+        }
+        indexBatch(batch);
+    }
+}
+
+void SemanticIndex::backfill() {
+    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+    uint64_t from = now;
+    for (const auto& index : indexes_) {
+        uint64_t watermark = index->watermark();
+        uint64_t start = watermark > 0
+            ? watermark - std::min(watermark, BACKFILL_OVERLAP_SECONDS)
+            : now - std::min<uint64_t>(now, static_cast<uint64_t>(options_.backfillDays) * 86400);
+        from = std::min(from, start);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.backfilling = true;
+    }
+    Logger::info("🧭 Semantic index backfill from " + std::to_string(now - from) + "s ago");
+
+    std::vector<Pending> batch;
+    uint64_t backfilled = 0;
+    bool ok = backfillDb_->forEachMessageSince(from, [&](const Message& message) {
+        if (!running_) {
+            return false;
+        }
+        if (message.messageId.size() > HnswIndex::MAX_ID_BYTES || indexFor(message.roomId).contains(message.messageId)) {
+            return true;
+        }
+        auto pending = toPending(message);
+        if (!pending) {
+            return true;
+        }
+        batch.push_back(std::move(*pending));
+        if (batch.size() < options_.batchSize) {
+            return true;
+        }
+        if (!indexBatch(batch)) {
+            return false;
+        }
+        backfilled += batch.size();
+        batch.clear();
+        return true;
+    });
+    if (ok && running_ && !batch.empty() && indexBatch(batch)) {
+        backfilled += batch.size();
+    }
+    if (!ok) {
+        Logger::warning("⚠️ Semantic index backfill stopped on a database error; older messages stay unindexed");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.backfilling = false;
+    stats_.backfilled += backfilled;
+    Logger::info("🧭 Semantic index backfill done: " + std::to_string(backfilled) + " messages");
+}
+
+bool SemanticIndex::indexBatch(const std::vector<Pending>& batch) {
+    uint32_t delayMs = 1000;
+    while (running_) {
+        if (tryIndex(batch)) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(delayMs), [this]() { return !running_; });
+        delayMs = std::min(delayMs * 2, MAX_RETRY_DELAY_MS);
+    }
+    return false;
+}
+
+bool SemanticIndex::tryIndex(const std::vector<Pending>& batch) {
+    std::vector<std::string> texts;
+    texts.reserve(batch.size());
+    for (const auto& p : batch) {
+        texts.push_back(p.text);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batchInFlight_ = true;
+    }
+    uint64_t started = nowMicros();
+    auto vectors = embedder_.embed(texts, EmbeddingClient::DOCUMENT);
+    uint64_t elapsed = nowMicros() - started;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.embedBatches++;
+    stats_.embedMicros += elapsed;
+    if (!vectors) {
+        stats_.embedFailures++;
+        batchInFlight_ = false;
+        removedDuringBatch_.clear();
+        return false;
+    }
+    auto removed = std::move(removedDuringBatch_);
+    removedDuringBatch_.clear();
+    batchInFlight_ = false;
+    lock.unlock();
+
+    std::vector<HnswIndex*> touched;
+    uint64_t indexed = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const Pending& p = batch[i];
+        if (removed.count(p.messageId)) {
+            continue;
+        }
+        HnswIndex& index = indexFor(p.roomId);
+        if (index.add(p.messageId, ShardRing::hash(p.roomId), p.timestamp, (*vectors)[i])) {
+            index.advanceWatermark(p.timestamp);
+            indexed++;
+            if (std::find(touched.begin(), touched.end(), &index) == touched.end()) {
+                touched.push_back(&index);
+            }
+        }
+    }
+    for (auto* index : touched) {
+        index->flush();
+    }
+
+    lock.lock();
+    stats_.indexed += indexed;
+    return true;
+}
+
+HnswIndex& SemanticIndex::indexFor(const std::string& roomId) {
+    size_t shard = shardFor_ ? shardFor_(roomId) : 0;
+    return *indexes_[shard < indexes_.size() ? shard : 0];
+}
+
+// ============================================================================
+// Search
+// ============================================================================
+
+std::optional<std::vector<SemanticIndex::Hit>> SemanticIndex::search(const std::string& text,
+                                                                     const std::vector<std::string>& roomIds,
+                                                                     size_t limit) {
+    std::string key = normalizeQuery(truncateUtf8(text, options_.maxTextBytes));
+    std::vector<Hit> hits;
+    if (key.empty() || roomIds.empty() || limit == 0) {
+        return hits;
+    }
+
+    auto query = queryCache_.get(key);
+    bool cached = query.has_value();
+    uint64_t embedMicros = 0;
+    if (!cached) {
+        uint64_t started = nowMicros();
+        auto vectors = embedder_.embed({key}, EmbeddingClient::QUERY);
+        embedMicros = nowMicros() - started;
+        if (!vectors) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.queries++;
+            stats_.queryEmbedMicros += embedMicros;
+            return std::nullopt;
+        }
+        query = std::move(vectors->front());
+        queryCache_.put(key, *query);
+    }
+
+    // Room keys per index, so each graph walk only accepts the caller's rooms
+    std::unordered_map<HnswIndex*, std::unordered_set<uint64_t>> roomKeys;
+    for (const auto& roomId : roomIds) {
+        roomKeys[&indexFor(roomId)].insert(ShardRing::hash(roomId));
+    }
+
+    uint64_t started = nowMicros();
+    size_t ef = std::max(options_.efSearch, limit);
+    for (auto& [index, keys] : roomKeys) {
+        const auto& allowed = keys;
+        auto found = index->search(*query, limit, ef, [&allowed](uint64_t roomKey) {
+            return allowed.count(roomKey) > 0;
+        }, options_.maxVisits);
+        for (auto& hit : found) {
+            hits.push_back({std::move(hit.messageId), hit.timestamp, hit.score});
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.score > b.score; });
+    if (hits.size() > limit) {
+        hits.resize(limit);
+    }
+    uint64_t searchMicros = nowMicros() - started;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.queries++;
+    stats_.queryCacheHits += cached ? 1 : 0;
+    stats_.queryEmbedMicros += embedMicros;
+    stats_.searchMicros += searchMicros;
+    return hits;
+}
+
+SemanticIndex::Stats SemanticIndex::stats() const {
+    Stats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s = stats_;
+        s.queued = queue_.size();
+    }
+    for (const auto& index : indexes_) {
+        s.vectors += index->size();
+        s.fileBytes += index->fileBytes();
+    }
+    return s;
+}
+
+uint64_t SemanticIndex::nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,563 @@
+#include "storage/bulk_importer.h"
+#include "storage/import_checkpoint.h"
+#include "database/mysql_client.h"
+#include "utils/logger.h"
+#include <nlohmann/json.hpp>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t MAX_CONTENT_BYTES = 65535;  // messages.content is TEXT
+constexpr size_t MAX_SENDER_NAME = 50;
+constexpr size_t MAX_MESSAGE_ID = 64;
+constexpr size_t MAX_ROOM_ID = 128;
+constexpr auto PROGRESS_INTERVAL = std::chrono::seconds(2);
+
+std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Cut to maxBytes without splitting a UTF-8 sequence
+std::string truncateUtf8(const std::string& s, size_t maxBytes) {
+    if (s.size() <= maxBytes) return s;
+    size_t cut = maxBytes;
+    while (cut > 0 && (static_cast<unsigned char>(s[cut]) & 0xC0) == 0x80) {
+        cut--;
+    }
+    return s.substr(0, cut);
+}
+
+// Stable id for rows that come without one, so re-runs hit the same primary key
+std::string fallbackMessageId(const std::string& roomId, const std::string& senderId,
+                              uint64_t timestamp, const std::string& content) {
+    uint64_t hash = 1469598103934665603ULL;  // FNV-1a 64
+    auto mix = [&hash](const std::string& s) {
+        for (unsigned char c : s) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff;
+        hash *= 1099511628211ULL;
+    };
+    mix(roomId);
+    mix(senderId);
+    mix(std::to_string(timestamp));
+    mix(content);
+
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string("imp-") + buf;
+}
+
+// Unix seconds from epoch seconds/milliseconds or "YYYY-MM-DD[T ]HH:MM:SS[Z]"
+std::optional<uint64_t> parseTimestamp(const json& value) {
+    if (value.is_number_unsigned() || value.is_number_integer()) {
+        int64_t ts = value.get<int64_t>();
+        if (ts <= 0) return std::nullopt;
+        return static_cast<uint64_t>(ts > 100000000000LL ? ts / 1000 : ts);
+    }
+    if (value.is_number_float()) {
+        double ts = value.get<double>();
+        if (ts <= 0) return std::nullopt;
+        return static_cast<uint64_t>(ts > 1e11 ? ts / 1000 : ts);
+    }
+    if (!value.is_string()) {
+        return std::nullopt;
+    }
+
+    const std::string s = value.get<std::string>();
+    if (!s.empty() && std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return parseTimestamp(json(std::stoll(s)));
+    }
+
+    std::tm tm{};
+    std::istringstream in(s);
+    in >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if (in.fail()) {
+        in.clear();
+        in.str(s);
+        in >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        if (in.fail()) return std::nullopt;
+    }
+#ifdef _WIN32
+    time_t t = _mkgmtime(&tm);
+#else
+    time_t t = timegm(&tm);
+#endif
+    if (t <= 0) return std::nullopt;
+    return static_cast<uint64_t>(t);
+}
+
+} // namespace
+
+BulkImporter::BulkImporter(const MySQLClient& dbTemplate, Options options)
+    : dbTemplate_(dbTemplate), options_(std::move(options)) {
+    options_.workers = std::max<size_t>(1, options_.workers);
+    options_.batchSize = std::clamp<size_t>(options_.batchSize, 1, 5000);
+}
+
+bool BulkImporter::loadIdMap(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        Logger::error("Cannot open ID map: " + path);
+        return false;
+    }
+    try {
+        json j = json::parse(in);
+        json users = j.value("users", json::object());
+        json rooms = j.value("rooms", json::object());
+        for (auto& [from, to] : users.items()) {
+            userMap_[from] = to.get<std::string>();
+        }
+        for (auto& [from, to] : rooms.items()) {
+            roomMap_[from] = to.get<std::string>();
+        }
+        Logger::info("✓ ID map: " + std::to_string(userMap_.size()) + " users, " +
+                     std::to_string(roomMap_.size()) + " rooms");
+        return true;
+    } catch (const std::exception& e) {
+        Logger::error("Invalid ID map " + path + ": " + e.what());
+        return false;
+    }
+}
+
+std::vector<std::string> BulkImporter::splitCsv(const std::string& record) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+
+    for (size_t i = 0; i < record.size(); ++i) {
+        char c = record[i];
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < record.size() && record[i + 1] == '"') {
+                    field.push_back('"');
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field.push_back(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else {
+            field.push_back(c);
+        }
+    }
+    fields.push_back(std::move(field));
+    return fields;
+}
+
+std::optional<Message> BulkImporter::parseRecord(const std::string& text, Format format,
+                                                 const std::vector<std::string>& csvHeader,
+                                                 const Directory& directory, std::string& reason) const {
+    json row;
+    if (format == Format::Csv) {
+        auto fields = splitCsv(text);
+        if (fields.size() != csvHeader.size()) {
+            reason = "expected " + std::to_string(csvHeader.size()) + " columns, got " + std::to_string(fields.size());
+            return std::nullopt;
+        }
+        row = json::object();
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (!fields[i].empty()) row[csvHeader[i]] = fields[i];
+        }
+    } else {
+        row = json::parse(text, nullptr, false);
+        if (row.is_discarded() || !row.is_object()) {
+            reason = "invalid JSON";
+            return std::nullopt;
+        }
+    }
+
+    auto str = [&row](const char* key) {
+        auto it = row.find(key);
+        return it != row.end() && it->is_string() ? it->get<std::string>() : std::string();
+    };
+
+    Message msg;
+
+    // Room: mapped ID must exist (rooms or DM conversations)
+    std::string roomId = str("roomId");
+    if (auto it = roomMap_.find(roomId); it != roomMap_.end()) roomId = it->second;
+    if (roomId.empty() || roomId.size() > MAX_ROOM_ID || !directory.roomIds.count(roomId)) {
+        reason = "unknown room '" + roomId + "'";
+        return std::nullopt;
+    }
+    msg.roomId = roomId;
+
+    // Sender: map by ID, then by username
+    std::string senderId = str("senderId");
+    std::string senderName = str("senderName");
+    if (auto it = userMap_.find(senderId); !senderId.empty() && it != userMap_.end()) {
+        senderId = it->second;
+    } else if (auto it = userMap_.find(senderName); senderId.empty() && !senderName.empty() && it != userMap_.end()) {
+        senderId = it->second;
+    }
+    if (!directory.userNames.count(senderId)) {
+        auto byName = directory.usernameIds.find(toLower(senderName));
+        if (byName == directory.usernameIds.end()) {
+            reason = "unknown sender '" + (senderId.empty() ? senderName : senderId) + "'";
+            return std::nullopt;
+        }
+        senderId = byName->second;
+    }
+    msg.senderId = senderId;
+    msg.senderName = truncateUtf8(senderName.empty() ? directory.userNames.at(senderId) : senderName, MAX_SENDER_NAME);
+
+    // Timestamp
+    auto tsIt = row.find("timestamp");
+    auto ts = tsIt == row.end() ? std::nullopt : parseTimestamp(*tsIt);
+    if (!ts) {
+        reason = "missing or invalid timestamp";
+        return std::nullopt;
+    }
+    msg.timestamp = *ts;
+
+    // Body
+    msg.content = str("content");
+    auto metaIt = row.find("metadata");
+    if (metaIt != row.end() && !metaIt->is_null()) {
+        if (metaIt->is_string()) {
+            // metadata is a JSON column: keep valid JSON as-is, store anything else as a JSON string
+            json parsed = json::parse(metaIt->get<std::string>(), nullptr, false);
+            msg.metadata = parsed.is_discarded() ? metaIt->dump() : metaIt->get<std::string>();
+        } else {
+            msg.metadata = metaIt->dump();
+        }
+    }
+    if (msg.content.empty() && msg.metadata.empty()) {
+        reason = "empty message";
+        return std::nullopt;
+    }
+    if (msg.content.size() > MAX_CONTENT_BYTES) {
+        reason = "content larger than 64KB";
+        return std::nullopt;
+    }
+
+    auto typeIt = row.find("messageType");
+    msg.messageType = 0;
+    if (typeIt != row.end()) {
+        if (typeIt->is_number_integer()) {
+            msg.messageType = typeIt->get<uint32_t>();
+        } else if (typeIt->is_string()) {
+            try { msg.messageType = static_cast<uint32_t>(std::stoul(typeIt->get<std::string>())); } catch (...) {}
+        }
+    }
+
+    msg.replyToId = str("replyToId");
+    msg.messageId = str("messageId");
+    if (msg.messageId.empty()) {
+        msg.messageId = fallbackMessageId(msg.roomId, msg.senderId, msg.timestamp, msg.content);
+    }
+    if (msg.messageId.size() > MAX_MESSAGE_ID || msg.replyToId.size() > MAX_MESSAGE_ID) {
+        reason = "messageId longer than 64 characters";
+        return std::nullopt;
+    }
+    return msg;
+}
+
+std::optional<BulkImporter::Stats> BulkImporter::run(const std::string& inputPath, ProgressCallback onProgress) {
+    const auto started = std::chrono::steady_clock::now();
+    const std::string checkpointPath = options_.checkpointPath.empty() ? inputPath + ".checkpoint" : options_.checkpointPath;
+    const std::string rejectPath = options_.rejectPath.empty() ? inputPath + ".rejects" : options_.rejectPath;
+
+    Format format = options_.format;
+    if (format == Format::Auto) {
+        format = endsWith(toLower(inputPath), ".csv") || endsWith(toLower(inputPath), ".csv.gz")
+                     ? Format::Csv : Format::JsonLines;
+    }
+    const bool csv = format == Format::Csv;
+
+    ImportReader reader(inputPath);
+    if (!reader.isOpen()) {
+        Logger::error("Cannot open import file: " + inputPath);
+        return std::nullopt;
+    }
+
+    // ---- Directory: users and rooms, loaded once and shared read-only ----
+    auto control = dbTemplate_.createWorkerConnection();
+    if (!control) {
+        Logger::error("Import: database unavailable");
+        return std::nullopt;
+    }
+
+    Directory directory;
+    for (const auto& user : control->getAllUsers()) {
+        directory.userNames[user.userId] = user.username;
+        directory.usernameIds[toLower(user.username)] = user.userId;
+    }
+    for (auto& roomId : control->getAllRoomIds()) {
+        directory.roomIds.insert(std::move(roomId));
+    }
+    Logger::info("📥 Import directory: " + std::to_string(directory.userNames.size()) + " users, " +
+                 std::to_string(directory.roomIds.size()) + " rooms");
+
+    // ---- CSV header + resume position ----
+    std::vector<std::string> csvHeader;
+    std::string record;
+    if (csv) {
+        if (!reader.next(record, true)) {
+            Logger::error("Import: empty CSV file");
+            return std::nullopt;
+        }
+        csvHeader = splitCsv(record);
+    }
+
+    Stats totals;
+    uint64_t startOffset = reader.offset();
+    if (options_.resume) {
+        if (auto cp = ImportCheckpoint::load(checkpointPath); cp && cp->offset > startOffset) {
+            totals.rowsRead = cp->totals.rowsRead;
+            totals.rowsImported = cp->totals.rowsImported;
+            totals.rowsDuplicate = cp->totals.rowsDuplicate;
+            totals.rowsRejected = cp->totals.rowsRejected;
+            startOffset = cp->offset;
+            if (!reader.seek(startOffset)) {
+                Logger::error("Import: cannot seek to checkpoint offset " + std::to_string(startOffset));
+                return std::nullopt;
+            }
+            Logger::info("↪️ Resuming import at offset " + std::to_string(startOffset) +
+                         " (" + std::to_string(totals.rowsImported) + " rows already imported)");
+        }
+    }
+    totals.resumedFromOffset = startOffset;
+    const uint64_t rowsAtStart = totals.rowsRead;
+
+    // ---- Workers: each with its own connection ----
+    std::vector<std::unique_ptr<MySQLClient>> connections;
+    for (size_t i = 0; i < options_.workers; ++i) {
+        auto db = dbTemplate_.createWorkerConnection();
+        if (!db) {
+            Logger::error("Import: worker " + std::to_string(i) + " could not connect");
+            return std::nullopt;
+        }
+        connections.push_back(std::move(db));
+    }
+
+    if (options_.deferIndexes && !control->setMessageSecondaryIndexes(false)) {
+        Logger::warning("⚠️ Could not drop secondary indexes - loading with indexes in place");
+    }
+
+    std::mutex queueMutex;
+    std::condition_variable queueNotEmpty;
+    std::condition_variable queueNotFull;
+    std::deque<Batch> queue;
+    bool readerDone = false;
+    const size_t maxQueued = options_.workers * 2;
+
+    // Counters as of the committed offset; the live ones run ahead of it
+    ImportCheckpoint checkpoint(startOffset, {totals.rowsRead, totals.rowsImported,
+                                              totals.rowsDuplicate, totals.rowsRejected});
+    std::mutex roomsMutex;
+    std::unordered_set<std::string> touchedRooms;
+
+    std::atomic<uint64_t> imported{totals.rowsImported};
+    std::atomic<uint64_t> duplicates{totals.rowsDuplicate};
+    std::atomic<uint64_t> rejected{totals.rowsRejected};
+    std::atomic<bool> failed{false};
+
+    std::mutex rejectMutex;
+    std::ofstream rejects;
+
+    auto reject = [&](uint64_t offset, const std::string& reason, const std::string& text) {
+        rejected++;
+        std::lock_guard<std::mutex> lock(rejectMutex);
+        if (!rejects.is_open()) {
+            rejects.open(rejectPath, std::ios::app);
+        }
+        json entry = {{"offset", offset}, {"reason", reason}, {"record", text}};
+        rejects << entry.dump(-1, ' ', false, json::error_handler_t::replace) << "\n";
+    };
+
+    auto workerLoop = [&](MySQLClient& db) {
+        std::vector<Message> rows;
+        std::vector<uint64_t> offsets;
+        std::unordered_set<std::string> rooms;
+
+        while (true) {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueNotEmpty.wait(lock, [&]() { return !queue.empty() || readerDone; });
+                if (queue.empty()) return;
+                batch = std::move(queue.front());
+                queue.pop_front();
+            }
+            queueNotFull.notify_one();
+
+            if (failed || cancelled_) continue;  // Drain without loading
+
+            // Validate + map
+            rows.clear();
+            offsets.clear();
+            uint64_t batchRejected = 0;
+            for (const auto& [offset, text] : batch.records) {
+                std::string reason;
+                auto msg = parseRecord(text, format, csvHeader, directory, reason);
+                if (msg) {
+                    rooms.insert(msg->roomId);
+                    rows.push_back(std::move(*msg));
+                    offsets.push_back(offset);
+                } else {
+                    reject(offset, reason, text);
+                    batchRejected++;
+                }
+            }
+
+            // Load: one multi-row INSERT; on failure isolate bad rows one by one
+            int64_t inserted = db.insertMessagesBulk(rows);
+            size_t failures = 0;
+            if (inserted < 0) {
+                inserted = 0;
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    int64_t n = db.insertMessagesBulk({rows[i]});
+                    if (n < 0) {
+                        failures++;
+                        batchRejected++;
+                        reject(offsets[i], "insert failed", rows[i].messageId);
+                    } else {
+                        inserted += n;
+                    }
+                }
+                if (!rows.empty() && failures == rows.size()) {
+                    Logger::error("Import: every row of a batch failed to insert - stopping");
+                    failed = true;
+                    continue;
+                }
+            }
+            uint64_t batchDuplicates = rows.size() - failures - static_cast<uint64_t>(inserted);
+            imported += static_cast<uint64_t>(inserted);
+            duplicates += batchDuplicates;
+
+            // Advance the checkpoint only across contiguous finished batches
+            checkpoint.finished(batch.seq, batch.endOffset, {batch.records.size(), static_cast<uint64_t>(inserted),
+                                                             batchDuplicates, batchRejected});
+            std::lock_guard<std::mutex> lock(roomsMutex);
+            touchedRooms.insert(rooms.begin(), rooms.end());
+            rooms.clear();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (auto& db : connections) {
+        workers.emplace_back(workerLoop, std::ref(*db));
+    }
+
+    // ---- Reader (this thread) ----
+    auto snapshot = [&](uint64_t rowsRead) {
+        Stats s;
+        s.rowsRead = rowsRead;
+        s.rowsImported = imported;
+        s.rowsDuplicate = duplicates;
+        s.rowsRejected = rejected;
+        s.resumedFromOffset = startOffset;
+        s.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        s.rowsPerSecond = s.elapsedSeconds > 0 ? (rowsRead - rowsAtStart) / s.elapsedSeconds : 0;
+        return s;
+    };
+    // Offset and counters of the same committed prefix, so a resume neither skips nor double-counts
+    auto saveCheckpoint = [&](bool complete) {
+        auto saved = checkpoint.committed();
+        saved.complete = complete;
+        ImportCheckpoint::save(checkpointPath, saved);
+    };
+
+    uint64_t rowsRead = totals.rowsRead;
+    uint64_t seq = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    Batch batch;
+
+    auto pushBatch = [&]() {
+        batch.seq = seq++;
+        batch.endOffset = reader.offset();
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueNotFull.wait(lock, [&]() { return queue.size() < maxQueued || failed; });
+        queue.push_back(std::move(batch));
+        lock.unlock();
+        queueNotEmpty.notify_one();
+        batch = Batch();
+    };
+
+    uint64_t recordOffset = reader.offset();
+    while (!failed && !cancelled_ && reader.next(record, csv)) {
+        if (!record.empty()) {
+            batch.records.emplace_back(recordOffset, std::move(record));
+            rowsRead++;
+        }
+        recordOffset = reader.offset();
+
+        if (batch.records.size() >= options_.batchSize) {
+            pushBatch();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastProgress >= PROGRESS_INTERVAL) {
+                lastProgress = now;
+                saveCheckpoint(false);
+                if (onProgress) onProgress(snapshot(rowsRead));
+            }
+        }
+    }
+    if (!batch.records.empty() && !failed && !cancelled_) {
+        pushBatch();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        readerDone = true;
+    }
+    queueNotEmpty.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    bool ok = !failed && !cancelled_;
+    saveCheckpoint(ok);
+
+    // ---- Finish: indexes, then derived reply counts ----
+    if (options_.deferIndexes && !control->setMessageSecondaryIndexes(true)) {
+        Logger::error("✗ Rebuilding messages indexes failed - run setMessageSecondaryIndexes(true) manually");
+    }
+    if (ok) {
+        for (const auto& roomId : touchedRooms) {
+            control->recomputeReplyCounts(roomId);
+        }
+    }
+
+    Stats result = snapshot(rowsRead);
+    if (onProgress) onProgress(result);
+
+    if (!ok) {
+        Logger::error("✗ Import " + std::string(cancelled_ ? "cancelled" : "failed") +
+                      "; re-run to resume from the checkpoint");
+        return std::nullopt;
+    }
+
+    Logger::info("✅ Import complete: " + std::to_string(result.rowsImported) + " imported, " +
+                 std::to_string(result.rowsDuplicate) + " duplicates, " +
+                 std::to_string(result.rowsRejected) + " rejected (" +
+                 std::to_string(static_cast<uint64_t>(result.rowsPerSecond)) + " rows/s)");
+    return result;
+}
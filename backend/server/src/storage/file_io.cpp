@@ -0,0 +1,313 @@
+#include "storage/file_io.h"
+#include "utils/logger.h"
+#include <fstream>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#ifdef CHATBOX_HAVE_IO_URING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstring>
+#endif
+
+namespace FileIO {
+
+namespace {
+
+std::atomic<IoBackend> currentBackend{IoBackend::Posix};
+
+// ============================================================================
+// POSIX (stream) backend - previous behaviour
+// ============================================================================
+
+class StreamWriter : public Writer {
+public:
+    explicit StreamWriter(const std::string& path) {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+    }
+
+    bool write(std::string_view chunk) override {
+        file_.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        return file_.good();
+    }
+
+    bool close() override {
+        if (!file_.is_open()) return false;
+        file_.close();
+        return !file_.fail();
+    }
+
+    bool isOpen() const override { return file_.is_open(); }
+
+private:
+    std::ofstream file_;
+};
+
+std::optional<std::string> streamReadFile(const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        return std::nullopt;
+    }
+    return std::string((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+}
+
+#ifdef CHATBOX_HAVE_IO_URING
+
+// ============================================================================
+// io_uring backend
+// ============================================================================
+
+constexpr unsigned RING_DEPTH = 64;
+constexpr size_t READ_CHUNK = 1024 * 1024;
+
+bool probeIoUring() {
+    io_uring ring;
+    if (io_uring_queue_init(4, &ring, 0) < 0) {
+        return false;
+    }
+    io_uring_queue_exit(&ring);
+    return true;
+}
+
+class UringWriter : public Writer {
+public:
+    explicit UringWriter(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return;
+        if (io_uring_queue_init(RING_DEPTH, &ring_, 0) < 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        ringReady_ = true;
+    }
+
+    ~UringWriter() override {
+        if (isOpen()) close();
+    }
+
+    bool write(std::string_view chunk) override {
+        if (!isOpen() || failed_) return false;
+
+        // Chunk memory belongs to uWS and is only valid during the callback,
+        // so queue an owned copy; it is freed when its completion is reaped
+        auto* buffer = new std::string(chunk);
+
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        while (!sqe) {
+            reap(1);
+            sqe = io_uring_get_sqe(&ring_);
+        }
+
+        io_uring_prep_write(sqe, fd_, buffer->data(), static_cast<unsigned>(buffer->size()), offset_);
+        io_uring_sqe_set_data(sqe, buffer);
+        offset_ += buffer->size();
+        inflight_++;
+        io_uring_submit(&ring_);
+
+        // Bound memory held by queued chunks
+        if (inflight_ >= RING_DEPTH) {
+            reap(inflight_ - RING_DEPTH / 2);
+        }
+        // Pick up finished writes without blocking
+        reapReady();
+        return !failed_;
+    }
+
+    bool close() override {
+        if (!isOpen()) return false;
+        reap(inflight_);
+        io_uring_queue_exit(&ring_);
+        ringReady_ = false;
+        bool ok = ::close(fd_) == 0 && !failed_;
+        fd_ = -1;
+        return ok;
+    }
+
+    bool isOpen() const override { return fd_ >= 0 && ringReady_; }
+
+private:
+    io_uring ring_{};
+    int fd_ = -1;
+    bool ringReady_ = false;
+    bool failed_ = false;
+    off_t offset_ = 0;
+    unsigned inflight_ = 0;
+
+    void complete(io_uring_cqe* cqe) {
+        auto* buffer = static_cast<std::string*>(io_uring_cqe_get_data(cqe));
+        if (cqe->res < 0 || static_cast<size_t>(cqe->res) != buffer->size()) {
+            failed_ = true;
+            Logger::error("io_uring write failed: " + std::string(cqe->res < 0 ? strerror(-cqe->res) : "short write"));
+        }
+        delete buffer;
+        io_uring_cqe_seen(&ring_, cqe);
+        inflight_--;
+    }
+
+    void reap(unsigned count) {
+        for (unsigned i = 0; i < count && inflight_ > 0; ++i) {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&ring_, &cqe) < 0 || !cqe) {
+                failed_ = true;
+                return;
+            }
+            complete(cqe);
+        }
+    }
+
+    void reapReady() {
+        io_uring_cqe* cqe = nullptr;
+        while (inflight_ > 0 && io_uring_peek_cqe(&ring_, &cqe) == 0 && cqe) {
+            complete(cqe);
+        }
+    }
+};
+
+std::optional<std::string> uringReadFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    io_uring ring;
+    if (io_uring_queue_init(RING_DEPTH, &ring, 0) < 0) {
+        ::close(fd);
+        return streamReadFile(path);
+    }
+
+    std::string data(static_cast<size_t>(st.st_size), '\0');
+    size_t submitted = 0;
+    unsigned inflight = 0;
+    bool ok = true;
+
+    // Keep up to RING_DEPTH chunk reads in flight
+    while ((submitted < data.size() || inflight > 0) && ok) {
+        while (submitted < data.size() && inflight < RING_DEPTH) {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            if (!sqe) break;
+            size_t len = std::min(READ_CHUNK, data.size() - submitted);
+            io_uring_prep_read(sqe, fd, &data[submitted], static_cast<unsigned>(len), submitted);
+            io_uring_sqe_set_data64(sqe, len);
+            submitted += len;
+            inflight++;
+        }
+        io_uring_submit(&ring);
+
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0 || !cqe) {
+            ok = false;
+            break;
+        }
+        if (cqe->res < 0 || static_cast<uint64_t>(cqe->res) != io_uring_cqe_get_data64(cqe)) {
+            ok = false;
+        }
+        io_uring_cqe_seen(&ring, cqe);
+        inflight--;
+    }
+
+    // Drain anything still in flight before the buffer goes away
+    while (inflight > 0) {
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0 || !cqe) break;
+        io_uring_cqe_seen(&ring, cqe);
+        inflight--;
+    }
+
+    io_uring_queue_exit(&ring);
+    ::close(fd);
+
+    if (!ok) {
+        Logger::warning("io_uring read failed, retrying with streams: " + path);
+        return streamReadFile(path);
+    }
+    return data;
+}
+
+#endif // CHATBOX_HAVE_IO_URING
+
+} // namespace
+
+IoBackend setBackend(IoBackend requested) {
+    IoBackend effective = IoBackend::Posix;
+
+    if (requested == IoBackend::IoUring) {
+#ifdef CHATBOX_HAVE_IO_URING
+        if (probeIoUring()) {
+            effective = IoBackend::IoUring;
+        } else {
+            Logger::warning("⚠️ io_uring not permitted by kernel - using POSIX file I/O");
+        }
+#else
+        Logger::warning("⚠️ IO_BACKEND=io_uring but server was built without CHATBOX_IO_URING - using POSIX file I/O");
+#endif
+    }
+
+    currentBackend = effective;
+    Logger::info("✓ File I/O backend: " + std::string(backendName(effective)) +
+                 ", socket backend: " + std::string(socketBackendName()));
+    return effective;
+}
+
+IoBackend backend() {
+    return currentBackend;
+}
+
+const char* backendName(IoBackend backend) {
+    return backend == IoBackend::IoUring ? "io_uring" : "posix";
+}
+
+bool ioUringCompiled() {
+#ifdef CHATBOX_HAVE_IO_URING
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* socketBackendName() {
+#if defined(CHATBOX_SOCKETS_IO_URING)
+    return "io_uring";
+#elif defined(CHATBOX_SOCKETS_LIBUV)
+    return "libuv";
+#elif defined(__linux__)
+    return "epoll";
+#elif defined(_WIN32)
+    return "libuv";
+#else
+    return "kqueue";
+#endif
+}
+
+std::unique_ptr<Writer> openWriter(const std::string& path) {
+#ifdef CHATBOX_HAVE_IO_URING
+    if (currentBackend == IoBackend::IoUring) {
+        auto writer = std::make_unique<UringWriter>(path);
+        if (writer->isOpen()) {
+            return writer;
+        }
+    }
+#endif
+    return std::make_unique<StreamWriter>(path);
+}
+
+std::optional<std::string> readFile(const std::string& path) {
+#ifdef CHATBOX_HAVE_IO_URING
+    if (currentBackend == IoBackend::IoUring) {
+        return uringReadFile(path);
+    }
+#endif
+    return streamReadFile(path);
+}
+
+} // namespace FileIO
@@ -0,0 +1,359 @@
+#include "storage/room_exporter.h"
+#include "storage/file_io.h"
+#include "database/mysql_client.h"
+#include "database/message_codec.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <random>
+#include <ctime>
+#include <cstdio>
+#include <vector>
+
+using json = nlohmann::json;
+
+// ============================================================================
+// GzipStream
+// ============================================================================
+
+GzipStream::GzipStream(Sink sink, int level) : sink_(std::move(sink)) {
+    // windowBits 15 + 16 = gzip wrapper instead of raw zlib
+    ready_ = deflateInit2(&zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!ready_) {
+        Logger::error("GzipStream: deflateInit2 failed");
+    }
+}
+
+GzipStream::~GzipStream() {
+    if (ready_) {
+        deflateEnd(&zs_);
+    }
+}
+
+bool GzipStream::write(std::string_view data) {
+    if (!ready_ || finished_) return false;
+    bytesIn_ += data.size();
+    return deflateInto(reinterpret_cast<const unsigned char*>(data.data()), data.size(), Z_NO_FLUSH);
+}
+
+bool GzipStream::finish() {
+    if (!ready_ || finished_) return false;
+    finished_ = true;
+    return deflateInto(nullptr, 0, Z_FINISH);
+}
+
+bool GzipStream::deflateInto(const unsigned char* data, size_t size, int flush) {
+    unsigned char out[OUT_CHUNK];
+
+    zs_.next_in = const_cast<unsigned char*>(data);
+    zs_.avail_in = static_cast<uInt>(size);
+
+    do {
+        zs_.next_out = out;
+        zs_.avail_out = OUT_CHUNK;
+
+        int ret = deflate(&zs_, flush);
+        if (ret == Z_STREAM_ERROR) {
+            return false;
+        }
+
+        size_t produced = OUT_CHUNK - zs_.avail_out;
+        if (produced > 0) {
+            bytesOut_ += produced;
+            if (!sink_(std::string_view(reinterpret_cast<const char*>(out), produced))) {
+                return false;
+            }
+        }
+    } while (zs_.avail_out == 0);
+
+    return true;
+}
+
+// ============================================================================
+// RoomExporter
+// ============================================================================
+
+namespace {
+
+std::string newJobId() {
+    static std::mt19937_64 rng{std::random_device{}()};
+    static std::mutex rngMutex;
+    uint64_t value;
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        value = rng();
+    }
+    char suffix[17];
+    std::snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(value));
+    return "exp-" + std::to_string(std::time(nullptr)) + "-" + suffix;
+}
+
+} // namespace
+
+RoomExporter::RoomExporter(const MySQLClient& dbTemplate, std::string exportDir)
+    : dbTemplate_(dbTemplate), exportDir_(std::move(exportDir)) {
+    std::error_code ec;
+    std::filesystem::create_directories(exportDir_, ec);
+    if (ec) {
+        Logger::warning("⚠️ Could not create export directory " + exportDir_ + ": " + ec.message());
+    }
+}
+
+RoomExporter::~RoomExporter() {
+    stop();
+}
+
+void RoomExporter::stop() {
+    stopping_ = true;
+
+    // Jobs take mutex_ to publish progress, so join outside it
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [jobId, job] : jobs_) {
+            if (job->thread.joinable()) {
+                threads.push_back(std::move(job->thread));
+            }
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+const char* RoomExporter::stateName(JobState state) {
+    switch (state) {
+        case JobState::Running: return "running";
+        case JobState::Completed: return "completed";
+        case JobState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+std::optional<std::string> RoomExporter::startFileExport(const std::string& roomId,
+                                                         const std::string& requestedBy,
+                                                         ProgressCallback onProgress) {
+    return launch(roomId, requestedBy, exportDir_, nullptr, std::move(onProgress));
+}
+
+std::optional<std::string> RoomExporter::startStreamExport(const std::string& roomId,
+                                                           const std::string& requestedBy,
+                                                           ChunkSink sink,
+                                                           ProgressCallback onProgress) {
+    return launch(roomId, requestedBy, "", std::move(sink), std::move(onProgress));
+}
+
+std::optional<RoomExporter::JobStatus> RoomExporter::getJob(const std::string& jobId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(jobId);
+    if (it == jobs_.end()) {
+        return std::nullopt;
+    }
+    return it->second->status;
+}
+
+std::optional<std::string> RoomExporter::launch(const std::string& roomId, const std::string& requestedBy,
+                                                const std::string& dir, ChunkSink sink,
+                                                ProgressCallback onProgress) {
+    if (stopping_) {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    reapFinishedLocked();
+
+    if (running_ >= MAX_RUNNING_JOBS) {
+        return std::nullopt;
+    }
+
+    auto job = std::make_unique<Job>();
+    job->status.jobId = newJobId();
+    job->status.roomId = roomId;
+    job->status.requestedBy = requestedBy;
+    job->status.startedAt = static_cast<uint64_t>(std::time(nullptr));
+    if (!dir.empty()) {
+        job->status.path = dir + "/" + job->status.jobId + ".jsonl.gz";
+    }
+
+    Job& ref = *job;
+    std::string jobId = job->status.jobId;
+    jobs_[jobId] = std::move(job);
+    running_++;
+
+    ref.thread = std::thread([this, &ref, sink = std::move(sink), onProgress = std::move(onProgress)]() {
+        runJob(ref, sink, onProgress);
+    });
+
+    Logger::info("📦 Export " + jobId + " started for room " + roomId);
+    return jobId;
+}
+
+void RoomExporter::reapFinishedLocked() {
+    // Join threads of finished jobs (they have already released everything)
+    for (auto& [jobId, job] : jobs_) {
+        if (job->status.state != JobState::Running && job->thread.joinable()) {
+            job->thread.join();
+        }
+    }
+
+    // Forget the oldest finished jobs (and their files) beyond the retention cap
+    while (jobs_.size() > MAX_RETAINED_JOBS) {
+        auto oldest = jobs_.end();
+        for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+            if (it->second->status.state == JobState::Running) continue;
+            if (oldest == jobs_.end() || it->second->status.finishedAt < oldest->second->status.finishedAt) {
+                oldest = it;
+            }
+        }
+        if (oldest == jobs_.end()) {
+            break;
+        }
+        if (!oldest->second->status.path.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(oldest->second->status.path, ec);
+        }
+        jobs_.erase(oldest);
+    }
+}
+
+void RoomExporter::runJob(Job& job, ChunkSink sink, ProgressCallback onProgress) {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "room-export");
+    JobStatus snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot = job.status;
+    }
+
+    std::string error;
+    std::unique_ptr<FileIO::Writer> writer;
+    std::string partPath;
+
+    auto db = dbTemplate_.createWorkerConnection();
+    if (!db) {
+        error = "Database unavailable";
+    }
+
+    if (error.empty() && !snapshot.path.empty()) {
+        // Written under a temporary name so a half-written export is never served
+        partPath = snapshot.path + ".part";
+        writer = FileIO::openWriter(partPath);
+        if (!writer->isOpen()) {
+            error = "Cannot open export file";
+        } else {
+            FileIO::Writer* out = writer.get();
+            sink = [out](std::string_view chunk) { return out->write(chunk); };
+        }
+    }
+
+    if (error.empty()) {
+        uint64_t total = db->countRoomMessages(snapshot.roomId);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job.status.totalRows = total;
+        }
+
+        bool sinkFailed = false;
+        auto guardedSink = [this, &sink, &sinkFailed](std::string_view chunk) {
+            if (stopping_ || !sink(chunk)) {
+                sinkFailed = true;
+                return false;
+            }
+            return true;
+        };
+
+        GzipStream gzip(guardedSink);
+        uint64_t rows = 0;
+
+        bool ok = db->forEachRoomMessage(snapshot.roomId, [&](const Message& msg) {
+            std::string line = toJsonLine(msg);
+            line.push_back('\n');
+            if (!gzip.write(line)) {
+                return false;
+            }
+
+            rows++;
+            if (rows % PROGRESS_EVERY_ROWS == 0) {
+                JobStatus progress;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    job.status.rowsWritten = rows;
+                    job.status.bytesWritten = gzip.bytesOut();
+                    progress = job.status;
+                }
+                if (onProgress) onProgress(progress);
+            }
+            return true;
+        }, BATCH_SIZE);
+
+        if (!ok) {
+            error = "Database read failed";
+        } else if (sinkFailed) {
+            error = stopping_ ? "Server shutting down" : "Output closed";
+        } else if (!gzip.finish() || sinkFailed) {
+            error = "Output closed";
+        }
+
+        if (writer && !writer->close() && error.empty()) {
+            error = "Export file write failed";
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        job.status.rowsWritten = rows;
+        job.status.bytesWritten = gzip.bytesOut();
+    }
+
+    if (!partPath.empty()) {
+        std::error_code ec;
+        if (error.empty()) {
+            std::filesystem::rename(partPath, snapshot.path, ec);
+            if (ec) error = "Cannot finalize export file";
+        }
+        if (!error.empty()) {
+            std::filesystem::remove(partPath, ec);
+        }
+    }
+
+    JobStatus finalStatus;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job.status.state = error.empty() ? JobState::Completed : JobState::Failed;
+        job.status.error = error;
+        job.status.finishedAt = static_cast<uint64_t>(std::time(nullptr));
+        running_--;
+        finalStatus = job.status;
+    }
+
+    if (error.empty()) {
+        Logger::info("📦 Export " + finalStatus.jobId + " completed: " + std::to_string(finalStatus.rowsWritten) +
+                     " rows, " + std::to_string(finalStatus.bytesWritten) + " bytes");
+    } else {
+        Logger::error("Export " + finalStatus.jobId + " failed: " + error);
+    }
+
+    if (onProgress) onProgress(finalStatus);
+}
+
+std::string RoomExporter::toJsonLine(const Message& stored) {
+    Message msg = stored;
+    message_codec::inflate(msg);
+
+    json line = {
+        {"messageId", msg.messageId},
+        {"roomId", msg.roomId},
+        {"senderId", msg.senderId},
+        {"senderName", msg.senderName},
+        {"content", msg.content},
+        {"messageType", msg.messageType},
+        {"timestamp", msg.timestamp}
+    };
+    if (!msg.replyToId.empty()) {
+        line["replyToId"] = msg.replyToId;
+    }
+    if (!msg.metadata.empty()) {
+        // Keep metadata structured when it parses, raw otherwise
+        json meta = json::parse(msg.metadata, nullptr, false);
+        line["metadata"] = meta.is_discarded() ? json(msg.metadata) : meta;
+    }
+    return line.dump(-1, ' ', false, json::error_handler_t::replace);
+}
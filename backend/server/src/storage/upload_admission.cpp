@@ -0,0 +1,191 @@
+#include "storage/upload_admission.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+UploadAdmission::UploadAdmission(Limits limits)
+    : limits_(limits),
+      tokens_(static_cast<int64_t>(limits.burstBytes)) {
+    limits_.maxActive = std::max<size_t>(limits_.maxActive, 1);
+    limits_.maxPerUser = std::max<size_t>(limits_.maxPerUser, 1);
+}
+
+UploadAdmission::Ticket UploadAdmission::request(const std::string& owner, Callback onAdmitted) {
+    Ticket ticket;
+
+    // Entries still queued while slots are free are held by their owner's limit, so
+    // only the owner's own earlier uploads have a claim ahead of this one
+    bool ownerQueued = std::any_of(queue_.begin(), queue_.end(),
+                                   [&](uint64_t id) { return slots_.at(id).owner == owner; });
+    if (!ownerQueued && canStart(owner)) {
+        ticket.id = nextId_++;
+        Slot& slot = slots_[ticket.id];
+        slot.owner = owner;
+        start(slot);
+        ticket.decision = Decision::Admitted;
+        return ticket;
+    }
+
+    if (queue_.size() >= limits_.maxQueued) {
+        ticket.retryAfterSeconds = retryAfter();
+        return ticket;
+    }
+
+    ticket.id = nextId_++;
+    Slot& slot = slots_[ticket.id];
+    slot.owner = owner;
+    slot.onAdmitted = std::move(onAdmitted);
+    queue_.push_back(ticket.id);
+    ticket.decision = Decision::Queued;
+    ticket.queuePosition = queue_.size();
+    return ticket;
+}
+
+void UploadAdmission::release(uint64_t id) {
+    auto it = slots_.find(id);
+    if (it == slots_.end()) {
+        return;
+    }
+
+    if (it->second.active) {
+        activeCount_--;
+        auto owner = activePerOwner_.find(it->second.owner);
+        if (owner != activePerOwner_.end() && --owner->second == 0) {
+            activePerOwner_.erase(owner);
+        }
+        double seconds = static_cast<double>(nowMs() - it->second.startedAtMs) / 1000.0;
+        avgUploadSeconds_ = 0.8 * avgUploadSeconds_ + 0.2 * seconds;
+    } else {
+        queue_.erase(std::remove(queue_.begin(), queue_.end(), id), queue_.end());
+    }
+    // A reserve the upload never used goes back to the bucket
+    tokens_ = std::min<int64_t>(static_cast<int64_t>(limits_.burstBytes), tokens_ + it->second.reservedBytes);
+    heldBytes_ -= it->second.heldBytes;
+    bandwidthWaiters_.erase(std::remove_if(bandwidthWaiters_.begin(), bandwidthWaiters_.end(),
+                                           [id](const auto& waiter) { return waiter.first == id; }),
+                            bandwidthWaiters_.end());
+    slots_.erase(it);
+
+    // Admit in FIFO order, skipping owners already at their limit
+    std::vector<Callback> admitted;
+    for (auto q = queue_.begin(); q != queue_.end() && activeCount_ < limits_.maxActive;) {
+        Slot& slot = slots_[*q];
+        if (!canStart(slot.owner)) {
+            ++q;
+            continue;
+        }
+        start(slot);
+        admitted.push_back(std::move(slot.onAdmitted));
+        q = queue_.erase(q);
+    }
+
+    // Callbacks may start or release other uploads
+    for (auto& callback : admitted) {
+        if (callback) callback();
+    }
+}
+
+bool UploadAdmission::isActive(uint64_t id) const {
+    auto it = slots_.find(id);
+    return it != slots_.end() && it->second.active;
+}
+
+bool UploadAdmission::consume(uint64_t id, size_t bytes, uint64_t nowMs) {
+    auto it = slots_.find(id);
+    if (limits_.diskBytesPerSecond == 0 || it == slots_.end() || !it->second.active) {
+        return true;
+    }
+    tokens_ += it->second.reservedBytes;
+    it->second.reservedBytes = 0;
+    tokens_ -= static_cast<int64_t>(bytes);
+    refill(nowMs);
+    return tokens_ > 0;
+}
+
+void UploadAdmission::waitForBandwidth(uint64_t id, Callback onResume) {
+    if (isActive(id)) {
+        bandwidthWaiters_.emplace_back(id, std::move(onResume));
+    }
+}
+
+bool UploadAdmission::hold(uint64_t id, size_t bytes) {
+    auto it = slots_.find(id);
+    if (it == slots_.end() ||
+        it->second.heldBytes + bytes > limits_.maxHeldPerUpload ||
+        heldBytes_ + bytes > limits_.maxHeldBytes) {
+        return false;
+    }
+    it->second.heldBytes += bytes;
+    heldBytes_ += bytes;
+    return true;
+}
+
+void UploadAdmission::unhold(uint64_t id, size_t bytes) {
+    auto it = slots_.find(id);
+    if (it == slots_.end()) {
+        return;  // release() already gave them back
+    }
+    bytes = std::min<uint64_t>(bytes, it->second.heldBytes);
+    it->second.heldBytes -= bytes;
+    heldBytes_ -= bytes;
+}
+
+uint32_t UploadAdmission::retryAfterHeld() const {
+    // Time for the bucket to write out what is held
+    if (limits_.diskBytesPerSecond == 0) {
+        return 1;
+    }
+    return static_cast<uint32_t>(std::clamp<uint64_t>(heldBytes_ / limits_.diskBytesPerSecond + 1, 1, 60));
+}
+
+void UploadAdmission::refill(uint64_t nowMs) {
+    if (lastRefillMs_ == 0 || nowMs < lastRefillMs_) {
+        lastRefillMs_ = nowMs;
+    }
+    uint64_t elapsed = nowMs - lastRefillMs_;
+    if (elapsed > 0) {
+        tokens_ = std::min<int64_t>(static_cast<int64_t>(limits_.burstBytes),
+                                    tokens_ + static_cast<int64_t>(limits_.diskBytesPerSecond * elapsed / 1000));
+        lastRefillMs_ = nowMs;
+    }
+
+    // Resume in arrival order while the balance lasts, reserving room for
+    // each one's next chunk; an upload that overdraws again queues at the back
+    while (tokens_ > 0 && !bandwidthWaiters_.empty()) {
+        auto [id, resume] = std::move(bandwidthWaiters_.front());
+        bandwidthWaiters_.pop_front();
+        auto it = slots_.find(id);
+        if (it == slots_.end() || !it->second.active) {
+            continue;  // Released meanwhile; never resume an upload that is not admitted
+        }
+        tokens_ -= RESUME_RESERVE_BYTES - it->second.reservedBytes;
+        it->second.reservedBytes = RESUME_RESERVE_BYTES;
+        if (resume) resume();
+    }
+}
+
+bool UploadAdmission::canStart(const std::string& owner) const {
+    if (activeCount_ >= limits_.maxActive) {
+        return false;
+    }
+    auto it = activePerOwner_.find(owner);
+    return it == activePerOwner_.end() || it->second < limits_.maxPerUser;
+}
+
+void UploadAdmission::start(Slot& slot) {
+    slot.active = true;
+    slot.startedAtMs = nowMs();
+    activeCount_++;
+    activePerOwner_[slot.owner]++;
+}
+
+uint32_t UploadAdmission::retryAfter() const {
+    // Time for the queue ahead to drain at the current concurrency
+    double seconds = avgUploadSeconds_ * static_cast<double>(queue_.size() + 1) / static_cast<double>(limits_.maxActive);
+    return static_cast<uint32_t>(std::clamp(seconds, 5.0, 300.0));
+}
+
+uint64_t UploadAdmission::nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,118 @@
+// chat_import - bulk load message history (JSONL / CSV, optionally .gz)
+//
+// Usage: chat_import <file> [--format jsonl|csv] [--map ids.json] [--workers N]
+//                           [--batch N] [--defer-indexes] [--no-resume] [--env path]
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <signal.h>
+#include "config/config_loader.h"
+#include "database/mysql_client.h"
+#include "storage/bulk_importer.h"
+#include "utils/logger.h"
+
+using namespace std;
+
+static BulkImporter* g_importer = nullptr;
+
+void signalHandler(int) {
+    // Stop reading; the checkpoint keeps everything loaded so far
+    if (g_importer) g_importer->cancel();
+}
+
+static void printUsage() {
+    cerr << "Usage: chat_import <file> [--format jsonl|csv] [--map ids.json] [--workers N]\n"
+            "                   [--batch N] [--defer-indexes] [--no-resume] [--env path]\n"
+            "\n"
+            "  --defer-indexes  drop messages secondary indexes during the load and rebuild\n"
+            "                   them at the end (only while the chat server is stopped)\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    string inputPath;
+    string mapPath;
+    string envPath = "../../config/.env";
+    BulkImporter::Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        auto next = [&]() -> string {
+            if (i + 1 >= argc) {
+                cerr << "Missing value for " << arg << "\n";
+                exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--format") {
+            string format = next();
+            options.format = format == "csv" ? BulkImporter::Format::Csv : BulkImporter::Format::JsonLines;
+        } else if (arg == "--map") {
+            mapPath = next();
+        } else if (arg == "--workers") {
+            options.workers = static_cast<size_t>(stoul(next()));
+        } else if (arg == "--batch") {
+            options.batchSize = static_cast<size_t>(stoul(next()));
+        } else if (arg == "--defer-indexes") {
+            options.deferIndexes = true;
+        } else if (arg == "--no-resume") {
+            options.resume = false;
+        } else if (arg == "--env") {
+            envPath = next();
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (inputPath.empty()) {
+            inputPath = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    try {
+        Config config = ConfigLoader::load(envPath);
+
+        MySQLClient db(config.mysqlHost, config.mysqlUser, config.mysqlPassword,
+                       config.mysqlDatabase, config.mysqlPort);
+        if (!db.connect()) {
+            Logger::error("Failed to connect to MySQL database");
+            return 1;
+        }
+        if (!config.messageShards.empty()) {
+            auto shards = parseShardList(config.messageShards, config.mysqlPort, config.mysqlDatabase);
+            if (shards.empty() || !db.connectShards(shards)) {
+                Logger::error("Failed to connect to message shards (MESSAGE_SHARDS)");
+                return 1;
+            }
+        }
+
+        BulkImporter importer(db, options);
+        if (!mapPath.empty() && !importer.loadIdMap(mapPath)) {
+            return 1;
+        }
+
+        g_importer = &importer;
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+
+        auto stats = importer.run(inputPath, [](const BulkImporter::Stats& s) {
+            Logger::info("📥 " + to_string(s.rowsRead) + " read, " + to_string(s.rowsImported) + " imported, " +
+                         to_string(s.rowsRejected) + " rejected - " +
+                         to_string(static_cast<uint64_t>(s.rowsPerSecond)) + " rows/s");
+        });
+        g_importer = nullptr;
+
+        return stats ? 0 : 1;
+
+    } catch (const exception& e) {
+        Logger::error("Fatal error: " + string(e.what()));
+        return 1;
+    }
+}
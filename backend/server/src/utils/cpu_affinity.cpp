@@ -0,0 +1,180 @@
+#include "utils/cpu_affinity.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu_affinity {
+
+namespace {
+
+struct Plan {
+    std::vector<int> eventLoop;
+    std::vector<int> roomWorkers;
+    std::vector<int> background;
+};
+
+constexpr int MAX_CPUS = 1024;  // CPU_SETSIZE
+
+Plan plan;  // Written by configure() before any thread starts, read-only afterwards
+
+std::vector<int> processCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+std::vector<int> without(const std::vector<int>& cpus, const std::vector<int>& excluded) {
+    std::vector<int> rest;
+    for (int cpu : cpus) {
+        if (std::find(excluded.begin(), excluded.end(), cpu) == excluded.end()) rest.push_back(cpu);
+    }
+    return rest;
+}
+
+std::string toString(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return "any";
+    }
+    // Collapse runs back into cpulist ranges
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!out.empty()) out += ",";
+        out += std::to_string(cpus[i]);
+        if (j > i) out += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out;
+}
+
+const std::vector<int>& cpusOf(ThreadClass threadClass) {
+    switch (threadClass) {
+        case ThreadClass::EventLoop: return plan.eventLoop;
+        case ThreadClass::RoomWorker: return plan.roomWorkers;
+        default: return plan.background;
+    }
+}
+
+} // namespace
+
+std::vector<int> parseCpuList(const std::string& spec) {
+    std::vector<int> cpus;
+    std::stringstream ss(spec);
+    std::string token;
+
+    try {
+        while (std::getline(ss, token, ',')) {
+            token.erase(std::remove_if(token.begin(), token.end(),
+                                       [](unsigned char c) { return std::isspace(c); }),
+                        token.end());
+            if (token.empty()) {
+                continue;
+            }
+            if (token.rfind("node", 0) == 0) {
+                std::ifstream nodeList("/sys/devices/system/node/node" + token.substr(4) + "/cpulist");
+                std::string line;
+                if (!nodeList || !std::getline(nodeList, line)) {
+                    Logger::warning("⚠️ Unknown NUMA node in CPU list: " + token);
+                    return {};
+                }
+                auto nodeCpus = parseCpuList(line);
+                cpus.insert(cpus.end(), nodeCpus.begin(), nodeCpus.end());
+                continue;
+            }
+            size_t dash = token.find('-');
+            int first = std::stoi(token.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(token.substr(dash + 1));
+            if (first < 0 || last < first || last >= MAX_CPUS) {
+                throw std::invalid_argument(token);
+            }
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+    } catch (const std::exception&) {
+        Logger::warning("⚠️ Invalid CPU list: \"" + spec + "\" (expected e.g. 0-3,8 or node1)");
+        return {};
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+void configure(const std::string& loopSpec, const std::string& workerSpec, const std::string& backgroundSpec) {
+    plan.eventLoop = parseCpuList(loopSpec);
+    plan.roomWorkers = parseCpuList(workerSpec);
+    plan.background = parseCpuList(backgroundSpec);
+
+    // Keep everything else off the loop's cores
+    if (!plan.eventLoop.empty()) {
+        auto rest = without(processCpus(), plan.eventLoop);
+        if (rest.empty()) {
+            Logger::warning("⚠️ CPU_LOOP covers every CPU; workers share the loop's cores");
+        } else {
+            if (plan.roomWorkers.empty()) plan.roomWorkers = rest;
+            if (plan.background.empty()) plan.background = rest;
+        }
+    }
+
+#ifndef __linux__
+    if (enabled()) {
+        Logger::warning("⚠️ CPU pinning is only supported on Linux; ignoring CPU_* settings");
+        plan = Plan{};
+    }
+#endif
+}
+
+bool enabled() {
+    return !plan.eventLoop.empty() || !plan.roomWorkers.empty() || !plan.background.empty();
+}
+
+void pinCurrentThread(ThreadClass threadClass, int index, const std::string& name) {
+#ifdef __linux__
+    if (!name.empty()) {
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());  // Kernel limit: 15 chars
+    }
+
+    const auto& cpus = cpusOf(threadClass);
+    if (cpus.empty()) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (index >= 0) {
+        CPU_SET(cpus[static_cast<size_t>(index) % cpus.size()], &set);
+    } else {
+        for (int cpu : cpus) CPU_SET(cpu, &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        Logger::warning("⚠️ Could not pin thread " + name + " (error " + std::to_string(rc) + ")");
+    }
+#else
+    (void)threadClass;
+    (void)index;
+    (void)name;
+#endif
+}
+
+std::string describe() {
+    return "loop=" + toString(plan.eventLoop) + " room-workers=" + toString(plan.roomWorkers) +
+           " background=" + toString(plan.background);
+}
+
+} // namespace cpu_affinity
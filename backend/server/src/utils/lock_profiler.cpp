@@ -0,0 +1,231 @@
+#include "utils/lock_profiler.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+namespace lock_profiler {
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+
+#ifdef CHATBOX_LOCK_PROFILING
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ProfiledMutex*> locks;
+};
+
+// Function-local: mutexes with static storage register during static init
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t bucketFor(uint64_t us) {
+    return std::min<size_t>(static_cast<size_t>(std::bit_width(us)), HISTOGRAM_BUCKETS - 1);
+}
+
+void storeMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+std::string siteLabel(const char* file, uint32_t line) {
+    if (!file) {
+        return "other";
+    }
+    const char* base = std::strrchr(file, '/');
+    return std::string(base ? base + 1 : file) + ":" + std::to_string(line);
+}
+
+#endif
+
+} // namespace
+
+#ifdef CHATBOX_LOCK_PROFILING
+
+bool compiledIn() { return true; }
+
+ProfiledMutex::ProfiledMutex(const char* name) : name_(name) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.locks.push_back(this);
+}
+
+ProfiledMutex::~ProfiledMutex() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.locks.erase(std::remove(reg.locks.begin(), reg.locks.end(), this), reg.locks.end());
+}
+
+void ProfiledMutex::lock(const std::source_location& site) {
+    if (!g_enabled.load(std::memory_order_relaxed)) {
+        mutex_.lock();
+        heldSinceNs_ = 0;
+        return;
+    }
+
+    uint64_t waitUs = 0;
+    if (!mutex_.try_lock()) {
+        uint64_t start = nowNs();
+        mutex_.lock();
+        waitUs = (nowNs() - start) / 1000;
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        waitTotalUs_.fetch_add(waitUs, std::memory_order_relaxed);
+        storeMax(waitMaxUs_, waitUs);
+    }
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    waitHistogram_[bucketFor(waitUs)].fetch_add(1, std::memory_order_relaxed);
+
+    holder_ = siteFor(site);
+    heldSinceNs_ = nowNs();
+}
+
+bool ProfiledMutex::try_lock() {
+    if (!mutex_.try_lock()) {
+        return false;
+    }
+    heldSinceNs_ = 0;
+    if (g_enabled.load(std::memory_order_relaxed)) {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        waitHistogram_[0].fetch_add(1, std::memory_order_relaxed);
+        holder_ = &sites_[MAX_SITES];
+        heldSinceNs_ = nowNs();
+    }
+    return true;
+}
+
+void ProfiledMutex::unlock() {
+    uint64_t heldSince = heldSinceNs_;
+    Site* holder = holder_;
+    heldSinceNs_ = 0;
+    holder_ = nullptr;
+    uint64_t releasedAt = heldSince ? nowNs() : 0;
+    mutex_.unlock();
+
+    // Bookkeeping after the release so it does not inflate hold times
+    if (heldSince) {
+        uint64_t holdUs = (releasedAt - heldSince) / 1000;
+        holdTotalUs_.fetch_add(holdUs, std::memory_order_relaxed);
+        storeMax(holdMaxUs_, holdUs);
+        holdHistogram_[bucketFor(holdUs)].fetch_add(1, std::memory_order_relaxed);
+        holder->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        holder->holdTotalUs.fetch_add(holdUs, std::memory_order_relaxed);
+        storeMax(holder->holdMaxUs, holdUs);
+    }
+}
+
+ProfiledMutex::Site* ProfiledMutex::siteFor(const std::source_location& site) {
+    if (site.line() == 0) {
+        return &sites_[MAX_SITES];
+    }
+
+    uint64_t key = (std::hash<const void*>{}(site.file_name()) * 31 + site.line()) | 1;
+    for (size_t probe = 0; probe < MAX_SITES; ++probe) {
+        Site& slot = sites_[(key + probe) % MAX_SITES];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+        if (current == 0 && slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+            slot.file.store(site.file_name(), std::memory_order_relaxed);
+            slot.line.store(site.line(), std::memory_order_relaxed);
+            return &slot;
+        }
+        if (current == key) {
+            return &slot;
+        }
+    }
+    return &sites_[MAX_SITES];
+}
+
+std::vector<LockReport> report(size_t topSites) {
+    std::vector<LockReport> reports;
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    for (const ProfiledMutex* m : reg.locks) {
+        LockReport r;
+        r.name = m->name_;
+        r.acquisitions = m->acquisitions_.load(std::memory_order_relaxed);
+        r.contended = m->contended_.load(std::memory_order_relaxed);
+        r.waitTotalUs = m->waitTotalUs_.load(std::memory_order_relaxed);
+        r.waitMaxUs = m->waitMaxUs_.load(std::memory_order_relaxed);
+        r.holdTotalUs = m->holdTotalUs_.load(std::memory_order_relaxed);
+        r.holdMaxUs = m->holdMaxUs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            r.waitHistogram[i] = m->waitHistogram_[i].load(std::memory_order_relaxed);
+            r.holdHistogram[i] = m->holdHistogram_[i].load(std::memory_order_relaxed);
+        }
+
+        for (size_t i = 0; i <= MAX_SITES; ++i) {
+            const auto& slot = m->sites_[i];
+            uint64_t count = slot.acquisitions.load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            SiteReport site;
+            site.site = i == MAX_SITES ? "other" : siteLabel(slot.file.load(std::memory_order_relaxed),
+                                                               slot.line.load(std::memory_order_relaxed));
+            site.acquisitions = count;
+            site.holdTotalUs = slot.holdTotalUs.load(std::memory_order_relaxed);
+            site.holdMaxUs = slot.holdMaxUs.load(std::memory_order_relaxed);
+            r.topHolders.push_back(std::move(site));
+        }
+        std::sort(r.topHolders.begin(), r.topHolders.end(),
+                  [](const SiteReport& a, const SiteReport& b) { return a.holdTotalUs > b.holdTotalUs; });
+        if (r.topHolders.size() > topSites) {
+            r.topHolders.resize(topSites);
+        }
+        reports.push_back(std::move(r));
+    }
+
+    std::sort(reports.begin(), reports.end(),
+              [](const LockReport& a, const LockReport& b) { return a.waitTotalUs > b.waitTotalUs; });
+    return reports;
+}
+
+void reset() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    for (ProfiledMutex* m : reg.locks) {
+        for (auto* counter : {&m->acquisitions_, &m->contended_, &m->waitTotalUs_, &m->waitMaxUs_,
+                              &m->holdTotalUs_, &m->holdMaxUs_}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            m->waitHistogram_[i].store(0, std::memory_order_relaxed);
+            m->holdHistogram_[i].store(0, std::memory_order_relaxed);
+        }
+        for (auto& slot : m->sites_) {
+            slot.acquisitions.store(0, std::memory_order_relaxed);
+            slot.holdTotalUs.store(0, std::memory_order_relaxed);
+            slot.holdMaxUs.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+#else
+
+bool compiledIn() { return false; }
+std::vector<LockReport> report(size_t) { return {}; }
+void reset() {}
+
+#endif
+
+bool enabled() {
+    return compiledIn() && g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool on) {
+    g_enabled.store(on, std::memory_order_relaxed);
+}
+
+} // namespace lock_profiler
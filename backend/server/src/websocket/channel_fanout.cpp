@@ -0,0 +1,77 @@
+#include "websocket/channel_fanout.h"
+
+void ChannelFanout::registerChannel(const std::string& channelId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_.insert(channelId);
+}
+
+bool ChannelFanout::isChannel(const std::string& roomId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channels_.count(roomId) > 0;
+}
+
+void ChannelFanout::subscribe(const std::string& channelId, void* ws, const std::string& userId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_[channelId][ws] = userId;
+    socketChannels_[ws].insert(channelId);
+}
+
+void ChannelFanout::unsubscribe(const std::string& channelId, void* ws) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = subscribers_.find(channelId);
+    if (it != subscribers_.end()) {
+        it->second.erase(ws);
+        if (it->second.empty()) {
+            subscribers_.erase(it);
+        }
+    }
+
+    auto socketIt = socketChannels_.find(ws);
+    if (socketIt != socketChannels_.end()) {
+        socketIt->second.erase(channelId);
+        if (socketIt->second.empty()) {
+            socketChannels_.erase(socketIt);
+        }
+    }
+}
+
+void ChannelFanout::unsubscribeAll(void* ws) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto socketIt = socketChannels_.find(ws);
+    if (socketIt == socketChannels_.end()) {
+        return;
+    }
+
+    for (const auto& channelId : socketIt->second) {
+        auto it = subscribers_.find(channelId);
+        if (it != subscribers_.end()) {
+            it->second.erase(ws);
+            if (it->second.empty()) {
+                subscribers_.erase(it);
+            }
+        }
+    }
+    socketChannels_.erase(socketIt);
+}
+
+size_t ChannelFanout::subscriberCount(const std::string& channelId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(channelId);
+    return it == subscribers_.end() ? 0 : it->second.size();
+}
+
+std::vector<ChannelFanout::Subscription> ChannelFanout::snapshot(const std::string& channelId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<Subscription> result;
+    auto it = subscribers_.find(channelId);
+    if (it != subscribers_.end()) {
+        result.reserve(it->second.size());
+        for (const auto& [ws, userId] : it->second) {
+            result.push_back({ws, userId});
+        }
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+#include "websocket/load_governor.h"
+#include "utils/logger.h"
+#include <algorithm>
+
+LoadGovernor::Level LoadGovernor::update(const Sample& sample) {
+    // Smooth lag a little so a single slow callback does not flip the level
+    lagEwmaMs_ = 0.5 * lagEwmaMs_ + 0.5 * static_cast<double>(sample.loopLagMs);
+    stats_.loopLagMs = static_cast<uint64_t>(lagEwmaMs_);
+    stats_.maxLoopLagMs = std::max(stats_.maxLoopLagMs, sample.loopLagMs);
+    stats_.dbQueueDepth = sample.dbQueueDepth;
+    stats_.bufferedBytes = sample.bufferedBytes;
+
+    if (!enabled_) {
+        return level_;
+    }
+
+    Level previous = level_;
+    int current = static_cast<int>(level_);
+    int pressure = pressureLevel(sample, 1.0);
+
+    if (pressure > current) {
+        level_ = static_cast<Level>(pressure);
+        calmSamples_ = 0;
+    } else if (current > 0 && pressureLevel(sample, thresholds_.recoverFactor) < current) {
+        if (++calmSamples_ >= thresholds_.recoverSamples) {
+            level_ = static_cast<Level>(current - 1);
+            calmSamples_ = 0;
+        }
+    } else {
+        calmSamples_ = 0;
+    }
+
+    if (level_ != previous) {
+        stats_.transitions++;
+        std::string message = std::string("🚦 Load level ") + levelName(previous) + " -> " + levelName(level_) +
+                              " (lag " + std::to_string(stats_.loopLagMs) + "ms, db queue " +
+                              std::to_string(sample.dbQueueDepth) + ", buffered " +
+                              std::to_string(sample.bufferedBytes / 1024) + "KB)";
+        if (level_ > previous) {
+            Logger::warning(message);
+        } else {
+            Logger::info(message);
+        }
+    }
+    return level_;
+}
+
+int LoadGovernor::pressureLevel(const Sample& sample, double factor) const {
+    auto levelOf = [factor](uint64_t value, const std::array<uint64_t, 3>& thresholds) {
+        int level = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (static_cast<double>(value) >= static_cast<double>(thresholds[i]) * factor) {
+                level = i + 1;
+            }
+        }
+        return level;
+    };
+    return std::max({levelOf(static_cast<uint64_t>(lagEwmaMs_), thresholds_.loopLagMs),
+                     levelOf(sample.dbQueueDepth, thresholds_.dbQueueDepth),
+                     levelOf(sample.bufferedBytes, thresholds_.bufferedBytes)});
+}
+
+const char* LoadGovernor::levelName(Level level) {
+    switch (level) {
+        case Level::Normal: return "normal";
+        case Level::ShedPresence: return "shed_presence";
+        case Level::DeferHeavy: return "defer_heavy";
+        case Level::ThrottleLogins: return "throttle_logins";
+    }
+    return "unknown";
+}
+
+bool LoadGovernor::allowTyping() {
+    if (level_ < Level::ShedPresence) {
+        return true;
+    }
+    stats_.typingDropped++;
+    return false;
+}
+
+bool LoadGovernor::allowPresence() {
+    if (level_ < Level::ShedPresence) {
+        return true;
+    }
+    stats_.presenceDropped++;
+    return false;
+}
+
+bool LoadGovernor::allowOnlineScan() {
+    if (level_ < Level::ShedPresence) {
+        return true;
+    }
+    stats_.rejected++;
+    return false;
+}
+
+bool LoadGovernor::admitLogin(uint64_t nowMs) {
+    double burst = std::max(thresholds_.loginsPerSecond, 1.0);
+    if (level_ < Level::ThrottleLogins) {
+        loginTokens_ = burst;
+        lastLoginRefillMs_ = nowMs;
+        return true;
+    }
+
+    if (nowMs > lastLoginRefillMs_) {
+        loginTokens_ = std::min(burst, loginTokens_ + thresholds_.loginsPerSecond * static_cast<double>(nowMs - lastLoginRefillMs_) / 1000.0);
+    }
+    lastLoginRefillMs_ = nowMs;
+    if (loginTokens_ >= 1.0) {
+        loginTokens_ -= 1.0;
+        return true;
+    }
+    stats_.loginsThrottled++;
+    return false;
+}
@@ -0,0 +1,191 @@
+#include "websocket/room_actor_pool.h"
+#include "database/mysql_client.h"
+#include "utils/logger.h"
+#include "utils/cpu_affinity.h"
+#include <chrono>
+#include <ctime>
+#include <algorithm>
+
+RoomActorPool::~RoomActorPool() {
+    stop();
+}
+
+bool RoomActorPool::start(size_t workerCount, const MySQLClient& dbTemplate) {
+    std::unique_lock<std::shared_mutex> poolLock(poolMutex_);
+    if (running_) {
+        return true;
+    }
+
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->db = dbTemplate.createWorkerConnection();
+        if (!worker->db) {
+            Logger::warning("⚠️ Room worker " + std::to_string(i) + " could not open a DB connection");
+            continue;
+        }
+        workers_.push_back(std::move(worker));
+    }
+
+    if (workers_.empty()) {
+        Logger::error("✗ Room actor pool disabled: no worker connections");
+        return false;
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[i];
+        worker.thread = std::thread([this, &worker, i]() { workerLoop(worker, i); });
+    }
+
+    Logger::info("✓ Room actor pool started with " + std::to_string(workers_.size()) + " workers");
+    return true;
+}
+
+void RoomActorPool::stop() {
+    {
+        // Waits out posts in progress; later posts see running_ == false
+        std::unique_lock<std::shared_mutex> poolLock(poolMutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+
+    // Workers may still post (and are refused) while draining, so no pool lock while joining
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->cv.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    std::unique_lock<std::shared_mutex> poolLock(poolMutex_);
+    workers_.clear();
+    Logger::info("Room actor pool stopped");
+}
+
+bool RoomActorPool::post(const std::string& roomId, Task task) {
+    return enqueue({roomId}, [task = std::move(task)](const std::vector<RoomState*>& states, MySQLClient& db) {
+        task(*states.front(), db);
+    });
+}
+
+bool RoomActorPool::postBatch(const std::vector<std::string>& roomIds, BatchTask task) {
+    if (roomIds.empty()) {
+        return false;
+    }
+    return enqueue(roomIds, std::move(task));
+}
+
+bool RoomActorPool::enqueue(std::vector<std::string> roomIds, BatchTask task) {
+    std::shared_lock<std::shared_mutex> poolLock(poolMutex_);
+    if (!running_ || workers_.empty()) {
+        Logger::debug("Room actor pool not running, task for " + roomIds.front() + " dropped");
+        return false;
+    }
+    size_t index = std::hash<std::string>{}(roomIds.front()) % workers_.size();
+    for (const auto& roomId : roomIds) {
+        if (std::hash<std::string>{}(roomId) % workers_.size() != index) {
+            Logger::error("Room actor batch spans workers (" + roomId + ")");
+            return false;
+        }
+    }
+
+    Worker& worker = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.mailbox.emplace_back(std::move(roomIds), std::move(task));
+    }
+    worker.cv.notify_one();
+    return true;
+}
+
+size_t RoomActorPool::workerFor(const std::string& roomId) const {
+    std::shared_lock<std::shared_mutex> poolLock(poolMutex_);
+    return workers_.empty() ? 0 : std::hash<std::string>{}(roomId) % workers_.size();
+}
+
+size_t RoomActorPool::pendingTasks() const {
+    std::shared_lock<std::shared_mutex> poolLock(poolMutex_);
+    size_t total = 0;
+    for (const auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        total += worker->mailbox.size();
+    }
+    return total;
+}
+
+void RoomActorPool::workerLoop(Worker& worker, size_t index) {
+    // Pinned before the worker builds its room state, so that memory is node-local
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::RoomWorker, static_cast<int>(index),
+                                   "room-worker-" + std::to_string(index));
+    Logger::debug("Room worker " + std::to_string(index) + " running");
+
+    uint64_t lastSweep = static_cast<uint64_t>(std::time(nullptr));
+    while (true) {
+        std::pair<std::vector<std::string>, BatchTask> item;
+        bool haveTask = false;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait_for(lock, std::chrono::seconds(SWEEP_INTERVAL_SECONDS),
+                               [&]() { return !worker.mailbox.empty() || !running_; });
+            if (!worker.mailbox.empty()) {
+                item = std::move(worker.mailbox.front());
+                worker.mailbox.pop_front();
+                haveTask = true;
+            } else if (!running_) {
+                break;  // Stopped and drained
+            }
+        }
+
+        uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+        if (now - lastSweep >= SWEEP_INTERVAL_SECONDS) {
+            evictIdleRooms(worker, now);
+            lastSweep = now;
+        }
+        if (!haveTask) {
+            continue;
+        }
+
+        std::vector<RoomState*> states;
+        states.reserve(item.first.size());
+        for (const auto& roomId : item.first) {
+            auto [it, created] = worker.rooms.try_emplace(roomId);
+            RoomState& state = it->second;
+            if (created) {
+                state.nextSeq = seedSeq();
+            }
+            state.lastActivity = now;
+            state.tasksHandled++;
+            states.push_back(&state);
+        }
+
+        try {
+            item.second(states, *worker.db);
+        } catch (const std::exception& e) {
+            Logger::error("Room actor task failed (" + item.first.front() + "): " + std::string(e.what()));
+        }
+    }
+}
+
+void RoomActorPool::evictIdleRooms(Worker& worker, uint64_t now) {
+    for (auto it = worker.rooms.begin(); it != worker.rooms.end();) {
+        if (it->second.lastActivity + ROOM_IDLE_SECONDS < now) {
+            it = worker.rooms.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+uint64_t RoomActorPool::seedSeq() {
+    // Above any seq an earlier state of the room handed out, unless it issued
+    // more than one message per microsecond
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
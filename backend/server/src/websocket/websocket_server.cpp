@@ -1,18 +1,30 @@
 #include "websocket/websocket_server.h"
 #include "utils/logger.h"
 #include "database/types.h"
+#include "database/message_codec.h"
 #include "ai/gemini_client.h"
+#include "storage/file_io.h"
+#include "utils/cpu_affinity.h"
+#include "integrations/address_guard.h"
 #include <uwebsockets/App.h>
 #include <nlohmann/json.hpp>
 #include <thread>
 #include <filesystem>
 #include <fstream>
 #include <set>
+#include <map>
+#include <unordered_set>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
 #include <random>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <functional>  // for std::hash
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <condition_variable>
 
 // Helper function to create canonical DM roomId
 // Format: dm_<hash> - ensures consistent roomId regardless of who sends first
@@ -42,6 +54,46 @@ static std::string createCanonicalDmRoomId(const std::string& userId1, const std
     return "dm_" + ss.str();  // dm_ + 32 hex chars = 35 chars total, fits in VARCHAR(64)
 }
 
+// Message ID: msg-<unix seconds>-<sender prefix>-<random>. The random part keeps two
+// messages a user sends within the same second from sharing an ID.
+static std::string newMessageId(const std::string& userId, uint64_t now) {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::stringstream ss;
+    ss << "msg-" << now << "-" << userId.substr(0, 8) << "-"
+       << std::hex << std::setfill('0') << std::setw(8) << (rng() & 0xFFFFFFFFu);
+    return ss.str();
+}
+
+// Hex string of `bytes` random bytes (RAND_bytes, mt19937 if that fails)
+static std::string randomHex(size_t bytes) {
+    std::vector<unsigned char> buffer(bytes);
+    if (RAND_bytes(buffer.data(), static_cast<int>(bytes)) != 1) {
+        std::mt19937_64 rng{std::random_device{}()};
+        for (auto& b : buffer) b = static_cast<unsigned char>(rng());
+    }
+    static const char* hex = "0123456789abcdef";
+    std::string out;
+    for (unsigned char b : buffer) {
+        out.push_back(hex[b >> 4]);
+        out.push_back(hex[b & 0x0F]);
+    }
+    return out;
+}
+
+// Room ID as a download file name: anything outside [A-Za-z0-9._-] (quotes, CR/LF,
+// separators) would break out of the Content-Disposition header or the path
+static std::string exportFileName(const std::string& roomId) {
+    std::string name;
+    for (char c : roomId.substr(0, 64)) {
+        bool safe = std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-';
+        name.push_back(safe ? c : '_');
+    }
+    if (name.empty() || name.front() == '.') {
+        name.insert(name.begin(), 'x');
+    }
+    return name + ".jsonl.gz";
+}
+
 using json = nlohmann::json;
 
 // Helper: URL Decode
@@ -70,6 +122,189 @@ std::string urlDecode(const std::string &SRC) {
     return ret;
 }
 
+// ============================================================================
+// Chunked HTTP streaming helpers (room export)
+// ============================================================================
+
+// Export status as sent to clients; finished jobs link with a single-use download token
+static json exportStatusJson(const RoomExporter::JobStatus& status, const std::string& downloadToken = "") {
+    json j = {
+        {"jobId", status.jobId},
+        {"roomId", status.roomId},
+        {"state", RoomExporter::stateName(status.state)},
+        {"rowsWritten", status.rowsWritten},
+        {"totalRows", status.totalRows},
+        {"bytesWritten", status.bytesWritten},
+        {"startedAt", status.startedAt * 1000}
+    };
+    if (status.state == RoomExporter::JobState::Completed && !status.path.empty() && !downloadToken.empty()) {
+        j["downloadUrl"] = "/exports/" + status.jobId + "?dl=" + downloadToken;
+    }
+    if (!status.error.empty()) {
+        j["error"] = status.error;
+    }
+    return j;
+}
+
+/**
+ * Bridge between an export job thread (producer) and a chunked HTTP
+ * response on the event loop. The producer blocks while MAX_QUEUED bytes are
+ * waiting; the loop only hands a chunk to uWS while the socket is not
+ * backpressured, so memory stays bounded however slow the client is.
+ */
+struct HttpExportStream {
+    static constexpr size_t MAX_QUEUED = 1024 * 1024;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> queue;
+    size_t queuedBytes = 0;
+    bool scheduled = false;  // A flush is already deferred to the loop
+    bool finished = false;   // Producer is done
+    bool aborted = false;    // Client went away (res is invalid)
+    bool blocked = false;    // Waiting for onWritable
+    bool ended = false;
+};
+
+// Loop thread: move queued chunks into the response until backpressure
+template <typename Res>
+static void flushExportStream(Res* res, const std::shared_ptr<HttpExportStream>& stream) {
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->scheduled = false;
+    if (stream->aborted || stream->ended || stream->blocked) {
+        return;
+    }
+
+    while (!stream->queue.empty()) {
+        std::string chunk = std::move(stream->queue.front());
+        stream->queue.pop_front();
+        stream->queuedBytes -= chunk.size();
+
+        lock.unlock();
+        bool ok = true;
+        res->cork([&]() { ok = res->write(chunk); });
+        lock.lock();
+
+        if (!ok) {
+            stream->blocked = true;
+            break;
+        }
+    }
+    stream->cv.notify_all();
+
+    if (!stream->blocked && stream->queue.empty() && stream->finished) {
+        stream->ended = true;
+        lock.unlock();
+        res->cork([&]() { res->end(); });
+    }
+}
+
+// Loop thread: serve a finished export file in fixed-size chunks
+template <typename Res>
+static void pumpExportFile(Res* res, std::shared_ptr<std::ifstream> file, std::shared_ptr<bool> aborted) {
+    constexpr size_t FILE_CHUNK = 64 * 1024;
+    std::string buffer(FILE_CHUNK, '\0');
+
+    while (!*aborted) {
+        file->read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+        std::streamsize got = file->gcount();
+        if (got <= 0) {
+            res->end();
+            return;
+        }
+        if (!res->write(std::string_view(buffer.data(), static_cast<size_t>(got)))) {
+            // Resume when the socket drains
+            res->onWritable([res, file, aborted](uint64_t) {
+                pumpExportFile(res, file, aborted);
+                return true;
+            });
+            return;
+        }
+    }
+}
+
+// Authorization: Bearer <token> check that takes the same time wherever a guess differs
+static bool bearerMatches(std::string_view header, const std::string& token) {
+    constexpr std::string_view prefix = "Bearer ";
+    if (token.empty() || header.size() != prefix.size() + token.size() || header.substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    return CRYPTO_memcmp(header.data() + prefix.size(), token.data(), token.size()) == 0;
+}
+
+// ============================================================================
+// Lock profiling report
+// ============================================================================
+
+static json histogramJson(const std::array<uint64_t, lock_profiler::HISTOGRAM_BUCKETS>& buckets) {
+    // Nonzero buckets keyed by exclusive upper bound in microseconds
+    json histogram = json::object();
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        std::string bound = i + 1 == buckets.size() ? "inf" : std::to_string(uint64_t{1} << i);
+        histogram[bound] = buckets[i];
+    }
+    return histogram;
+}
+
+// Lock profiler report for /admin/stats
+static json lockProfileJson() {
+    json locks = {
+        {"compiledIn", lock_profiler::compiledIn()},
+        {"enabled", lock_profiler::enabled()},
+        {"locks", json::array()}
+    };
+    
+    for (const auto& lock : lock_profiler::report()) {
+        json holders = json::array();
+        for (const auto& site : lock.topHolders) {
+            holders.push_back({
+                {"site", site.site},
+                {"acquisitions", site.acquisitions},
+                {"holdTotalUs", site.holdTotalUs},
+                {"holdMaxUs", site.holdMaxUs}
+            });
+        }
+        locks["locks"].push_back({
+            {"name", lock.name},
+            {"acquisitions", lock.acquisitions},
+            {"contended", lock.contended},
+            {"waitTotalUs", lock.waitTotalUs},
+            {"waitMaxUs", lock.waitMaxUs},
+            {"holdTotalUs", lock.holdTotalUs},
+            {"holdMaxUs", lock.holdMaxUs},
+            {"waitHistogramUs", histogramJson(lock.waitHistogram)},
+            {"holdHistogramUs", histogramJson(lock.holdHistogram)},
+            {"topHolders", holders}
+        });
+    }
+    return locks;
+}
+
+// room_summary reply: rolling summary plus the newest messages it does not cover yet
+static json roomSummaryJson(const std::string& roomId, const RoomSummarizer::Snapshot& snapshot) {
+    json tail = json::array();
+    for (const auto& line : snapshot.tail) {
+        tail.push_back({
+            {"messageId", line.messageId},
+            {"username", line.senderName},
+            {"content", line.text},
+            {"timestamp", line.timestamp * 1000}
+        });
+    }
+    return {
+        {"type", "room_summary"},
+        {"roomId", roomId},
+        {"summary", snapshot.summary},
+        {"summarizedMessages", snapshot.summarizedMessages},
+        {"updatedAt", snapshot.updatedAt * 1000},
+        {"tail", tail},
+        {"updating", snapshot.updating}
+    };
+}
+
 // Real WebSocket implementation với ChatBox protocol support
 
 // Per-socket user data
@@ -86,13 +321,48 @@ WebSocketServer::WebSocketServer(int port,
     , geminiClient_(geminiClient)
     , webrtcHandler_(std::make_shared<WebRTCHandler>(broker))
     , fileHandler_(std::make_shared<FileHandler>(nullptr, nullptr, broker))
-    , dbClient_(authManager ? authManager->getDatabase() : nullptr) {
+    , dbClient_(authManager ? authManager->getDatabase() : nullptr)
+    , userDirectory_(std::make_shared<UserDirectory>())
+    , uploads_(std::make_unique<UploadAdmission>(UploadAdmission::Limits{}))
+    , webhooks_(std::make_unique<WebhookDispatcher>(WebhookDispatcher::Options{}))
+    , linkPreviews_(std::make_unique<LinkUnfurler>(LinkUnfurler::Options{})) {
+    
+    setAiOptions(2, RoomSummarizer::Options{});
     
     // Set up WebRTC callback to use sendToUser for direct delivery
     webrtcHandler_->setSendToUserCallback([this](const std::string& userId, const std::string& message) {
         this->sendToUser(userId, message);
     });
     
+    // Channels are few - keep their IDs in memory so broadcasts can route them
+    if (dbClient_) {
+        auto channels = dbClient_->getChannelRoomIds();
+        for (const auto& channelId : channels) {
+            channelFanout_.registerChannel(channelId);
+        }
+        Logger::info("📣 Loaded " + std::to_string(channels.size()) + " broadcast channels");
+    }
+    
+    if (dbClient_) {
+        exporter_ = std::make_unique<RoomExporter>(*dbClient_);
+    }
+    
+    // User directory for search_users and the registration username filter
+    if (dbClient_) {
+        userDirectory_->load(dbClient_->getAllUsers());
+        authManager_->setUserDirectory(userDirectory_);
+        Logger::info("📇 User directory loaded: " + std::to_string(userDirectory_->size()) + " users");
+    }
+    
+    // Disappearing messages: room TTLs are few, keep them in memory
+    if (dbClient_) {
+        auto ttls = dbClient_->getRoomMessageTtls();
+        for (const auto& [roomId, ttl] : ttls) {
+            expiryIndex_.setRoomTtl(roomId, ttl);
+        }
+        Logger::info("⌛ Loaded " + std::to_string(ttls.size()) + " room message TTLs");
+    }
+    
     Logger::info("✓ WebSocket server khởi tạo với Protocol Support trên port " + std::to_string(port));
 }
 
@@ -112,6 +382,32 @@ void WebSocketServer::run() {
     try {
         // Create uWebSockets app
         uWS::App app;
+        loop_ = uWS::Loop::get();
+        
+        // Disk-bandwidth refill tick for paused uploads (armed on demand)
+        uploadTimer_ = us_create_timer((struct us_loop_t*)loop_, 0, sizeof(WebSocketServer*));
+        *(WebSocketServer**)us_timer_ext(uploadTimer_) = this;
+        
+        // Load governor sample tick (lag = how late each tick fires)
+        loadTimer_ = us_create_timer((struct us_loop_t*)loop_, 0, sizeof(WebSocketServer*));
+        *(WebSocketServer**)us_timer_ext(loadTimer_) = this;
+        lastLoadTickMs_ = steadyNowMs();
+        us_timer_set(loadTimer_, onLoadTimer, LOAD_SAMPLE_MS, LOAD_SAMPLE_MS);
+        
+        aiExecutor_->start();
+        
+        // Room actors: one worker pool, each worker with its own DB connection
+        if (dbClient_) {
+            roomActors_.start(roomWorkerCount_, *dbClient_);
+            startExpiryPurger();
+            webhooks_->setSubscriptions(dbClient_->getRoomWebhooks());
+            webhooks_->start();
+            if (linkPreviews_) linkPreviews_->start();
+            startSemanticIndex();
+            startWarmup();
+        } else {
+            warm_ = true;
+        }
         
         // Ensure "uploads" directory exists
         namespace fs = std::filesystem;
@@ -128,10 +424,37 @@ void WebSocketServer::run() {
         };
 
         // POST /upload - Streaming mode for LARGE files (1GB+)
-        app.post("/upload", [addCors](auto* res, auto* req) {
+        app.post("/upload", [this, addCors](auto* res, auto* req) {
             std::string rawFilename = std::string(req->getHeader("x-filename"));
             std::string originalFilename = urlDecode(rawFilename);
             
+            // Admission: per-user (or per-IP when anonymous) and global concurrency limits
+            std::string authHeader = std::string(req->getHeader("authorization"));
+            std::optional<SessionInfo> session;
+            if (authHeader.rfind("Bearer ", 0) == 0) {
+                session = authManager_->getSessionFromToken(authHeader.substr(7));
+            }
+            std::string owner = session ? session->userId : "ip:" + std::string(res->getRemoteAddressAsText());
+            
+            // Set once the upload state exists; only runs if the request was queued
+            auto onAdmitted = std::make_shared<std::function<void()>>();
+            auto ticket = uploads_->request(owner, [onAdmitted]() {
+                if (*onAdmitted) (*onAdmitted)();
+            });
+            if (ticket.decision == UploadAdmission::Decision::Rejected) {
+                json error = {
+                    {"error", "Too many uploads in progress"},
+                    {"retryAfter", ticket.retryAfterSeconds}
+                };
+                addCors(res);
+                res->writeStatus("503 Service Unavailable")
+                   ->writeHeader("Retry-After", std::to_string(ticket.retryAfterSeconds))
+                   ->writeHeader("Content-Type", "application/json")
+                   ->end(error.dump());
+                Logger::warning("Upload rejected (queue full) for " + owner);
+                return;
+            }
+            
             if (originalFilename.empty()) {
                 originalFilename = "file_" + std::to_string(std::time(nullptr));
             }
@@ -162,37 +485,51 @@ void WebSocketServer::run() {
             
             // Use streaming write - open file once, append chunks
             struct UploadState {
-                std::ofstream file;
+                std::unique_ptr<FileIO::Writer> file;  // posix or io_uring (IO_BACKEND)
                 std::string filename; // Original filename
                 std::string storageFilename; // Filename on disk
                 std::string path;
                 size_t totalBytes = 0;
+                uint64_t ticketId = 0;  // UploadAdmission slot
+                std::string held;       // Read while still queued, written once admitted
+                bool heldLast = false;
             };
             
             UploadState* state = new UploadState();
+            state->ticketId = ticket.id;
             state->filename = originalFilename;
             state->storageFilename = storageFilename;
             state->path = path;
-            state->file.open(path, std::ios::binary | std::ios::trunc);
+            state->file = FileIO::openWriter(path);
             
-            if (!state->file.is_open()) {
+            if (!state->file->isOpen()) {
                 Logger::error("Failed to create file: " + path);
                 addCors(res);
                 res->writeStatus("500 Internal Server Error");
                 res->end("{\"error\":\"Failed to create file\"}");
+                uploads_->release(state->ticketId);
                 delete state;
                 return;
             }
             
-            Logger::info("Starting large file upload: " + originalFilename);
-
-            res->onData([res, state, addCors](std::string_view chunk, bool isLast) {
+            // Writes one chunk of an admitted upload; false when reading must not go on
+            // (paused for bandwidth, or the response has ended and state is gone)
+            auto writeChunk = [this, res, state, addCors](std::string_view chunk, bool isLast) {
                 // Write chunk directly to disk (no RAM buffering)
-                state->file.write(chunk.data(), chunk.size());
+                state->file->write(chunk);
                 state->totalBytes += chunk.size();
                 
+                // Over the disk budget: stop reading until this upload's turn comes round
+                if (!isLast && !uploads_->consume(state->ticketId, chunk.size(), steadyNowMs())) {
+                    res->pause();
+                    uploads_->waitForBandwidth(state->ticketId, [res]() { res->resume(); });
+                    armUploadTimer();
+                    return false;
+                }
+                
                 if (isLast) {
-                    state->file.close();
+                    state->file->close();
+                    uploads_->release(state->ticketId);
                     
                     // Format file size for logging
                     std::string sizeStr;
@@ -219,12 +556,58 @@ void WebSocketServer::run() {
                     res->end(response.dump());
                     Logger::info("Large file uploaded: " + state->filename + " (" + sizeStr + ")");
                     delete state;
+                    return false;
+                }
+                return true;
+            };
+            
+            if (ticket.decision == UploadAdmission::Decision::Queued) {
+                // Leave the body in the socket until a slot frees up
+                res->pause();
+                *onAdmitted = [this, res, state, writeChunk]() {
+                    // What uWS read before the pause goes first; the rest is still in the socket
+                    std::string held = std::move(state->held);
+                    bool heldLast = state->heldLast;
+                    uploads_->unhold(state->ticketId, held.size());
+                    if ((held.empty() && !heldLast) || writeChunk(held, heldLast)) {
+                        res->resume();
+                    }
+                };
+                Logger::info("⏳ Upload queued (position " + std::to_string(ticket.queuePosition) + "): " + originalFilename);
+            } else {
+                Logger::info("Starting large file upload: " + originalFilename);
+            }
+
+            res->onData([this, res, state, addCors, writeChunk](std::string_view chunk, bool isLast) {
+                if (uploads_->isActive(state->ticketId)) {
+                    writeChunk(chunk, isLast);
+                    return;
+                }
+                
+                // Still queued: pause() does not cancel data uWS had already read. Keep it
+                // (bounded) for the admission callback instead of writing or charging it
+                if (!uploads_->hold(state->ticketId, chunk.size())) {
+                    uint32_t retryAfter = uploads_->retryAfterHeld();
+                    addCors(res);
+                    res->writeStatus("503 Service Unavailable")
+                       ->writeHeader("Retry-After", std::to_string(retryAfter))
+                       ->writeHeader("Content-Type", "application/json")
+                       ->end(json({{"error", "Too many uploads in progress"}, {"retryAfter", retryAfter}}).dump());
+                    uploads_->release(state->ticketId);
+                    state->file->close();
+                    std::filesystem::remove(state->path);
+                    Logger::warning("Queued upload dropped (held data over limit): " + state->filename);
+                    delete state;
+                    return;
                 }
+                state->held.append(chunk);
+                state->heldLast = isLast;
             });
 
-            res->onAborted([state]() {
-                if (state->file.is_open()) {
-                    state->file.close();
+            res->onAborted([this, state]() {
+                uploads_->release(state->ticketId);
+                if (state->file->isOpen()) {
+                    state->file->close();
                 }
                 // Clean up partial file
                 std::filesystem::remove(state->path);
@@ -245,13 +628,11 @@ void WebSocketServer::run() {
             std::string path = "uploads/" + filename;
             
             if (std::filesystem::exists(path)) {
-                std::ifstream is(path, std::ios::binary);
-                if (is) {
-                    std::string str((std::istreambuf_iterator<char>(is)), 
-                                     std::istreambuf_iterator<char>());
+                auto content = FileIO::readFile(path);
+                if (content) {
                     addCors(res);
                     // Simple mimetype check based on extension could be added here
-                    res->end(str);
+                    res->end(*content);
                     return;
                 }
             }
@@ -326,6 +707,22 @@ void WebSocketServer::run() {
             .maxPayloadLength = 16 * 1024 * 1024,
             .idleTimeout = 120,
             
+            // Refuse sockets until the caches are warm: clients retry, and nothing
+            // mutates a cache while the warm-up snapshot is being loaded into it
+            .upgrade = [this](auto* res, auto* req, auto* context) {
+                if (!warm_) {
+                    res->writeStatus("503 Service Unavailable")
+                       ->writeHeader("Retry-After", "5")
+                       ->end("Server is starting");
+                    return;
+                }
+                res->template upgrade<PerSocketData>({},
+                    req->getHeader("sec-websocket-key"),
+                    req->getHeader("sec-websocket-protocol"),
+                    req->getHeader("sec-websocket-extensions"),
+                    context);
+            },
+            
             // Connection opened
             .open = [this](auto* ws) {
                 PerSocketData* data = ws->getUserData();
@@ -335,7 +732,7 @@ void WebSocketServer::run() {
                 
                 // Store connection - cast to void* and store websocket pointer
                 {
-                    std::lock_guard<std::mutex> lock(connectionsMutex_);
+                    ProfiledLock lock(connectionsMutex_);
                     ConnectionState state;
                     state.wsPtr = (void*)ws;  // Store raw pointer for broadcast
                     connections_[(void*)ws] = state;
@@ -346,1205 +743,49 @@ void WebSocketServer::run() {
             
             // Message received - PROTOCOL HANDLING
             .message = [this](auto* ws, std::string_view message, uWS::OpCode opCode) {
+                dispatchMessage((void*)ws, std::string(message.data(), message.size()));
+            },
+            
+            .drain = [this](auto* ws) {
+                noteBuffered((void*)ws);
+            },
+            .ping = [](auto* ws, std::string_view) {},
+            .pong = [](auto* ws, std::string_view) {},
+            
+            // Connection closed
+            .close = [this](auto* ws, int code, std::string_view message) {
                 PerSocketData* data = ws->getUserData();
                 
-                try {
-                    // Convert string_view to string for JSON parsing
-                    std::string msgStr(message.data(), message.size());
+                // Whatever was still queued for this socket is dropped with it
+                bufferedBytes_.fetch_sub(static_cast<int64_t>(data->bufferedBytes), std::memory_order_relaxed);
+                data->bufferedBytes = 0;
+                
+                if (data->authenticated) {
+                    Logger::info("Client disconnected: " + data->username);
+                    membershipIndex_.userDisconnected(data->userId);
                     
-                    // Parse JSON message
-                    json msg = json::parse(msgStr);
-                    std::string type = msg.value("type", "");
+                    // Update user status to offline in database
+                    try {
+                        dbClient_->updateUserStatus(data->userId, 0);  // 0 = offline
+                        Logger::debug("Updated " + data->username + " status to offline");
+                    } catch (const std::exception& e) {
+                        Logger::warning("Failed to update offline status: " + std::string(e.what()));
+                    }
                     
-                    Logger::info("📨 Message type: " + type);
+                    // Broadcast offline presence to other users
+                    json offlineMsg = {
+                        {"type", "presence_update"},
+                        {"userId", data->userId},
+                        {"username", data->username},
+                        {"status", "offline"}
+                    };
                     
-                    if (type == "register") {
-                        handleRegisterJson((void*)ws, msgStr);
-                    }
-                    else if (type == "login") {
-                        handleLoginJson((void*)ws, msgStr);
-                    }
-                    else if (type == "auth") {
-                        // Authenticate WebSocket with existing JWT token
-                        std::string token = msg.value("token", "");
-                        if (!token.empty()) {
-                            auto sessionInfo = authManager_->getSessionFromToken(token);
-                            if (sessionInfo) {
-                                data->authenticated = true;
-                                data->userId = sessionInfo->userId;
-                                data->username = sessionInfo->username;
-                                data->sessionId = "ws-session-" + sessionInfo->userId;
-                                
-                                // IMPORTANT: Also update connections_ map for sendToUser to work
-                                {
-                                    std::lock_guard<std::mutex> lock(connectionsMutex_);
-                                    connections_[(void*)ws].authenticated = true;
-                                    connections_[(void*)ws].userId = sessionInfo->userId;
-                                    connections_[(void*)ws].username = sessionInfo->username;
-                                }
-                                
-                                json response = {
-                                    {"type", "auth_response"},
-                                    {"success", true},
-                                    {"userId", sessionInfo->userId},
-                                    {"username", sessionInfo->username}
-                                };
-                                sendJsonMessage((void*)ws, response.dump());
-                                Logger::info("✓ WebSocket authenticated via token: " + sessionInfo->username);
-                                
-                                // Auto-send online users list after auth success
-                                handleGetOnlineUsersJson((void*)ws);
-                            } else {
-                                sendErrorJson((void*)ws, "Invalid token");
-                                Logger::warning("✗ WebSocket auth failed: invalid token");
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Token required");
-                        }
-                    }
-                    else if (type == "chat") {
-                        if (data->authenticated) {
-                            handleChatMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "typing") {
-                        if (data->authenticated) {
-                            handleTypingJson((void*)ws, msgStr);
-                        }
-                    }
-                    else if (type == "get_online_users") {
-                        if (data->authenticated) {
-                            handleGetOnlineUsersJson((void*)ws);
-                        }
-                    }
-                    else if (type == "edit_message") {
-                        if (data->authenticated) {
-                            handleEditMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "delete_message") {
-                        if (data->authenticated) {
-                            handleDeleteMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "add_reaction") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string emoji = msg.value("emoji", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "reaction_added"},
-                                {"messageId", messageId},
-                                {"emoji", emoji},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            // Send to sender
-                            sendJsonMessage((void*)ws, response.dump());
-                            // Broadcast to room
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("👍 Reaction added by " + data->username + ": " + emoji);
-                        }
-                    }
-                    else if (type == "pin_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "message_pinned"},
-                                {"messageId", messageId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("📌 Message pinned by " + data->username);
-                        }
-                    }
-                    else if (type == "unpin_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "message_unpinned"},
-                                {"messageId", messageId},
-                                {"roomId", roomId}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("📌 Message unpinned by " + data->username);
-                        }
-                    }
-                    else if (type == "reply_message") {
-                        if (data->authenticated) {
-                            std::string content = msg.value("content", "");
-                            std::string replyToId = msg.value("replyToId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            // Create message with replyToId
-                            std::string messageId = "msg-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
-                            
-                            json response = {
-                                {"type", "chat"},
-                                {"messageId", messageId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username},
-                                {"content", content},
-                                {"replyToId", replyToId},
-                                {"timestamp", std::time(nullptr) * 1000}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("↩️ Reply sent by " + data->username);
-                        }
-                    }
-                    else if (type == "create_room") {
-                        if (data->authenticated) {
-                            handleCreateRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "join_room") {
-                        if (data->authenticated) {
-                            handleJoinRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "leave_room") {
-                        if (data->authenticated) {
-                            handleLeaveRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "get_rooms") {
-                        if (data->authenticated) {
-                            handleGetRoomsJson((void*)ws);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "search_messages") {
-                        if (data->authenticated) {
-                            handleSearchMessagesJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "mark_read") {
-                        if (data->authenticated) {
-                            handleMarkReadJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "ping") {
-                        // Respond with pong
-                        json response = {
-                            {"type", "pong"},
-                            {"timestamp", std::time(nullptr)}
-                        };
-                        std::string responseStr = response.dump();
-                        ws->send(responseStr, opCode);
-                    }
-                    // ============== WebRTC Call Signaling ==============
-                    else if (type == "call_init") {
-                        if (data->authenticated) {
-                            std::string targetId = msg.value("targetId", "");
-                            std::string callType = msg.value("callType", "video");
-                            
-                            // Generate a simple call ID
-                            std::string callId = "call-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
-                            
-                            // Send call_incoming directly to target user
-                            json incomingCall = {
-                                {"type", "call_incoming"},
-                                {"callId", callId},
-                                {"callerId", data->userId},
-                                {"callerName", data->username},
-                                {"callType", callType}
-                            };
-                            sendToUser(targetId, incomingCall.dump());
-                            
-                            // Send confirmation to caller
-                            json response = {
-                                {"type", "call_init_response"},
-                                {"success", true},
-                                {"callId", callId},
-                                {"message", "Calling " + targetId + "..."}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("📞 Call initiated by " + data->username + " to " + targetId + " (callId: " + callId + ")");
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_accept") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string callerId = msg.value("callerId", "");
-                            
-                            // Send call_accepted to caller
-                            json acceptMsg = {
-                                {"type", "call_accepted"},
-                                {"callId", callId},
-                                {"accepterId", data->userId},
-                                {"accepterName", data->username}
-                            };
-                            sendToUser(callerId, acceptMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_accept_response"},
-                                {"success", true},
-                                {"message", "Call accepted"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("✅ Call accepted: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_reject") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string callerId = msg.value("callerId", "");
-                            std::string reason = msg.value("reason", "declined");
-                            
-                            // Send call_rejected to caller
-                            json rejectMsg = {
-                                {"type", "call_rejected"},
-                                {"callId", callId},
-                                {"rejecterId", data->userId},
-                                {"reason", reason}
-                            };
-                            sendToUser(callerId, rejectMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_reject_response"},
-                                {"success", true},
-                                {"message", "Call rejected"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("❌ Call rejected: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_end") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            
-                            // Send call_ended to other party
-                            json endMsg = {
-                                {"type", "call_ended"},
-                                {"callId", callId},
-                                {"endedBy", data->userId}
-                            };
-                            sendToUser(targetId, endMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_end_response"},
-                                {"success", true},
-                                {"message", "Call ended"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("📴 Call ended: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "webrtc_offer") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string sdp = msg.value("sdp", "");
-                            
-                            webrtcHandler_->sendOffer(callId, data->userId, targetId, sdp);
-                            Logger::info("📡 WebRTC Offer forwarded: " + callId);
-                        }
-                    }
-                    else if (type == "webrtc_answer") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string sdp = msg.value("sdp", "");
-                            
-                            webrtcHandler_->sendAnswer(callId, data->userId, targetId, sdp);
-                            Logger::info("📡 WebRTC Answer forwarded: " + callId);
-                        }
-                    }
-                    else if (type == "webrtc_ice") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string candidate = msg.value("candidate", "");
-                            
-                            webrtcHandler_->sendIceCandidate(callId, data->userId, targetId, candidate);
-                            Logger::debug("🧊 ICE Candidate forwarded: " + callId);
-                        }
-                    }
-                    // ============== Presence Status ==============
-                    else if (type == "presence_update") {
-                        if (data->authenticated) {
-                            std::string status = msg.value("status", "online");
-                            Logger::info("👤 Presence update from " + data->username + ": " + status);
-                            
-                            // Broadcast to all connections
-                            json broadcastMsg = {
-                                {"type", "presence_update"},
-                                {"userId", data->userId},
-                                {"username", data->username},
-                                {"status", status}
-                            };
-                            broadcast(broadcastMsg.dump());
-                        }
-                    }
-                    // ============== Profile Update ==============
-                    else if (type == "profile_update") {
-                        if (data->authenticated) {
-                            std::string displayName = msg.value("displayName", "");
-                            std::string statusMessage = msg.value("statusMessage", "");
-                            std::string avatar = msg.value("avatar", "");
-                            
-                            Logger::info("👤 Profile update from " + data->username);
-                            
-                            // Save to database
-                            bool saved = false;
-                            try {
-                                auto session = dbClient_->getSession();
-                                if (session) {
-                                    session->sql(
-                                        "UPDATE users SET "
-                                        "display_name = COALESCE(NULLIF(?, ''), display_name), "
-                                        "status_message = ?, "
-                                        "avatar_url = COALESCE(NULLIF(?, ''), avatar_url) "
-                                        "WHERE user_id = ?"
-                                    ).bind(displayName, statusMessage, avatar, data->userId).execute();
-                                    saved = true;
-                                    Logger::info("✅ Profile saved to database");
-                                }
-                            } catch (const std::exception& e) {
-                                Logger::warning("Failed to save profile: " + std::string(e.what()));
-                            }
-                            
-                            // Broadcast the update
-                            json broadcastMsg = {
-                                {"type", "profile_updated"},
-                                {"userId", data->userId},
-                                {"displayName", displayName.empty() ? data->username : displayName},
-                                {"statusMessage", statusMessage},
-                                {"avatar", avatar}
-                            };
-                            broadcast(broadcastMsg.dump());
-                            
-                            // Confirm to sender
-                            json response = {
-                                {"type", "profile_update_response"},
-                                {"success", saved},
-                                {"message", saved ? "Profile updated successfully" : "Profile updated (broadcast only)"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Change Password ==============
-                    else if (type == "change_password") {
-                        if (data->authenticated) {
-                            std::string currentPassword = msg.value("currentPassword", "");
-                            std::string newPassword = msg.value("newPassword", "");
-                            
-                            Logger::info("🔐 Change password request from " + data->username);
-                            
-                            // Use AuthManager's changePassword method
-                            std::string error = authManager_->changePassword(data->userId, currentPassword, newPassword);
-                            bool success = error.empty();
-                            
-                            if (success) {
-                                Logger::info("✅ Password changed successfully for " + data->username);
-                            } else {
-                                Logger::warning("❌ Password change failed for " + data->username + ": " + error);
-                            }
-                            
-                            json response = {
-                                {"type", "change_password_response"},
-                                {"success", success},
-                                {"message", success ? "Password changed successfully" : error}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== AI Chat (Gemini) ==============
-                    else if (type == "ai_request") {
-                        if (data->authenticated && geminiClient_) {
-                            std::string message = msg.value("message", "");
-                            Logger::info("🤖 AI request from " + data->username + ": " + message.substr(0, 50) + "...");
-                            
-                            // Call Gemini API asynchronously
-                            std::thread([this, ws, message, userId = data->userId]() {
-                                try {
-                                    auto response = geminiClient_->sendMessage(message);
-                                    if (response.has_value()) {
-                                        Logger::info("✅ AI response received");
-                                        
-                                        json responseJson = {
-                                            {"type", "ai_response"},
-                                            {"response", response.value()}
-                                        };
-                                        
-                                        // Send response back to client
-                                        sendJsonMessage((void*)ws, responseJson.dump());
-                                    } else {
-                                        Logger::error("❌ AI request failed: No response");
-                                        json errorJson = {
-                                            {"type", "ai_error"},
-                                            {"error", "Failed to get AI response"}
-                                        };
-                                        sendJsonMessage((void*)ws, errorJson.dump());
-                                    }
-                                } catch (const std::exception& e) {
-                                    Logger::error("❌ AI request failed: " + std::string(e.what()));
-                                    json errorJson = {
-                                        {"type", "ai_error"},
-                                        {"message", e.what()}
-                                    };
-                                    sendJsonMessage((void*)ws, errorJson.dump());
-                                }
-                            }).detach();
-                        } else if (!geminiClient_) {
-                            sendErrorJson((void*)ws, "AI service not available");
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Polls ==============
-                    else if (type == "poll_create") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            std::string question = msg.value("question", "");
-                            auto options = msg.value("options", json::array());
-                            
-                            uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                            std::string pollId = "poll-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                            
-                            // Create poll struct for database
-                            Poll pollData;
-                            pollData.pollId = pollId;
-                            pollData.roomId = roomId;
-                            pollData.question = question;
-                            pollData.createdBy = data->userId;
-                            pollData.createdAt = now;
-                            pollData.isClosed = false;
-                            
-                            json pollOptions = json::array();
-                            int optIdx = 0;
-                            for (const auto& opt : options) {
-                                // Include pollId in optId to make it unique across polls
-                                std::string optId = pollId + "-opt-" + std::to_string(optIdx);
-                                PollOption optData;
-                                optData.optionId = optId;
-                                optData.text = opt.get<std::string>();
-                                optData.index = optIdx;
-                                optData.voteCount = 0;
-                                pollData.options.push_back(optData);
-                                
-                                pollOptions.push_back({
-                                    {"id", optId},
-                                    {"text", opt.get<std::string>()},
-                                    {"votes", 0},
-                                    {"voters", json::array()}
-                                });
-                                optIdx++;
-                            }
-                            
-                            // Save to database
-                            auto db = authManager_->getDatabase();
-                            if (db && db->createPoll(pollData)) {
-                                Logger::info("✅ Poll saved to database: " + pollId);
-                            }
-                            
-                            json poll = {
-                                {"id", pollId},
-                                {"question", question},
-                                {"options", pollOptions},
-                                {"createdBy", data->userId},
-                                {"createdAt", now},
-                                {"isClosed", false}
-                            };
-                            
-                            json broadcastMsg = {
-                                {"type", "poll_created"},
-                                {"roomId", roomId},
-                                {"poll", poll}
-                            };
-                            
-                            // For DM rooms, send to both users
-                            if (roomId.substr(0, 3) == "dm_") {
-                                // Extract target user ID from dm_targetUserId format
-                                std::string targetUserId = roomId.substr(3);
-                                // Send to target user with their perspective roomId
-                                std::string targetRoomId = "dm_" + data->userId;
-                                json targetMsg = broadcastMsg;
-                                targetMsg["roomId"] = targetRoomId;
-                                sendToUser(targetUserId, targetMsg.dump());
-                                // Send to sender
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                                Logger::info("📊 Poll sent to DM: " + roomId + " and " + targetRoomId);
-                            } else {
-                                // Broadcast to ALL users in room (including creator for confirmation)
-                                broadcastToRoom(roomId, broadcastMsg.dump());
-                            }
-                            Logger::info("📊 Poll created by " + data->username + ": " + question);
-                        }
-                    }
-                    else if (type == "poll_vote") {
-                        if (data->authenticated) {
-                            std::string pollId = msg.value("pollId", "");
-                            std::string optionId = msg.value("optionId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            // Save vote to database
-                            PollVote vote;
-                            vote.pollId = pollId;
-                            vote.optionId = optionId;
-                            vote.userId = data->userId;
-                            vote.username = data->username;
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db && db->votePoll(vote)) {
-                                Logger::info("✅ Vote saved to database");
-                            }
-                            
-                            json broadcastMsg = {
-                                {"type", "poll_vote"},
-                                {"pollId", pollId},
-                                {"optionId", optionId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            // For DM rooms, send to both users
-                            if (!roomId.empty() && roomId.substr(0, 3) == "dm_") {
-                                std::string targetUserId = roomId.substr(3);
-                                std::string targetRoomId = "dm_" + data->userId;
-                                json targetMsg = broadcastMsg;
-                                targetMsg["roomId"] = targetRoomId;
-                                sendToUser(targetUserId, targetMsg.dump());
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                            } else if (!roomId.empty()) {
-                                broadcastToRoom(roomId, broadcastMsg.dump());
-                            } else {
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                            }
-                            Logger::info("🗳️ Vote cast by " + data->username + " in room " + roomId);
-                        }
-                    }
-                    else if (type == "poll_close") {
-                        if (data->authenticated) {
-                            std::string pollId = msg.value("pollId", "");
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db) {
-                                auto poll = db->getPoll(pollId);
-                                if (poll && poll->createdBy == data->userId) {
-                                    db->closePoll(pollId);
-                                    
-                                    json broadcastMsg = {
-                                        {"type", "poll_closed"},
-                                        {"pollId", pollId}
-                                    };
-                                    broadcast(broadcastMsg.dump());
-                                    Logger::info("📊 Poll closed: " + pollId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Only poll creator can close the poll");
-                                }
-                            }
-                        }
-                    }
-                    else if (type == "get_room_polls") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            bool activeOnly = msg.value("activeOnly", false);
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db) {
-                                auto polls = db->getRoomPolls(roomId, activeOnly);
-                                json pollsJson = json::array();
-                                
-                                for (const auto& poll : polls) {
-                                    json optionsJson = json::array();
-                                    for (const auto& opt : poll.options) {
-                                        json votersJson = json::array();
-                                        for (size_t i = 0; i < opt.voterIds.size(); i++) {
-                                            votersJson.push_back(opt.voterNames[i]);
-                                        }
-                                        optionsJson.push_back({
-                                            {"id", opt.optionId},
-                                            {"text", opt.text},
-                                            {"votes", opt.voteCount},
-                                            {"voters", votersJson}
-                                        });
-                                    }
-                                    pollsJson.push_back({
-                                        {"id", poll.pollId},
-                                        {"question", poll.question},
-                                        {"options", optionsJson},
-                                        {"createdBy", poll.createdBy},
-                                        {"createdAt", poll.createdAt},
-                                        {"isClosed", poll.isClosed}
-                                    });
-                                }
-                                
-                                json response = {
-                                    {"type", "room_polls"},
-                                    {"roomId", roomId},
-                                    {"polls", pollsJson}
-                                };
-                                sendJsonMessage((void*)ws, response.dump());
-                            }
-                        }
-                    }
-                    // ============== Games ==============
-                    else if (type == "game_invite") {
-                        if (data->authenticated) {
-                            std::string gameType = msg.value("gameType", "tictactoe");
-                            std::string opponentId = msg.value("opponentId", "");
-                            std::string gameId = "game-" + std::to_string(std::time(nullptr)) + "-" + std::to_string(rand());
-                            
-                            // Store pending invite
-                            json gameInfo = {
-                                {"gameId", gameId},
-                                {"gameType", gameType},
-                                {"inviter", data->userId},
-                                {"inviterName", data->username},
-                                {"invitee", opponentId}
-                            };
-                            
-                            json inviteMsg = {
-                                {"type", "game_invite"},
-                                {"gameId", gameId},
-                                {"gameType", gameType},
-                                {"fromUser", data->username},
-                                {"fromUserId", data->userId}
-                            };
-                            
-                            // Send to opponent
-                            sendToUser(opponentId, inviteMsg.dump());
-                            Logger::info("🎮 Game invite from " + data->username + " to " + opponentId);
-                        }
-                    }
-                    else if (type == "game_accept") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            std::string inviterId = msg.value("fromUserId", "");
-                            
-                            // Create initial game state
-                            json gameState = {
-                                {"id", gameId},
-                                {"type", "tictactoe"},
-                                {"board", json::array({"", "", "", "", "", "", "", "", ""})},
-                                {"currentTurn", "X"},
-                                {"players", {{"X", inviterId}, {"O", data->userId}}},
-                                {"winner", nullptr},
-                                {"status", "playing"}
-                            };
-                            
-                            json gameStartMsg = {
-                                {"type", "game_start"},
-                                {"gameId", gameId},
-                                {"game", gameState}
-                            };
-                            
-                            std::string gameMsg = gameStartMsg.dump();
-                            
-                            // Send to both players explicitly
-                            sendToUser(inviterId, gameMsg);  // Send to inviter (X player)
-                            sendToUser(data->userId, gameMsg);  // Send to accepter (O player)
-                            
-                            Logger::info("🎮 Game started: " + gameId + " between " + inviterId + " and " + data->userId);
-                        }
-                    }
-                    else if (type == "game_reject") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            json rejectMsg = {
-                                {"type", "game_rejected"},
-                                {"gameId", gameId}
-                            };
-                            broadcast(rejectMsg.dump());
-                            Logger::info("🎮 Game rejected: " + gameId);
-                        }
-                    }
-                    else if (type == "game_move") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            int position = msg.value("position", -1);
-                            
-                            // Broadcast move to all connected users (they will filter by gameId)
-                            json moveMsg = {
-                                {"type", "game_move"},
-                                {"gameId", gameId},
-                                {"position", position},
-                                {"playerId", data->userId}
-                            };
-                            broadcast(moveMsg.dump());
-                            Logger::info("🎮 Game move in " + gameId + " at position " + std::to_string(position) + " by " + data->userId);
-                        }
-                    }
-                    // ============== Watch Together ==============
-                    else if (type == "watch_create") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            std::string videoUrl = msg.value("videoUrl", "");
-                            
-                            json watchMsg = {
-                                {"type", "watch_session_created"},
-                                {"roomId", roomId},
-                                {"videoUrl", videoUrl},
-                                {"createdBy", data->username},
-                                {"viewerCount", 1}
-                            };
-                            broadcastToRoom(roomId, watchMsg.dump(), "");
-                            Logger::info("📺 Watch session created by " + data->username);
-                        }
-                    }
-                    else if (type == "watch_sync") {
-                        if (data->authenticated) {
-                            std::string action = msg.value("action", "");
-                            double time = msg.value("time", 0.0);
-                            
-                            json syncMsg = {
-                                {"type", "watch_sync"},
-                                {"action", action},
-                                {"time", time},
-                                {"syncedBy", data->username}
-                            };
-                            broadcast(syncMsg.dump());
-                        }
-                    }
-                    else if (type == "watch_end") {
-                        if (data->authenticated) {
-                            json endMsg = {
-                                {"type", "watch_ended"}
-                            };
-                            broadcast(endMsg.dump());
-                            Logger::info("📺 Watch session ended");
-                        }
-                    }
-                    // ============== Chunked File Upload ==============
-                    else if (type == "upload_init") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            Logger::info("📤 Upload init from " + data->username);
-                            
-                            // Call FileHandler to initialize upload
-                            fileHandler_->handleUploadInit((void*)ws, msg, data->userId, roomId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "upload_chunk") {
-                        if (data->authenticated) {
-                            std::string uploadId = msg.value("uploadId", "");
-                            int chunkIndex = msg.value("chunkIndex", 0);
-                            Logger::debug("📦 Upload chunk " + std::to_string(chunkIndex) + " from " + data->username);
-                            
-                            // Call FileHandler to process chunk
-                            fileHandler_->handleUploadChunk((void*)ws, msg, data->userId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "upload_finalize") {
-                        if (data->authenticated) {
-                            std::string uploadId = msg.value("uploadId", "");
-                            Logger::info("✅ Upload finalize from " + data->username + " (" + uploadId + ")");
-                            
-                            // Call FileHandler to finalize upload
-                            fileHandler_->handleUploadFinalize((void*)ws, msg, data->userId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Forward Message ==============
-                    else if (type == "forward_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string targetRoomId = msg.value("targetRoomId", "");
-                            
-                            if (messageId.empty() || targetRoomId.empty()) {
-                                sendErrorJson((void*)ws, "messageId and targetRoomId required");
-                            } else {
-                                // Get original message from database
-                                auto originalMsg = dbClient_->getMessage(messageId);
-                                if (originalMsg) {
-                                    // Create forwarded message
-                                    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                                    std::string newMsgId = "msg-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                                    
-                                    Message forwardedMsg;
-                                    forwardedMsg.messageId = newMsgId;
-                                    forwardedMsg.roomId = targetRoomId;
-                                    forwardedMsg.senderId = data->userId;
-                                    forwardedMsg.senderName = data->username;
-                                    forwardedMsg.content = originalMsg->content;
-                                    forwardedMsg.timestamp = now;
-                                    forwardedMsg.metadata = "{\"forwarded_from\": \"" + messageId + "\", \"original_sender\": \"" + originalMsg->senderName + "\"}";
-                                    
-                                    if (dbClient_->createMessage(forwardedMsg)) {
-                                        json response = {
-                                            {"type", "message_forwarded"},
-                                            {"messageId", newMsgId},
-                                            {"originalMessageId", messageId},
-                                            {"targetRoomId", targetRoomId},
-                                            {"content", originalMsg->content},
-                                            {"forwardedBy", data->username},
-                                            {"originalSender", originalMsg->senderName},
-                                            {"timestamp", now * 1000}
-                                        };
-                                        
-                                        broadcastToRoom(targetRoomId, response.dump());
-                                        sendJsonMessage((void*)ws, json({{"type", "forward_success"}, {"messageId", newMsgId}}).dump());
-                                        Logger::info("↗️ Message forwarded by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to forward message");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "Original message not found");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Block/Unblock User ==============
-                    else if (type == "user_block") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            
-                            if (targetUserId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId required");
-                            } else if (targetUserId == data->userId) {
-                                sendErrorJson((void*)ws, "Cannot block yourself");
-                            } else {
-                                if (dbClient_->blockUser(data->userId, targetUserId)) {
-                                    json response = {
-                                        {"type", "user_blocked"},
-                                        {"targetUserId", targetUserId},
-                                        {"success", true}
-                                    };
-                                    sendJsonMessage((void*)ws, response.dump());
-                                    Logger::info("🚫 User " + data->username + " blocked " + targetUserId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to block user");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "user_unblock") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            
-                            if (targetUserId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId required");
-                            } else {
-                                if (dbClient_->unblockUser(data->userId, targetUserId)) {
-                                    json response = {
-                                        {"type", "user_unblocked"},
-                                        {"targetUserId", targetUserId},
-                                        {"success", true}
-                                    };
-                                    sendJsonMessage((void*)ws, response.dump());
-                                    Logger::info("✅ User " + data->username + " unblocked " + targetUserId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to unblock user");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "get_blocked_users") {
-                        if (data->authenticated) {
-                            auto blockedUsers = dbClient_->getBlockedUsers(data->userId);
-                            json response = {
-                                {"type", "blocked_users_list"},
-                                {"blockedUsers", blockedUsers}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Kick User from Room ==============
-                    else if (type == "kick_user") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            if (targetUserId.empty() || roomId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId and roomId required");
-                            } else {
-                                // Check if user has permission (owner or admin)
-                                std::string role = dbClient_->getMemberRole(roomId, data->userId);
-                                if (role == "owner" || role == "admin") {
-                                    // Remove user from room
-                                    if (dbClient_->removeRoomMember(roomId, targetUserId)) {
-                                        // Notify kicked user
-                                        json kickNotify = {
-                                            {"type", "kicked_from_room"},
-                                            {"roomId", roomId},
-                                            {"kickedBy", data->username}
-                                        };
-                                        sendToUser(targetUserId, kickNotify.dump());
-                                        
-                                        // Notify room
-                                        json roomNotify = {
-                                            {"type", "user_kicked"},
-                                            {"roomId", roomId},
-                                            {"targetUserId", targetUserId},
-                                            {"kickedBy", data->username}
-                                        };
-                                        broadcastToRoom(roomId, roomNotify.dump());
-                                        
-                                        json response = {
-                                            {"type", "kick_success"},
-                                            {"targetUserId", targetUserId},
-                                            {"roomId", roomId}
-                                        };
-                                        sendJsonMessage((void*)ws, response.dump());
-                                        Logger::info("👢 User " + targetUserId + " kicked from " + roomId + " by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to kick user");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "No permission to kick users");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Invite User to Room ==============
-                    else if (type == "invite_user") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            if (targetUserId.empty() || roomId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId and roomId required");
-                            } else {
-                                // Check if inviter is member of room
-                                auto members = dbClient_->getRoomMembers(roomId);
-                                bool isMember = std::find(members.begin(), members.end(), data->userId) != members.end();
-                                
-                                if (isMember) {
-                                    // Add user to room
-                                    if (dbClient_->addRoomMember(roomId, targetUserId)) {
-                                        // Get room info
-                                        auto room = dbClient_->getRoom(roomId);
-                                        std::string roomName = room ? room->name : roomId;
-                                        
-                                        // Notify invited user
-                                        json inviteNotify = {
-                                            {"type", "room_invitation"},
-                                            {"roomId", roomId},
-                                            {"roomName", roomName},
-                                            {"invitedBy", data->username}
-                                        };
-                                        sendToUser(targetUserId, inviteNotify.dump());
-                                        
-                                        // Notify room
-                                        json roomNotify = {
-                                            {"type", "user_invited"},
-                                            {"roomId", roomId},
-                                            {"targetUserId", targetUserId},
-                                            {"invitedBy", data->username}
-                                        };
-                                        broadcastToRoom(roomId, roomNotify.dump());
-                                        
-                                        json response = {
-                                            {"type", "invite_success"},
-                                            {"targetUserId", targetUserId},
-                                            {"roomId", roomId}
-                                        };
-                                        sendJsonMessage((void*)ws, response.dump());
-                                        Logger::info("📨 User " + targetUserId + " invited to " + roomId + " by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to invite user (maybe already member)");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "You must be a room member to invite others");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Sticker Message ==============
-                    else if (type == "chat_sticker") {
-                        if (data->authenticated) {
-                            std::string sticker = msg.value("sticker", "");
-                            std::string roomId = msg.value("roomId", "global");
-                            
-                            if (sticker.empty()) {
-                                sendErrorJson((void*)ws, "sticker required");
-                            } else {
-                                uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                                std::string messageId = "sticker-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                                
-                                Message stickerMsg;
-                                stickerMsg.messageId = messageId;
-                                stickerMsg.roomId = roomId;
-                                stickerMsg.senderId = data->userId;
-                                stickerMsg.senderName = data->username;
-                                stickerMsg.content = "[sticker:" + sticker + "]";
-                                stickerMsg.timestamp = now;
-                                stickerMsg.metadata = "{\"type\": \"sticker\", \"sticker\": \"" + sticker + "\"}";
-                                
-                                if (dbClient_->createMessage(stickerMsg)) {
-                                    json response = {
-                                        {"type", "chat"},
-                                        {"messageType", "sticker"},
-                                        {"messageId", messageId},
-                                        {"roomId", roomId},
-                                        {"userId", data->userId},
-                                        {"username", data->username},
-                                        {"sticker", sticker},
-                                        {"timestamp", now * 1000}
-                                    };
-                                    std::string responseStr = response.dump();
-                                    sendJsonMessage((void*)ws, responseStr);  // Echo to sender
-                                    broadcastToRoom(roomId, responseStr, data->userId);  // Broadcast to others
-                                    Logger::info("🎨 Sticker sent by " + data->username);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to send sticker");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Location Message ==============
-                    else if (type == "chat_location") {
-                        if (data->authenticated) {
-                            double latitude = msg.value("latitude", 0.0);
-                            double longitude = msg.value("longitude", 0.0);
-                            std::string roomId = msg.value("roomId", "global");
-                            
-                            if (latitude == 0.0 && longitude == 0.0) {
-                                sendErrorJson((void*)ws, "latitude and longitude required");
-                            } else {
-                                uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                                std::string messageId = "loc-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                                
-                                std::string locationStr = std::to_string(latitude) + "," + std::to_string(longitude);
-                                
-                                Message locMsg;
-                                locMsg.messageId = messageId;
-                                locMsg.roomId = roomId;
-                                locMsg.senderId = data->userId;
-                                locMsg.senderName = data->username;
-                                locMsg.content = "[location:" + locationStr + "]";
-                                locMsg.timestamp = now;
-                                locMsg.metadata = "{\"type\": \"location\", \"latitude\": " + std::to_string(latitude) + ", \"longitude\": " + std::to_string(longitude) + "}";
-                                
-                                if (dbClient_->createMessage(locMsg)) {
-                                    json response = {
-                                        {"type", "chat"},
-                                        {"messageType", "location"},
-                                        {"messageId", messageId},
-                                        {"roomId", roomId},
-                                        {"userId", data->userId},
-                                        {"username", data->username},
-                                        {"latitude", latitude},
-                                        {"longitude", longitude},
-                                        {"timestamp", now * 1000}
-                                    };
-                                    std::string responseStr = response.dump();
-                                    sendJsonMessage((void*)ws, responseStr);  // Echo to sender
-                                    broadcastToRoom(roomId, responseStr, data->userId);  // Broadcast to others
-                                    Logger::info("📍 Location sent by " + data->username);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to send location");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else {
-                        Logger::warning("Unknown message type: " + type);
-                        sendErrorJson((void*)ws, "Unknown message type");
-                    }
-                    
-                } catch (const json::exception& e) {
-                    Logger::error("JSON parse error: " + std::string(e.what()));
-                    sendErrorJson((void*)ws, "Invalid JSON");
-                } catch (const std::exception& e) {
-                    Logger::error("Message handling error: " + std::string(e.what()));
-                    sendErrorJson((void*)ws, "Internal error");
-                }
-            },
-            
-            .drain = [](auto* ws) {},
-            .ping = [](auto* ws, std::string_view) {},
-            .pong = [](auto* ws, std::string_view) {},
-            
-            // Connection closed
-            .close = [this](auto* ws, int code, std::string_view message) {
-                PerSocketData* data = ws->getUserData();
-                
-                if (data->authenticated) {
-                    Logger::info("Client disconnected: " + data->username);
-                    
-                    // Update user status to offline in database
-                    try {
-                        dbClient_->updateUserStatus(data->userId, 0);  // 0 = offline
-                        Logger::debug("Updated " + data->username + " status to offline");
-                    } catch (const std::exception& e) {
-                        Logger::warning("Failed to update offline status: " + std::string(e.what()));
-                    }
-                    
-                    // Broadcast offline presence to other users
-                    json offlineMsg = {
-                        {"type", "presence_update"},
-                        {"userId", data->userId},
-                        {"username", data->username},
-                        {"status", "offline"}
-                    };
-                    
-                    // Broadcast to all other connections
-                    {
-                        std::lock_guard<std::mutex> lock(connectionsMutex_);
-                        for (const auto& [key, state] : connections_) {
-                            if (state.authenticated && state.wsPtr && state.userId != data->userId) {
-                                auto* otherWs = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-                                otherWs->send(offlineMsg.dump(), uWS::OpCode::TEXT);
+                    // Broadcast to all other connections (shed under load)
+                    if (loadGovernor_.allowPresence()) {
+                        ProfiledLock lock(connectionsMutex_);
+                        for (const auto& [key, state] : connections_) {
+                            if (state.authenticated && state.wsPtr && state.userId != data->userId) {
+                                sendTracked(state.wsPtr, offlineMsg.dump());
                             }
                         }
                     }
@@ -1553,1173 +794,4934 @@ void WebSocketServer::run() {
                 }
                 
                 // Remove connection
+                channelFanout_.unsubscribeAll((void*)ws);
+                releaseChunkedUploads((void*)ws);
                 {
-                    std::lock_guard<std::mutex> lock(connectionsMutex_);
+                    ProfiledLock lock(connectionsMutex_);
                     connections_.erase((void*)ws);
                 }
             }
-        });
+        });
+        
+        // GET /exports/:jobId?dl= - download a finished export (chunked); authorized by the
+        // single-use token from downloadUrl or by Authorization: Bearer <session token>
+        app.get("/exports/:jobId", [this, addCors](auto* res, auto* req) {
+            std::string jobId = std::string(req->getParameter(0));
+            std::string authHeader = std::string(req->getHeader("authorization"));
+            std::string downloadToken = std::string(req->getQuery("dl"));
+            std::optional<std::string> userId;
+            if (authHeader.rfind("Bearer ", 0) == 0) {
+                auto sessionInfo = authManager_->getSessionFromToken(authHeader.substr(7));
+                if (sessionInfo) userId = sessionInfo->userId;
+            } else if (!downloadToken.empty()) {
+                userId = redeemDownloadToken(downloadToken, jobId);
+            }
+            
+            addCors(res);
+            if (!userId) {
+                res->writeStatus("401 Unauthorized")->end("Invalid token");
+                return;
+            }
+            
+            auto job = exporter_ ? exporter_->getJob(jobId) : std::nullopt;
+            if (!job || job->requestedBy != *userId || job->path.empty()) {
+                res->writeStatus("404 Not Found")->end("Export not found");
+                return;
+            }
+            if (job->state != RoomExporter::JobState::Completed) {
+                res->writeStatus("409 Conflict")->end(std::string("Export is ") + RoomExporter::stateName(job->state));
+                return;
+            }
+            
+            auto file = std::make_shared<std::ifstream>(job->path, std::ios::binary);
+            if (!*file) {
+                res->writeStatus("410 Gone")->end("Export file removed");
+                return;
+            }
+            
+            auto aborted = std::make_shared<bool>(false);
+            res->onAborted([aborted]() { *aborted = true; });
+            res->writeHeader("Content-Type", "application/gzip");
+            res->writeHeader("Content-Disposition", "attachment; filename=\"" + exportFileName(job->roomId) + "\"");
+            pumpExportFile(res, file, aborted);
+        });
+        
+        // GET /export/room/:roomId - stream a live export (gzip JSONL, chunked)
+        // Authorization: Bearer <session token>
+        app.get("/export/room/:roomId", [this, addCors](auto* res, auto* req) {
+            std::string roomId = urlDecode(std::string(req->getParameter(0)));
+            std::string authHeader = std::string(req->getHeader("authorization"));
+            std::optional<SessionInfo> sessionInfo;
+            if (authHeader.rfind("Bearer ", 0) == 0) {
+                sessionInfo = authManager_->getSessionFromToken(authHeader.substr(7));
+            }
+            
+            addCors(res);
+            if (!sessionInfo) {
+                res->writeStatus("401 Unauthorized")->end("Invalid token");
+                return;
+            }
+            
+            auto storageRoomId = exporter_ ? resolveExportRoom(sessionInfo->userId, roomId) : std::nullopt;
+            if (!storageRoomId) {
+                res->writeStatus("403 Forbidden")->end("Not allowed to export this room");
+                return;
+            }
+            
+            auto stream = std::make_shared<HttpExportStream>();
+            
+            // Job thread: queue compressed chunks, wait while too much is pending
+            auto sink = [this, res, stream](std::string_view chunk) {
+                std::unique_lock<std::mutex> lock(stream->mutex);
+                while (stream->queuedBytes >= HttpExportStream::MAX_QUEUED && !stream->aborted) {
+                    if (exporter_->isStopping()) return false;
+                    stream->cv.wait_for(lock, std::chrono::milliseconds(100));
+                }
+                if (stream->aborted) return false;
+                
+                stream->queue.emplace_back(chunk);
+                stream->queuedBytes += chunk.size();
+                bool schedule = !stream->scheduled;
+                stream->scheduled = true;
+                lock.unlock();
+                
+                if (schedule) {
+                    runOnLoop([res, stream]() { flushExportStream(res, stream); });
+                }
+                return true;
+            };
+            
+            auto onProgress = [this, res, stream](const RoomExporter::JobStatus& status) {
+                if (status.state == RoomExporter::JobState::Running) return;
+                {
+                    std::lock_guard<std::mutex> lock(stream->mutex);
+                    stream->finished = true;
+                }
+                runOnLoop([res, stream]() { flushExportStream(res, stream); });
+            };
+            
+            res->onAborted([stream]() {
+                std::lock_guard<std::mutex> lock(stream->mutex);
+                stream->aborted = true;
+                stream->cv.notify_all();
+            });
+            res->onWritable([res, stream](uint64_t) {
+                {
+                    std::lock_guard<std::mutex> lock(stream->mutex);
+                    stream->blocked = false;
+                }
+                flushExportStream(res, stream);
+                return true;
+            });
+            
+            auto jobId = exporter_->startStreamExport(*storageRoomId, sessionInfo->userId, sink, onProgress);
+            if (!jobId) {
+                res->writeStatus("503 Service Unavailable")
+                   ->writeHeader("Retry-After", "30")
+                   ->end("Too many exports running");
+                return;
+            }
+            
+            res->writeHeader("Content-Type", "application/gzip");
+            res->writeHeader("Content-Disposition", "attachment; filename=\"" + exportFileName(roomId) + "\"");
+            res->writeHeader("X-Export-Job", *jobId);
+        });
+        
+        // GET /admin/stats?roomId= - activity analytics (Authorization: Bearer <ADMIN_TOKEN>)
+        app.get("/admin/stats", [this, addCors](auto* res, auto* req) {
+            addCors(res);
+            if (!bearerMatches(req->getHeader("authorization"), adminToken_)) {
+                res->writeStatus("403 Forbidden")->end("Forbidden");
+                return;
+            }
+            
+            uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+            std::string roomId = urlDecode(std::string(req->getQuery("roomId")));
+            json stats = roomId.empty() ? activityStats_.serverSnapshot(now)
+                                        : activityStats_.roomSnapshot(roomId, now);
+            if (stats.is_null()) {
+                res->writeStatus("404 Not Found")->end("No recent activity for this room");
+                return;
+            }
+            if (roomId.empty()) {
+                // Message compression since start: bytes saved on write, inflate cost on read
+                auto codec = message_codec::stats();
+                stats["compression"] = {
+                    {"valuesCompressed", codec.valuesCompressed},
+                    {"valuesSkipped", codec.valuesSkipped},
+                    {"rawBytes", codec.rawBytes},
+                    {"storedBytes", codec.storedBytes},
+                    {"savedBytes", codec.rawBytes - codec.storedBytes},
+                    {"valuesInflated", codec.valuesInflated},
+                    {"inflateMicros", codec.inflateMicros},
+                    {"avgInflateMicros", codec.valuesInflated ? static_cast<double>(codec.inflateMicros) / codec.valuesInflated : 0.0}
+                };
+                auto hooks = webhooks_->stats();
+                stats["webhooks"] = {
+                    {"endpoints", hooks.endpoints},
+                    {"eventsPending", hooks.eventsPending},
+                    {"eventsDelivered", hooks.eventsDelivered},
+                    {"batchesDelivered", hooks.batchesDelivered},
+                    {"retries", hooks.retries},
+                    {"eventsDeadLettered", hooks.eventsDeadLettered}
+                };
+                auto ai = aiExecutor_->stats();
+                stats["ai"] = {
+                    {"tasksSubmitted", ai.submitted},
+                    {"tasksCompleted", ai.completed},
+                    {"tasksRejected", ai.rejected},
+                    {"queued", ai.queued},
+                    {"running", ai.running}
+                };
+                if (summarizer_) {
+                    auto summaries = summarizer_->stats();
+                    stats["ai"]["summaries"] = {
+                        {"rooms", summaries.rooms},
+                        {"folds", summaries.folds},
+                        {"foldFailures", summaries.foldFailures},
+                        {"foldsRejected", summaries.foldsRejected},
+                        {"messagesFolded", summaries.messagesFolded},
+                        {"messagesDropped", summaries.messagesDropped}
+                    };
+                }
+                if (translator_) {
+                    auto translations = translator_->stats();
+                    stats["ai"]["translations"] = {
+                        {"requested", translations.requested},
+                        {"cacheHits", translations.cacheHits},
+                        {"coalesced", translations.coalesced},
+                        {"aiCalls", translations.aiCalls},
+                        {"translated", translations.translated},
+                        {"failed", translations.failed},
+                        {"rejected", translations.rejected},
+                        {"invalidated", translations.invalidated}
+                    };
+                }
+                if (linkPreviews_) {
+                    auto previews = linkPreviews_->stats();
+                    stats["linkPreviews"] = {
+                        {"requests", previews.requests},
+                        {"cacheHits", previews.cacheHits},
+                        {"coalesced", previews.coalesced},
+                        {"fetched", previews.fetched},
+                        {"failed", previews.failed},
+                        {"dropped", previews.dropped},
+                        {"inFlight", previews.inFlight},
+                        {"queued", previews.queued}
+                    };
+                }
+                if (semanticIndex_) {
+                    auto semantic = semanticIndex_->stats();
+                    stats["semanticSearch"] = {
+                        {"vectors", semantic.vectors},
+                        {"fileBytes", semantic.fileBytes},
+                        {"queued", semantic.queued},
+                        {"indexed", semantic.indexed},
+                        {"removed", semantic.removed},
+                        {"compacted", semantic.compacted},
+                        {"skipped", semantic.skipped},
+                        {"dropped", semantic.dropped},
+                        {"backfilling", semantic.backfilling},
+                        {"backfilled", semantic.backfilled},
+                        {"embedBatches", semantic.embedBatches},
+                        {"embedFailures", semantic.embedFailures},
+                        {"avgEmbedBatchMs", semantic.embedBatches ? semantic.embedMicros / 1000.0 / semantic.embedBatches : 0.0},
+                        {"queries", semantic.queries},
+                        {"queryCacheHits", semantic.queryCacheHits},
+                        {"avgQueryEmbedMs", semantic.queries > semantic.queryCacheHits
+                            ? semantic.queryEmbedMicros / 1000.0 / (semantic.queries - semantic.queryCacheHits) : 0.0},
+                        {"avgSearchMs", semantic.queries ? semantic.searchMicros / 1000.0 / semantic.queries : 0.0}
+                    };
+                }
+                auto load = loadGovernor_.stats();
+                stats["load"] = {
+                    {"level", LoadGovernor::levelName(loadGovernor_.level())},
+                    {"loopLagMs", load.loopLagMs},
+                    {"maxLoopLagMs", load.maxLoopLagMs},
+                    {"dbQueueDepth", load.dbQueueDepth},
+                    {"bufferedBytes", load.bufferedBytes},
+                    {"transitions", load.transitions},
+                    {"typingDropped", load.typingDropped},
+                    {"presenceDropped", load.presenceDropped},
+                    {"deferred", load.deferred},
+                    {"deferredPending", deferredOps_.size()},
+                    {"rejected", load.rejected},
+                    {"loginsThrottled", load.loginsThrottled}
+                };
+                stats["locks"] = lockProfileJson();
+                if (req->getQuery("resetLocks") == "1") {
+                    lock_profiler::reset();
+                }
+            }
+            res->writeHeader("Content-Type", "application/json")->end(stats.dump());
+        });
+        
+        // HTTP health check
+        app.get("/health", [this](auto* res, auto* req) {
+            // 503 while caches warm up, so load balancers hold traffic back
+            if (!warm_) {
+                res->writeStatus("503 Service Unavailable")
+                   ->writeHeader("Content-Type", "application/json")
+                   ->writeHeader("Retry-After", "5")
+                   ->end("{\"status\":\"starting\",\"service\":\"chatbox-websocket\"}");
+                return;
+            }
+            json health = {
+                {"status", "ok"},
+                {"service", "chatbox-websocket"},
+                {"load", LoadGovernor::levelName(loadGovernor_.level())}
+            };
+            res->writeStatus("200 OK")
+               ->writeHeader("Content-Type", "application/json")
+               ->end(health.dump());
+        });
+        
+        // Listen
+        app.listen(port_, [this](auto* listenSocket) {
+            if (listenSocket) {
+                Logger::info("========================================");
+                Logger::info("✅ WebSocket server LIVE!");
+                Logger::info("========================================"); 
+                Logger::info("Listening on: 0.0.0.0:" + std::to_string(port_));
+                Logger::info("WebSocket: ws://localhost:" + std::to_string(port_) + "/");
+                Logger::info("Health: http://localhost:" + std::to_string(port_) + "/health");
+                Logger::info("");
+                Logger::info("Protocol: ChatBox v1");
+                Logger::info("  - register: Create new account");
+                Logger::info("  - login: Authenticate user");
+                Logger::info("  - chat: Send message");
+                Logger::info("  - ping: Keep-alive");
+                Logger::info("========================================");
+                Logger::info("");
+                Logger::info("Ready for protocol messages! 🚀");
+                Logger::info("");
+            } else {
+                Logger::error("❌ Failed to listen on port " + std::to_string(port_));
+                running_ = false;
+            }
+        });
+        
+        app.run();
+        if (uploadTimer_) {
+            us_timer_close(uploadTimer_);
+            uploadTimer_ = nullptr;
+        }
+        if (loadTimer_) {
+            us_timer_close(loadTimer_);
+            loadTimer_ = nullptr;
+        }
+        if (warmupThread_.joinable()) warmupThread_.join();
+        if (linkPreviews_) linkPreviews_->stop();
+        if (semanticIndex_) semanticIndex_->stop();
+        aiExecutor_->stop();
+        roomActors_.stop();
+        stopExpiryPurger();
+        webhooks_->stop();
+        if (exporter_) exporter_->stop();
+        
+    } catch (const std::exception& e) {
+        Logger::error("WebSocket server error: " + std::string(e.what()));
+        running_ = false;
+        if (warmupThread_.joinable()) warmupThread_.join();
+        if (linkPreviews_) linkPreviews_->stop();
+        if (semanticIndex_) semanticIndex_->stop();
+        aiExecutor_->stop();
+        roomActors_.stop();
+        stopExpiryPurger();
+        webhooks_->stop();
+        if (exporter_) exporter_->stop();
+    }
+    
+    Logger::info("WebSocket server stopped");
+}
+
+void WebSocketServer::stop() {
+    if (running_) {
+        running_ = false;
+        Logger::info("Stopping WebSocket server...");
+    }
+}
+
+// Protocol message handlers
+
+void WebSocketServer::dispatchMessage(void* wsPtr, const std::string& msgStr) {
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    PerSocketData* data = ws->getUserData();
+    
+    try {
+        // Parse JSON message
+        json msg = json::parse(msgStr);
+        std::string type = msg.value("type", "");
+        
+        Logger::info("📨 Message type: " + type);
+        
+        if (shedOrDefer(wsPtr, type, msgStr)) {
+            return;
+        }
+        
+        if (type == "register") {
+            handleRegisterJson((void*)ws, msgStr);
+        }
+        else if (type == "login") {
+            handleLoginJson((void*)ws, msgStr);
+        }
+        else if (type == "auth") {
+            // Authenticate WebSocket with existing JWT token
+            std::string token = msg.value("token", "");
+            if (!token.empty()) {
+                auto sessionInfo = authManager_->getSessionFromToken(token);
+                if (sessionInfo) {
+                    if (!data->authenticated) {
+                        membershipIndex_.userConnected(sessionInfo->userId);
+                    }
+                    data->authenticated = true;
+                    data->userId = sessionInfo->userId;
+                    data->username = sessionInfo->username;
+                    data->sessionId = "ws-session-" + sessionInfo->userId;
+                    
+                    // IMPORTANT: Also update connections_ map for sendToUser to work
+                    {
+                        ProfiledLock lock(connectionsMutex_);
+                        connections_[(void*)ws].authenticated = true;
+                        connections_[(void*)ws].userId = sessionInfo->userId;
+                        connections_[(void*)ws].username = sessionInfo->username;
+                    }
+                    
+                    json response = {
+                        {"type", "auth_response"},
+                        {"success", true},
+                        {"userId", sessionInfo->userId},
+                        {"username", sessionInfo->username}
+                    };
+                    sendJsonMessage((void*)ws, response.dump());
+                    Logger::info("✓ WebSocket authenticated via token: " + sessionInfo->username);
+                    
+                    // Auto-send online users list after auth success (skipped under load)
+                    if (loadGovernor_.allowPresence()) {
+                        handleGetOnlineUsersJson((void*)ws);
+                    }
+                } else {
+                    sendErrorJson((void*)ws, "Invalid token");
+                    Logger::warning("✗ WebSocket auth failed: invalid token");
+                }
+            } else {
+                sendErrorJson((void*)ws, "Token required");
+            }
+        }
+        else if (type == "chat") {
+            if (data->authenticated) {
+                handleChatMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "typing") {
+            if (data->authenticated && loadGovernor_.allowTyping()) {
+                handleTypingJson((void*)ws, msgStr);
+            }
+        }
+        else if (type == "get_online_users") {
+            if (data->authenticated) {
+                if (loadGovernor_.allowOnlineScan()) {
+                    handleGetOnlineUsersJson((void*)ws);
+                } else {
+                    sendServerBusy((void*)ws, type, 5);
+                }
+            }
+        }
+        else if (type == "search_users") {
+            if (data->authenticated) {
+                handleSearchUsersJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "edit_message") {
+            if (data->authenticated) {
+                handleEditMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "delete_message") {
+            if (data->authenticated) {
+                handleDeleteMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "add_reaction") {
+            if (data->authenticated) {
+                std::string messageId = msg.value("messageId", "");
+                std::string emoji = msg.value("emoji", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                json response = {
+                    {"type", "reaction_added"},
+                    {"messageId", messageId},
+                    {"emoji", emoji},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username}
+                };
+                
+                // Send to sender
+                sendJsonMessage((void*)ws, response.dump());
+                // Broadcast to room
+                broadcastToRoom(roomId, response.dump(), data->userId);
+                Logger::info("👍 Reaction added by " + data->username + ": " + emoji);
+            }
+        }
+        else if (type == "pin_message") {
+            if (data->authenticated) {
+                std::string messageId = msg.value("messageId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                json response = {
+                    {"type", "message_pinned"},
+                    {"messageId", messageId},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username}
+                };
+                
+                sendJsonMessage((void*)ws, response.dump());
+                broadcastToRoom(roomId, response.dump(), data->userId);
+                Logger::info("📌 Message pinned by " + data->username);
+            }
+        }
+        else if (type == "unpin_message") {
+            if (data->authenticated) {
+                std::string messageId = msg.value("messageId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                json response = {
+                    {"type", "message_unpinned"},
+                    {"messageId", messageId},
+                    {"roomId", roomId}
+                };
+                
+                sendJsonMessage((void*)ws, response.dump());
+                broadcastToRoom(roomId, response.dump(), data->userId);
+                Logger::info("📌 Message unpinned by " + data->username);
+            }
+        }
+        else if (type == "reply_message") {
+            if (data->authenticated) {
+                handleReplyMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "get_thread") {
+            if (data->authenticated) {
+                handleGetThreadJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "create_room") {
+            if (data->authenticated) {
+                handleCreateRoomJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "join_room") {
+            if (data->authenticated) {
+                handleJoinRoomJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "leave_room") {
+            if (data->authenticated) {
+                handleLeaveRoomJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "get_members") {
+            if (data->authenticated) {
+                handleGetMembersJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "get_rooms") {
+            if (data->authenticated) {
+                handleGetRoomsJson((void*)ws);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "search_messages") {
+            if (data->authenticated) {
+                handleSearchMessagesJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "mark_read") {
+            if (data->authenticated) {
+                handleMarkReadJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "ping") {
+            // Respond with pong
+            json response = {
+                {"type", "pong"},
+                {"timestamp", std::time(nullptr)}
+            };
+            std::string responseStr = response.dump();
+            sendJsonMessage((void*)ws, responseStr);
+        }
+        else if (type == "batch") {
+            if (data->authenticated) {
+                handleBatchJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== WebRTC Call Signaling ==============
+        else if (type == "call_init") {
+            if (data->authenticated) {
+                std::string targetId = msg.value("targetId", "");
+                std::string callType = msg.value("callType", "video");
+                
+                // Generate a simple call ID
+                std::string callId = "call-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
+                
+                // Send call_incoming directly to target user
+                json incomingCall = {
+                    {"type", "call_incoming"},
+                    {"callId", callId},
+                    {"callerId", data->userId},
+                    {"callerName", data->username},
+                    {"callType", callType}
+                };
+                sendToUser(targetId, incomingCall.dump());
+                
+                // Send confirmation to caller
+                json response = {
+                    {"type", "call_init_response"},
+                    {"success", true},
+                    {"callId", callId},
+                    {"message", "Calling " + targetId + "..."}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("📞 Call initiated by " + data->username + " to " + targetId + " (callId: " + callId + ")");
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "call_accept") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string callerId = msg.value("callerId", "");
+                
+                // Send call_accepted to caller
+                json acceptMsg = {
+                    {"type", "call_accepted"},
+                    {"callId", callId},
+                    {"accepterId", data->userId},
+                    {"accepterName", data->username}
+                };
+                sendToUser(callerId, acceptMsg.dump());
+                
+                json response = {
+                    {"type", "call_accept_response"},
+                    {"success", true},
+                    {"message", "Call accepted"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("✅ Call accepted: " + callId);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "call_reject") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string callerId = msg.value("callerId", "");
+                std::string reason = msg.value("reason", "declined");
+                
+                // Send call_rejected to caller
+                json rejectMsg = {
+                    {"type", "call_rejected"},
+                    {"callId", callId},
+                    {"rejecterId", data->userId},
+                    {"reason", reason}
+                };
+                sendToUser(callerId, rejectMsg.dump());
+                
+                json response = {
+                    {"type", "call_reject_response"},
+                    {"success", true},
+                    {"message", "Call rejected"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("❌ Call rejected: " + callId);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "call_end") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                
+                // Send call_ended to other party
+                json endMsg = {
+                    {"type", "call_ended"},
+                    {"callId", callId},
+                    {"endedBy", data->userId}
+                };
+                sendToUser(targetId, endMsg.dump());
+                
+                json response = {
+                    {"type", "call_end_response"},
+                    {"success", true},
+                    {"message", "Call ended"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("📴 Call ended: " + callId);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "webrtc_offer") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                std::string sdp = msg.value("sdp", "");
+                
+                webrtcHandler_->sendOffer(callId, data->userId, targetId, sdp);
+                Logger::info("📡 WebRTC Offer forwarded: " + callId);
+            }
+        }
+        else if (type == "webrtc_answer") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                std::string sdp = msg.value("sdp", "");
+                
+                webrtcHandler_->sendAnswer(callId, data->userId, targetId, sdp);
+                Logger::info("📡 WebRTC Answer forwarded: " + callId);
+            }
+        }
+        else if (type == "webrtc_ice") {
+            if (data->authenticated) {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                std::string candidate = msg.value("candidate", "");
+                
+                webrtcHandler_->sendIceCandidate(callId, data->userId, targetId, candidate);
+                Logger::debug("🧊 ICE Candidate forwarded: " + callId);
+            }
+        }
+        // ============== Presence Status ==============
+        else if (type == "presence_update") {
+            if (data->authenticated && loadGovernor_.allowPresence()) {
+                std::string status = msg.value("status", "online");
+                Logger::info("👤 Presence update from " + data->username + ": " + status);
+                
+                // Broadcast to all connections
+                json broadcastMsg = {
+                    {"type", "presence_update"},
+                    {"userId", data->userId},
+                    {"username", data->username},
+                    {"status", status}
+                };
+                broadcast(broadcastMsg.dump());
+            }
+        }
+        // ============== Profile Update ==============
+        else if (type == "profile_update") {
+            if (data->authenticated) {
+                std::string displayName = msg.value("displayName", "");
+                std::string statusMessage = msg.value("statusMessage", "");
+                std::string avatar = msg.value("avatar", "");
+                
+                Logger::info("👤 Profile update from " + data->username);
+                
+                // Save to database
+                bool saved = false;
+                try {
+                    auto session = dbClient_->getSession();
+                    if (session) {
+                        session->sql(
+                            "UPDATE users SET "
+                            "display_name = COALESCE(NULLIF(?, ''), display_name), "
+                            "status_message = ?, "
+                            "avatar_url = COALESCE(NULLIF(?, ''), avatar_url) "
+                            "WHERE user_id = ?"
+                        ).bind(displayName, statusMessage, avatar, data->userId).execute();
+                        saved = true;
+                        membershipIndex_.updateProfile(data->userId, "", avatar);
+                        userDirectory_->updateProfile(data->userId, displayName, avatar, statusMessage);
+                        Logger::info("✅ Profile saved to database");
+                    }
+                } catch (const std::exception& e) {
+                    Logger::warning("Failed to save profile: " + std::string(e.what()));
+                }
+                
+                // Broadcast the update
+                json broadcastMsg = {
+                    {"type", "profile_updated"},
+                    {"userId", data->userId},
+                    {"displayName", displayName.empty() ? data->username : displayName},
+                    {"statusMessage", statusMessage},
+                    {"avatar", avatar}
+                };
+                broadcast(broadcastMsg.dump());
+                
+                // Confirm to sender
+                json response = {
+                    {"type", "profile_update_response"},
+                    {"success", saved},
+                    {"message", saved ? "Profile updated successfully" : "Profile updated (broadcast only)"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Change Password ==============
+        else if (type == "change_password") {
+            if (data->authenticated) {
+                std::string currentPassword = msg.value("currentPassword", "");
+                std::string newPassword = msg.value("newPassword", "");
+                
+                Logger::info("🔐 Change password request from " + data->username);
+                
+                // Use AuthManager's changePassword method
+                std::string error = authManager_->changePassword(data->userId, currentPassword, newPassword);
+                bool success = error.empty();
+                
+                if (success) {
+                    Logger::info("✅ Password changed successfully for " + data->username);
+                } else {
+                    Logger::warning("❌ Password change failed for " + data->username + ": " + error);
+                }
+                
+                json response = {
+                    {"type", "change_password_response"},
+                    {"success", success},
+                    {"message", success ? "Password changed successfully" : error}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== AI Chat (Gemini) ==============
+        else if (type == "ai_request") {
+            if (data->authenticated && geminiClient_) {
+                std::string message = msg.value("message", "");
+                Logger::info("🤖 AI request from " + data->username + ": " + message.substr(0, 50) + "...");
+                
+                // Gemini call on the AI executor; the reply goes back through the loop
+                void* wsPtr = (void*)ws;
+                bool queued = aiExecutor_->submit([this, wsPtr, message]() {
+                    json reply;
+                    auto response = geminiClient_->sendMessage(message);
+                    if (response.has_value()) {
+                        Logger::info("✅ AI response received");
+                        reply = {
+                            {"type", "ai_response"},
+                            {"response", response.value()}
+                        };
+                    } else {
+                        Logger::error("❌ AI request failed: No response");
+                        reply = {
+                            {"type", "ai_error"},
+                            {"error", "Failed to get AI response"}
+                        };
+                    }
+                    runOnLoop([this, wsPtr, payload = reply.dump()]() {
+                        if (isConnectionAlive(wsPtr)) {
+                            sendJsonMessage(wsPtr, payload);
+                        }
+                    });
+                });
+                if (!queued) {
+                    sendServerBusy((void*)ws, "ai_request", 5);
+                }
+            } else if (!geminiClient_) {
+                sendErrorJson((void*)ws, "AI service not available");
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "summarize") {
+            if (data->authenticated) {
+                handleSummarizeJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "translate_message") {
+            if (data->authenticated) {
+                handleTranslateMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "semantic_search") {
+            if (data->authenticated) {
+                handleSemanticSearchJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Polls ==============
+        else if (type == "poll_create") {
+            if (data->authenticated) {
+                std::string roomId = msg.value("roomId", "global");
+                std::string question = msg.value("question", "");
+                auto options = msg.value("options", json::array());
+                
+                uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                std::string pollId = "poll-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
+                
+                // Create poll struct for database
+                Poll pollData;
+                pollData.pollId = pollId;
+                pollData.roomId = roomId;
+                pollData.question = question;
+                pollData.createdBy = data->userId;
+                pollData.createdAt = now;
+                pollData.isClosed = false;
+                
+                json pollOptions = json::array();
+                int optIdx = 0;
+                for (const auto& opt : options) {
+                    // Include pollId in optId to make it unique across polls
+                    std::string optId = pollId + "-opt-" + std::to_string(optIdx);
+                    PollOption optData;
+                    optData.optionId = optId;
+                    optData.text = opt.get<std::string>();
+                    optData.index = optIdx;
+                    optData.voteCount = 0;
+                    pollData.options.push_back(optData);
+                    
+                    pollOptions.push_back({
+                        {"id", optId},
+                        {"text", opt.get<std::string>()},
+                        {"votes", 0},
+                        {"voters", json::array()}
+                    });
+                    optIdx++;
+                }
+                
+                // Save to database
+                auto db = authManager_->getDatabase();
+                if (db && db->createPoll(pollData)) {
+                    Logger::info("✅ Poll saved to database: " + pollId);
+                }
+                
+                json poll = {
+                    {"id", pollId},
+                    {"question", question},
+                    {"options", pollOptions},
+                    {"createdBy", data->userId},
+                    {"createdAt", now},
+                    {"isClosed", false}
+                };
+                
+                json broadcastMsg = {
+                    {"type", "poll_created"},
+                    {"roomId", roomId},
+                    {"poll", poll}
+                };
+                
+                // For DM rooms, send to both users
+                if (roomId.substr(0, 3) == "dm_") {
+                    // Extract target user ID from dm_targetUserId format
+                    std::string targetUserId = roomId.substr(3);
+                    // Send to target user with their perspective roomId
+                    std::string targetRoomId = "dm_" + data->userId;
+                    json targetMsg = broadcastMsg;
+                    targetMsg["roomId"] = targetRoomId;
+                    sendToUser(targetUserId, targetMsg.dump());
+                    // Send to sender
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                    Logger::info("📊 Poll sent to DM: " + roomId + " and " + targetRoomId);
+                } else {
+                    // Broadcast to ALL users in room (including creator for confirmation)
+                    broadcastToRoom(roomId, broadcastMsg.dump());
+                }
+                Logger::info("📊 Poll created by " + data->username + ": " + question);
+            }
+        }
+        else if (type == "poll_vote") {
+            if (data->authenticated) {
+                std::string pollId = msg.value("pollId", "");
+                std::string optionId = msg.value("optionId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                // Save vote to database
+                PollVote vote;
+                vote.pollId = pollId;
+                vote.optionId = optionId;
+                vote.userId = data->userId;
+                vote.username = data->username;
+                
+                auto db = authManager_->getDatabase();
+                if (db && db->votePoll(vote)) {
+                    Logger::info("✅ Vote saved to database");
+                }
+                
+                json broadcastMsg = {
+                    {"type", "poll_vote"},
+                    {"pollId", pollId},
+                    {"optionId", optionId},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username}
+                };
+                
+                // For DM rooms, send to both users
+                if (!roomId.empty() && roomId.substr(0, 3) == "dm_") {
+                    std::string targetUserId = roomId.substr(3);
+                    std::string targetRoomId = "dm_" + data->userId;
+                    json targetMsg = broadcastMsg;
+                    targetMsg["roomId"] = targetRoomId;
+                    sendToUser(targetUserId, targetMsg.dump());
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                } else if (!roomId.empty()) {
+                    broadcastToRoom(roomId, broadcastMsg.dump());
+                } else {
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                }
+                Logger::info("🗳️ Vote cast by " + data->username + " in room " + roomId);
+            }
+        }
+        else if (type == "poll_close") {
+            if (data->authenticated) {
+                std::string pollId = msg.value("pollId", "");
+                
+                auto db = authManager_->getDatabase();
+                if (db) {
+                    auto poll = db->getPoll(pollId);
+                    if (poll && poll->createdBy == data->userId) {
+                        db->closePoll(pollId);
+                        
+                        json broadcastMsg = {
+                            {"type", "poll_closed"},
+                            {"pollId", pollId}
+                        };
+                        broadcast(broadcastMsg.dump());
+                        Logger::info("📊 Poll closed: " + pollId);
+                    } else {
+                        sendErrorJson((void*)ws, "Only poll creator can close the poll");
+                    }
+                }
+            }
+        }
+        else if (type == "get_room_polls") {
+            if (data->authenticated) {
+                std::string roomId = msg.value("roomId", "global");
+                bool activeOnly = msg.value("activeOnly", false);
+                
+                auto db = authManager_->getDatabase();
+                if (db) {
+                    auto polls = db->getRoomPolls(roomId, activeOnly);
+                    json pollsJson = json::array();
+                    
+                    for (const auto& poll : polls) {
+                        json optionsJson = json::array();
+                        for (const auto& opt : poll.options) {
+                            json votersJson = json::array();
+                            for (size_t i = 0; i < opt.voterIds.size(); i++) {
+                                votersJson.push_back(opt.voterNames[i]);
+                            }
+                            optionsJson.push_back({
+                                {"id", opt.optionId},
+                                {"text", opt.text},
+                                {"votes", opt.voteCount},
+                                {"voters", votersJson}
+                            });
+                        }
+                        pollsJson.push_back({
+                            {"id", poll.pollId},
+                            {"question", poll.question},
+                            {"options", optionsJson},
+                            {"createdBy", poll.createdBy},
+                            {"createdAt", poll.createdAt},
+                            {"isClosed", poll.isClosed}
+                        });
+                    }
+                    
+                    json response = {
+                        {"type", "room_polls"},
+                        {"roomId", roomId},
+                        {"polls", pollsJson}
+                    };
+                    sendJsonMessage((void*)ws, response.dump());
+                }
+            }
+        }
+        // ============== Games ==============
+        else if (type == "game_invite") {
+            if (data->authenticated) {
+                std::string gameType = msg.value("gameType", "tictactoe");
+                std::string opponentId = msg.value("opponentId", "");
+                std::string gameId = "game-" + std::to_string(std::time(nullptr)) + "-" + std::to_string(rand());
+                
+                // Store pending invite
+                json gameInfo = {
+                    {"gameId", gameId},
+                    {"gameType", gameType},
+                    {"inviter", data->userId},
+                    {"inviterName", data->username},
+                    {"invitee", opponentId}
+                };
+                
+                json inviteMsg = {
+                    {"type", "game_invite"},
+                    {"gameId", gameId},
+                    {"gameType", gameType},
+                    {"fromUser", data->username},
+                    {"fromUserId", data->userId}
+                };
+                
+                // Send to opponent
+                sendToUser(opponentId, inviteMsg.dump());
+                Logger::info("🎮 Game invite from " + data->username + " to " + opponentId);
+            }
+        }
+        else if (type == "game_accept") {
+            if (data->authenticated) {
+                std::string gameId = msg.value("gameId", "");
+                std::string inviterId = msg.value("fromUserId", "");
+                
+                // Create initial game state
+                json gameState = {
+                    {"id", gameId},
+                    {"type", "tictactoe"},
+                    {"board", json::array({"", "", "", "", "", "", "", "", ""})},
+                    {"currentTurn", "X"},
+                    {"players", {{"X", inviterId}, {"O", data->userId}}},
+                    {"winner", nullptr},
+                    {"status", "playing"}
+                };
+                
+                json gameStartMsg = {
+                    {"type", "game_start"},
+                    {"gameId", gameId},
+                    {"game", gameState}
+                };
+                
+                std::string gameMsg = gameStartMsg.dump();
+                
+                // Send to both players explicitly
+                sendToUser(inviterId, gameMsg);  // Send to inviter (X player)
+                sendToUser(data->userId, gameMsg);  // Send to accepter (O player)
+                
+                Logger::info("🎮 Game started: " + gameId + " between " + inviterId + " and " + data->userId);
+            }
+        }
+        else if (type == "game_reject") {
+            if (data->authenticated) {
+                std::string gameId = msg.value("gameId", "");
+                json rejectMsg = {
+                    {"type", "game_rejected"},
+                    {"gameId", gameId}
+                };
+                broadcast(rejectMsg.dump());
+                Logger::info("🎮 Game rejected: " + gameId);
+            }
+        }
+        else if (type == "game_move") {
+            if (data->authenticated) {
+                std::string gameId = msg.value("gameId", "");
+                int position = msg.value("position", -1);
+                
+                // Broadcast move to all connected users (they will filter by gameId)
+                json moveMsg = {
+                    {"type", "game_move"},
+                    {"gameId", gameId},
+                    {"position", position},
+                    {"playerId", data->userId}
+                };
+                broadcast(moveMsg.dump());
+                Logger::info("🎮 Game move in " + gameId + " at position " + std::to_string(position) + " by " + data->userId);
+            }
+        }
+        // ============== Watch Together ==============
+        else if (type == "watch_create") {
+            if (data->authenticated) {
+                std::string roomId = msg.value("roomId", "global");
+                std::string videoUrl = msg.value("videoUrl", "");
+                
+                json watchMsg = {
+                    {"type", "watch_session_created"},
+                    {"roomId", roomId},
+                    {"videoUrl", videoUrl},
+                    {"createdBy", data->username},
+                    {"viewerCount", 1}
+                };
+                broadcastToRoom(roomId, watchMsg.dump(), "");
+                Logger::info("📺 Watch session created by " + data->username);
+            }
+        }
+        else if (type == "watch_sync") {
+            if (data->authenticated) {
+                std::string action = msg.value("action", "");
+                double time = msg.value("time", 0.0);
+                
+                json syncMsg = {
+                    {"type", "watch_sync"},
+                    {"action", action},
+                    {"time", time},
+                    {"syncedBy", data->username}
+                };
+                broadcast(syncMsg.dump());
+            }
+        }
+        else if (type == "watch_end") {
+            if (data->authenticated) {
+                json endMsg = {
+                    {"type", "watch_ended"}
+                };
+                broadcast(endMsg.dump());
+                Logger::info("📺 Watch session ended");
+            }
+        }
+        // ============== Chunked File Upload ==============
+        else if (type == "upload_init") {
+            if (data->authenticated) {
+                Logger::info("📤 Upload init from " + data->username);
+                
+                // Admission control first; FileHandler starts the session once admitted
+                handleUploadInitJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "upload_chunk") {
+            if (data->authenticated) {
+                std::string uploadId = msg.value("uploadId", "");
+                int chunkIndex = msg.value("chunkIndex", 0);
+                Logger::debug("📦 Upload chunk " + std::to_string(chunkIndex) + " from " + data->username);
+                
+                // Paced by the upload disk-bandwidth budget
+                handleUploadChunkJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "upload_finalize") {
+            if (data->authenticated) {
+                std::string uploadId = msg.value("uploadId", "");
+                Logger::info("✅ Upload finalize from " + data->username + " (" + uploadId + ")");
+                
+                // Call FileHandler to finalize upload (after any chunks still waiting on bandwidth)
+                handleUploadFinalizeJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Forward Message ==============
+        else if (type == "forward_message") {
+            if (data->authenticated) {
+                handleForwardMessageJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Disappearing Messages ==============
+        else if (type == "set_room_ttl") {
+            if (data->authenticated) {
+                handleSetRoomTtlJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Outbound Webhooks ==============
+        else if (type == "add_webhook") {
+            if (data->authenticated) {
+                handleAddWebhookJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "remove_webhook") {
+            if (data->authenticated) {
+                handleRemoveWebhookJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "list_webhooks") {
+            if (data->authenticated) {
+                handleListWebhooksJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Room Export ==============
+        else if (type == "export_room") {
+            if (data->authenticated) {
+                handleExportRoomJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "export_status") {
+            if (data->authenticated) {
+                handleExportStatusJson((void*)ws, msgStr);
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Block/Unblock User ==============
+        else if (type == "user_block") {
+            if (data->authenticated) {
+                std::string targetUserId = msg.value("targetUserId", "");
+                
+                if (targetUserId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId required");
+                } else if (targetUserId == data->userId) {
+                    sendErrorJson((void*)ws, "Cannot block yourself");
+                } else {
+                    if (dbClient_->blockUser(data->userId, targetUserId)) {
+                        json response = {
+                            {"type", "user_blocked"},
+                            {"targetUserId", targetUserId},
+                            {"success", true}
+                        };
+                        sendJsonMessage((void*)ws, response.dump());
+                        Logger::info("🚫 User " + data->username + " blocked " + targetUserId);
+                    } else {
+                        sendErrorJson((void*)ws, "Failed to block user");
+                    }
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "user_unblock") {
+            if (data->authenticated) {
+                std::string targetUserId = msg.value("targetUserId", "");
+                
+                if (targetUserId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId required");
+                } else {
+                    if (dbClient_->unblockUser(data->userId, targetUserId)) {
+                        json response = {
+                            {"type", "user_unblocked"},
+                            {"targetUserId", targetUserId},
+                            {"success", true}
+                        };
+                        sendJsonMessage((void*)ws, response.dump());
+                        Logger::info("✅ User " + data->username + " unblocked " + targetUserId);
+                    } else {
+                        sendErrorJson((void*)ws, "Failed to unblock user");
+                    }
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else if (type == "get_blocked_users") {
+            if (data->authenticated) {
+                auto blockedUsers = dbClient_->getBlockedUsers(data->userId);
+                json response = {
+                    {"type", "blocked_users_list"},
+                    {"blockedUsers", blockedUsers}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Kick User from Room ==============
+        else if (type == "kick_user") {
+            if (data->authenticated) {
+                std::string targetUserId = msg.value("targetUserId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                if (targetUserId.empty() || roomId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId and roomId required");
+                } else {
+                    // Check if user has permission (owner or admin)
+                    std::string role = dbClient_->getMemberRole(roomId, data->userId);
+                    if (role == "owner" || role == "admin") {
+                        // Remove user from room
+                        if (dbClient_->removeRoomMember(roomId, targetUserId)) {
+                            membershipIndex_.removeMember(roomId, targetUserId);
+                            
+                            // Notify kicked user
+                            json kickNotify = {
+                                {"type", "kicked_from_room"},
+                                {"roomId", roomId},
+                                {"kickedBy", data->username}
+                            };
+                            sendToUser(targetUserId, kickNotify.dump());
+                            
+                            // Notify room
+                            json roomNotify = {
+                                {"type", "user_kicked"},
+                                {"roomId", roomId},
+                                {"targetUserId", targetUserId},
+                                {"kickedBy", data->username}
+                            };
+                            broadcastToRoom(roomId, roomNotify.dump());
+                            
+                            json response = {
+                                {"type", "kick_success"},
+                                {"targetUserId", targetUserId},
+                                {"roomId", roomId}
+                            };
+                            sendJsonMessage((void*)ws, response.dump());
+                            Logger::info("👢 User " + targetUserId + " kicked from " + roomId + " by " + data->username);
+                        } else {
+                            sendErrorJson((void*)ws, "Failed to kick user");
+                        }
+                    } else {
+                        sendErrorJson((void*)ws, "No permission to kick users");
+                    }
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Invite User to Room ==============
+        else if (type == "invite_user") {
+            if (data->authenticated) {
+                std::string targetUserId = msg.value("targetUserId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                if (targetUserId.empty() || roomId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId and roomId required");
+                } else {
+                    // Check if inviter is member of room
+                    auto members = dbClient_->getRoomMembers(roomId);
+                    bool isMember = std::find(members.begin(), members.end(), data->userId) != members.end();
+                    
+                    if (isMember) {
+                        // Add user to room
+                        if (dbClient_->addRoomMember(roomId, targetUserId)) {
+                            if (auto target = dbClient_->getUserById(targetUserId)) {
+                                membershipIndex_.addMember(roomId, *target);
+                            }
+                            
+                            // Get room info
+                            auto room = dbClient_->getRoom(roomId);
+                            std::string roomName = room ? room->name : roomId;
+                            
+                            // Notify invited user
+                            json inviteNotify = {
+                                {"type", "room_invitation"},
+                                {"roomId", roomId},
+                                {"roomName", roomName},
+                                {"invitedBy", data->username}
+                            };
+                            sendToUser(targetUserId, inviteNotify.dump());
+                            
+                            // Notify room
+                            json roomNotify = {
+                                {"type", "user_invited"},
+                                {"roomId", roomId},
+                                {"targetUserId", targetUserId},
+                                {"invitedBy", data->username}
+                            };
+                            broadcastToRoom(roomId, roomNotify.dump());
+                            
+                            json response = {
+                                {"type", "invite_success"},
+                                {"targetUserId", targetUserId},
+                                {"roomId", roomId}
+                            };
+                            sendJsonMessage((void*)ws, response.dump());
+                            Logger::info("📨 User " + targetUserId + " invited to " + roomId + " by " + data->username);
+                        } else {
+                            sendErrorJson((void*)ws, "Failed to invite user (maybe already member)");
+                        }
+                    } else {
+                        sendErrorJson((void*)ws, "You must be a room member to invite others");
+                    }
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Sticker Message ==============
+        else if (type == "chat_sticker") {
+            if (data->authenticated) {
+                std::string sticker = msg.value("sticker", "");
+                std::string roomId = msg.value("roomId", "global");
+                
+                if (sticker.empty()) {
+                    sendErrorJson((void*)ws, "sticker required");
+                } else if (!canPostToRoom(roomId, data->userId)) {
+                    sendErrorJson((void*)ws, "Only channel admins can post");
+                } else {
+                    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                    std::string messageId = newMessageId(data->userId, now);
+                    
+                    Message stickerMsg;
+                    stickerMsg.messageId = messageId;
+                    stickerMsg.roomId = resolveStorageRoomId(data->userId, roomId);
+                    stickerMsg.senderId = data->userId;
+                    stickerMsg.senderName = data->username;
+                    stickerMsg.content = "[sticker:" + sticker + "]";
+                    stickerMsg.timestamp = now;
+                    stickerMsg.metadata = "{\"type\": \"sticker\", \"sticker\": \"" + sticker + "\"}";
+                    
+                    json response = {
+                        {"type", "chat"},
+                        {"messageType", "sticker"},
+                        {"messageId", messageId},
+                        {"roomId", roomId},
+                        {"userId", data->userId},
+                        {"username", data->username},
+                        {"sticker", sticker},
+                        {"timestamp", now * 1000}
+                    };
+                    postRoomMessage((void*)ws, stickerMsg, response, roomId, "Failed to send sticker",
+                                    "🎨 Sticker sent by " + data->username);
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        // ============== Location Message ==============
+        else if (type == "chat_location") {
+            if (data->authenticated) {
+                double latitude = msg.value("latitude", 0.0);
+                double longitude = msg.value("longitude", 0.0);
+                std::string roomId = msg.value("roomId", "global");
+                
+                if (latitude == 0.0 && longitude == 0.0) {
+                    sendErrorJson((void*)ws, "latitude and longitude required");
+                } else if (!canPostToRoom(roomId, data->userId)) {
+                    sendErrorJson((void*)ws, "Only channel admins can post");
+                } else {
+                    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                    std::string messageId = newMessageId(data->userId, now);
+                    
+                    std::string locationStr = std::to_string(latitude) + "," + std::to_string(longitude);
+                    
+                    Message locMsg;
+                    locMsg.messageId = messageId;
+                    locMsg.roomId = resolveStorageRoomId(data->userId, roomId);
+                    locMsg.senderId = data->userId;
+                    locMsg.senderName = data->username;
+                    locMsg.content = "[location:" + locationStr + "]";
+                    locMsg.timestamp = now;
+                    locMsg.metadata = "{\"type\": \"location\", \"latitude\": " + std::to_string(latitude) + ", \"longitude\": " + std::to_string(longitude) + "}";
+                    
+                    json response = {
+                        {"type", "chat"},
+                        {"messageType", "location"},
+                        {"messageId", messageId},
+                        {"roomId", roomId},
+                        {"userId", data->userId},
+                        {"username", data->username},
+                        {"latitude", latitude},
+                        {"longitude", longitude},
+                        {"timestamp", now * 1000}
+                    };
+                    postRoomMessage((void*)ws, locMsg, response, roomId, "Failed to send location",
+                                    "📍 Location sent by " + data->username);
+                }
+            } else {
+                sendErrorJson((void*)ws, "Not authenticated");
+            }
+        }
+        else {
+            Logger::warning("Unknown message type: " + type);
+            sendErrorJson((void*)ws, "Unknown message type");
+        }
+        
+    } catch (const json::exception& e) {
+        Logger::error("JSON parse error: " + std::string(e.what()));
+        sendErrorJson((void*)ws, "Invalid JSON");
+    } catch (const std::exception& e) {
+        Logger::error("Message handling error: " + std::string(e.what()));
+        sendErrorJson((void*)ws, "Internal error");
+    }
+}
+
+void WebSocketServer::handleBatchJson(void* wsPtr, const std::string& jsonStr) {
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    PerSocketData* data = ws->getUserData();
+    
+    if (batchReplies_) {
+        sendErrorJson(wsPtr, "Batches cannot be nested");
+        return;
+    }
+    
+    try {
+        json msg = json::parse(jsonStr);
+        std::string requestId = msg.value("requestId", "");
+        
+        if (!msg.contains("ops") || !msg["ops"].is_array() || msg["ops"].empty()) {
+            sendErrorJson(wsPtr, "Batch ops required");
+            return;
+        }
+        const json& ops = msg["ops"];
+        if (ops.size() > MAX_BATCH_OPS) {
+            sendErrorJson(wsPtr, "Too many operations in batch (max " + std::to_string(MAX_BATCH_OPS) + ")");
+            return;
+        }
+        
+        Logger::info("📦 Batch of " + std::to_string(ops.size()) + " ops from " + data->username);
+        
+        // Combine the database work the ops would otherwise do one by one:
+        // all read marks become one multi-row upsert, and the histories of
+        // rooms being joined are fetched with one query before the joins run
+        std::vector<std::string> readIds;
+        std::vector<bool> readPersisted(ops.size(), false);
+        std::vector<std::string> prefetchRooms;
+        std::unordered_set<std::string> seenRooms;
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const json& op = ops[i];
+            if (!op.is_object()) {
+                continue;
+            }
+            std::string type = op.value("type", "");
+            if (type == "mark_read") {
+                std::string messageId = op.value("messageId", "");
+                if (!messageId.empty() && !channelFanout_.isChannel(op.value("roomId", "global"))) {
+                    readIds.push_back(messageId);
+                    readPersisted[i] = true;
+                }
+            } else if (type == "join_room") {
+                // DM rooms resolve to a per-user conversation ID; those load on join
+                std::string roomId = op.value("roomId", "");
+                if (!roomId.empty() && roomId.rfind("dm_", 0) != 0 &&
+                    seenRooms.insert(roomId).second && !historyCache_.get(roomId)) {
+                    prefetchRooms.push_back(roomId);
+                }
+            }
+        }
+        
+        if (!readIds.empty() && !dbClient_->markMessagesRead(data->userId, readIds)) {
+            Logger::warning("Failed to save " + std::to_string(readIds.size()) + " read marks");
+            // Continue anyway - still broadcast the read receipts
+        }
+        if (prefetchRooms.size() > 1) {
+            // Same 50-message window as loadRoomHistory; rooms written meanwhile are skipped
+            std::unordered_map<std::string, uint64_t> versions;
+            for (const auto& roomId : prefetchRooms) {
+                versions[roomId] = historyCache_.version(roomId);
+            }
+            for (const auto& [roomId, messages] : dbClient_->getMessagesByRooms(prefetchRooms, 50)) {
+                historyCache_.put(roomId, messages, versions[roomId]);
+            }
+        }
+        
+        // Run the ops in order, collecting every reply addressed to this socket
+        std::vector<std::string> replies;
+        std::string results;
+        {
+            struct CaptureGuard {
+                WebSocketServer* server;
+                ~CaptureGuard() {
+                    server->batchSocket_ = nullptr;
+                    server->batchReplies_ = nullptr;
+                }
+            } guard{this};
+            batchSocket_ = wsPtr;
+            batchReplies_ = &replies;
+            
+            for (size_t i = 0; i < ops.size(); ++i) {
+                const json& op = ops[i];
+                std::string type = op.is_object() ? op.value("type", "") : "";
+                size_t firstReply = replies.size();
+                
+                if (type.empty()) {
+                    sendErrorJson(wsPtr, "Operation type required");
+                } else if (type == "batch" || type == "login" || type == "register" || type == "auth") {
+                    sendErrorJson(wsPtr, "Not allowed in batch: " + type);
+                } else if (readPersisted[i]) {
+                    broadcastReadReceipt(op.value("messageId", ""), op.value("roomId", "global"),
+                                         data->userId, data->username);
+                } else {
+                    dispatchMessage(wsPtr, op.dump());
+                }
+                
+                if (i > 0) {
+                    results += ",";
+                }
+                results += "{\"index\":" + std::to_string(i) + ",\"type\":" + json(type).dump() + ",\"replies\":[";
+                for (size_t r = firstReply; r < replies.size(); ++r) {
+                    if (r > firstReply) {
+                        results += ",";
+                    }
+                    results += replies[r];
+                }
+                results += "]}";
+            }
+        }
+        
+        // Replies are already serialized JSON; splice them in rather than re-parsing
+        sendJsonMessage(wsPtr, "{\"type\":\"batch_response\",\"requestId\":" + json(requestId).dump() +
+                               ",\"results\":[" + results + "]}");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Batch error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Invalid batch");
+    }
+}
+
+void WebSocketServer::sendJsonMessage(void* wsPtr, const std::string& jsonStr) {
+    // Inside a batch, replies to the batching socket go into its batch_response
+    if (batchReplies_ && wsPtr == batchSocket_) {
+        batchReplies_->push_back(jsonStr);
+        return;
+    }
+    
+    sendTracked(wsPtr, jsonStr);
+}
+
+void WebSocketServer::sendTracked(void* wsPtr, std::string_view payload) {
+    // Cast back to proper WebSocket type - we know it's non-SSL from our App setup
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    ws->send(payload, uWS::OpCode::TEXT);
+    noteBuffered(wsPtr);
+}
+
+void WebSocketServer::noteBuffered(void* wsPtr) {
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    PerSocketData* data = ws->getUserData();
+    size_t buffered = ws->getBufferedAmount();
+    bufferedBytes_.fetch_add(static_cast<int64_t>(buffered) - static_cast<int64_t>(data->bufferedBytes),
+                             std::memory_order_relaxed);
+    data->bufferedBytes = buffered;
+}
+
+void WebSocketServer::sendErrorJson(void* wsPtr, const std::string& error) {
+    json response = {
+        {"type", "error"},
+        {"message", error}
+    };
+    sendJsonMessage(wsPtr, response.dump());
+}
+
+void WebSocketServer::handleRegisterJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        json msg = json::parse(jsonStr);
+        
+        std::string username = msg.value("username", "");
+        std::string password = msg.value("password", "");
+        std::string email = msg.value("email", "");
+        
+        if (username.empty() || password.empty()) {
+            sendErrorJson(wsPtr, "Username and password required");
+            return;
+        }
+        
+        UserRegistration reg;
+        reg.username = username;
+        reg.password = password;
+        reg.email = email.empty() ? (username + "@chatbox.local") : email;
+        
+        bool success = authManager_->registerUser(reg);
+        
+        json response = {
+            {"type", "register_response"},
+            {"success", success},
+            {"message", success ? "Registration successful" : "Username already exists"}
+        };
+        
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info(success ? "✓ User registered: " + username : "✗ Registration failed: " + username);
+        
+    } catch (const std::exception& e) {
+        Logger::error("Register error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Registration failed");
+    }
+}
+
+void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        
+        std::string username = msg.value("username", "");
+        std::string password = msg.value("password", "");
+        
+        if (username.empty() || password.empty()) {
+            sendErrorJson(wsPtr, "Username and password required");
+            return;
+        }
+        
+        LoginResult result = authManager_->login(username, password);
+        
+        if (result.success) {
+            if (!data->authenticated) {
+                membershipIndex_.userConnected(result.userId);
+            }
+            
+            // Mark socket as authenticated
+            data->authenticated = true;
+            data->userId = result.userId;
+            data->username = username;
+            data->sessionId = "ws-session-" + result.userId;
+            
+            // Update connection state in connections_ map for broadcast
+            {
+                ProfiledLock lock(connectionsMutex_);
+                if (connections_.find(wsPtr) != connections_.end()) {
+                    connections_[wsPtr].authenticated = true;
+                    connections_[wsPtr].userId = result.userId;
+                    connections_[wsPtr].username = username;
+                    Logger::info("📝 Updated connection state for: " + username);
+                }
+            }
+            
+            // Get user's display name and avatar from database
+            std::string displayName = username;
+            std::string avatar = "";
+            try {
+                auto session = dbClient_->getSession();
+                if (session) {
+                    auto userResult = session->sql(
+                        "SELECT display_name, avatar_url FROM users WHERE user_id = ?"
+                    ).bind(result.userId).execute();
+                    auto row = userResult.fetchOne();
+                    if (row) {
+                        if (!row[0].isNull()) displayName = row[0].get<std::string>();
+                        if (!row[1].isNull()) avatar = row[1].get<std::string>();
+                    }
+                }
+            } catch (const std::exception& e) {
+                Logger::warning("Failed to get user profile: " + std::string(e.what()));
+            }
+
+            json response = {
+                {"type", "login_response"},
+                {"success", true},
+                {"token", result.token},
+                {"userId", result.userId},
+                {"username", displayName.empty() ? username : displayName},
+                {"avatar", avatar},
+                {"message", "Login successful"}
+            };
+            
+            sendJsonMessage(wsPtr, response.dump());
+            Logger::info("✓ User logged in: " + username + " (userId: " + result.userId + ")");
+            
+            // Send chat history for global room
+            try {
+                std::string defaultRoom = "global";
+                auto messages = loadRoomHistory(defaultRoom);
+                
+                if (!messages.empty()) {
+                    Logger::info("📜 Sending " + std::to_string(messages.size()) + " history messages to " + username);
+                    
+                    json historyResponse = {
+                        {"type", "history"},
+                        {"roomId", defaultRoom},
+                        {"messages", json::array()}
+                    };
+                    
+                    for (auto& msg : messages) {
+                        message_codec::inflate(msg);
+                        json msgJson = {
+                            {"messageId", msg.messageId},
+                            {"roomId", msg.roomId},
+                            {"userId", msg.senderId},
+                            {"username", msg.senderName},
+                            {"content", msg.content},
+                            {"timestamp", msg.timestamp}
+                        };
+                        if (!msg.replyToId.empty()) {
+                            msgJson["replyToId"] = msg.replyToId;
+                        }
+                        if (msg.replyCount > 0) {
+                            msgJson["replyCount"] = msg.replyCount;
+                            msgJson["lastReplyAt"] = msg.lastReplyAt;
+                        }
+                        // Include metadata if present
+                        if (!msg.metadata.empty()) {
+                            try {
+                                msgJson["metadata"] = json::parse(msg.metadata);
+                            } catch (...) {
+                                // Invalid JSON, skip metadata
+                            }
+                        }
+                        historyResponse["messages"].push_back(msgJson);
+                    }
+                    
+                    sendJsonMessage(wsPtr, historyResponse.dump());
+                }
+            } catch (const std::exception& e) {
+                Logger::error("Failed to load history: " + std::string(e.what()));
+            }
+            
+            // Broadcast user joined to all other users
+            json userJoinedMsg = {
+                {"type", "user_joined"},
+                {"userId", result.userId},
+                {"username", username}
+            };
+            broadcastToRoom("global", userJoinedMsg.dump(), result.userId);
+            Logger::info("📢 Broadcast user_joined: " + username);
+            
+        } else {
+            json response = {
+                {"type", "login_response"},
+                {"success", false},
+                {"message", result.errorMessage}
+            };
+            
+            sendJsonMessage(wsPtr, response.dump());
+            Logger::warning("✗ Login failed: " + username);
+        }
+        
+    } catch (const std::exception& e) {
+        Logger::error("Login error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Login failed");
+    }
+}
+
+void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        
+        std::string content = msg.value("content", "");
+        std::string roomId = msg.value("roomId", "global");
+        
+        if (content.empty()) {
+            return;
+        }
+        
+        if (!canPostToRoom(roomId, data->userId)) {
+            sendErrorJson(wsPtr, "Only channel admins can post");
+            return;
+        }
+        
+        Logger::info("💬 Chat from " + data->username + " in room '" + roomId + "': " + content);
+        
+        // ============================================================================
+        // CHECK FOR @AI COMMAND
+        // ============================================================================
+        if (content.length() > 3 && content.substr(0, 3) == "@ai" && geminiClient_) {
+            std::string question = content.substr(3);
+            // Trim leading spaces
+            size_t start = question.find_first_not_of(" \t");
+            if (start != std::string::npos) {
+                question = question.substr(start);
+            }
+            
+            Logger::info("🤖 AI command detected: " + question);
+            
+            // Gemini call on the AI executor; the answer is posted to the room from the loop
+            std::string storageRoomId = resolveStorageRoomId(data->userId, roomId);
+            bool queued = aiExecutor_->submit([this, wsPtr, question, roomId, storageRoomId]() {
+                auto aiResponse = geminiClient_->sendMessage(question);
+                runOnLoop([this, wsPtr, aiResponse, roomId, storageRoomId]() {
+                    if (!aiResponse.has_value()) {
+                        Logger::error("✗ Failed to get AI response");
+                        if (isConnectionAlive(wsPtr)) {
+                            sendJsonMessage(wsPtr, json({
+                                {"type", "ai_error"},
+                                {"error", "Failed to get AI response"}
+                            }).dump());
+                        }
+                        return;
+                    }
+                    Logger::info("✓ AI response received (" + std::to_string(aiResponse.value().length()) + " chars)");
+                    
+                    auto now = std::time(nullptr);
+                    Message aiDbMessage;
+                    aiDbMessage.messageId = newMessageId("ai-assistant", static_cast<uint64_t>(now));
+                    aiDbMessage.roomId = storageRoomId;
+                    aiDbMessage.senderId = "ai-assistant";
+                    aiDbMessage.senderName = "AI Assistant";
+                    aiDbMessage.content = aiResponse.value();
+                    aiDbMessage.messageType = 0;
+                    aiDbMessage.timestamp = now;
+                    
+                    json aiMsg = {
+                        {"type", "chat"},
+                        {"messageId", aiDbMessage.messageId},
+                        {"roomId", roomId},
+                        {"userId", "ai-assistant"},
+                        {"username", "AI Assistant"},
+                        {"content", aiDbMessage.content},
+                        {"timestamp", now * 1000}
+                    };
+                    
+                    // No echo: the asker is in the room, and the broadcast only skips the assistant
+                    postRoomMessage(nullptr, std::move(aiDbMessage), std::move(aiMsg), roomId,
+                                    "Failed to save AI response", "✅ AI response broadcasted to room");
+                });
+            });
+            if (!queued) {
+                sendServerBusy(wsPtr, "chat", 5);
+            }
+            return; // Don't process as regular message
+        }
+        // ============================================================================
+        
+        // Generate message ID
+        std::string messageId = newMessageId(data->userId, static_cast<uint64_t>(std::time(nullptr)));
+        
+        // Check if message has metadata (file attachment)
+        json metadata = nullptr;
+        if (msg.contains("metadata") && msg["metadata"].is_object()) {
+            metadata = msg["metadata"];
+        }
+        
+        // Create message response
+        json response = {
+            {"type", "chat"},
+            {"messageId", messageId},
+            {"roomId", roomId},
+            {"userId", data->userId},
+            {"username", data->username},
+            {"content", content},
+            {"timestamp", std::time(nullptr) * 1000}  // Convert to milliseconds for JS
+        };
+        
+        // Add metadata if present (for file attachments)
+        if (!metadata.is_null()) {
+            response["metadata"] = metadata;
+            Logger::info("📎 Message has file attachment: " + metadata.value("fileName", "unknown"));
+        }
+        
+        // For DM, use conversation_id from database (Discord/Telegram style)
+        std::string storageRoomId = roomId;
+        if (roomId.rfind("dm_", 0) == 0) {
+            std::string targetUserId = roomId.substr(3);
+            // Get or create DM conversation (like Discord channel)
+            storageRoomId = resolveStorageRoomId(data->userId, roomId);
+            Logger::info("📦 DM conversation roomId for storage: " + storageRoomId);
+        }
+        
+        Message dbMessage;
+        dbMessage.messageId = messageId;
+        dbMessage.roomId = storageRoomId;  // Use conversation_id for DM
+        dbMessage.senderId = data->userId;
+        dbMessage.senderName = data->username;  // Add sender name
+        dbMessage.content = content;
+        dbMessage.messageType = 0;  // 0 = text message
+        dbMessage.replyToId = "";   // No reply for now
+        dbMessage.timestamp = std::time(nullptr);
+        // Save metadata as JSON string
+        if (!metadata.is_null()) {
+            dbMessage.metadata = metadata.dump();
+        }
+        dbMessage.expiresAt = expiryIndex_.deadlineFor(storageRoomId, dbMessage.timestamp);
+        if (dbMessage.expiresAt) {
+            response["expiresAt"] = dbMessage.expiresAt * 1000;
+        }
+        
+        // Runs on the event loop once the message is persisted
+        std::string userId = data->userId;
+        std::string username = data->username;
+        auto deliver = [this, wsPtr, roomId, userId, username, content, metadata](const json& response) {
+            std::string responseStr = response.dump();
+            
+            // Check if this is a DM (format: dm_userId)
+            if (roomId.rfind("dm_", 0) == 0) {
+                // Extract target user ID from room ID
+                std::string targetUserId = roomId.substr(3); // Remove "dm_" prefix
+                Logger::info("📨 DM detected from " + userId + " to user: " + targetUserId);
+                
+                // Create response for sender with their perspective roomId
+                json senderResponse = response;
+                senderResponse["roomId"] = roomId;  // Sender sees dm_targetUserId
+                if (isConnectionAlive(wsPtr)) {
+                    sendJsonMessage(wsPtr, senderResponse.dump());
+                }
+                
+                // Create response for receiver with their perspective roomId
+                json receiverResponse = response;
+                receiverResponse["roomId"] = "dm_" + userId;  // Receiver sees dm_senderId
+                
+                // Send to target user with their perspective roomId
+                sendToUser(targetUserId, receiverResponse.dump());
+            } else {
+                // Echo back to sender for non-DM messages
+                if (isConnectionAlive(wsPtr)) {
+                    sendJsonMessage(wsPtr, responseStr);
+                }
+                // Broadcast to all other users in room
+                broadcastToRoom(roomId, responseStr, userId);
+            }
+            
+            // Publish to PubSub (for future multi-server support)
+            broker_->publish("chat." + roomId, responseStr);
+        };
+        
+        // Persist on the room's actor (ordered per room, parallel across rooms),
+        // then hand the fan-out back to the event loop
+        bool posted = roomActors_.post(storageRoomId, [this, dbMessage, response, deliver](RoomActorPool::RoomState& state, MySQLClient& db) mutable {
+            response["seq"] = state.nextSeq++;
+            if (saveMessage(dbMessage, &db)) {
+                Logger::info("💾 Message saved to database");
+            } else {
+                Logger::error("✗ createMessage returned false!");
+            }
+            runOnLoop([deliver, response]() { deliver(response); });
+        });
+        if (posted) {
+            return;
+        }
+        
+        // No actor pool (or it is stopping) - save inline on the event loop
+        try {
+            // Note: Will use DB default for created_at
+            bool saved = saveMessage(dbMessage);
+            
+            if (saved) {
+                Logger::info("💾 Message saved to database");
+            } else {
+                Logger::error("✗ createMessage returned false!");
+            }
+            
+        } catch (const std::exception& e) {
+            Logger::error("Failed to save message to DB: " + std::string(e.what()));
+            // Continue anyway - message still gets broadcast
+        }
+        
+        deliver(response);
+        
+    } catch (const std::exception& e) {
+        Logger::error("Chat message error: " + std::string(e.what()));
+    }
+}
+
+// Public methods
+size_t WebSocketServer::getConnectionCount() const {
+    ProfiledLock lock(connectionsMutex_);
+    return connections_.size();
+}
+
+void WebSocketServer::broadcast(const std::string& message) {
+    ProfiledLock lock(connectionsMutex_);
+    
+    int sent = 0;
+    for (const auto& [key, state] : connections_) {
+        if (state.authenticated && state.wsPtr) {
+            sendTracked(state.wsPtr, message);
+            sent++;
+        }
+    }
+    
+    Logger::info("📢 Broadcast to " + std::to_string(sent) + " authenticated clients");
+}
+
+void WebSocketServer::broadcastToRoom(const std::string& roomId, const std::string& message, const std::string& excludeUserId) {
+    // Channels fan out to in-memory subscriptions, never to room_members
+    if (channelFanout_.isChannel(roomId)) {
+        publishToChannel(roomId, message, excludeUserId);
+        return;
+    }
+    
+    // Members from the membership index (one query the first time a room is seen),
+    // looked up before taking the connections lock
+    std::unordered_set<std::string> roomMembers;
+    if (roomId != "global") {
+        try {
+            ensureMembershipLoaded(roomId);
+            roomMembers = membershipIndex_.memberIds(roomId);
+        } catch (...) {
+            Logger::warning("Could not get room members for: " + roomId);
+        }
+    }
+    
+    ProfiledLock lock(connectionsMutex_);
+    
+    // Special handling for "global" room - broadcast to ALL authenticated users
+    if (roomId == "global") {
+        int sent = 0;
+        for (const auto& [key, state] : connections_) {
+            if (state.authenticated && state.wsPtr && state.userId != excludeUserId) {
+                sendTracked(state.wsPtr, message);
+                sent++;
+            }
+        }
+        Logger::info("📢 Broadcast to global room: " + std::to_string(sent) + " users");
+        return;
+    }
+    
+    // For other rooms, send to all room members (not just currently viewing)
+    int sent = 0;
+    for (const auto& [key, state] : connections_) {
+        // Skip excluded user (usually sender) and unauthenticated users
+        if (!state.authenticated || !state.wsPtr || state.userId == excludeUserId) {
+            continue;
+        }
+        
+        // Member of this room (membership index), or currently viewing it
+        bool shouldSend = roomMembers.count(state.userId) > 0 || state.currentRoom == roomId;
+        
+        if (shouldSend) {
+            sendTracked(state.wsPtr, message);
+            sent++;
+        }
+    }
+    
+    Logger::info("📢 Broadcast to room '" + roomId + "': " + std::to_string(sent) + " users");
+}
+
+void WebSocketServer::sendToUser(const std::string& userId, const std::string& message) {
+    ProfiledLock lock(connectionsMutex_);
+    
+    Logger::info("🔍 sendToUser looking for userId: " + userId);
+    Logger::info("🔍 Total connections: " + std::to_string(connections_.size()));
+    
+    for (const auto& [key, state] : connections_) {
+        Logger::debug("🔍 Checking connection: userId=" + state.userId + ", authenticated=" + std::to_string(state.authenticated));
+        if (state.authenticated && state.wsPtr && state.userId == userId) {
+            sendTracked(state.wsPtr, message);
+            Logger::info("📤 Message sent to user: " + userId);
+            return;
+        }
+    }
+    
+    Logger::warning("User not found or not connected: " + userId);
+}
+
+void WebSocketServer::handleTypingJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        bool isTyping = msg.value("isTyping", false);
+        
+        // No typing indicators in broadcast channels
+        if (channelFanout_.isChannel(msg.value("roomId", ""))) {
+            return;
+        }
+        
+        json response = {
+            {"type", "typing"},
+            {"userId", data->userId},
+            {"username", data->username},
+            {"isTyping", isTyping}
+        };
+        
+        // Broadcast to room, excluding sender
+        broadcastToRoom("global", response.dump(), data->userId);
+        
+    } catch (const std::exception& e) {
+        Logger::error("Typing handler error: " + std::string(e.what()));
+    }
+}
+
+void WebSocketServer::handleGetOnlineUsersJson(void* wsPtr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* currentUser = ws->getUserData();
+        
+        // Get online user IDs from connections
+        std::set<std::string> onlineUserIds;
+        {
+            ProfiledLock lock(connectionsMutex_);
+            for (const auto& [ptr, state] : connections_) {
+                if (state.authenticated && !state.userId.empty()) {
+                    onlineUserIds.insert(state.userId);
+                }
+            }
+        }
+        
+        // Get all users from database and mark online status
+        json usersArray = json::array();
+        auto db = authManager_->getDatabase();
+        if (db) {
+            auto allUsers = db->getAllUsers();
+            for (const auto& user : allUsers) {
+                // Don't include current user in the list
+                if (user.userId == currentUser->userId) continue;
+                
+                bool isOnline = onlineUserIds.find(user.userId) != onlineUserIds.end();
+                usersArray.push_back({
+                    {"userId", user.userId},
+                    {"username", user.username},
+                    {"online", isOnline},
+                    {"status", isOnline ? "online" : "offline"}
+                });
+            }
+        }
+        
+        json response = {
+            {"type", "online_users"},
+            {"users", usersArray},
+            {"count", usersArray.size()}
+        };
+        
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info("📋 Sent users list: " + std::to_string(usersArray.size()) + " users (" + std::to_string(onlineUserIds.size()) + " online)");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Get online users error: " + std::string(e.what()));
+    }
+}
+
+void WebSocketServer::handleSearchUsersJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string query = msg.value("query", "");
+        std::string cursor = msg.value("cursor", "");
+        size_t limit = std::clamp<size_t>(msg.value("limit", 20), 1, 50);
+        
+        auto isOnline = [this](const std::string& userId) { return membershipIndex_.isOnline(userId); };
+        auto toJson = [](const UserDirectory::Entry& user) {
+            return json{
+                {"userId", user.userId},
+                {"username", user.username},
+                {"displayName", user.displayName.empty() ? user.username : user.displayName},
+                {"avatar", user.avatar},
+                {"statusMessage", user.statusMessage},
+                {"online", user.online}
+            };
+        };
+        
+        json users = json::array();
+        json response = {
+            {"type", "search_users_result"},
+            {"query", query}
+        };
+        
+        if (query.empty()) {
+            // No query: alphabetical listing, one page at a time
+            auto page = userDirectory_->list(cursor, limit, isOnline);
+            for (const auto& user : page.users) {
+                users.push_back(toJson(user));
+            }
+            if (!page.nextCursor.empty()) {
+                response["nextCursor"] = page.nextCursor;
+            }
+        } else {
+            for (const auto& user : userDirectory_->search(query, limit, data->userId, isOnline)) {
+                users.push_back(toJson(user));
+            }
+        }
+        
+        response["users"] = users;
+        sendJsonMessage(wsPtr, response.dump());
+        
+    } catch (const std::exception& e) {
+        Logger::error("Search users error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to search users");
+    }
+}
+
+void WebSocketServer::handleEditMessageJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string messageId = msg.value("messageId", "");
+        std::string newContent = msg.value("newContent", "");
+        std::string roomId = msg.value("roomId", "");
+        
+        if (messageId.empty() || newContent.empty()) {
+            sendErrorJson(wsPtr, "Missing messageId or newContent");
+            return;
+        }
+        
+        Logger::info("✏️ Edit message request: " + messageId + " by " + data->username);
+        
+        std::string userId = data->userId;
+        postToMessageRoom(messageId, userId, roomId, [this, wsPtr, messageId, newContent, userId]
+                                                     (std::optional<Message> message, uint64_t seq, MySQLClient* db) {
+            // Verify user owns this message, then update it
+            std::string error;
+            if (!message) {
+                error = "Message not found";
+            } else if (message->senderId != userId) {
+                error = "You can only edit your own messages";
+            } else if (!db->updateMessageContent(messageId, userId, newContent)) {
+                error = "Failed to edit message";
+            }
+            if (!error.empty()) {
+                runOnLoop([this, wsPtr, error]() {
+                    if (isConnectionAlive(wsPtr)) {
+                        sendErrorJson(wsPtr, error);
+                    }
+                });
+                return;
+            }
+            
+            std::string storedRoomId = message->roomId;
+            historyCache_.updateContent(storedRoomId, messageId, newContent);
+            if (translator_) {
+                translator_->invalidate(messageId);
+            }
+            if (semanticIndex_) {
+                message->content = newContent;
+                message->compressed &= ~Message::CONTENT_COMPRESSED;
+                semanticIndex_->enqueue(*message);
+            }
+            
+            json response = {
+                {"type", "message_edited"},
+                {"messageId", messageId},
+                {"newContent", newContent},
+                {"editedAt", std::time(nullptr)},
+                {"userId", userId}
+            };
+            if (seq > 0) {
+                response["seq"] = seq;
+            }
+            std::string payload = response.dump();
+            runOnLoop([this, wsPtr, storedRoomId, payload, userId]() {
+                // Send to sender first, then the room (excluding sender)
+                if (isConnectionAlive(wsPtr)) {
+                    sendJsonMessage(wsPtr, payload);
+                }
+                broadcastToRoom(storedRoomId, payload, userId);
+                Logger::info("✅ Message edited and broadcasted");
+            });
+        });
+        
+    } catch (const std::exception& e) {
+        Logger::error("Edit message error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to edit message");
+    }
+}
+
+void WebSocketServer::handleDeleteMessageJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string messageId = msg.value("messageId", "");
+        std::string roomId = msg.value("roomId", "");
+        
+        if (messageId.empty()) {
+            sendErrorJson(wsPtr, "Missing messageId");
+            return;
+        }
+        
+        Logger::info("🗑️ Delete message request: " + messageId + " by " + data->username);
+        
+        std::string userId = data->userId;
+        postToMessageRoom(messageId, userId, roomId, [this, wsPtr, messageId, userId]
+                                                     (std::optional<Message> message, uint64_t seq, MySQLClient* db) {
+            // Own messages, or any message for room admins/owners; soft delete (is_deleted=1)
+            std::string error;
+            if (!message) {
+                error = "Message not found";
+            } else if (message->senderId != userId && !db->hasMemberPermission(message->roomId, userId, "kick")) {
+                error = "You can only delete your own messages";
+            } else if (!db->softDeleteMessage(messageId, message->roomId)) {
+                error = "Failed to delete message";
+            }
+            if (!error.empty()) {
+                runOnLoop([this, wsPtr, error]() {
+                    if (isConnectionAlive(wsPtr)) {
+                        sendErrorJson(wsPtr, error);
+                    }
+                });
+                return;
+            }
+            
+            std::string storedRoomId = message->roomId;
+            historyCache_.invalidate(storedRoomId);
+            if (translator_) {
+                translator_->invalidate(messageId);
+            }
+            if (semanticIndex_) {
+                semanticIndex_->remove(messageId);
+            }
+            
+            json response = {
+                {"type", "message_deleted"},
+                {"messageId", messageId},
+                {"userId", userId}
+            };
+            if (seq > 0) {
+                response["seq"] = seq;
+            }
+            std::string payload = response.dump();
+            runOnLoop([this, wsPtr, storedRoomId, payload, userId]() {
+                // Send to sender first, then the room (excluding sender)
+                if (isConnectionAlive(wsPtr)) {
+                    sendJsonMessage(wsPtr, payload);
+                }
+                broadcastToRoom(storedRoomId, payload, userId);
+                Logger::info("✅ Message deleted and broadcasted");
+            });
+        });
+        
+    } catch (const std::exception& e) {
+        Logger::error("Delete message error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to delete message");
+    }
+}
+
+// Room management handlers
+
+void WebSocketServer::handleCreateRoomJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        // Support both 'name' and 'roomName' for compatibility
+        std::string roomName = msg.value("name", msg.value("roomName", ""));
+        std::string roomType = msg.value("roomType", "public");
+        
+        if (roomName.empty()) {
+            sendErrorJson(wsPtr, "Room name required");
+            return;
+        }
+        
+        // Generate room ID
+        std::string roomId = "room-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
+        
+        Logger::info("🏠 Creating room: " + roomName + " (" + roomId + ") by " + data->username);
+        
+        // Save to database
+        auto db = authManager_->getDatabase();
+        if (db) {
+            Room room;
+            room.roomId = roomId;
+            room.name = roomName;
+            room.creatorId = data->userId;
+            room.roomType = roomType == "channel" ? "channel" : "public";
+            
+            if (db->createRoom(room)) {
+                Logger::info("✅ Room saved to database: " + roomId);
+                if (room.roomType == "channel") {
+                    channelFanout_.registerChannel(roomId);
+                }
+            } else {
+                Logger::warning("⚠️ Failed to save room to database");
+            }
+        }
+        
+        json response = {
+            {"type", "room_created"},
+            {"roomId", roomId},
+            {"roomName", roomName},
+            {"roomType", roomType}
+        };
+        
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info("✅ Room created: " + roomId);
+        
+    } catch (const std::exception& e) {
+        Logger::error("Create room error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to create room");
+    }
+}
+
+void WebSocketServer::handleJoinRoomJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        
+        if (roomId.empty()) {
+            sendErrorJson(wsPtr, "Room ID required");
+            return;
+        }
+        
+        Logger::info("🚪 User joining room: " + data->username + " → " + roomId);
+        auto joinStart = std::chrono::steady_clock::now();
+        
+        // Update currentRoom in PerSocketData
+        data->currentRoom = roomId;
+        
+        // Update currentRoom in connections_ map
+        {
+            ProfiledLock lock(connectionsMutex_);
+            if (connections_.count(wsPtr)) {
+                connections_[wsPtr].currentRoom = roomId;
+            }
+        }
+        
+        bool isChannel = channelFanout_.isChannel(roomId);
+        if (isChannel) {
+            // Channel readers are in-memory subscriptions - no room_members row
+            channelFanout_.subscribe(roomId, wsPtr, data->userId);
+        } else {
+            // Save to room_members table
+            bool added = dbClient_->addRoomMember(roomId, data->userId);
+            if (!added) {
+                Logger::warning("User already member or failed to add to room");
+            } else if (auto self = dbClient_->getUserById(data->userId)) {
+                membershipIndex_.addMember(roomId, *self);
+            }
+        }
+        ensureMembershipLoaded(roomId);
+        
+        // For DM, use conversation_id from database (Discord/Telegram style)
+        std::string queryRoomId = roomId;
+        if (roomId.rfind("dm_", 0) == 0) {
+            std::string targetUserId = roomId.substr(3);
+            Logger::info("📦 DM join - user=" + data->userId + ", target=" + targetUserId);
+            // Get or create DM conversation (like Discord channel)
+            queryRoomId = resolveStorageRoomId(data->userId, roomId);
+            Logger::info("📦 DM conversation roomId for query: " + queryRoomId);
+        }
+        
+        // Load room history using conversation_id
+        Logger::info("📚 Loading history for queryRoomId: " + queryRoomId);
+        auto historyMessages = loadRoomHistory(queryRoomId);
+        Logger::info("📚 Got " + std::to_string(historyMessages.size()) + " messages from DB for roomId=" + queryRoomId);
+        json history = json::array();
+        for (auto& m : historyMessages) {
+            message_codec::inflate(m);
+            // For DM history, convert roomId back to user's perspective
+            std::string displayRoomId = m.roomId;
+            if (m.roomId.rfind("dm_", 0) == 0) {
+                // This is a DM conversation_id
+                // Convert to user's perspective (dm_otherUserId)
+                displayRoomId = roomId;  // Use the roomId the user requested
+            }
+            json msgJson = {
+                {"messageId", m.messageId},
+                {"roomId", displayRoomId},
+                {"userId", m.senderId},
+                {"username", m.senderName},
+                {"content", m.content},
+                {"timestamp", m.timestamp * 1000}
+            };
+            // Thread summary (materialized at ingestion - no per-message lookups)
+            if (!m.replyToId.empty()) {
+                msgJson["replyToId"] = m.replyToId;
+            }
+            if (m.replyCount > 0) {
+                msgJson["replyCount"] = m.replyCount;
+                msgJson["lastReplyAt"] = m.lastReplyAt * 1000;
+            }
+            if (m.expiresAt > 0) {
+                msgJson["expiresAt"] = m.expiresAt * 1000;
+            }
+            // Add metadata if present
+            if (!m.metadata.empty()) {
+                try {
+                    msgJson["metadata"] = json::parse(m.metadata);
+                } catch (...) {}
+            }
+            history.push_back(msgJson);
+        }
+        
+        // Ack immediately with the room header and first screen of messages;
+        // polls follow as a separate frame (see sendRoomDetails) and the member
+        // list is paged on demand via get_members
+        json response = {
+            {"type", "room_joined"},
+            {"roomId", roomId},
+            {"userId", data->userId},
+            {"username", data->username},
+            {"history", history},
+            {"memberCount", membershipIndex_.memberCount(roomId)},
+            {"onlineCount", membershipIndex_.onlineCount(roomId)}
+        };
+        if (uint32_t ttl = expiryIndex_.roomTtl(queryRoomId)) {
+            response["messageTtl"] = ttl;
+        }
+        if (isChannel) {
+            response["roomType"] = "channel";
+            response["subscriberCount"] = channelFanout_.subscriberCount(roomId);
+            response["canPost"] = canPostToRoom(roomId, data->userId);
+        }
+        
+        // Send to user who joined
+        sendJsonMessage(wsPtr, response.dump());
+        
+        auto firstMessageMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - joinStart).count();
+        Logger::info("⏱️ Join " + roomId + ": first messages sent in " + std::to_string(firstMessageMs) + "ms");
+        
+        // Load the heavier parts on the next loop iteration so the ack is flushed first
+        std::string userId = data->userId;
+        uWS::Loop::get()->defer([this, wsPtr, userId, roomId, queryRoomId, joinStart]() {
+            sendRoomDetails(wsPtr, userId, roomId, queryRoomId, joinStart);
+        });
+        
+        // Broadcast to others in room (channels don't announce readers)
+        if (!isChannel) {
+            json broadcast = {
+                {"type", "user_joined_room"},
+                {"roomId", roomId},
+                {"userId", data->userId},
+                {"username", data->username}
+            };
+            broadcastToRoom(roomId, broadcast.dump(), data->userId);
+        }
+        
+        Logger::info("✅ User joined room: " + roomId + " (loaded " + std::to_string(historyMessages.size()) + " messages)");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Join room error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to join room");
+    }
+}
+
+bool WebSocketServer::isConnectionInRoom(void* wsPtr, const std::string& userId, const std::string& roomId) {
+    ProfiledLock lock(connectionsMutex_);
+    auto it = connections_.find(wsPtr);
+    return it != connections_.end() &&
+           it->second.userId == userId &&
+           it->second.currentRoom == roomId;
+}
+
+bool WebSocketServer::isConnectionAlive(void* wsPtr) {
+    ProfiledLock lock(connectionsMutex_);
+    return connections_.count(wsPtr) > 0;
+}
+
+void WebSocketServer::runOnLoop(std::function<void()> fn) {
+    // uWS::Loop::defer is safe to call from any thread
+    if (loop_) {
+        loop_->defer(std::move(fn));
+    } else {
+        fn();
+    }
+}
+
+void WebSocketServer::sendRoomDetails(void* wsPtr, const std::string& userId,
+                                      const std::string& roomId, const std::string& queryRoomId,
+                                      std::chrono::steady_clock::time_point joinStart) {
+    try {
+        // Socket may have closed or switched rooms since the ack
+        if (!isConnectionInRoom(wsPtr, userId, roomId)) {
+            return;
+        }
+        
+        // Load active polls for this room (try both roomId and queryRoomId for DM)
+        auto roomPolls = dbClient_->getRoomPolls(roomId, false);
+        if (roomPolls.empty() && roomId != queryRoomId) {
+            roomPolls = dbClient_->getRoomPolls(queryRoomId, false);
+        }
+        json pollsJson = json::array();
+        for (const auto& poll : roomPolls) {
+            json optionsJson = json::array();
+            for (const auto& opt : poll.options) {
+                optionsJson.push_back({
+                    {"id", opt.optionId},
+                    {"text", opt.text},
+                    {"votes", opt.voteCount},
+                    {"voters", opt.voterIds}
+                });
+            }
+            pollsJson.push_back({
+                {"id", poll.pollId},
+                {"question", poll.question},
+                {"options", optionsJson},
+                {"createdBy", poll.createdBy},
+                {"createdAt", poll.createdAt},
+                {"isClosed", poll.isClosed},
+                {"roomId", roomId}
+            });
+        }
+        
+        json pollsFrame = {
+            {"type", "room_polls"},
+            {"roomId", roomId},
+            {"polls", pollsJson}
+        };
+        sendJsonMessage(wsPtr, pollsFrame.dump());
+        
+        auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - joinStart).count();
+        Logger::info("⏱️ Join " + roomId + ": " + std::to_string(roomPolls.size()) + " polls sent in " + std::to_string(totalMs) + "ms");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Room details error: " + std::string(e.what()));
+    }
+}
+
+bool WebSocketServer::ensureMembershipLoaded(const std::string& roomId) {
+    if (membershipIndex_.hasRoom(roomId)) {
+        return true;
+    }
+    // Unknown room IDs have no rows; they are not cached, so they cannot fill the index
+    auto members = dbClient_ ? dbClient_->getRoomMemberProfiles(roomId) : std::vector<User>{};
+    if (members.empty()) {
+        return false;
+    }
+    membershipIndex_.loadRoom(roomId, members);
+    Logger::debug("👥 Membership index loaded for " + roomId + ": " + std::to_string(members.size()) + " members");
+    return true;
+}
+
+bool WebSocketServer::canPostToRoom(const std::string& roomId, const std::string& userId) {
+    if (!channelFanout_.isChannel(roomId)) {
+        return true;
+    }
+    std::string role = dbClient_->getMemberRole(roomId, userId);
+    return role == "owner" || role == "admin";
+}
+
+void WebSocketServer::publishToChannel(const std::string& channelId, const std::string& message, const std::string& excludeUserId) {
+    // Serialize once, then push in paced batches so a 100k-reader channel
+    // does not stall the event loop for other rooms
+    auto targets = std::make_shared<std::vector<ChannelFanout::Subscription>>(channelFanout_.snapshot(channelId));
+    auto payload = std::make_shared<const std::string>(message);
+    
+    Logger::info("📣 Channel fan-out " + channelId + ": " + std::to_string(targets->size()) + " subscribers");
+    sendChannelBatch(targets, payload, excludeUserId, 0);
+}
+
+void WebSocketServer::sendChannelBatch(std::shared_ptr<std::vector<ChannelFanout::Subscription>> targets,
+                                       std::shared_ptr<const std::string> payload,
+                                       const std::string& excludeUserId, size_t offset) {
+    size_t end = std::min(offset + CHANNEL_FANOUT_BATCH, targets->size());
+    {
+        ProfiledLock lock(connectionsMutex_);
+        for (size_t i = offset; i < end; ++i) {
+            const auto& target = (*targets)[i];
+            if (target.userId == excludeUserId) continue;
+            
+            // Socket may have closed since the snapshot was taken
+            auto it = connections_.find(target.ws);
+            if (it == connections_.end() || it->second.userId != target.userId) continue;
+            
+            sendTracked(target.ws, *payload);
+        }
+    }
+    
+    if (end < targets->size()) {
+        uWS::Loop::get()->defer([this, targets, payload, excludeUserId, end]() {
+            sendChannelBatch(targets, payload, excludeUserId, end);
+        });
+    }
+}
+
+void WebSocketServer::handleGetMembersJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        std::string cursor = msg.value("cursor", "");
+        std::string prefix = msg.value("prefix", "");
+        int limit = std::clamp(msg.value("limit", 50), 1, 200);
+        
+        if (roomId.empty()) {
+            sendErrorJson(wsPtr, "Room ID required");
+            return;
+        }
+        
+        // Members of a loaded room are answered from memory; anyone else is checked like
+        // history: the room must exist, and private rooms are for members only
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        const std::string& userId = ws->getUserData()->userId;
+        if (roomId != "global" && roomId.rfind("dm_", 0) != 0 && !membershipIndex_.isMember(roomId, userId)) {
+            auto room = dbClient_->getRoom(roomId);
+            if (!room) {
+                sendErrorJson(wsPtr, "Room not found");
+                return;
+            }
+            if (room->roomType == "private" && dbClient_->getMemberRole(roomId, userId).empty()) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
+            }
+        }
+        
+        ensureMembershipLoaded(roomId);
+        auto page = membershipIndex_.getPage(roomId, cursor, static_cast<size_t>(limit), prefix);
+        
+        json membersJson = json::array();
+        for (const auto& member : page.members) {
+            membersJson.push_back({
+                {"userId", member.userId},
+                {"username", member.username},
+                {"avatar", member.avatar},
+                {"online", member.online}
+            });
+        }
+        
+        json response = {
+            {"type", "room_members"},
+            {"roomId", roomId},
+            {"members", membersJson},
+            {"cursor", cursor},
+            {"prefix", prefix},
+            {"hasMore", !page.nextCursor.empty()},
+            {"memberCount", membershipIndex_.memberCount(roomId)},
+            {"onlineCount", membershipIndex_.onlineCount(roomId)}
+        };
+        if (!page.nextCursor.empty()) {
+            response["nextCursor"] = page.nextCursor;
+        }
+        
+        sendJsonMessage(wsPtr, response.dump());
+        
+    } catch (const std::exception& e) {
+        Logger::error("Get members error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to load members");
+    }
+}
+
+void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        
+        if (roomId.empty()) {
+            sendErrorJson(wsPtr, "Room ID required");
+            return;
+        }
+        
+        Logger::info("🚪 User leaving room: " + data->username + " ← " + roomId);
+        
+        // Channel readers only hold an in-memory subscription
+        if (channelFanout_.isChannel(roomId)) {
+            channelFanout_.unsubscribe(roomId, wsPtr);
+            json response = {
+                {"type", "room_left"},
+                {"roomId", roomId},
+                {"success", true}
+            };
+            sendJsonMessage(wsPtr, response.dump());
+            return;
+        }
+        
+        // Broadcast to others BEFORE clearing room (so they still get the message)
+        json broadcast = {
+            {"type", "user_left_room"},
+            {"roomId", roomId},
+            {"userId", data->userId},
+            {"username", data->username}
+        };
+        broadcastToRoom(roomId, broadcast.dump(), data->userId);
+        
+        // Clear currentRoom in PerSocketData
+        data->currentRoom = "";
+        
+        // Clear currentRoom in connections_ map
+        {
+            ProfiledLock lock(connectionsMutex_);
+            if (connections_.count(wsPtr)) {
+                connections_[wsPtr].currentRoom = "";
+            }
+        }
+        
+        // Remove from room_members table
+        bool removed = dbClient_->removeRoomMember(roomId, data->userId);
+        membershipIndex_.removeMember(roomId, data->userId);
+        if (!removed) {
+            Logger::warning("User was not member of room or failed to remove");
+        }
+        
+        json response = {
+            {"type", "room_left"},
+            {"roomId", roomId},
+            {"success", removed}
+        };
+        sendJsonMessage(wsPtr, response.dump());
+        
+        Logger::info("✅ User left room: " + roomId);
+        
+    } catch (const std::exception& e) {
+        Logger::error("Leave room error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to leave room");
+    }
+}
+
+void WebSocketServer::handleGetRoomsJson(void* wsPtr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json rooms = json::array();
+        
+        // Always include global room
+        rooms.push_back({
+            {"roomId", "global"},
+            {"roomName", "Global Chat"},
+            {"roomType", "public"},
+            {"unread", 0}
+        });
+        
+        // Query user's rooms from database
+        try {
+            auto session = dbClient_->getSession();
+            if (session) {
+                auto result = session->sql(
+                    "SELECT r.room_id, r.name, r.room_type, rm.role "
+                    "FROM rooms r "
+                    "JOIN room_members rm ON r.room_id = rm.room_id "
+                    "WHERE rm.user_id = ? ORDER BY r.created_at DESC"
+                ).bind(data->userId).execute();
+                
+                mysqlx::Row row;
+                while ((row = result.fetchOne())) {
+                    rooms.push_back({
+                        {"roomId", row[0].get<std::string>()},
+                        {"roomName", row[1].get<std::string>()},
+                        {"roomType", row[2].get<std::string>()},
+                        {"role", row[3].get<std::string>()},
+                        {"unread", 0}
+                    });
+                }
+            }
+        } catch (const std::exception& e) {
+            Logger::warning("Failed to query user rooms: " + std::string(e.what()));
+            // Continue with just global room
+        }
         
-        // HTTP health check
-        app.get("/health", [](auto* res, auto* req) {
-            res->writeStatus("200 OK")
-               ->writeHeader("Content-Type", "application/json")
-               ->end("{\"status\":\"ok\",\"service\":\"chatbox-websocket\"}");
-        });
+        json response = {
+            {"type", "room_list"},
+            {"rooms", rooms},
+            {"count", rooms.size()}
+        };
         
-        // Listen
-        app.listen(port_, [this](auto* listenSocket) {
-            if (listenSocket) {
-                Logger::info("========================================");
-                Logger::info("✅ WebSocket server LIVE!");
-                Logger::info("========================================"); 
-                Logger::info("Listening on: 0.0.0.0:" + std::to_string(port_));
-                Logger::info("WebSocket: ws://localhost:" + std::to_string(port_) + "/");
-                Logger::info("Health: http://localhost:" + std::to_string(port_) + "/health");
-                Logger::info("");
-                Logger::info("Protocol: ChatBox v1");
-                Logger::info("  - register: Create new account");
-                Logger::info("  - login: Authenticate user");
-                Logger::info("  - chat: Send message");
-                Logger::info("  - ping: Keep-alive");
-                Logger::info("========================================");
-                Logger::info("");
-                Logger::info("Ready for protocol messages! 🚀");
-                Logger::info("");
-            } else {
-                Logger::error("❌ Failed to listen on port " + std::to_string(port_));
-                running_ = false;
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info("📋 Sent room list: " + std::to_string(rooms.size()) + " rooms");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Get rooms error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to get rooms");
+    }
+}
+
+void WebSocketServer::handleSearchMessagesJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        
+        json msg = json::parse(jsonStr);
+        std::string query = msg.value("query", "");
+        std::string roomId = msg.value("roomId", "");
+        int limit = msg.value("limit", 50);
+        
+        if (query.empty()) {
+            sendErrorJson(wsPtr, "Search query required");
+            return;
+        }
+        
+        Logger::info("🔍 Search request: '" + query + "' in room: " + (roomId.empty() ? "all" : roomId));
+        
+        json results = json::array();
+        
+        // Query database with LIKE search
+        auto db = authManager_->getDatabase();
+        if (db) {
+            auto messages = db->searchMessages(query, roomId, limit);
+            
+            for (const auto& m : messages) {
+                results.push_back({
+                    {"messageId", m.messageId},
+                    {"roomId", m.roomId},
+                    {"senderId", m.senderId},
+                    {"senderName", m.senderName},
+                    {"content", m.content},
+                    {"messageType", m.messageType},
+                    {"timestamp", m.timestamp}
+                });
             }
-        });
+        }
         
-        app.run();
+        json response = {
+            {"type", "search_results"},
+            {"query", query},
+            {"results", results},
+            {"count", results.size()}
+        };
+        
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info("✅ Search completed: " + std::to_string(results.size()) + " results");
         
     } catch (const std::exception& e) {
-        Logger::error("WebSocket server error: " + std::string(e.what()));
-        running_ = false;
+        Logger::error("Search error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Search failed");
+    }
+}
+
+void WebSocketServer::handleMarkReadJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string messageId = msg.value("messageId", "");
+        std::string roomId = msg.value("roomId", "global");
+        
+        if (messageId.empty()) {
+            sendErrorJson(wsPtr, "Message ID required");
+            return;
+        }
+        
+        // Read receipts are disabled for broadcast channels
+        if (channelFanout_.isChannel(roomId)) {
+            return;
+        }
+        
+        Logger::info("✓✓ Mark read: " + messageId + " by " + data->username);
+        
+        // Update read status in database
+        if (!dbClient_->markMessagesRead(data->userId, {messageId})) {
+            Logger::warning("Failed to save read status for " + messageId);
+            // Continue anyway - still broadcast the read receipt
+        }
+        
+        broadcastReadReceipt(messageId, roomId, data->userId, data->username);
+        Logger::info("✅ Read receipt sent");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Mark read error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to mark message as read");
+    }
+}
+
+void WebSocketServer::broadcastReadReceipt(const std::string& messageId, const std::string& roomId,
+                                           const std::string& userId, const std::string& username) {
+    json response = {
+        {"type", "message_read"},
+        {"messageId", messageId},
+        {"roomId", roomId},
+        {"readBy", userId},
+        {"username", username},
+        {"timestamp", std::time(nullptr) * 1000}
+    };
+    
+    // Broadcast to room (sender will update their UI)
+    broadcastToRoom(roomId, response.dump());
+}
+
+bool WebSocketServer::sendToSession(const std::string& sessionId, const std::string& message) {
+    ProfiledLock lock(connectionsMutex_);
+    
+    for (const auto& [key, state] : connections_) {
+        if (state.authenticated && state.wsPtr && state.sessionId == sessionId) {
+            sendTracked(state.wsPtr, message);
+            Logger::debug("📤 Sent to session: " + sessionId);
+            return true;
+        }
     }
     
-    Logger::info("WebSocket server stopped");
+    Logger::warning("Session not found: " + sessionId);
+    return false;
 }
 
-void WebSocketServer::stop() {
-    if (running_) {
-        running_ = false;
-        Logger::info("Stopping WebSocket server...");
+// ============================================================================
+// MESSAGE INGESTION / HISTORY
+// ============================================================================
+
+bool WebSocketServer::saveMessage(const Message& message, MySQLClient* db) {
+    // Room actors pass their own connection; the event loop uses the shared one
+    if (!db) {
+        db = authManager_->getDatabase().get();
+    }
+    
+    // Disappearing messages: stamp the room TTL unless the caller already did
+    uint64_t expiresAt = message.expiresAt ? message.expiresAt
+                                           : expiryIndex_.deadlineFor(message.roomId, message.timestamp);
+    Message stamped;
+    const Message* stored = &message;
+    if (expiresAt != message.expiresAt) {
+        stamped = message;
+        stamped.expiresAt = expiresAt;
+        stored = &stamped;
     }
+    
+    if (!db || !db->createMessage(*stored)) {
+        return false;
+    }
+    
+    recordSavedMessage(*stored);
+    return true;
 }
 
-// Protocol message handlers
+bool WebSocketServer::saveMessages(std::vector<Message>& messages, MySQLClient* db) {
+    if (!db) {
+        db = authManager_->getDatabase().get();
+    }
+    
+    for (auto& message : messages) {
+        if (!message.expiresAt) {
+            message.expiresAt = expiryIndex_.deadlineFor(message.roomId, message.timestamp);
+        }
+    }
+    
+    if (!db || !db->createMessages(messages)) {
+        return false;
+    }
+    
+    for (const auto& message : messages) {
+        recordSavedMessage(message);
+    }
+    return true;
+}
 
-void WebSocketServer::sendJsonMessage(void* wsPtr, const std::string& jsonStr) {
-    // Cast back to proper WebSocket type - we know it's non-SSL from our App setup
-    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-    ws->send(jsonStr, uWS::OpCode::TEXT);
+void WebSocketServer::recordSavedMessage(const Message& message) {
+    historyCache_.append(message);
+    if (!message.replyToId.empty()) {
+        historyCache_.recordReply(message.roomId, message.replyToId, message.timestamp);
+    }
+    if (message.expiresAt) {
+        expiryIndex_.add(message.messageId, message.roomId, message.expiresAt);
+    }
+    activityStats_.record(message.roomId, message.senderId, message.timestamp);
+    publishWebhookEvent(message);
+    requestLinkPreview(message);
+    if (summarizer_) {
+        summarizer_->append(message);
+    }
+    if (semanticIndex_) {
+        semanticIndex_->enqueue(message);
+    }
 }
 
-void WebSocketServer::sendErrorJson(void* wsPtr, const std::string& error) {
-    json response = {
-        {"type", "error"},
-        {"message", error}
+std::vector<Message> WebSocketServer::loadRoomHistory(const std::string& storageRoomId) {
+    auto cached = historyCache_.get(storageRoomId);
+    if (cached) {
+        Logger::debug("📚 History cache hit: " + storageRoomId);
+        return *cached;
+    }
+    
+    // A message saved on a room actor during the read must not be cached away
+    uint64_t version = historyCache_.version(storageRoomId);
+    auto messages = dbClient_->getMessagesByRoom(storageRoomId, 50);
+    historyCache_.put(storageRoomId, messages, version);
+    return messages;
+}
+
+std::string WebSocketServer::resolveStorageRoomId(const std::string& userId, const std::string& roomId) {
+    // For DM, use conversation_id from database (Discord/Telegram style)
+    if (roomId.rfind("dm_", 0) == 0) {
+        std::string otherId = roomId.substr(3);
+        std::string key = userId < otherId ? userId + "|" + otherId : otherId + "|" + userId;
+        if (auto cached = dmConversations_.get(key)) {
+            return *cached;
+        }
+        std::string conversationId = dbClient_->getOrCreateDmConversation(userId, otherId);
+        dmConversations_.put(key, conversationId);
+        return conversationId;
+    }
+    return roomId;
+}
+
+void WebSocketServer::postRoomMessage(void* wsPtr, Message message, json response, const std::string& roomId,
+                                      const std::string& failure, const std::string& sentLog) {
+    message.expiresAt = expiryIndex_.deadlineFor(message.roomId, message.timestamp);
+    if (message.expiresAt) {
+        response["expiresAt"] = message.expiresAt * 1000;
+    }
+    
+    std::string userId = message.senderId;
+    auto persistAndDeliver = [this, wsPtr, message, response, roomId, userId, failure, sentLog]
+                             (MySQLClient* db, uint64_t seq) mutable {
+        bool saved = saveMessage(message, db);
+        if (saved && seq > 0) {
+            response["seq"] = seq;
+        }
+        std::string payload = saved ? response.dump() : "";
+        runOnLoop([this, wsPtr, saved, payload, roomId, userId, failure, sentLog]() {
+            if (!saved) {
+                if (isConnectionAlive(wsPtr)) {
+                    sendErrorJson(wsPtr, failure);
+                }
+                return;
+            }
+            if (isConnectionAlive(wsPtr)) {
+                sendJsonMessage(wsPtr, payload);  // Echo to sender
+            }
+            broadcastToRoom(roomId, payload, userId);  // Broadcast to others
+            Logger::info(sentLog);
+        });
     };
-    sendJsonMessage(wsPtr, response.dump());
+    
+    bool posted = roomActors_.post(message.roomId, [persistAndDeliver](RoomActorPool::RoomState& state, MySQLClient& db) mutable {
+        persistAndDeliver(&db, state.nextSeq++);
+    });
+    if (!posted) {
+        persistAndDeliver(nullptr, 0);
+    }
 }
 
-void WebSocketServer::handleRegisterJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::postToMessageRoom(const std::string& messageId, const std::string& userId,
+                                        const std::string& roomId, MessageTask task) {
+    // The owning actor is known up front when the client names the room; otherwise
+    // one lookup finds the stored room
+    std::string storageRoomId;
+    if (!roomId.empty()) {
+        storageRoomId = resolveStorageRoomId(userId, roomId);
+    } else if (auto located = dbClient_ ? dbClient_->getMessage(messageId) : std::nullopt) {
+        storageRoomId = located->roomId;
+    } else {
+        task(std::nullopt, 0, dbClient_.get());
+        return;
+    }
+    
+    // Re-read on the actor: the room's earlier inserts and edits have run by then
+    bool posted = roomActors_.post(storageRoomId, [messageId, storageRoomId, task](RoomActorPool::RoomState& state, MySQLClient& db) {
+        auto message = db.getMessage(messageId);
+        if (message && message->roomId != storageRoomId) {
+            message.reset();
+        }
+        uint64_t seq = message ? state.nextSeq++ : 0;
+        task(std::move(message), seq, &db);
+    });
+    if (!posted) {
+        std::optional<Message> message = dbClient_ ? dbClient_->getMessage(messageId) : std::nullopt;
+        if (message && message->roomId != storageRoomId) {
+            message.reset();
+        }
+        task(std::move(message), 0, dbClient_.get());
+    }
+}
+
+// ============================================================================
+// THREADS
+// ============================================================================
+
+void WebSocketServer::handleReplyMessageJson(void* wsPtr, const std::string& jsonStr) {
     try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
         json msg = json::parse(jsonStr);
+        std::string content = msg.value("content", "");
+        std::string replyToId = msg.value("replyToId", "");
+        std::string roomId = msg.value("roomId", "");
         
-        std::string username = msg.value("username", "");
-        std::string password = msg.value("password", "");
-        std::string email = msg.value("email", "");
+        if (content.empty() || replyToId.empty() || roomId.empty()) {
+            sendErrorJson(wsPtr, "content, replyToId and roomId required");
+            return;
+        }
         
-        if (username.empty() || password.empty()) {
-            sendErrorJson(wsPtr, "Username and password required");
+        if (!canPostToRoom(roomId, data->userId)) {
+            sendErrorJson(wsPtr, "Only channel admins can post");
             return;
         }
         
-        UserRegistration reg;
-        reg.username = username;
-        reg.password = password;
-        reg.email = email.empty() ? (username + "@chatbox.local") : email;
+        uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+        std::string messageId = newMessageId(data->userId, now);
+        std::string storageRoomId = resolveStorageRoomId(data->userId, roomId);
         
-        bool success = authManager_->registerUser(reg);
+        // Persist reply - createMessage bumps the parent's reply_count in the same ingestion step
+        Message reply;
+        reply.messageId = messageId;
+        reply.roomId = storageRoomId;
+        reply.senderId = data->userId;
+        reply.senderName = data->username;
+        reply.content = content;
+        reply.messageType = 0;
+        reply.replyToId = replyToId;
+        reply.timestamp = now;
+        reply.expiresAt = expiryIndex_.deadlineFor(storageRoomId, now);
         
         json response = {
-            {"type", "register_response"},
-            {"success", success},
-            {"message", success ? "Registration successful" : "Username already exists"}
+            {"type", "chat"},
+            {"messageId", messageId},
+            {"roomId", roomId},
+            {"userId", data->userId},
+            {"username", data->username},
+            {"content", content},
+            {"replyToId", replyToId},
+            {"timestamp", now * 1000}
+        };
+        if (reply.expiresAt) {
+            response["expiresAt"] = reply.expiresAt * 1000;
+        }
+        
+        std::string userId = data->userId;
+        std::string username = data->username;
+        auto persistAndDeliver = [this, wsPtr, reply, response, roomId, storageRoomId, replyToId, userId, username, now]
+                                 (MySQLClient* db, uint64_t seq) mutable {
+            if (!saveMessage(reply, db)) {
+                runOnLoop([this, wsPtr]() {
+                    if (isConnectionAlive(wsPtr)) {
+                        sendErrorJson(wsPtr, "Failed to send reply");
+                    }
+                });
+                return;
+            }
+            if (seq > 0) {
+                response["seq"] = seq;
+            }
+            
+            // Let clients update the "N replies" badge without fetching the thread
+            std::optional<uint32_t> replyCount;
+            if (auto cached = historyCache_.get(storageRoomId)) {
+                for (const auto& m : *cached) {
+                    if (m.messageId == replyToId) {
+                        replyCount = m.replyCount;
+                        break;
+                    }
+                }
+            }
+            if (!replyCount) {
+                auto parentMsg = db ? db->getMessage(replyToId) : dbClient_->getMessage(replyToId);
+                if (parentMsg) {
+                    replyCount = parentMsg->replyCount;
+                }
+            }
+            
+            runOnLoop([this, wsPtr, response, roomId, replyToId, replyCount, userId, username, now]() {
+                if (isConnectionAlive(wsPtr)) {
+                    sendJsonMessage(wsPtr, response.dump());
+                }
+                broadcastToRoom(roomId, response.dump(), userId);
+                
+                if (replyCount) {
+                    json threadUpdate = {
+                        {"type", "thread_updated"},
+                        {"roomId", roomId},
+                        {"messageId", replyToId},
+                        {"replyCount", *replyCount},
+                        {"lastReplyAt", now * 1000}
+                    };
+                    if (isConnectionAlive(wsPtr)) {
+                        sendJsonMessage(wsPtr, threadUpdate.dump());
+                    }
+                    broadcastToRoom(roomId, threadUpdate.dump(), userId);
+                }
+                
+                Logger::info("↩️ Reply sent by " + username);
+            });
         };
         
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info(success ? "✓ User registered: " + username : "✗ Registration failed: " + username);
+        bool posted = roomActors_.post(storageRoomId, [persistAndDeliver](RoomActorPool::RoomState& state, MySQLClient& db) mutable {
+            persistAndDeliver(&db, state.nextSeq++);
+        });
+        if (!posted) {
+            persistAndDeliver(nullptr, 0);
+        }
         
     } catch (const std::exception& e) {
-        Logger::error("Register error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Registration failed");
+        Logger::error("Reply message error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to send reply");
     }
 }
 
-void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleForwardMessageJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
+        std::string messageId = msg.value("messageId", "");
+        std::string sourceRoomId = msg.value("roomId", "");
         
-        std::string username = msg.value("username", "");
-        std::string password = msg.value("password", "");
+        // targetRoomIds forwards to many rooms at once; targetRoomId is the single-room form
+        std::vector<std::string> requested;
+        if (msg.contains("targetRoomIds") && msg["targetRoomIds"].is_array()) {
+            for (const auto& room : msg["targetRoomIds"]) {
+                if (room.is_string() && !room.get<std::string>().empty()) {
+                    requested.push_back(room.get<std::string>());
+                }
+            }
+        } else if (!msg.value("targetRoomId", "").empty()) {
+            requested.push_back(msg.value("targetRoomId", ""));
+        }
         
-        if (username.empty() || password.empty()) {
-            sendErrorJson(wsPtr, "Username and password required");
+        if (messageId.empty() || requested.empty()) {
+            sendErrorJson(wsPtr, "messageId and targetRoomId required");
+            return;
+        }
+        if (requested.size() > MAX_FORWARD_TARGETS) {
+            sendErrorJson(wsPtr, "Too many target rooms (max " + std::to_string(MAX_FORWARD_TARGETS) + ")");
             return;
         }
         
-        LoginResult result = authManager_->login(username, password);
+        std::vector<std::string> targets;
+        json failed = json::array();
+        std::set<std::string> seen;
+        for (const auto& room : requested) {
+            if (!seen.insert(room).second) {
+                continue;
+            }
+            if (canPostToRoom(room, data->userId)) {
+                targets.push_back(room);
+            } else {
+                failed.push_back({{"targetRoomId", room}, {"error", "Only channel admins can post"}});
+            }
+        }
+        if (targets.empty()) {
+            sendErrorJson(wsPtr, "Only channel admins can post");
+            return;
+        }
         
-        if (result.success) {
-            // Mark socket as authenticated
-            data->authenticated = true;
-            data->userId = result.userId;
-            data->username = username;
-            data->sessionId = "ws-session-" + result.userId;
-            
-            // Update connection state in connections_ map for broadcast
-            {
-                std::lock_guard<std::mutex> lock(connectionsMutex_);
-                if (connections_.find(wsPtr) != connections_.end()) {
-                    connections_[wsPtr].authenticated = true;
-                    connections_[wsPtr].userId = result.userId;
-                    connections_[wsPtr].username = username;
-                    Logger::info("📝 Updated connection state for: " + username);
-                }
+        std::string userId = data->userId;
+        std::string username = data->username;
+        
+        // Read the original once, then each owning room actor inserts its rooms' copies in
+        // one statement and stamps their seq; the fan-out runs on the loop as groups finish
+        auto forwardAll = [this, wsPtr, messageId, targets, failed, userId, username](MySQLClient* db) {
+            auto original = db ? db->getMessage(messageId) : dbClient_->getMessage(messageId);
+            if (!original) {
+                runOnLoop([this, wsPtr]() {
+                    if (isConnectionAlive(wsPtr)) {
+                        sendErrorJson(wsPtr, "Original message not found");
+                    }
+                });
+                return;
             }
             
-            // Get user's display name and avatar from database
-            std::string displayName = username;
-            std::string avatar = "";
-            try {
-                auto session = dbClient_->getSession();
-                if (session) {
-                    auto userResult = session->sql(
-                        "SELECT display_name, avatar_url FROM users WHERE user_id = ?"
-                    ).bind(result.userId).execute();
-                    auto row = userResult.fetchOne();
-                    if (row) {
-                        if (!row[0].isNull()) displayName = row[0].get<std::string>();
-                        if (!row[1].isNull()) avatar = row[1].get<std::string>();
-                    }
-                }
-            } catch (const std::exception& e) {
-                Logger::warning("Failed to get user profile: " + std::string(e.what()));
+            // Copies reuse the stored (possibly still compressed) content; only the
+            // metadata and the fan-out frame need the plain text
+            Message served = *original;
+            message_codec::inflate(served);
+            
+            // Copies keep the original's metadata, so attachments point at the same stored file
+            json metadata = json::parse(served.metadata.empty() ? "{}" : served.metadata, nullptr, false);
+            if (!metadata.is_object()) {
+                metadata = json::object();
             }
-
-            json response = {
-                {"type", "login_response"},
-                {"success", true},
-                {"token", result.token},
-                {"userId", result.userId},
-                {"username", displayName.empty() ? username : displayName},
-                {"avatar", avatar},
-                {"message", "Login successful"}
+            metadata["forwarded_from"] = messageId;
+            metadata["original_sender"] = served.senderName;
+            std::string metadataStr = metadata.dump();
+            
+            uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+            Message base;
+            base.senderId = userId;
+            base.senderName = username;
+            base.content = original->content;
+            base.compressed = original->compressed & Message::CONTENT_COMPRESSED;
+            base.messageType = original->messageType;
+            base.metadata = metadataStr;
+            base.timestamp = now;
+            
+            // Everything but the per-room fields is serialized once and shared by every room's frame
+            auto sharedTail = std::make_shared<const std::string>(json({
+                {"originalMessageId", messageId},
+                {"content", served.content},
+                {"messageType", served.messageType},
+                {"metadata", metadataStr},
+                {"forwardedBy", username},
+                {"originalSender", served.senderName},
+                {"timestamp", now * 1000}
+            }).dump().substr(1));
+            
+            // Collects the groups' results; only touched on the event loop
+            struct Progress {
+                size_t pendingGroups = 0;
+                std::vector<json> forwarded;   // By target index, null unless saved
+                json failed;
             };
+            auto progress = std::make_shared<Progress>();
+            progress->forwarded.resize(targets.size());
+            progress->failed = failed;
             
-            sendJsonMessage(wsPtr, response.dump());
-            Logger::info("✓ User logged in: " + username + " (userId: " + result.userId + ")");
+            // Target indexes by owning actor (one group without the pool)
+            std::map<size_t, std::vector<size_t>> groups;
+            for (size_t i = 0; i < targets.size(); ++i) {
+                groups[db ? roomActors_.workerFor(targets[i]) : 0].push_back(i);
+            }
+            progress->pendingGroups = groups.size();
             
-            // Send chat history for global room
-            try {
-                std::string defaultRoom = "global";
-                auto messages = authManager_->getDatabase()->getRecentMessages(defaultRoom, 50, 0);
-                
-                if (!messages.empty()) {
-                    Logger::info("📜 Sending " + std::to_string(messages.size()) + " history messages to " + username);
-                    
-                    json historyResponse = {
-                        {"type", "history"},
-                        {"roomId", defaultRoom},
-                        {"messages", json::array()}
-                    };
+            for (auto& [worker, indexes] : groups) {
+                auto saveGroup = [this, wsPtr, base, targets, indexes, sharedTail, progress, username]
+                                 (const std::vector<RoomActorPool::RoomState*>& states, MySQLClient* groupDb) {
+                    std::vector<Message> copies;
+                    std::vector<uint64_t> seqs;   // 0 = saved without an actor
+                    copies.reserve(indexes.size());
+                    for (size_t k = 0; k < indexes.size(); ++k) {
+                        Message copy = base;
+                        copy.messageId = newMessageId(base.senderId, base.timestamp);
+                        copy.roomId = targets[indexes[k]];
+                        copies.push_back(std::move(copy));
+                        seqs.push_back(states.empty() ? 0 : states[k]->nextSeq++);
+                    }
+                    bool saved = saveMessages(copies, groupDb);
                     
-                    for (const auto& msg : messages) {
-                        json msgJson = {
-                            {"messageId", msg.messageId},
-                            {"roomId", msg.roomId},
-                            {"userId", msg.senderId},
-                            {"username", msg.senderName},
-                            {"content", msg.content},
-                            {"timestamp", msg.timestamp}
-                        };
-                        // Include metadata if present
-                        if (!msg.metadata.empty()) {
-                            try {
-                                msgJson["metadata"] = json::parse(msg.metadata);
-                            } catch (...) {
-                                // Invalid JSON, skip metadata
+                    runOnLoop([this, wsPtr, saved, copies = std::move(copies), seqs, indexes, sharedTail, progress, username]() {
+                        for (size_t k = 0; k < copies.size(); ++k) {
+                            const Message& copy = copies[k];
+                            if (!saved) {
+                                progress->failed.push_back({{"targetRoomId", copy.roomId}, {"error", "Failed to save"}});
+                                continue;
                             }
+                            std::string seq = seqs[k] ? ",\"seq\":" + std::to_string(seqs[k]) : "";
+                            broadcastToRoom(copy.roomId, "{\"type\":\"message_forwarded\",\"messageId\":" + json(copy.messageId).dump() +
+                                                         ",\"targetRoomId\":" + json(copy.roomId).dump() + seq + "," + *sharedTail);
+                            progress->forwarded[indexes[k]] = {{"targetRoomId", copy.roomId}, {"messageId", copy.messageId}};
                         }
-                        historyResponse["messages"].push_back(msgJson);
-                    }
-                    
-                    sendJsonMessage(wsPtr, historyResponse.dump());
+                        if (--progress->pendingGroups > 0) {
+                            return;
+                        }
+                        
+                        json forwarded = json::array();
+                        for (const auto& entry : progress->forwarded) {
+                            if (!entry.is_null()) {
+                                forwarded.push_back(entry);
+                            }
+                        }
+                        if (!isConnectionAlive(wsPtr)) {
+                            return;
+                        }
+                        if (forwarded.empty()) {
+                            sendErrorJson(wsPtr, "Failed to forward message");
+                            return;
+                        }
+                        sendJsonMessage(wsPtr, json({
+                            {"type", "forward_success"},
+                            {"messageId", forwarded.front()["messageId"]},
+                            {"forwarded", forwarded},
+                            {"failed", progress->failed}
+                        }).dump());
+                        Logger::info("↗️ Message forwarded to " + std::to_string(forwarded.size()) + " room(s) by " + username);
+                    });
+                };
+                
+                std::vector<std::string> rooms;
+                for (size_t i : indexes) {
+                    rooms.push_back(targets[i]);
+                }
+                bool posted = db && roomActors_.postBatch(rooms, [saveGroup](const std::vector<RoomActorPool::RoomState*>& states, MySQLClient& groupDb) {
+                    saveGroup(states, &groupDb);
+                });
+                if (!posted) {
+                    saveGroup({}, db);   // No pool, or it is stopping: save on this thread's connection
                 }
-            } catch (const std::exception& e) {
-                Logger::error("Failed to load history: " + std::string(e.what()));
             }
-            
-            // Broadcast user joined to all other users
-            json userJoinedMsg = {
-                {"type", "user_joined"},
-                {"userId", result.userId},
-                {"username", username}
-            };
-            broadcastToRoom("global", userJoinedMsg.dump(), result.userId);
-            Logger::info("📢 Broadcast user_joined: " + username);
-            
-        } else {
-            json response = {
-                {"type", "login_response"},
-                {"success", false},
-                {"message", result.errorMessage}
-            };
-            
-            sendJsonMessage(wsPtr, response.dump());
-            Logger::warning("✗ Login failed: " + username);
+        };
+        
+        // The read runs on an actor too (source room, else the first target)
+        std::string readerRoom = sourceRoomId.empty() ? targets.front() : sourceRoomId;
+        bool posted = roomActors_.post(readerRoom, [forwardAll](RoomActorPool::RoomState&, MySQLClient& db) {
+            forwardAll(&db);
+        });
+        if (!posted) {
+            forwardAll(nullptr);
         }
         
     } catch (const std::exception& e) {
-        Logger::error("Login error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Login failed");
+        Logger::error("Forward message error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to forward message");
     }
 }
 
-void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleGetThreadJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
+        std::string parentId = msg.value("messageId", "");
+        std::string cursor = msg.value("cursor", "");
+        int limit = std::clamp(msg.value("limit", 50), 1, 100);
         
-        std::string content = msg.value("content", "");
-        std::string roomId = msg.value("roomId", "global");
-        
-        if (content.empty()) {
+        if (parentId.empty()) {
+            sendErrorJson(wsPtr, "messageId required");
             return;
         }
         
-        Logger::info("💬 Chat from " + data->username + " in room '" + roomId + "': " + content);
+        // Cursor format: "<createdAt>:<messageId>" of the last reply already seen
+        uint64_t afterTimestamp = 0;
+        std::string afterMessageId;
+        size_t sep = cursor.find(':');
+        if (sep != std::string::npos) {
+            try {
+                afterTimestamp = std::stoull(cursor.substr(0, sep));
+                afterMessageId = cursor.substr(sep + 1);
+            } catch (...) {
+                sendErrorJson(wsPtr, "Invalid cursor");
+                return;
+            }
+        }
         
-        // ============================================================================
-        // CHECK FOR @AI COMMAND
-        // ============================================================================
-        if (content.length() > 3 && content.substr(0, 3) == "@ai" && geminiClient_) {
-            std::string question = content.substr(3);
-            // Trim leading spaces
-            size_t start = question.find_first_not_of(" \t");
-            if (start != std::string::npos) {
-                question = question.substr(start);
+        // Same access rule as history: DM participants, members of private rooms
+        auto parent = dbClient_->getMessage(parentId);
+        if (!parent) {
+            sendErrorJson(wsPtr, "Message not found");
+            return;
+        }
+        if (parent->roomId.rfind("dm_", 0) == 0) {
+            auto participants = dbClient_->getDmParticipants(parent->roomId);
+            if (!participants || (participants->first != data->userId && participants->second != data->userId)) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
             }
-            
-            Logger::info("🤖 AI command detected: " + question);
-            
-            // Get AI response
-            auto aiResponse = geminiClient_->sendMessage(question);
-            
-            if (aiResponse.has_value()) {
-                Logger::info("✓ AI response received (" + std::to_string(aiResponse.value().length()) + " chars)");
-                
-                // Generate AI message ID
-                std::string aiMessageId = "msg-ai-" + std::to_string(std::time(nullptr));
-                
-                // Create AI response message
-                json aiMsg = {
-                    {"type", "chat"},
-                    {"messageId", aiMessageId},
-                    {"roomId", roomId},
-                    {"userId", "ai-assistant"},
-                    {"username", "AI Assistant"},
-                    {"content", aiResponse.value()},
-                    {"timestamp", std::time(nullptr)}
-                };
-                
-                // Save AI response to database
-                try {
-                    Message aiDbMessage;
-                    aiDbMessage.messageId = aiMessageId;
-                    aiDbMessage.roomId = roomId;
-                    aiDbMessage.senderId = "ai-assistant";
-                    aiDbMessage.senderName = "AI Assistant";
-                    aiDbMessage.content = aiResponse.value();
-                    aiDbMessage.messageType = 0;
-                    aiDbMessage.replyToId = "";
-                    aiDbMessage.timestamp = std::time(nullptr);
-                    
-                    authManager_->getDatabase()->createMessage(aiDbMessage);
-                    Logger::info("💾 AI message saved to database");
-                } catch (const std::exception& e) {
-                    Logger::error("Failed to save AI message: " + std::string(e.what()));
-                }
-                
-                // Broadcast AI response to all users in room (including sender)
-                std::string aiResponseStr = aiMsg.dump();
-                sendJsonMessage(wsPtr, aiResponseStr);
-                broadcastToRoom(roomId, aiResponseStr);
-                
-                Logger::info("✅ AI response broadcasted to room");
-                return; // Don't process as regular message
-            } else {
-                Logger::error("✗ Failed to get AI response");
-                // Continue to process as regular message
+        } else {
+            auto room = dbClient_->getRoom(parent->roomId);
+            if (room && room->roomType == "private" && dbClient_->getMemberRole(parent->roomId, data->userId).empty()) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
             }
         }
-        // ============================================================================
         
-        // Generate message ID
-        std::string messageId = "msg-" + std::to_string(std::time(nullptr)) + "-" + 
-                                data->userId.substr(0, 8);
+        // Fetch one extra row to know whether another page exists
+        auto replies = dbClient_->getThreadReplies(parentId, afterTimestamp, afterMessageId, limit + 1);
+        bool hasMore = replies.size() > static_cast<size_t>(limit);
+        if (hasMore) {
+            replies.pop_back();
+        }
+        
+        json repliesJson = json::array();
+        for (auto& m : replies) {
+            message_codec::inflate(m);
+            repliesJson.push_back({
+                {"messageId", m.messageId},
+                {"roomId", m.roomId},
+                {"userId", m.senderId},
+                {"username", m.senderName},
+                {"content", m.content},
+                {"replyToId", m.replyToId},
+                {"timestamp", m.timestamp * 1000}
+            });
+        }
+        
+        json response = {
+            {"type", "thread"},
+            {"messageId", parentId},
+            {"replies", repliesJson},
+            {"hasMore", hasMore}
+        };
+        if (hasMore && !replies.empty()) {
+            response["nextCursor"] = std::to_string(replies.back().timestamp) + ":" + replies.back().messageId;
+        }
+        
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::debug("🧵 Sent thread page for " + parentId + ": " + std::to_string(replies.size()) + " replies");
+        
+    } catch (const std::exception& e) {
+        Logger::error("Get thread error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to load thread");
+    }
+}
+
+// ============================================================================
+// ROOM EXPORT
+// ============================================================================
+
+std::optional<std::string> WebSocketServer::resolveExportRoom(const std::string& userId, const std::string& roomId) {
+    if (!dbClient_ || roomId.empty()) {
+        return std::nullopt;
+    }
+    // DM participants may export their conversation
+    if (roomId.rfind("dm_", 0) == 0) {
+        std::string storageRoomId = resolveStorageRoomId(userId, roomId);
+        if (storageRoomId.empty()) return std::nullopt;
+        return storageRoomId;
+    }
+    if (!dbClient_->hasMemberPermission(roomId, userId, "export")) {
+        return std::nullopt;
+    }
+    return roomId;
+}
+
+std::string WebSocketServer::issueDownloadToken(const std::string& jobId, const std::string& userId) {
+    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+    std::string token = randomHex(16);
+    std::lock_guard<std::mutex> lock(downloadTokensMutex_);
+    for (auto it = downloadTokens_.begin(); it != downloadTokens_.end();) {
+        it = it->second.expiresAt <= now ? downloadTokens_.erase(it) : std::next(it);
+    }
+    downloadTokens_[token] = DownloadToken{jobId, userId, now + DOWNLOAD_TOKEN_TTL_SECONDS};
+    return token;
+}
+
+// Owner of the job if the token was issued for it and has not expired; used up either way
+std::optional<std::string> WebSocketServer::redeemDownloadToken(const std::string& token, const std::string& jobId) {
+    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+    std::lock_guard<std::mutex> lock(downloadTokensMutex_);
+    auto it = downloadTokens_.find(token);
+    if (it == downloadTokens_.end()) {
+        return std::nullopt;
+    }
+    DownloadToken entry = std::move(it->second);
+    downloadTokens_.erase(it);
+    if (entry.jobId != jobId || entry.expiresAt <= now) {
+        return std::nullopt;
+    }
+    return entry.userId;
+}
+
+void WebSocketServer::handleExportRoomJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        
+        if (!exporter_) {
+            sendErrorJson(wsPtr, "Export unavailable");
+            return;
+        }
+        auto storageRoomId = resolveExportRoom(data->userId, roomId);
+        if (!storageRoomId) {
+            sendErrorJson(wsPtr, "Only room owners and admins can export");
+            return;
+        }
+        
+        // Progress is pushed to every session of the requester
+        std::string userId = data->userId;
+        auto jobId = exporter_->startFileExport(*storageRoomId, userId,
+            [this, userId, roomId](const RoomExporter::JobStatus& status) {
+                bool finished = status.state == RoomExporter::JobState::Completed;
+                json update = exportStatusJson(status, finished ? issueDownloadToken(status.jobId, userId) : "");
+                update["type"] = status.state == RoomExporter::JobState::Running ? "export_progress" : "export_complete";
+                update["roomId"] = roomId;
+                std::string payload = update.dump();
+                runOnLoop([this, userId, payload]() { sendToUser(userId, payload); });
+            });
+        
+        if (!jobId) {
+            sendErrorJson(wsPtr, "Too many exports running, try again later");
+            return;
+        }
+        
+        json response = {
+            {"type", "export_started"},
+            {"jobId", *jobId},
+            {"roomId", roomId}
+        };
+        sendJsonMessage(wsPtr, response.dump());
+        
+    } catch (const std::exception& e) {
+        Logger::error("Export room error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to start export");
+    }
+}
+
+void WebSocketServer::handleExportStatusJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
+        
+        json msg = json::parse(jsonStr);
+        std::string jobId = msg.value("jobId", "");
+        
+        auto job = exporter_ ? exporter_->getJob(jobId) : std::nullopt;
+        if (!job || job->requestedBy != data->userId) {
+            sendErrorJson(wsPtr, "Export not found");
+            return;
+        }
+        
+        bool finished = job->state == RoomExporter::JobState::Completed;
+        json response = exportStatusJson(*job, finished ? issueDownloadToken(jobId, data->userId) : "");
+        response["type"] = "export_status";
+        sendJsonMessage(wsPtr, response.dump());
         
-        // Check if message has metadata (file attachment)
-        json metadata = nullptr;
-        if (msg.contains("metadata") && msg["metadata"].is_object()) {
-            metadata = msg["metadata"];
-        }
+    } catch (const std::exception& e) {
+        Logger::error("Export status error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to get export status");
+    }
+}
+
+// ============================================================================
+// DISAPPEARING MESSAGES
+// ============================================================================
+
+void WebSocketServer::handleSetRoomTtlJson(void* wsPtr, const std::string& jsonStr) {
+    try {
+        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        PerSocketData* data = ws->getUserData();
         
-        // Create message response
-        json response = {
-            {"type", "chat"},
-            {"messageId", messageId},
-            {"roomId", roomId},
-            {"userId", data->userId},
-            {"username", data->username},
-            {"content", content},
-            {"timestamp", std::time(nullptr) * 1000}  // Convert to milliseconds for JS
-        };
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        int64_t ttlSeconds = msg.value("ttlSeconds", static_cast<int64_t>(-1));
         
-        // Add metadata if present (for file attachments)
-        if (!metadata.is_null()) {
-            response["metadata"] = metadata;
-            Logger::info("📎 Message has file attachment: " + metadata.value("fileName", "unknown"));
+        // 0 turns it off; otherwise 30 seconds .. 30 days
+        if (roomId.empty() || ttlSeconds < 0 || (ttlSeconds > 0 && ttlSeconds < 30) || ttlSeconds > 30 * 86400) {
+            sendErrorJson(wsPtr, "roomId and ttlSeconds (0 or 30..2592000) required");
+            return;
         }
         
-        std::string responseStr = response.dump();
+        bool isDm = roomId.rfind("dm_", 0) == 0;
+        if (!isDm && !dbClient_->hasMemberPermission(roomId, data->userId, "edit_settings")) {
+            sendErrorJson(wsPtr, "Only room moderators can change disappearing messages");
+            return;
+        }
         
-        // Save to database
-        try {
-            Logger::info("🔍 Preparing to save message to database...");
-            
-            // For DM, use conversation_id from database (Discord/Telegram style)
-            std::string storageRoomId = roomId;
-            if (roomId.rfind("dm_", 0) == 0) {
-                std::string targetUserId = roomId.substr(3);
-                // Get or create DM conversation (like Discord channel)
-                storageRoomId = dbClient_->getOrCreateDmConversation(data->userId, targetUserId);
-                Logger::info("📦 DM conversation roomId for storage: " + storageRoomId);
-            }
-            
-            Message dbMessage;
-            dbMessage.messageId = messageId;
-            dbMessage.roomId = storageRoomId;  // Use conversation_id for DM
-            dbMessage.senderId = data->userId;
-            dbMessage.senderName = data->username;  // Add sender name
-            dbMessage.content = content;
-            dbMessage.messageType = 0;  // 0 = text message
-            dbMessage.replyToId = "";   // No reply for now
-            dbMessage.timestamp = std::time(nullptr);
-            // Save metadata as JSON string
-            if (!metadata.is_null()) {
-                dbMessage.metadata = metadata.dump();
-            }
-            
-            Logger::info("🔍 Calling authManager_->getDatabase()->createMessage()...");
-            
-            // Note: Will use DB default for created_at
-            bool saved = authManager_->getDatabase()->createMessage(dbMessage);
-            
-            if (saved) {
-                Logger::info("💾 Message saved to database");
-            } else {
-                Logger::error("✗ createMessage returned false!");
-            }
-            
-        } catch (const std::exception& e) {
-            Logger::error("Failed to save message to DB: " + std::string(e.what()));
-            // Continue anyway - message still gets broadcast
+        // DM participants share one setting on the conversation
+        std::string storageRoomId = resolveStorageRoomId(data->userId, roomId);
+        if (!dbClient_->setRoomMessageTtl(storageRoomId, static_cast<uint32_t>(ttlSeconds))) {
+            sendErrorJson(wsPtr, "Failed to update disappearing messages");
+            return;
         }
+        expiryIndex_.setRoomTtl(storageRoomId, static_cast<uint32_t>(ttlSeconds));
         
-        // Check if this is a DM (format: dm_userId)
-        if (roomId.rfind("dm_", 0) == 0) {
-            // Extract target user ID from room ID
-            std::string targetUserId = roomId.substr(3); // Remove "dm_" prefix
-            Logger::info("📨 DM detected from " + data->userId + " to user: " + targetUserId);
-            
-            // Create response for sender with their perspective roomId
-            json senderResponse = {
-                {"type", "chat"},
-                {"messageId", response["messageId"]},
-                {"roomId", roomId},  // Sender sees dm_targetUserId
-                {"userId", data->userId},
-                {"username", data->username},
-                {"content", content},
-                {"timestamp", response["timestamp"]}
-            };
-            if (!metadata.is_null()) {
-                senderResponse["metadata"] = metadata;
-            }
-            sendJsonMessage(wsPtr, senderResponse.dump());
-            
-            // Create response for receiver with their perspective roomId
-            json receiverResponse = {
-                {"type", "chat"},
-                {"messageId", response["messageId"]},
-                {"roomId", "dm_" + data->userId},  // Receiver sees dm_senderId
-                {"userId", data->userId},
-                {"username", data->username},
-                {"content", content},
-                {"timestamp", response["timestamp"]}
-            };
-            if (!metadata.is_null()) {
-                receiverResponse["metadata"] = metadata;
-            }
-            
-            // Send to target user with their perspective roomId
-            sendToUser(targetUserId, receiverResponse.dump());
+        // Applies to messages sent from now on
+        json update = {
+            {"type", "room_ttl_updated"},
+            {"roomId", roomId},
+            {"ttlSeconds", ttlSeconds},
+            {"updatedBy", data->userId}
+        };
+        sendJsonMessage(wsPtr, update.dump());
+        if (isDm) {
+            update["roomId"] = "dm_" + data->userId;
+            sendToUser(roomId.substr(3), update.dump());
         } else {
-            // Echo back to sender for non-DM messages
-            sendJsonMessage(wsPtr, responseStr);
-            // Broadcast to all other users in room
-            broadcastToRoom(roomId, responseStr, data->userId);
+            broadcastToRoom(roomId, update.dump(), data->userId);
         }
-        
-        // Publish to PubSub (for future multi-server support)
-        broker_->publish("chat." + roomId, responseStr);
+        Logger::info("⌛ Message TTL for " + storageRoomId + " set to " + std::to_string(ttlSeconds) + "s");
         
     } catch (const std::exception& e) {
-        Logger::error("Chat message error: " + std::string(e.what()));
+        Logger::error("Set room TTL error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to update disappearing messages");
     }
 }
 
-// Public methods
-size_t WebSocketServer::getConnectionCount() const {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    return connections_.size();
-}
+// ============================================================================
+// STARTUP CACHE WARMING
+// ============================================================================
 
-void WebSocketServer::broadcast(const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    
-    int sent = 0;
-    for (const auto& [key, state] : connections_) {
-        if (state.authenticated && state.wsPtr) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            sent++;
-        }
+void WebSocketServer::startWarmup() {
+    if (warmupRooms_ == 0) {
+        warm_ = true;
+        return;
     }
-    
-    Logger::info("📢 Broadcast to " + std::to_string(sent) + " authenticated clients");
+    warm_ = false;
+    warmupThread_ = std::thread([this]() { warmCaches(); });
 }
 
-void WebSocketServer::broadcastToRoom(const std::string& roomId, const std::string& message, const std::string& excludeUserId) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
+void WebSocketServer::warmCaches() {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "cache-warmup");
+    auto started = std::chrono::steady_clock::now();
     
-    // Special handling for "global" room - broadcast to ALL authenticated users
-    if (roomId == "global") {
-        int sent = 0;
-        for (const auto& [key, state] : connections_) {
-            if (state.authenticated && state.wsPtr && state.userId != excludeUserId) {
-                auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-                ws->send(message, uWS::OpCode::TEXT);
-                sent++;
-            }
-        }
-        Logger::info("📢 Broadcast to global room: " + std::to_string(sent) + " users");
+    // Connections of our own: the event loop's session stays free for /health and admin
+    std::shared_ptr<MySQLClient> db = dbClient_->createWorkerConnection();
+    if (!db) {
+        Logger::warning("⚠️ Cache warm-up skipped: could not open a DB connection");
+        warm_ = true;
         return;
     }
     
-    // For other rooms, send to all room members (not just currently viewing)
-    std::vector<std::string> roomMembers;
-    try {
-        roomMembers = dbClient_->getRoomMembers(roomId);
-    } catch (...) {
-        Logger::warning("Could not get room members for: " + roomId);
+    std::vector<std::string> activeRooms = db->getActiveRoomIds(warmupRooms_);
+    std::vector<std::string> groupRooms;
+    std::vector<std::string> dmRooms;
+    for (const auto& roomId : activeRooms) {
+        (roomId.rfind("dm_", 0) == 0 ? dmRooms : groupRooms).push_back(roomId);
     }
     
-    int sent = 0;
-    for (const auto& [key, state] : connections_) {
-        // Skip excluded user (usually sender) and unauthenticated users
-        if (!state.authenticated || !state.wsPtr || state.userId == excludeUserId) {
-            continue;
-        }
-        
-        bool shouldSend = false;
-        
-        // Check if user is a member of this room (from database)
-        for (const auto& memberId : roomMembers) {
-            if (memberId == state.userId) {
-                shouldSend = true;
-                break;
-            }
+    // One set-based query per cache, run side by side on separate connections
+    size_t historyRooms = 0;
+    size_t memberRooms = 0;
+    size_t dmPairs = 0;
+    std::vector<std::thread> tasks;
+    
+    tasks.emplace_back([&]() {
+        cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "warmup-history");
+        for (const auto& [roomId, messages] : db->getMessagesByRooms(activeRooms, 50)) {
+            historyCache_.put(roomId, messages);
+            historyRooms++;
         }
-        
-        // Also send if user is currently viewing this room
-        if (!shouldSend && state.currentRoom == roomId) {
-            shouldSend = true;
+    });
+    
+    tasks.emplace_back([&]() {
+        cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "warmup-members");
+        auto membersDb = dbClient_->createWorkerConnection();
+        if (!membersDb) {
+            return;
         }
-        
-        if (shouldSend) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            sent++;
+        for (const auto& [roomId, members] : membersDb->getRoomMemberProfilesByRooms(groupRooms)) {
+            membershipIndex_.loadRoom(roomId, members);
+            memberRooms++;
         }
-    }
-    
-    Logger::info("📢 Broadcast to room '" + roomId + "': " + std::to_string(sent) + " users");
-}
-
-void WebSocketServer::sendToUser(const std::string& userId, const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    
-    Logger::info("🔍 sendToUser looking for userId: " + userId);
-    Logger::info("🔍 Total connections: " + std::to_string(connections_.size()));
+    });
     
-    for (const auto& [key, state] : connections_) {
-        Logger::debug("🔍 Checking connection: userId=" + state.userId + ", authenticated=" + std::to_string(state.authenticated));
-        if (state.authenticated && state.wsPtr && state.userId == userId) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            Logger::info("📤 Message sent to user: " + userId);
+    tasks.emplace_back([&]() {
+        cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "warmup-dms");
+        auto dmDb = dbClient_->createWorkerConnection();
+        if (!dmDb) {
             return;
         }
+        for (const auto& [conversationId, users] : dmDb->getDmParticipantsByIds(dmRooms)) {
+            dmConversations_.put(users.first + "|" + users.second, conversationId);
+            dmPairs++;
+        }
+    });
+    
+    for (auto& task : tasks) {
+        task.join();
     }
     
-    Logger::warning("User not found or not connected: " + userId);
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    Logger::info("🔥 Caches warm in " + std::to_string(elapsedMs) + "ms: history for " +
+                 std::to_string(historyRooms) + " rooms, members for " + std::to_string(memberRooms) +
+                 " rooms, " + std::to_string(dmPairs) + " DM conversations");
+    warm_ = true;
 }
 
-void WebSocketServer::handleTypingJson(void* wsPtr, const std::string& jsonStr) {
+// ============================================================================
+// OUTBOUND WEBHOOKS
+// ============================================================================
+
+void WebSocketServer::handleAddWebhookJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
-        bool isTyping = msg.value("isTyping", false);
+        std::string roomId = msg.value("roomId", "");
+        std::string url = msg.value("url", "");
+        std::string secret = msg.value("secret", "");
+        
+        bool validUrl = url.rfind("http://", 0) == 0 || url.rfind("https://", 0) == 0;
+        if (roomId.empty() || !validUrl || url.size() > 2048 || secret.size() > 128) {
+            sendErrorJson(wsPtr, "roomId and an http(s) url required");
+            return;
+        }
+        // Names are checked again after DNS on every delivery; literals and localhost fail here
+        if (address_guard::isPrivateHost(address_guard::hostOf(url))) {
+            sendErrorJson(wsPtr, "Webhook url must point to a public host");
+            return;
+        }
+        if (roomId.rfind("dm_", 0) == 0 || !dbClient_->hasMemberPermission(roomId, data->userId, "edit_settings")) {
+            sendErrorJson(wsPtr, "Only room moderators can manage webhooks");
+            return;
+        }
+        if (webhooks_->subscriptions(roomId).size() >= MAX_WEBHOOKS_PER_ROOM) {
+            sendErrorJson(wsPtr, "Too many webhooks in this room (max " + std::to_string(MAX_WEBHOOKS_PER_ROOM) + ")");
+            return;
+        }
+        
+        // Without a caller-chosen secret, generate one; it is only returned here
+        bool generated = secret.empty();
+        RoomWebhook webhook;
+        webhook.webhookId = "wh-" + std::to_string(std::time(nullptr)) + "-" + randomHex(4);
+        webhook.roomId = roomId;
+        webhook.url = url;
+        webhook.secret = generated ? randomHex(16) : secret;
+        webhook.createdBy = data->userId;
+        
+        if (!dbClient_->createRoomWebhook(webhook)) {
+            sendErrorJson(wsPtr, "Failed to add webhook");
+            return;
+        }
+        webhooks_->addSubscription(webhook);
         
         json response = {
-            {"type", "typing"},
-            {"userId", data->userId},
-            {"username", data->username},
-            {"isTyping", isTyping}
+            {"type", "webhook_added"},
+            {"webhookId", webhook.webhookId},
+            {"roomId", roomId},
+            {"url", url}
         };
-        
-        // Broadcast to room, excluding sender
-        broadcastToRoom("global", response.dump(), data->userId);
+        if (generated) {
+            response["secret"] = webhook.secret;
+        }
+        sendJsonMessage(wsPtr, response.dump());
+        Logger::info("🪝 Webhook " + webhook.webhookId + " added to " + roomId + " by " + data->username);
         
     } catch (const std::exception& e) {
-        Logger::error("Typing handler error: " + std::string(e.what()));
+        Logger::error("Add webhook error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to add webhook");
     }
 }
 
-void WebSocketServer::handleGetOnlineUsersJson(void* wsPtr) {
+void WebSocketServer::handleRemoveWebhookJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* currentUser = ws->getUserData();
+        PerSocketData* data = ws->getUserData();
         
-        // Get online user IDs from connections
-        std::set<std::string> onlineUserIds;
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            for (const auto& [ptr, state] : connections_) {
-                if (state.authenticated && !state.userId.empty()) {
-                    onlineUserIds.insert(state.userId);
-                }
-            }
-        }
+        json msg = json::parse(jsonStr);
+        std::string roomId = msg.value("roomId", "");
+        std::string webhookId = msg.value("webhookId", "");
         
-        // Get all users from database and mark online status
-        json usersArray = json::array();
-        auto db = authManager_->getDatabase();
-        if (db) {
-            auto allUsers = db->getAllUsers();
-            for (const auto& user : allUsers) {
-                // Don't include current user in the list
-                if (user.userId == currentUser->userId) continue;
-                
-                bool isOnline = onlineUserIds.find(user.userId) != onlineUserIds.end();
-                usersArray.push_back({
-                    {"userId", user.userId},
-                    {"username", user.username},
-                    {"online", isOnline},
-                    {"status", isOnline ? "online" : "offline"}
-                });
-            }
+        if (roomId.empty() || webhookId.empty()) {
+            sendErrorJson(wsPtr, "roomId and webhookId required");
+            return;
         }
+        if (!dbClient_->hasMemberPermission(roomId, data->userId, "edit_settings")) {
+            sendErrorJson(wsPtr, "Only room moderators can manage webhooks");
+            return;
+        }
+        if (!dbClient_->deleteRoomWebhook(webhookId, roomId)) {
+            sendErrorJson(wsPtr, "Webhook not found");
+            return;
+        }
+        webhooks_->removeSubscription(webhookId);
         
-        json response = {
-            {"type", "online_users"},
-            {"users", usersArray},
-            {"count", usersArray.size()}
-        };
-        
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info("📋 Sent users list: " + std::to_string(usersArray.size()) + " users (" + std::to_string(onlineUserIds.size()) + " online)");
+        sendJsonMessage(wsPtr, json({
+            {"type", "webhook_removed"},
+            {"webhookId", webhookId},
+            {"roomId", roomId}
+        }).dump());
         
     } catch (const std::exception& e) {
-        Logger::error("Get online users error: " + std::string(e.what()));
+        Logger::error("Remove webhook error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to remove webhook");
     }
 }
 
-void WebSocketServer::handleEditMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleListWebhooksJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
-        std::string messageId = msg.value("messageId", "");
-        std::string newContent = msg.value("newContent", "");
-        std::string roomId = msg.value("roomId", "global");
+        std::string roomId = msg.value("roomId", "");
         
-        if (messageId.empty() || newContent.empty()) {
-            sendErrorJson(wsPtr, "Missing messageId or newContent");
+        if (roomId.empty()) {
+            sendErrorJson(wsPtr, "roomId required");
             return;
         }
-        
-        Logger::info("✏️ Edit message request: " + messageId + " by " + data->username);
-        
-        // Verify user owns this message
-        auto db = authManager_->getDatabase();
-        if (db) {
-            auto message = db->getMessage(messageId);
-            if (message.has_value()) {
-                if (message->senderId != data->userId) {
-                    sendErrorJson(wsPtr, "You can only edit your own messages");
-                    return;
-                }
-                roomId = message->roomId;
-            }
+        if (!dbClient_->hasMemberPermission(roomId, data->userId, "edit_settings")) {
+            sendErrorJson(wsPtr, "Only room moderators can manage webhooks");
+            return;
         }
         
-        // Update in database
-        if (db) {
-            try {
-                db->getSession()->sql(
-                    "UPDATE messages SET content = ?, edited_at = NOW() WHERE message_id = ? AND sender_id = ?"
-                ).bind(newContent, messageId, data->userId).execute();
-            } catch (...) {
-                Logger::warning("Could not update message in database");
-            }
+        // Secrets are never listed
+        json list = json::array();
+        for (const auto& webhook : webhooks_->subscriptions(roomId)) {
+            list.push_back({
+                {"webhookId", webhook.webhookId},
+                {"url", webhook.url},
+                {"createdBy", webhook.createdBy},
+                {"signed", !webhook.secret.empty()}
+            });
         }
-        
-        json response = {
-            {"type", "message_edited"},
-            {"messageId", messageId},
-            {"newContent", newContent},
-            {"editedAt", std::time(nullptr)},
-            {"userId", data->userId}
-        };
-        
-        // Send to sender first
-        sendJsonMessage(wsPtr, response.dump());
-        // Broadcast to room (excluding sender)
-        broadcastToRoom(roomId, response.dump(), data->sessionId);
-        Logger::info("✅ Message edited and broadcasted");
+        sendJsonMessage(wsPtr, json({
+            {"type", "webhooks"},
+            {"roomId", roomId},
+            {"webhooks", list}
+        }).dump());
         
     } catch (const std::exception& e) {
-        Logger::error("Edit message error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to edit message");
+        Logger::error("List webhooks error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to list webhooks");
+    }
+}
+
+void WebSocketServer::publishWebhookEvent(const Message& message) {
+    // Runs wherever the message was saved (room actors included): only queues
+    if (!webhooks_->hasSubscribers(message.roomId)) {
+        return;
     }
+    
+    Message plain = message;
+    message_codec::inflate(plain);
+    
+    json event = {
+        {"event", "message.created"},
+        {"messageId", plain.messageId},
+        {"roomId", plain.roomId},
+        {"senderId", plain.senderId},
+        {"senderName", plain.senderName},
+        {"content", plain.content},
+        {"messageType", plain.messageType},
+        {"timestamp", plain.timestamp * 1000}
+    };
+    if (!plain.replyToId.empty()) {
+        event["replyToId"] = plain.replyToId;
+    }
+    if (!plain.metadata.empty()) {
+        json meta = json::parse(plain.metadata, nullptr, false);
+        event["metadata"] = meta.is_discarded() ? json(plain.metadata) : meta;
+    }
+    webhooks_->publish(message.roomId, event.dump());
+}
+
+// ============================================================================
+// CATCH-ME-UP SUMMARIES
+// ============================================================================
+
+void WebSocketServer::setAiOptions(size_t workers, const RoomSummarizer::Options& summaryOptions) {
+    summarizer_.reset();
+    translator_.reset();
+    aiExecutor_ = std::make_unique<AiExecutor>(workers, AI_MAX_QUEUED);
+    if (!geminiClient_) {
+        return;
+    }
+    
+    summarizer_ = std::make_unique<RoomSummarizer>(summaryOptions, *aiExecutor_,
+        [gemini = geminiClient_](const std::string& prompt, const std::string& message) {
+            return gemini->generateResponse(prompt, message);
+        });
+    // Requesters whose summary was still being brought up to date get it pushed when it lands
+    summarizer_->setOnUpdated([this](const std::string& roomId, const std::vector<RoomSummarizer::Waiter>& waiters) {
+        auto snapshot = summarizer_->snapshot(roomId);
+        for (const auto& waiter : waiters) {
+            std::string payload = roomSummaryJson(waiter.roomId, snapshot).dump();
+            runOnLoop([this, userId = waiter.userId, payload]() { sendToUser(userId, payload); });
+        }
+    });
+    
+    translator_ = std::make_unique<MessageTranslator>(MessageTranslator::Options{}, *aiExecutor_,
+        [gemini = geminiClient_](const std::string& prompt, const std::string& message) {
+            return gemini->generateResponse(prompt, message);
+        });
 }
 
-void WebSocketServer::handleDeleteMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleSummarizeJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
-        std::string messageId = msg.value("messageId", "");
-        std::string roomId = msg.value("roomId", "global");
+        std::string roomId = msg.value("roomId", "");
         
-        if (messageId.empty()) {
-            sendErrorJson(wsPtr, "Missing messageId");
+        if (roomId.empty()) {
+            sendErrorJson(wsPtr, "roomId required");
             return;
         }
-        
-        Logger::info("🗑️ Delete message request: " + messageId + " by " + data->username);
-        
-        // Verify user owns this message
-        auto db = authManager_->getDatabase();
-        if (db) {
-            auto message = db->getMessage(messageId);
-            if (message.has_value()) {
-                if (message->senderId != data->userId) {
-                    // Check if user is room admin/owner
-                    bool isAdmin = db->hasMemberPermission(message->roomId, data->userId, "kick");
-                    if (!isAdmin) {
-                        sendErrorJson(wsPtr, "You can only delete your own messages");
-                        return;
-                    }
-                }
-                roomId = message->roomId;
-            }
+        if (!summarizer_ || !dbClient_) {
+            sendErrorJson(wsPtr, "AI service not available");
+            return;
         }
         
-        // Soft delete in database (set is_deleted=1)
-        if (db) {
-            try {
-                db->getSession()->sql(
-                    "UPDATE messages SET is_deleted = 1, deleted_at = NOW() WHERE message_id = ?"
-                ).bind(messageId).execute();
-            } catch (...) {
-                Logger::warning("Could not mark message as deleted in database");
+        std::string storageRoomId = roomId;
+        if (roomId.rfind("dm_", 0) == 0) {
+            storageRoomId = resolveStorageRoomId(data->userId, roomId);
+        } else {
+            auto room = dbClient_->getRoom(roomId);
+            if (room && room->roomType == "private" && dbClient_->getMemberRole(roomId, data->userId).empty()) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
             }
         }
         
-        json response = {
-            {"type", "message_deleted"},
-            {"messageId", messageId},
-            {"userId", data->userId}
-        };
+        // First request since start: recent history (usually from the history cache) seeds the room
+        if (!summarizer_->isKnown(storageRoomId)) {
+            summarizer_->seed(storageRoomId, loadRoomHistory(storageRoomId));
+        }
         
-        // Send to sender first
-        sendJsonMessage(wsPtr, response.dump());
-        // Broadcast to room (excluding sender)
-        broadcastToRoom(roomId, response.dump(), data->sessionId);
-        Logger::info("✅ Message deleted and broadcasted");
+        // Answered from memory; if a fold had to start, the fresher summary follows as another room_summary
+        auto snapshot = summarizer_->snapshot(storageRoomId, RoomSummarizer::Waiter{data->userId, roomId});
+        sendJsonMessage(wsPtr, roomSummaryJson(roomId, snapshot).dump());
         
     } catch (const std::exception& e) {
-        Logger::error("Delete message error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to delete message");
+        Logger::error("Summarize error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to summarize room");
     }
 }
 
-// Room management handlers
-
-void WebSocketServer::handleCreateRoomJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleTranslateMessageJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
-        // Support both 'name' and 'roomName' for compatibility
-        std::string roomName = msg.value("name", msg.value("roomName", ""));
-        std::string roomType = msg.value("roomType", "public");
+        std::string roomId = msg.value("roomId", "");
+        std::string targetLang = msg.value("targetLang", "");
+        std::vector<std::string> messageIds;
+        if (msg.contains("messageIds") && msg["messageIds"].is_array()) {
+            for (const auto& id : msg["messageIds"]) {
+                if (id.is_string()) {
+                    messageIds.push_back(id.get<std::string>());
+                }
+            }
+        } else if (!msg.value("messageId", "").empty()) {
+            messageIds.push_back(msg.value("messageId", ""));
+        }
         
-        if (roomName.empty()) {
-            sendErrorJson(wsPtr, "Room name required");
+        if (roomId.empty() || messageIds.empty()) {
+            sendErrorJson(wsPtr, "roomId and messageId or messageIds required");
+            return;
+        }
+        if (messageIds.size() > MAX_TRANSLATE_MESSAGES) {
+            sendErrorJson(wsPtr, "At most " + std::to_string(MAX_TRANSLATE_MESSAGES) + " messages per request");
+            return;
+        }
+        if (!MessageTranslator::isValidLanguage(targetLang)) {
+            sendErrorJson(wsPtr, "Invalid targetLang");
+            return;
+        }
+        if (!translator_ || !dbClient_) {
+            sendErrorJson(wsPtr, "AI service not available");
             return;
         }
         
-        // Generate room ID
-        std::string roomId = "room-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
-        
-        Logger::info("🏠 Creating room: " + roomName + " (" + roomId + ") by " + data->username);
-        
-        // Save to database
-        auto db = authManager_->getDatabase();
-        if (db) {
-            Room room;
-            room.roomId = roomId;
-            room.name = roomName;
-            room.creatorId = data->userId;
-            
-            if (db->createRoom(room)) {
-                Logger::info("✅ Room saved to database: " + roomId);
-            } else {
-                Logger::warning("⚠️ Failed to save room to database");
+        std::string storageRoomId = roomId;
+        if (roomId.rfind("dm_", 0) == 0) {
+            storageRoomId = resolveStorageRoomId(data->userId, roomId);
+        } else {
+            auto room = dbClient_->getRoom(roomId);
+            if (room && room->roomType == "private" && dbClient_->getMemberRole(roomId, data->userId).empty()) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
             }
         }
         
-        json response = {
-            {"type", "room_created"},
-            {"roomId", roomId},
-            {"roomName", roomName},
-            {"roomType", roomType}
-        };
+        // Only text messages of this room; everything else is reported as failed
+        std::unordered_map<std::string, Message> rows;
+        for (auto& m : dbClient_->getMessagesByIds(messageIds)) {
+            if (m.roomId == storageRoomId && m.messageType == 0) {
+                std::string messageId = m.messageId;
+                rows.emplace(std::move(messageId), std::move(m));
+            }
+        }
+        std::vector<MessageTranslator::Item> items;
+        json failed = json::array();
+        for (const auto& messageId : messageIds) {
+            auto it = rows.find(messageId);
+            if (it == rows.end()) {
+                failed.push_back(messageId);
+                continue;
+            }
+            message_codec::inflate(it->second);
+            items.push_back({messageId, it->second.content});
+        }
         
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info("✅ Room created: " + roomId);
+        // Shared cache first; misses are batched with other requests on the AI executor
+        std::string userId = data->userId;
+        translator_->translate(items, targetLang,
+            [this, wsPtr, userId, roomId, targetLang, failed](std::vector<MessageTranslator::Result> results) {
+                json translations = json::array();
+                json notTranslated = failed;
+                for (const auto& result : results) {
+                    if (result.text) {
+                        translations.push_back({
+                            {"messageId", result.messageId},
+                            {"text", *result.text},
+                            {"cached", result.cached}
+                        });
+                    } else {
+                        notTranslated.push_back(result.messageId);
+                    }
+                }
+                json response = {
+                    {"type", "message_translations"},
+                    {"roomId", roomId},
+                    {"targetLang", targetLang},
+                    {"translations", translations},
+                    {"failed", notTranslated}
+                };
+                runOnLoop([this, wsPtr, userId, payload = response.dump()]() {
+                    auto* socket = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+                    if (isConnectionAlive(wsPtr) && socket->getUserData()->userId == userId) {
+                        sendJsonMessage(wsPtr, payload);
+                    }
+                });
+            });
         
     } catch (const std::exception& e) {
-        Logger::error("Create room error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to create room");
+        Logger::error("Translate error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to translate");
     }
 }
 
-void WebSocketServer::handleJoinRoomJson(void* wsPtr, const std::string& jsonStr) {
+// ============================================================================
+// SEMANTIC SEARCH
+// ============================================================================
+
+void WebSocketServer::startSemanticIndex() {
+    if (!semanticEnabled_ || semanticOptions_.embedding.apiKey.empty() || !dbClient_) {
+        return;
+    }
+    
+    // The backfill gets its own connection; the loop's session stays free
+    auto backfillDb = dbClient_->createWorkerConnection();
+    if (!backfillDb) {
+        Logger::warning("⚠️ Semantic index backfill skipped: could not open a DB connection");
+    }
+    MySQLClient* db = dbClient_.get();
+    semanticIndex_ = std::make_unique<SemanticIndex>(
+        semanticOptions_, db->shardCount(),
+        [db](const std::string& roomId) { return db->shardForRoom(roomId); },
+        std::move(backfillDb));
+    if (!semanticIndex_->start()) {
+        Logger::error("❌ Semantic search disabled: index files could not be opened");
+        semanticIndex_.reset();
+    }
+}
+
+void WebSocketServer::handleSemanticSearchJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
         json msg = json::parse(jsonStr);
+        std::string query = msg.value("query", "");
         std::string roomId = msg.value("roomId", "");
+        size_t limit = static_cast<size_t>(std::clamp(msg.value("limit", 20), 1, static_cast<int>(MAX_SEMANTIC_RESULTS)));
         
-        if (roomId.empty()) {
-            sendErrorJson(wsPtr, "Room ID required");
+        if (query.empty()) {
+            sendErrorJson(wsPtr, "Search query required");
+            return;
+        }
+        if (!semanticIndex_) {
+            sendErrorJson(wsPtr, "Semantic search not available");
             return;
         }
         
-        Logger::info("🚪 User joining room: " + data->username + " → " + roomId);
-        
-        // Update currentRoom in PerSocketData
-        data->currentRoom = roomId;
-        
-        // Update currentRoom in connections_ map
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            if (connections_.count(wsPtr)) {
-                connections_[wsPtr].currentRoom = roomId;
+        // Stored rooms the caller can read: their rooms and DMs, or the one asked for
+        std::vector<std::string> roomIds;
+        if (roomId.empty()) {
+            roomIds = dbClient_->getUserRoomIds(data->userId);
+            roomIds.push_back("global");
+        } else if (roomId.rfind("dm_", 0) == 0) {
+            roomIds.push_back(resolveStorageRoomId(data->userId, roomId));
+        } else {
+            auto room = dbClient_->getRoom(roomId);
+            if (room && room->roomType == "private" && dbClient_->getMemberRole(roomId, data->userId).empty()) {
+                sendErrorJson(wsPtr, "Not a member of this room");
+                return;
             }
+            roomIds.push_back(roomId);
         }
         
-        // Save to room_members table
-        bool added = dbClient_->addRoomMember(roomId, data->userId);
-        if (!added) {
-            Logger::warning("User already member or failed to add to room");
+        Logger::info("🧭 Semantic search: '" + query.substr(0, 50) + "' over " + std::to_string(roomIds.size()) + " rooms");
+        
+        // Query embedding and graph walk on the AI executor; rows are loaded back on the loop
+        uint64_t startedMs = steadyNowMs();
+        std::string userId = data->userId;
+        bool queued = aiExecutor_->submit([this, wsPtr, userId, query, roomIds, limit, startedMs]() {
+            auto hits = semanticIndex_->search(query, roomIds, limit);
+            runOnLoop([this, wsPtr, userId, query, roomIds, hits = std::move(hits), startedMs]() {
+                if (!isConnectionAlive(wsPtr)) {
+                    return;
+                }
+                if (!hits) {
+                    sendErrorJson(wsPtr, "Semantic search failed");
+                    return;
+                }
+                sendSemanticResults(wsPtr, userId, query, roomIds, *hits, startedMs);
+            });
+        });
+        if (!queued) {
+            sendServerBusy(wsPtr, "semantic_search", 5);
         }
         
-        // For DM, use conversation_id from database (Discord/Telegram style)
-        std::string queryRoomId = roomId;
-        if (roomId.rfind("dm_", 0) == 0) {
-            std::string targetUserId = roomId.substr(3);
-            Logger::info("📦 DM join - user=" + data->userId + ", target=" + targetUserId);
-            // Get or create DM conversation (like Discord channel)
-            queryRoomId = dbClient_->getOrCreateDmConversation(data->userId, targetUserId);
-            Logger::info("📦 DM conversation roomId for query: " + queryRoomId);
+    } catch (const std::exception& e) {
+        Logger::error("Semantic search error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Semantic search failed");
+    }
+}
+
+void WebSocketServer::sendSemanticResults(void* wsPtr, const std::string& userId, const std::string& query,
+                                          const std::vector<std::string>& roomIds,
+                                          const std::vector<SemanticIndex::Hit>& hits, uint64_t startedMs) {
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    if (ws->getUserData()->userId != userId) {
+        return;  // Socket slot reused by someone else
+    }
+    
+    std::vector<std::string> ids;
+    ids.reserve(hits.size());
+    for (const auto& hit : hits) {
+        ids.push_back(hit.messageId);
+    }
+    
+    // Rows are the truth: the index can lag an edit or deletion, and rooms are checked once more
+    std::unordered_set<std::string> allowed(roomIds.begin(), roomIds.end());
+    std::unordered_map<std::string, Message> rows;
+    std::vector<std::string> dmRooms;
+    for (auto& m : dbClient_->getMessagesByIds(ids)) {
+        if (!allowed.count(m.roomId)) {
+            continue;
+        }
+        if (m.roomId.rfind("dm_", 0) == 0) {
+            dmRooms.push_back(m.roomId);
+        }
+        std::string messageId = m.messageId;
+        rows.emplace(std::move(messageId), std::move(m));
+    }
+    
+    // DMs go back the way the client addresses them (dm_<other user>)
+    std::unordered_map<std::string, std::string> clientRoomIds;
+    if (!dmRooms.empty()) {
+        for (const auto& [conversationId, users] : dbClient_->getDmParticipantsByIds(dmRooms)) {
+            clientRoomIds[conversationId] = "dm_" + (users.first == userId ? users.second : users.first);
+        }
+    }
+    
+    json results = json::array();
+    for (const auto& hit : hits) {
+        auto it = rows.find(hit.messageId);
+        if (it == rows.end()) {
+            continue;
+        }
+        Message& m = it->second;
+        message_codec::inflate(m);
+        auto clientRoom = clientRoomIds.find(m.roomId);
+        results.push_back({
+            {"messageId", m.messageId},
+            {"roomId", clientRoom != clientRoomIds.end() ? clientRoom->second : m.roomId},
+            {"senderId", m.senderId},
+            {"senderName", m.senderName},
+            {"content", m.content},
+            {"messageType", m.messageType},
+            {"timestamp", m.timestamp * 1000},
+            {"score", hit.score}
+        });
+    }
+    
+    json response = {
+        {"type", "semantic_search_results"},
+        {"query", query},
+        {"results", results},
+        {"count", results.size()},
+        {"tookMs", steadyNowMs() - startedMs}
+    };
+    sendJsonMessage(wsPtr, response.dump());
+}
+
+// ============================================================================
+// LINK PREVIEWS
+// ============================================================================
+
+void WebSocketServer::requestLinkPreview(const Message& message) {
+    // Runs wherever the message was saved; only text messages, only the first link
+    if (!linkPreviews_ || message.messageType != 0) {
+        return;
+    }
+    
+    const std::string* text = &message.content;
+    Message plain;
+    if (message.compressed & Message::CONTENT_COMPRESSED) {
+        plain = message;
+        message_codec::inflate(plain);
+        text = &plain.content;
+    } else if (message.content.find("http") == std::string::npos) {
+        return;
+    }
+    
+    auto urls = LinkUnfurler::extractUrls(*text, 1);
+    if (urls.empty()) {
+        return;
+    }
+    
+    std::string messageId = message.messageId;
+    std::string roomId = message.roomId;
+    linkPreviews_->unfurl(urls.front(), [this, messageId, roomId](const std::optional<LinkPreview>& preview) {
+        if (preview) {
+            attachLinkPreview(messageId, roomId, *preview);
         }
+    });
+}
+
+void WebSocketServer::attachLinkPreview(const std::string& messageId, const std::string& roomId,
+                                        const LinkPreview& preview) {
+    // Called from the unfurler thread (or inline on a cache hit). Only the linkPreview key is
+    // written, so attachment metadata and concurrent content edits are left as they are
+    auto attach = [this, messageId, roomId, preview](MySQLClient& db) {
+        json card = {{"url", preview.url}, {"title", preview.title}};
+        if (!preview.description.empty()) card["description"] = preview.description;
+        if (!preview.image.empty()) card["image"] = preview.image;
+        if (!preview.siteName.empty()) card["siteName"] = preview.siteName;
         
-        // Load room history using conversation_id
-        Logger::info("📚 Loading history for queryRoomId: " + queryRoomId);
-        auto historyMessages = dbClient_->getMessagesByRoom(queryRoomId, 50);
-        Logger::info("📚 Got " + std::to_string(historyMessages.size()) + " messages from DB for roomId=" + queryRoomId);
-        json history = json::array();
-        for (const auto& m : historyMessages) {
-            // For DM history, convert roomId back to user's perspective
-            std::string displayRoomId = m.roomId;
-            if (m.roomId.rfind("dm_", 0) == 0) {
-                // This is a DM conversation_id
-                // Convert to user's perspective (dm_otherUserId)
-                displayRoomId = roomId;  // Use the roomId the user requested
+        std::string metadata;
+        if (auto merged = db.setMessageMetadataKey(messageId, "linkPreview", card.dump())) {
+            metadata = *merged;
+        } else {
+            // Compressed metadata (or no such message): rewrite it whole
+            auto message = db.getMessage(messageId);
+            if (!message) {
+                return;
             }
-            json msgJson = {
-                {"messageId", m.messageId},
-                {"roomId", displayRoomId},
-                {"userId", m.senderId},
-                {"username", m.senderName},
-                {"content", m.content},
-                {"timestamp", m.timestamp * 1000}
-            };
-            // Add metadata if present
-            if (!m.metadata.empty()) {
-                try {
-                    msgJson["metadata"] = json::parse(m.metadata);
-                } catch (...) {}
+            message_codec::inflate(*message);
+            json current = json::parse(message->metadata.empty() ? "{}" : message->metadata, nullptr, false);
+            if (current.is_discarded() || !current.is_object()) {
+                current = json::object();
             }
-            history.push_back(msgJson);
-        }
-        
-        // Get room members
-        auto members = dbClient_->getRoomMembers(roomId);
-        
-        // Build members array with user info
-        json membersJson = json::array();
-        for (const auto& memberId : members) {
-            auto userOpt = dbClient_->getUserById(memberId);
-            if (userOpt) {
-                json memberObj = {
-                    {"userId", userOpt->userId},
-                    {"username", userOpt->username},
-                    {"avatar", userOpt->avatarUrl}
-                };
-                membersJson.push_back(memberObj);
+            current["linkPreview"] = card;
+            metadata = current.dump();
+            if (!db.updateMessageMetadata(messageId, metadata)) {
+                return;
             }
         }
-        
-        // Load active polls for this room (try both roomId and queryRoomId for DM)
-        auto roomPolls = dbClient_->getRoomPolls(roomId, false);
-        if (roomPolls.empty() && roomId != queryRoomId) {
-            roomPolls = dbClient_->getRoomPolls(queryRoomId, false);
-        }
-        json pollsJson = json::array();
-        for (const auto& poll : roomPolls) {
-            json optionsJson = json::array();
-            for (const auto& opt : poll.options) {
-                optionsJson.push_back({
-                    {"id", opt.optionId},
-                    {"text", opt.text},
-                    {"votes", opt.voteCount},
-                    {"voters", opt.voterIds}
-                });
-            }
-            pollsJson.push_back({
-                {"id", poll.pollId},
-                {"question", poll.question},
-                {"options", optionsJson},
-                {"createdBy", poll.createdBy},
-                {"createdAt", poll.createdAt},
-                {"isClosed", poll.isClosed},
-                {"roomId", roomId}
-            });
+        json meta = json::parse(metadata, nullptr, false);
+        if (meta.is_discarded()) {
+            meta = {{"linkPreview", card}};
         }
-        Logger::info("📊 Loaded " + std::to_string(roomPolls.size()) + " polls for room " + roomId);
-        
-        json response = {
-            {"type", "room_joined"},
-            {"roomId", roomId},
-            {"userId", data->userId},
-            {"username", data->username},
-            {"history", history},
-            {"memberCount", members.size()},
-            {"members", membersJson},
-            {"polls", pollsJson}
-        };
-        
-        // Send to user who joined
-        sendJsonMessage(wsPtr, response.dump());
-        
-        // Broadcast to others in room
-        json broadcast = {
-            {"type", "user_joined_room"},
-            {"roomId", roomId},
-            {"userId", data->userId},
-            {"username", data->username}
-        };
-        broadcastToRoom(roomId, broadcast.dump(), data->userId);
-        
-        Logger::info("✅ User joined room: " + roomId + " (loaded " + std::to_string(historyMessages.size()) + " messages)");
-        
-    } catch (const std::exception& e) {
-        Logger::error("Join room error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to join room");
+        historyCache_.updateMetadata(roomId, messageId, metadata);
+        
+        // Same event as an edit, without newContent: clients merge the metadata
+        deliverToStorageRoom(roomId, {
+            {"type", "message_edited"},
+            {"messageId", messageId},
+            {"roomId", roomId},
+            {"metadata", meta}
+        }, db);
+    };
+    
+    if (roomActors_.post(roomId, [attach](RoomActorPool::RoomState&, MySQLClient& db) { attach(db); })) {
+        return;
+    }
+    if (dbClient_) {
+        runOnLoop([attach, db = dbClient_]() { attach(*db); });
     }
 }
 
-void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const std::string& jsonStr) {
-    try {
-        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
-        std::string roomId = msg.value("roomId", "");
-        
-        if (roomId.empty()) {
-            sendErrorJson(wsPtr, "Room ID required");
+void WebSocketServer::startExpiryPurger() {
+    if (expiryRunning_) {
+        return;
+    }
+    
+    // Own connection: the purge never touches the event loop's session
+    std::shared_ptr<MySQLClient> db = dbClient_->createWorkerConnection();
+    if (!db) {
+        Logger::error("✗ Disappearing messages disabled: purge job could not connect");
+        return;
+    }
+    
+    expiryRunning_ = true;
+    expiryThread_ = std::thread([this, db]() { runExpiryPurger(*db); });
+}
+
+void WebSocketServer::stopExpiryPurger() {
+    {
+        std::lock_guard<std::mutex> lock(expiryMutex_);
+        if (!expiryRunning_.exchange(false)) {
             return;
         }
+    }
+    expiryCv_.notify_all();
+    if (expiryThread_.joinable()) {
+        expiryThread_.join();
+    }
+}
+
+void WebSocketServer::runExpiryPurger(MySQLClient& db) {
+    cpu_affinity::pinCurrentThread(cpu_affinity::ThreadClass::Background, -1, "expiry-purger");
+    Logger::info("⌛ Expiry purge job running");
+    
+    while (expiryRunning_) {
+        uint64_t now = static_cast<uint64_t>(std::time(nullptr));
         
-        Logger::info("🚪 User leaving room: " + data->username + " ← " + roomId);
-        
-        // Broadcast to others BEFORE clearing room (so they still get the message)
-        json broadcast = {
-            {"type", "user_left_room"},
-            {"roomId", roomId},
-            {"userId", data->userId},
-            {"username", data->username}
-        };
-        broadcastToRoom(roomId, broadcast.dump(), data->userId);
-        
-        // Clear currentRoom in PerSocketData
-        data->currentRoom = "";
-        
-        // Clear currentRoom in connections_ map
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            if (connections_.count(wsPtr)) {
-                connections_[wsPtr].currentRoom = "";
+        // Keep the next hour of expiries in memory. The first pass also picks
+        // up everything that expired while the server was down.
+        if (expiryIndex_.horizon() < now + EXPIRY_HORIZON_SECONDS / 2) {
+            uint64_t target = now + EXPIRY_HORIZON_SECONDS;
+            uint64_t from = expiryIndex_.setHorizon(target);
+            size_t loaded = 0;
+            bool ok = db.forEachExpiringMessage(from, target,
+                [this, &loaded](const std::string& messageId, const std::string& roomId, uint64_t expiresAt) {
+                    expiryIndex_.add(messageId, roomId, expiresAt);
+                    loaded++;
+                });
+            if (!ok) {
+                expiryIndex_.setHorizon(from);  // Retry this window next pass
+            } else if (loaded > 0) {
+                Logger::debug("⌛ Loaded " + std::to_string(loaded) + " upcoming expiries");
             }
         }
         
-        // Remove from room_members table
-        bool removed = dbClient_->removeRoomMember(roomId, data->userId);
-        if (!removed) {
-            Logger::warning("User was not member of room or failed to remove");
+        auto due = expiryIndex_.takeDue(now, EXPIRY_PURGE_BATCH);
+        if (!due.empty()) {
+            std::vector<std::string> ids;
+            ids.reserve(due.size());
+            for (const auto& entry : due) {
+                ids.push_back(entry.messageId);
+            }
+            
+            if (db.deleteMessagesByIds(ids) < 0) {
+                expiryIndex_.restore(due);
+            } else {
+                std::map<std::string, std::vector<std::string>> byRoom;
+                for (auto& entry : due) {
+                    byRoom[entry.roomId].push_back(std::move(entry.messageId));
+                }
+                for (const auto& [roomId, messageIds] : byRoom) {
+                    historyCache_.removeMessages(roomId, messageIds);
+                }
+                if (semanticIndex_) {
+                    for (const auto& messageId : ids) {
+                        semanticIndex_->remove(messageId);
+                    }
+                }
+                notifyMessagesExpired(byRoom, db);
+                Logger::info("⌛ Purged " + std::to_string(due.size()) + " expired messages in " +
+                             std::to_string(byRoom.size()) + " rooms");
+                
+                if (due.size() == EXPIRY_PURGE_BATCH) {
+                    continue;  // Backlog - next batch right away
+                }
+                if (semanticIndex_) {
+                    semanticIndex_->compact();  // Backlog drained: purged vectors leave the shard files
+                }
+            }
         }
         
-        json response = {
-            {"type", "room_left"},
+        std::unique_lock<std::mutex> lock(expiryMutex_);
+        expiryCv_.wait_for(lock, std::chrono::seconds(1), [this]() { return !expiryRunning_; });
+    }
+}
+
+void WebSocketServer::notifyMessagesExpired(const std::map<std::string, std::vector<std::string>>& byRoom,
+                                            MySQLClient& db) {
+    // One frame per room per purge pass, however many messages expired in it
+    for (const auto& [roomId, messageIds] : byRoom) {
+        deliverToStorageRoom(roomId, {
+            {"type", "messages_expired"},
             {"roomId", roomId},
-            {"success", removed}
-        };
-        sendJsonMessage(wsPtr, response.dump());
-        
-        Logger::info("✅ User left room: " + roomId);
+            {"messageIds", messageIds}
+        }, db);
+    }
+}
+
+void WebSocketServer::deliverToStorageRoom(const std::string& roomId, json frame, MySQLClient& db) {
+    auto participants = db.getDmParticipants(roomId);
+    if (participants) {
+        // Each side addresses the DM as dm_<other user>
+        const auto& [user1, user2] = *participants;
+        frame["roomId"] = "dm_" + user2;
+        std::string toUser1 = frame.dump();
+        frame["roomId"] = "dm_" + user1;
+        std::string toUser2 = frame.dump();
+        runOnLoop([this, user1, user2, toUser1, toUser2]() {
+            sendToUser(user1, toUser1);
+            sendToUser(user2, toUser2);
+        });
+    } else {
+        std::string payload = frame.dump();
+        runOnLoop([this, roomId, payload]() { broadcastToRoom(roomId, payload); });
+    }
+}
+
+// ============================================================================
+// UPLOAD ADMISSION
+// ============================================================================
+
+uint64_t WebSocketServer::steadyNowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void WebSocketServer::armUploadTimer() {
+    if (uploadTimer_ && !uploadTimerArmed_) {
+        us_timer_set(uploadTimer_, onUploadTimer, UPLOAD_REFILL_MS, UPLOAD_REFILL_MS);
+        uploadTimerArmed_ = true;
+    }
+}
+
+void WebSocketServer::onUploadTimer(struct us_timer_t* timer) {
+    auto* self = *(WebSocketServer**)us_timer_ext(timer);
+    self->uploads_->refill(steadyNowMs());
+    
+    // Nothing paused any more: stop ticking until the next overdraw
+    if (!self->uploads_->hasBandwidthWaiters()) {
+        us_timer_set(timer, onUploadTimer, 0, 0);
+        self->uploadTimerArmed_ = false;
+    }
+}
+
+// ============================================================================
+// LOAD SHEDDING
+// ============================================================================
+
+void WebSocketServer::onLoadTimer(struct us_timer_t* timer) {
+    auto* self = *(WebSocketServer**)us_timer_ext(timer);
+    self->sampleLoad();
+}
+
+void WebSocketServer::sampleLoad() {
+    uint64_t now = steadyNowMs();
+    LoadGovernor::Sample sample;
+    sample.loopLagMs = now > lastLoadTickMs_ + LOAD_SAMPLE_MS ? now - lastLoadTickMs_ - LOAD_SAMPLE_MS : 0;
+    lastLoadTickMs_ = now;
+    sample.dbQueueDepth = roomActors_.pendingTasks();
+    sample.bufferedBytes = static_cast<uint64_t>(std::max<int64_t>(0, bufferedBytes_.load(std::memory_order_relaxed)));
+    loadGovernor_.update(sample);
+    
+    // Level is back down: replay deferred ops, a bounded number per tick
+    for (size_t i = 0; i < DEFERRED_OPS_PER_TICK && loadGovernor_.allowHeavy() && !deferredOps_.empty(); ++i) {
+        auto [wsPtr, userId, jsonStr] = std::move(deferredOps_.front());
+        deferredOps_.pop_front();
         
-    } catch (const std::exception& e) {
-        Logger::error("Leave room error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to leave room");
+        // Skip sockets that closed (or were reused by someone else) meanwhile
+        bool live = false;
+        {
+            ProfiledLock lock(connectionsMutex_);
+            auto it = connections_.find(wsPtr);
+            live = it != connections_.end() && it->second.userId == userId;
+        }
+        if (live) {
+            dispatchMessage(wsPtr, jsonStr);
+        }
     }
 }
 
-void WebSocketServer::handleGetRoomsJson(void* wsPtr) {
+bool WebSocketServer::shedOrDefer(void* wsPtr, const std::string& type, const std::string& jsonStr) {
+    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+    PerSocketData* data = ws->getUserData();
+    
+    if (type == "login" || type == "register" || type == "auth") {
+        if (!loadGovernor_.admitLogin(steadyNowMs())) {
+            sendServerBusy(wsPtr, type, 10);
+            return true;
+        }
+        return false;
+    }
+    
+    bool heavy = type == "search_messages" || type == "search_users" || type == "ai_request" ||
+                 type == "semantic_search" || type == "translate_message";
+    if (!heavy || !data->authenticated || loadGovernor_.allowHeavy()) {
+        return false;
+    }
+    if (deferredOps_.size() >= MAX_DEFERRED_OPS) {
+        loadGovernor_.recordRejected();
+        sendServerBusy(wsPtr, type, 10);
+        return true;
+    }
+    deferredOps_.emplace_back(wsPtr, data->userId, jsonStr);
+    loadGovernor_.recordDeferred();
+    return true;
+}
+
+void WebSocketServer::sendServerBusy(void* wsPtr, const std::string& op, uint32_t retryAfterSeconds) {
+    sendJsonMessage(wsPtr, json({
+        {"type", "server_busy"},
+        {"op", op},
+        {"retryAfter", retryAfterSeconds}
+    }).dump());
+}
+
+void WebSocketServer::handleUploadInitJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
         PerSocketData* data = ws->getUserData();
         
-        json rooms = json::array();
+        json msg = json::parse(jsonStr);
+        std::string uploadId = msg.value("uploadId", "");
+        if (uploadId.empty()) {
+            uploadId = "upload-" + std::to_string(steadyNowMs()) + "-" + data->userId.substr(0, 8);
+            msg["uploadId"] = uploadId;
+        }
+        if (chunkedUploads_.count(uploadId)) {
+            sendJsonMessage(wsPtr, json{{"type", "upload_error"}, {"uploadId", uploadId},
+                                        {"message", "Upload already started"}}.dump());
+            return;
+        }
+        std::string roomId = msg.value("roomId", "global");
+        std::string userId = data->userId;
         
-        // Always include global room
-        rooms.push_back({
-            {"roomId", "global"},
-            {"roomName", "Global Chat"},
-            {"roomType", "public"},
-            {"unread", 0}
+        auto ticket = uploads_->request(userId, [this, wsPtr, msg, userId, roomId, uploadId]() {
+            if (!isConnectionAlive(wsPtr)) {
+                return;  // Close handler releases the slot
+            }
+            Logger::info("📤 Upload admitted from queue: " + uploadId);
+            fileHandler_->handleUploadInit(wsPtr, msg, userId, roomId);
         });
         
-        // Query user's rooms from database
-        try {
-            auto session = dbClient_->getSession();
-            if (session) {
-                auto result = session->sql(
-                    "SELECT r.room_id, r.name, r.room_type, rm.role "
-                    "FROM rooms r "
-                    "JOIN room_members rm ON r.room_id = rm.room_id "
-                    "WHERE rm.user_id = ? ORDER BY r.created_at DESC"
-                ).bind(data->userId).execute();
-                
-                mysqlx::Row row;
-                while ((row = result.fetchOne())) {
-                    rooms.push_back({
-                        {"roomId", row[0].get<std::string>()},
-                        {"roomName", row[1].get<std::string>()},
-                        {"roomType", row[2].get<std::string>()},
-                        {"role", row[3].get<std::string>()},
-                        {"unread", 0}
-                    });
-                }
-            }
-        } catch (const std::exception& e) {
-            Logger::warning("Failed to query user rooms: " + std::string(e.what()));
-            // Continue with just global room
+        if (ticket.decision == UploadAdmission::Decision::Rejected) {
+            json error = {
+                {"type", "upload_error"},
+                {"uploadId", uploadId},
+                {"message", "Too many uploads in progress, try again later"},
+                {"retryAfter", ticket.retryAfterSeconds}
+            };
+            sendJsonMessage(wsPtr, error.dump());
+            return;
         }
         
-        json response = {
-            {"type", "room_list"},
-            {"rooms", rooms},
-            {"count", rooms.size()}
-        };
-        
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info("📋 Sent room list: " + std::to_string(rooms.size()) + " rooms");
+        chunkedUploads_[uploadId] = {ticket.id, wsPtr};
+        if (ticket.decision == UploadAdmission::Decision::Queued) {
+            json queued = {
+                {"type", "upload_queued"},
+                {"uploadId", uploadId},
+                {"position", ticket.queuePosition}
+            };
+            sendJsonMessage(wsPtr, queued.dump());
+            return;
+        }
+        fileHandler_->handleUploadInit(wsPtr, msg, userId, roomId);
         
     } catch (const std::exception& e) {
-        Logger::error("Get rooms error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to get rooms");
+        Logger::error("Upload init error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to start upload");
     }
 }
 
-void WebSocketServer::handleSearchMessagesJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleUploadChunkJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
+        std::string userId = ws->getUserData()->userId;
         
-        json msg = json::parse(jsonStr);
-        std::string query = msg.value("query", "");
-        std::string roomId = msg.value("roomId", "");
-        int limit = msg.value("limit", 50);
+        auto msg = std::make_shared<json>(json::parse(jsonStr));
+        auto write = [this, wsPtr, msg, userId]() {
+            if (isConnectionAlive(wsPtr)) {
+                fileHandler_->handleUploadChunk(wsPtr, *msg, userId);
+            }
+        };
         
-        if (query.empty()) {
-            sendErrorJson(wsPtr, "Search query required");
+        auto it = chunkedUploads_.find(msg->value("uploadId", ""));
+        if (it == chunkedUploads_.end()) {
+            write();  // FileHandler reports the unknown session
             return;
         }
         
-        Logger::info("🔍 Search request: '" + query + "' in room: " + (roomId.empty() ? "all" : roomId));
-        
-        json results = json::array();
-        
-        // Query database with LIKE search
-        auto db = authManager_->getDatabase();
-        if (db) {
-            auto messages = db->searchMessages(query, roomId, limit);
-            
-            for (const auto& m : messages) {
-                results.push_back({
-                    {"messageId", m.messageId},
-                    {"roomId", m.roomId},
-                    {"senderId", m.senderId},
-                    {"senderName", m.senderName},
-                    {"content", m.content},
-                    {"messageType", m.messageType},
-                    {"timestamp", m.timestamp}
-                });
-            }
+        uint64_t ticketId = it->second.first;
+        if (!uploads_->isActive(ticketId)) {
+            sendJsonMessage(wsPtr, json({
+                {"type", "upload_error"},
+                {"uploadId", it->first},
+                {"message", "Upload is still queued; wait for upload_ready"}
+            }).dump());
+            return;
         }
         
-        json response = {
-            {"type", "search_results"},
-            {"query", query},
-            {"results", results},
-            {"count", results.size()}
-        };
+        // WebSocket reads cannot be paused, so an over-budget chunk waits its
+        // turn in memory; its upload_progress ack is delayed with it
+        size_t bytes = msg->value("chunkData", "").size() / 4 * 3;
+        bool withinBudget = uploads_->consume(ticketId, bytes, steadyNowMs());
+        if (withinBudget && !uploads_->hasBandwidthWaiters()) {
+            write();
+            return;
+        }
         
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info("✅ Search completed: " + std::to_string(results.size()) + " results");
+        // Bounded: past the caps the chunk is refused and the client resends it later
+        size_t held = jsonStr.size();
+        if (!uploads_->hold(ticketId, held)) {
+            sendJsonMessage(wsPtr, json({
+                {"type", "upload_chunk_rejected"},
+                {"uploadId", it->first},
+                {"chunkIndex", msg->value("chunkIndex", 0)},
+                {"retryAfter", uploads_->retryAfterHeld()}
+            }).dump());
+            return;
+        }
+        // Earlier chunks are still waiting: queue behind them to keep order
+        uploads_->waitForBandwidth(ticketId, [this, ticketId, held, write]() {
+            uploads_->unhold(ticketId, held);
+            write();
+        });
+        armUploadTimer();
         
     } catch (const std::exception& e) {
-        Logger::error("Search error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Search failed");
+        Logger::error("Upload chunk error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to store upload chunk");
     }
 }
 
-void WebSocketServer::handleMarkReadJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleUploadFinalizeJson(void* wsPtr, const std::string& jsonStr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
-        std::string messageId = msg.value("messageId", "");
-        std::string roomId = msg.value("roomId", "global");
-        
-        if (messageId.empty()) {
-            sendErrorJson(wsPtr, "Message ID required");
-            return;
-        }
-        
-        Logger::info("✓✓ Mark read: " + messageId + " by " + data->username);
+        std::string userId = ws->getUserData()->userId;
         
-        // Update read status in database
-        try {
-            auto session = dbClient_->getSession();
-            if (session) {
-                // Create/update message_reads table entry
-                session->sql(
-                    "INSERT INTO message_reads (message_id, user_id, read_at) "
-                    "VALUES (?, ?, NOW()) "
-                    "ON DUPLICATE KEY UPDATE read_at = NOW()"
-                ).bind(messageId, data->userId).execute();
-                Logger::debug("Read status saved to database");
+        auto msg = std::make_shared<json>(json::parse(jsonStr));
+        std::string uploadId = msg->value("uploadId", "");
+        auto finalize = [this, wsPtr, msg, userId, uploadId]() {
+            if (isConnectionAlive(wsPtr)) {
+                fileHandler_->handleUploadFinalize(wsPtr, *msg, userId);
+            }
+            auto it = chunkedUploads_.find(uploadId);
+            if (it != chunkedUploads_.end()) {
+                uint64_t ticketId = it->second.first;
+                chunkedUploads_.erase(it);
+                uploads_->release(ticketId);
             }
-        } catch (const std::exception& e) {
-            Logger::warning("Failed to save read status: " + std::string(e.what()));
-            // Continue anyway - still broadcast the read receipt
-        }
-        
-        json response = {
-            {"type", "message_read"},
-            {"messageId", messageId},
-            {"roomId", roomId},
-            {"readBy", data->userId},
-            {"username", data->username},
-            {"timestamp", std::time(nullptr) * 1000}
         };
         
-        // Broadcast to room (sender will update their UI)
-        broadcastToRoom(roomId, response.dump());
-        Logger::info("✅ Read receipt sent");
+        // Chunks of this upload may still be waiting for bandwidth; stay behind them
+        auto it = chunkedUploads_.find(uploadId);
+        if (it != chunkedUploads_.end() && uploads_->hasBandwidthWaiters()) {
+            uploads_->waitForBandwidth(it->second.first, finalize);
+            armUploadTimer();
+        } else {
+            finalize();
+        }
         
     } catch (const std::exception& e) {
-        Logger::error("Mark read error: " + std::string(e.what()));
-        sendErrorJson(wsPtr, "Failed to mark message as read");
+        Logger::error("Upload finalize error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Failed to finalize upload");
     }
 }
 
-bool WebSocketServer::sendToSession(const std::string& sessionId, const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    
-    for (const auto& [key, state] : connections_) {
-        if (state.authenticated && state.wsPtr && state.sessionId == sessionId) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            Logger::debug("📤 Sent to session: " + sessionId);
-            return true;
+void WebSocketServer::releaseChunkedUploads(void* wsPtr) {
+    std::vector<uint64_t> tickets;
+    for (auto it = chunkedUploads_.begin(); it != chunkedUploads_.end();) {
+        if (it->second.second == wsPtr) {
+            tickets.push_back(it->second.first);
+            it = chunkedUploads_.erase(it);
+        } else {
+            ++it;
         }
     }
-    
-    Logger::warning("Session not found: " + sessionId);
-    return false;
+    for (uint64_t ticketId : tickets) {
+        uploads_->release(ticketId);
+    }
 }
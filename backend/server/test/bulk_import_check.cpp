@@ -0,0 +1,167 @@
+// Bulk import resume: contiguous checkpoint commits, checkpoint file, reader seek
+//
+// Workers finish batches out of order; the checkpoint may only move past a
+// batch once every earlier one is in. A re-run seeks to the saved offset and
+// must continue with the first record of the first unfinished batch, for
+// plain and gzip input.
+
+#include "check_support.h"
+#include "storage/import_checkpoint.h"
+#include <zlib.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using Counts = ImportCheckpoint::Counts;
+
+namespace {
+
+// Records in batches of batchSize: (end offset of each batch, records)
+std::pair<std::vector<uint64_t>, std::vector<std::string>> readBatches(const std::string& path, size_t batchSize,
+                                                                       bool csv) {
+    ImportReader reader(path);
+    std::vector<uint64_t> ends;
+    std::vector<std::string> records;
+    std::string record;
+    while (reader.next(record, csv)) {
+        records.push_back(record);
+        if (records.size() % batchSize == 0) {
+            ends.push_back(reader.offset());
+        }
+    }
+    if (records.size() % batchSize != 0) {
+        ends.push_back(reader.offset());
+    }
+    return {ends, records};
+}
+
+} // namespace
+
+int main() {
+    std::cout << "bulk_import_check\n";
+
+    // Out-of-order finishes advance the offset only over the contiguous prefix
+    {
+        ImportCheckpoint checkpoint(100, {5, 4, 1, 0});
+        checkpoint.finished(1, 300, {10, 9, 0, 1});
+        checkpoint.finished(2, 400, {10, 10, 0, 0});
+        CHECK(checkpoint.committed().offset == 100);
+        CHECK(checkpoint.committed().totals.rowsRead == 5);
+        CHECK(checkpoint.waiting() == 2);
+
+        checkpoint.finished(0, 200, {10, 8, 2, 0});
+        auto committed = checkpoint.committed();
+        CHECK(committed.offset == 400 && checkpoint.waiting() == 0);
+        CHECK(committed.totals.rowsRead == 35 && committed.totals.rowsImported == 31);
+        CHECK(committed.totals.rowsDuplicate == 3 && committed.totals.rowsRejected == 1);
+
+        checkpoint.finished(4, 600, {10, 10, 0, 0});   // Gap at 3
+        CHECK(checkpoint.committed().offset == 400);
+    }
+
+    // Many workers, shuffled order: the end state is the last batch, counters summed once
+    {
+        constexpr uint64_t BATCHES = 2000;
+        std::vector<uint64_t> order(BATCHES);
+        for (uint64_t i = 0; i < BATCHES; ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937_64(7));
+
+        ImportCheckpoint checkpoint(0, {});
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        for (int w = 0; w < 4; ++w) {
+            workers.emplace_back([&]() {
+                for (size_t i = next++; i < BATCHES; i = next++) {
+                    checkpoint.finished(order[i], (order[i] + 1) * 1000, {1, 1, 0, 0});
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto committed = checkpoint.committed();
+        CHECK(committed.offset == BATCHES * 1000 && committed.totals.rowsRead == BATCHES);
+        CHECK(checkpoint.waiting() == 0);
+    }
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "chatbox_import_check";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // Checkpoint file round trip; missing or unreadable files are ignored
+    {
+        std::string path = (dir / "in.checkpoint").string();
+        CHECK(!ImportCheckpoint::load(path));
+        ImportCheckpoint::Saved saved;
+        saved.offset = 12345;
+        saved.totals = {100, 90, 7, 3};
+        saved.complete = true;
+        CHECK(ImportCheckpoint::save(path, saved));
+        auto loaded = ImportCheckpoint::load(path);
+        CHECK(loaded && loaded->offset == 12345 && loaded->complete);
+        CHECK(loaded && loaded->totals.rowsImported == 90 && loaded->totals.rowsRejected == 3);
+        CHECK(!std::filesystem::exists(path + ".tmp"));
+
+        std::ofstream(path, std::ios::trunc) << "{not json";
+        CHECK(!ImportCheckpoint::load(path));
+    }
+
+    // Resume: batches 0 and 2 of plain and gzip input loaded, batch 1 not
+    std::vector<std::string> lines;
+    for (int i = 0; i < 10; ++i) {
+        lines.push_back("{\"messageId\":\"m" + std::to_string(i) + "\",\"content\":\"line " + std::to_string(i) + "\"}");
+    }
+    std::string plainPath = (dir / "in.jsonl").string();
+    std::string gzipPath = (dir / "in.jsonl.gz").string();
+    {
+        std::ofstream plain(plainPath);
+        gzFile gz = gzopen(gzipPath.c_str(), "wb");
+        for (const auto& line : lines) {
+            plain << line << "\r\n";
+            gzputs(gz, (line + "\n").c_str());
+        }
+        gzclose(gz);
+    }
+    for (const auto& input : {plainPath, gzipPath}) {
+        auto [ends, records] = readBatches(input, 3, false);
+        CHECK(records == lines && ends.size() == 4);
+
+        std::string checkpointPath = input + ".checkpoint";
+        ImportCheckpoint checkpoint(0, {});
+        checkpoint.finished(2, ends[2], {3, 3, 0, 0});
+        checkpoint.finished(0, ends[0], {3, 3, 0, 0});
+        auto saved = checkpoint.committed();
+        CHECK(ImportCheckpoint::save(checkpointPath, saved));
+
+        auto loaded = ImportCheckpoint::load(checkpointPath);
+        ImportReader reader(input);
+        CHECK(loaded && loaded->offset == ends[0] && reader.seek(loaded->offset));
+        std::vector<std::string> rest;
+        std::string record;
+        while (reader.next(record, false)) {
+            rest.push_back(record);
+        }
+        // Lines 0-2 skipped; batch 1 (3-5) and everything after read again
+        CHECK(rest == std::vector<std::string>(lines.begin() + 3, lines.end()));
+    }
+
+    // CSV: a quoted field with a newline is one record, and offsets fall between records
+    {
+        std::string path = (dir / "in.csv").string();
+        std::ofstream(path) << "messageId,content\nm1,\"two\nlines\"\nm2,plain\n";
+        ImportReader reader(path);
+        std::string record;
+        CHECK(reader.next(record, true) && record == "messageId,content");
+        CHECK(reader.next(record, true) && record == "m1,\"two\nlines\"");
+        uint64_t afterFirst = reader.offset();
+        CHECK(reader.next(record, true) && record == "m2,plain");
+        CHECK(!reader.next(record, true));
+        CHECK(reader.seek(afterFirst) && reader.next(record, true) && record == "m2,plain");
+    }
+
+    std::filesystem::remove_all(dir);
+    return checkResult("bulk_import_check");
+}
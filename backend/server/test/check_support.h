@@ -0,0 +1,241 @@
+#ifndef CHECK_SUPPORT_H
+#define CHECK_SUPPORT_H
+
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+/**
+ * Check Support
+ *
+ * Shared by the subsystem checks under test/: a CHECK macro that counts
+ * failures instead of aborting, and a minimal HTTP server on 127.0.0.1 that
+ * stands in for webhook receivers, web pages and AI APIs.
+ *
+ * POSIX only. Each check is a plain executable that returns non-zero if any
+ * CHECK failed (see CHATBOX_BUILD_CHECKS in CMakeLists.txt).
+ */
+
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond) \
+    do { \
+        if (cond) { \
+            std::cout << "  ok    " << #cond << "\n"; \
+        } else { \
+            std::cout << "  FAIL  " << #cond << "  (" << __FILE__ << ":" << __LINE__ << ")\n"; \
+            checkFailures()++; \
+        } \
+    } while (0)
+
+inline int checkResult(const std::string& name) {
+    std::cout << (checkFailures() == 0 ? "PASS " : "FAIL ") << name << "\n";
+    return checkFailures() == 0 ? 0 : 1;
+}
+
+/**
+ * Poll cond every 10ms until it holds or timeoutMs passes
+ */
+inline bool waitFor(const std::function<bool()>& cond, uint32_t timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+/**
+ * One thread, one request per connection (Connection: close), any free port
+ */
+class LocalHttpServer {
+public:
+    struct Request {
+        std::string method;
+        std::string path;
+        std::unordered_map<std::string, std::string> headers;  // Lower-case names
+        std::string body;
+    };
+
+    struct Response {
+        int status = 200;
+        std::string contentType = "text/plain";
+        std::string body;
+        uint32_t delayMs = 0;  // Hold the reply, e.g. so concurrent callers overlap
+    };
+
+    using Handler = std::function<Response(const Request& request)>;
+
+    explicit LocalHttpServer(Handler handler) : handler_(std::move(handler)) {}
+    ~LocalHttpServer() { stop(); }
+
+    LocalHttpServer(const LocalHttpServer&) = delete;
+    LocalHttpServer& operator=(const LocalHttpServer&) = delete;
+
+    bool start() {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) {
+            return false;
+        }
+        int yes = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t length = sizeof(addr);
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listenFd_, 64) != 0 ||
+            ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+            ::close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+
+        running_ = true;
+        thread_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    size_t requests() const { return requests_; }
+
+private:
+    Handler handler_;
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> requests_{0};
+
+    void run() {
+        while (running_) {
+            pollfd pfd{listenFd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 50) <= 0) {
+                continue;
+            }
+            int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd >= 0) {
+                serve(fd);
+                ::close(fd);
+            }
+        }
+    }
+
+    void serve(int fd) {
+        std::string data;
+        char buffer[4096];
+        size_t headerEnd = std::string::npos;
+        size_t contentLength = 0;
+        while (true) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 2000) <= 0) {
+                return;
+            }
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            data.append(buffer, static_cast<size_t>(n));
+            if (headerEnd == std::string::npos) {
+                headerEnd = data.find("\r\n\r\n");
+                if (headerEnd != std::string::npos) {
+                    contentLength = parseContentLength(data.substr(0, headerEnd));
+                }
+            }
+            if (headerEnd != std::string::npos && data.size() >= headerEnd + 4 + contentLength) {
+                break;
+            }
+        }
+
+        Request request = parse(data, headerEnd, contentLength);
+        requests_++;
+        Response response = handler_(request);
+        if (response.delayMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(response.delayMs));
+        }
+
+        std::string out = "HTTP/1.1 " + std::to_string(response.status) + " Status\r\n"
+                          "Content-Type: " + response.contentType + "\r\n"
+                          "Content-Length: " + std::to_string(response.body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + response.body;
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    static size_t parseContentLength(const std::string& head) {
+        std::string lower = head;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+        size_t pos = lower.find("\r\ncontent-length:");
+        return pos == std::string::npos ? 0 : std::stoul(lower.substr(pos + 17));
+    }
+
+    static Request parse(const std::string& data, size_t headerEnd, size_t contentLength) {
+        Request request;
+        size_t lineEnd = data.find("\r\n");
+        std::string first = data.substr(0, lineEnd);
+        size_t space1 = first.find(' ');
+        size_t space2 = first.find(' ', space1 + 1);
+        request.method = first.substr(0, space1);
+        request.path = first.substr(space1 + 1, space2 - space1 - 1);
+
+        size_t pos = lineEnd + 2;
+        while (pos < headerEnd) {
+            size_t end = data.find("\r\n", pos);
+            std::string line = data.substr(pos, end - pos);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                std::string name = line.substr(0, colon);
+                std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+                size_t value = line.find_first_not_of(' ', colon + 1);
+                request.headers[name] = value == std::string::npos ? "" : line.substr(value);
+            }
+            pos = end + 2;
+        }
+        request.body = data.substr(headerEnd + 4, contentLength);
+        return request;
+    }
+};
+
+#endif // CHECK_SUPPORT_H
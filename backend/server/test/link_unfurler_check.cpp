@@ -0,0 +1,99 @@
+// Link previews: single-flight fetches, shared cache, cached failures
+//
+// A local page server counts fetches; concurrent unfurls of one link (with
+// tracking parameters that normalize away) must cost a single fetch.
+
+#include "check_support.h"
+#include "integrations/link_unfurler.h"
+#include <vector>
+
+int main() {
+    LocalHttpServer pages([](const LocalHttpServer::Request& request) {
+        LocalHttpServer::Response response;
+        if (request.path.rfind("/post", 0) == 0) {
+            response.contentType = "text/html; charset=utf-8";
+            response.body = "<html><head><title>Fallback title</title>"
+                            "<meta property=\"og:title\" content=\"Release notes\">"
+                            "<meta property=\"og:description\" content=\"What changed in 2.0\">"
+                            "<meta property=\"og:site_name\" content=\"Example\">"
+                            "</head><body>" + std::string(1000, 'x') + "</body></html>";
+            response.delayMs = 300;  // Keep the first fetch in flight while the others arrive
+        } else {
+            response.status = 404;
+        }
+        return response;
+    });
+    if (!pages.start()) {
+        std::cout << "could not start the local page server\n";
+        return 1;
+    }
+
+    LinkUnfurler::Options options;
+    options.allowPrivateHosts = true;  // The page server is on loopback
+    LinkUnfurler unfurler(options);
+    unfurler.start();
+
+    std::mutex mutex;
+    std::vector<std::optional<LinkPreview>> previews;
+    auto collect = [&](const std::optional<LinkPreview>& preview) {
+        std::lock_guard<std::mutex> lock(mutex);
+        previews.push_back(preview);
+    };
+    auto collected = [&](size_t n) {
+        return [&, n]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return previews.size() >= n;
+        };
+    };
+
+    std::cout << "link_unfurler_check\n";
+
+    // Ten messages with the same link arrive together
+    bool accepted = true;
+    for (int i = 0; i < 10; ++i) {
+        std::string url = pages.url("/post") + (i % 2 ? "?utm_source=chat" : "") + (i % 3 ? "#top" : "");
+        accepted = unfurler.unfurl(url, collect) && accepted;
+    }
+    CHECK(accepted);
+    CHECK(waitFor(collected(10), 5000));
+    CHECK(pages.requests() == 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool allSame = previews.size() == 10;
+        for (const auto& preview : previews) {
+            allSame = allSame && preview && preview->title == "Release notes" &&
+                      preview->description == "What changed in 2.0" && preview->siteName == "Example";
+        }
+        CHECK(allSame);
+    }
+
+    // Later messages are answered from the cache
+    CHECK(unfurler.unfurl(pages.url("/post"), collect));
+    CHECK(waitFor(collected(11), 1000));
+    CHECK(pages.requests() == 1);
+
+    // A dead link is fetched once and its failure cached
+    CHECK(unfurler.unfurl(pages.url("/missing"), collect));
+    CHECK(waitFor(collected(12), 5000));
+    CHECK(unfurler.unfurl(pages.url("/missing"), collect));
+    CHECK(waitFor(collected(13), 1000));
+    CHECK(pages.requests() == 2);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(previews.size() == 13 && !previews[11] && !previews[12]);
+    }
+
+    // Not fetchable at all: refused without a callback
+    CHECK(!unfurler.unfurl("ftp://example.com/file", collect));
+
+    auto stats = unfurler.stats();
+    CHECK(stats.requests == 13);
+    CHECK(stats.coalesced == 9);
+    CHECK(stats.fetched == 1);
+    CHECK(stats.failed == 1);
+    CHECK(stats.cacheHits == 2);
+
+    unfurler.stop();
+    pages.stop();
+    return checkResult("link_unfurler_check");
+}
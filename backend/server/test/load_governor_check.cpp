@@ -0,0 +1,160 @@
+// Load governor: escalation, recovery hysteresis, shedding decisions, login token bucket
+//
+// Samples are fed by hand as the 250ms loop timer would.
+
+#include "check_support.h"
+#include "websocket/load_governor.h"
+
+using Level = LoadGovernor::Level;
+
+namespace {
+
+LoadGovernor::Sample lag(uint64_t ms) {
+    LoadGovernor::Sample sample;
+    sample.loopLagMs = ms;
+    return sample;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "load_governor_check\n";
+
+    LoadGovernor::Thresholds thresholds;
+    thresholds.recoverSamples = 4;
+    thresholds.recoverFactor = 0.6;
+    thresholds.loginsPerSecond = 10;
+
+    // Escalation: straight to the highest level any signal reaches
+    {
+        LoadGovernor governor(thresholds);
+        CHECK(governor.update({}) == Level::Normal);
+
+        LoadGovernor::Sample queue;
+        queue.dbQueueDepth = 2500;
+        CHECK(governor.update(queue) == Level::DeferHeavy);
+
+        LoadGovernor::Sample buffered;
+        buffered.bufferedBytes = 600ULL << 20;
+        CHECK(governor.update(buffered) == Level::ThrottleLogins);
+        CHECK(governor.stats().transitions == 2);
+        CHECK(governor.stats().bufferedBytes == (600ULL << 20));
+    }
+
+    // Lag is smoothed: one slow callback does not escalate, sustained lag does
+    {
+        LoadGovernor governor(thresholds);
+        CHECK(governor.update(lag(90)) == Level::Normal);       // EWMA 45
+        CHECK(governor.update(lag(0)) == Level::Normal);
+        CHECK(governor.update(lag(200)) == Level::ShedPresence);  // EWMA ~111
+        CHECK(governor.update(lag(200)) == Level::DeferHeavy);    // EWMA ~155
+        CHECK(governor.stats().maxLoopLagMs == 200);
+    }
+
+    // Recovery: one step per recoverSamples calm samples, below 0.6 x the thresholds
+    {
+        LoadGovernor governor(thresholds);
+        LoadGovernor::Sample high;
+        high.dbQueueDepth = 9000;
+        CHECK(governor.update(high) == Level::ThrottleLogins);
+
+        LoadGovernor::Sample between;
+        between.dbQueueDepth = 6000;   // Under 8000, but over 0.6 x 8000: not calm yet
+        for (int i = 0; i < 10; ++i) {
+            governor.update(between);
+        }
+        CHECK(governor.level() == Level::ThrottleLogins);
+
+        LoadGovernor::Sample calm;
+        for (int i = 0; i < 3; ++i) {
+            governor.update(calm);
+        }
+        CHECK(governor.level() == Level::ThrottleLogins);
+        governor.update(calm);
+        CHECK(governor.level() == Level::DeferHeavy);
+
+        // A noisy sample resets the calm streak
+        for (int i = 0; i < 3; ++i) {
+            governor.update(calm);
+        }
+        LoadGovernor::Sample noisy;
+        noisy.dbQueueDepth = 1500;     // Over 0.6 x 2000
+        governor.update(noisy);
+        for (int i = 0; i < 3; ++i) {
+            governor.update(calm);
+        }
+        CHECK(governor.level() == Level::DeferHeavy);
+        governor.update(calm);
+        CHECK(governor.level() == Level::ShedPresence);
+
+        for (int i = 0; i < 4; ++i) {
+            governor.update(calm);
+        }
+        CHECK(governor.level() == Level::Normal);
+        CHECK(governor.stats().transitions == 4);
+    }
+
+    // Decisions shed cheapest work first and count what was dropped
+    {
+        LoadGovernor governor(thresholds);
+        CHECK(governor.allowTyping() && governor.allowPresence() && governor.allowOnlineScan() && governor.allowHeavy());
+
+        LoadGovernor::Sample queue;
+        queue.dbQueueDepth = 600;
+        governor.update(queue);
+        CHECK(!governor.allowTyping() && !governor.allowPresence() && !governor.allowOnlineScan());
+        CHECK(governor.allowHeavy());
+
+        queue.dbQueueDepth = 2500;
+        governor.update(queue);
+        CHECK(!governor.allowHeavy());
+        auto stats = governor.stats();
+        CHECK(stats.typingDropped == 1 && stats.presenceDropped == 1 && stats.rejected == 1);
+    }
+
+    // Logins: unlimited below level 3, then a token bucket at loginsPerSecond
+    {
+        LoadGovernor governor(thresholds);
+        uint64_t now = 1000000;
+        int unthrottled = 0;
+        for (int i = 0; i < 100; ++i) {
+            unthrottled += governor.admitLogin(now);
+        }
+        CHECK(unthrottled == 100);
+
+        LoadGovernor::Sample high;
+        high.dbQueueDepth = 9000;
+        governor.update(high);
+        int admitted = 0;
+        for (int i = 0; i < 50; ++i) {
+            admitted += governor.admitLogin(now);
+        }
+        CHECK(admitted == 10);   // The burst
+
+        now += 500;              // Half a second: five more
+        admitted = 0;
+        for (int i = 0; i < 50; ++i) {
+            admitted += governor.admitLogin(now);
+        }
+        CHECK(admitted == 5);
+        CHECK(governor.stats().loginsThrottled == 85);
+
+        now += 10000;            // Refill is capped at the burst
+        admitted = 0;
+        for (int i = 0; i < 50; ++i) {
+            admitted += governor.admitLogin(now);
+        }
+        CHECK(admitted == 10);
+    }
+
+    // Disabled: samples are recorded, the level never moves
+    {
+        LoadGovernor governor(thresholds);
+        governor.setEnabled(false);
+        LoadGovernor::Sample high;
+        high.dbQueueDepth = 9000;
+        CHECK(governor.update(high) == Level::Normal && governor.stats().dbQueueDepth == 9000);
+    }
+
+    return checkResult("load_governor_check");
+}
@@ -0,0 +1,129 @@
+// Message codec: round trips in MySQL's COMPRESS() layout, skipped values, inflate()
+//
+// COMPRESS(str) is a 4-byte little-endian length followed by a zlib stream
+// (and a '.' when the stream ends in a space), so blobs written here must
+// UNCOMPRESS() in SQL and blobs written by SQL must decompress here.
+
+#include "check_support.h"
+#include "database/message_codec.h"
+#include <zlib.h>
+#include <random>
+
+namespace {
+
+std::string fromHex(const std::string& hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+// What MySQL's COMPRESS() returns for value
+std::string mysqlCompress(const std::string& value) {
+    uLongf bound = compressBound(static_cast<uLong>(value.size()));
+    std::string stream(bound, '\0');
+    compress2(reinterpret_cast<Bytef*>(stream.data()), &bound,
+              reinterpret_cast<const Bytef*>(value.data()), static_cast<uLong>(value.size()), Z_DEFAULT_COMPRESSION);
+    stream.resize(bound);
+    std::string blob;
+    uint32_t length = static_cast<uint32_t>(value.size()) & 0x3FFFFFFF;
+    for (int i = 0; i < 4; ++i) {
+        blob.push_back(static_cast<char>((length >> (8 * i)) & 0xFF));
+    }
+    blob += stream;
+    if (blob.back() == ' ') {
+        blob.push_back('.');
+    }
+    return blob;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "message_codec_check\n";
+
+    std::string text;
+    for (int i = 0; text.size() < 5000; ++i) {
+        text += "Deploy " + std::to_string(i % 17) + " of the release branch is scheduled for Friday. ";
+    }
+
+    // Written blobs are byte-for-byte COMPRESS() output and round trip
+    {
+        auto blob = message_codec::compress(text);
+        CHECK(blob.has_value());
+        CHECK(blob && *blob == mysqlCompress(text));
+        CHECK(blob && blob->size() < text.size() / 2);
+        auto back = blob ? message_codec::decompress(*blob) : std::nullopt;
+        CHECK(back && *back == text);
+    }
+
+    // Blobs from SQL: SELECT HEX(COMPRESS('a')), a long value, and the trailing '.' form
+    {
+        auto a = message_codec::decompress(fromHex("01000000789C4B040000620062"));
+        CHECK(a && *a == "a");
+        auto fromSql = message_codec::decompress(mysqlCompress(text));
+        CHECK(fromSql && *fromSql == text);
+        auto dotted = message_codec::decompress(mysqlCompress(text) + ".");
+        CHECK(dotted && *dotted == text);
+    }
+
+    // Skipped: short values, and values that do not shrink by 10%
+    {
+        auto before = message_codec::stats();
+        CHECK(!message_codec::compress(std::string(message_codec::MIN_BYTES - 1, 'x')));
+        CHECK(!message_codec::compress(""));
+        auto afterShort = message_codec::stats();
+        CHECK(afterShort.valuesSkipped == before.valuesSkipped);   // Too short is not counted as skipped
+
+        std::string noise(4096, '\0');
+        std::mt19937 rng(1);
+        for (auto& c : noise) {
+            c = static_cast<char>(rng());
+        }
+        CHECK(!message_codec::compress(noise));
+        auto afterNoise = message_codec::stats();
+        CHECK(afterNoise.valuesSkipped == before.valuesSkipped + 1);
+
+        CHECK(message_codec::compress(std::string(message_codec::MIN_BYTES, 'x')).has_value());
+        auto afterLong = message_codec::stats();
+        CHECK(afterLong.valuesCompressed == before.valuesCompressed + 1);
+        CHECK(afterLong.rawBytes - before.rawBytes == message_codec::MIN_BYTES);
+    }
+
+    // Corrupt blobs are refused rather than misread
+    {
+        auto blob = *message_codec::compress(text);
+        CHECK(!message_codec::decompress(blob.substr(0, blob.size() / 2)));
+        CHECK(!message_codec::decompress("abcd"));
+        std::string wrongLength = blob;
+        wrongLength[0] = static_cast<char>(wrongLength[0] + 1);
+        CHECK(!message_codec::decompress(wrongLength));
+        // A length no stream of this size can reach is refused before allocating it
+        CHECK(!message_codec::decompress(std::string("\xFF\xFF\xFF\x3F", 4) + blob.substr(4, 100)));
+    }
+
+    // inflate(): only flagged fields are touched; a corrupt one becomes empty
+    {
+        Message message{};
+        message.messageId = "m1";
+        message.content = *message_codec::compress(text);
+        message.metadata = "{\"small\":true}";
+        message.compressed = Message::CONTENT_COMPRESSED;
+        message_codec::inflate(message);
+        CHECK(message.content == text && message.metadata == "{\"small\":true}" && message.compressed == 0);
+
+        message_codec::inflate(message);   // No-op once inflated
+        CHECK(message.content == text);
+
+        Message corrupt{};
+        corrupt.messageId = "m2";
+        corrupt.content = "plain";
+        corrupt.metadata = "not a blob";
+        corrupt.compressed = Message::CONTENT_COMPRESSED | Message::METADATA_COMPRESSED;
+        message_codec::inflate(corrupt);
+        CHECK(corrupt.content.empty() && corrupt.metadata.empty() && corrupt.compressed == 0);
+    }
+
+    return checkResult("message_codec_check");
+}
@@ -0,0 +1,114 @@
+// Message expiry index: horizon, bucketed takeDue, batch limits, restore, room TTLs
+//
+// Times are plain numbers; the purge job's loop is replayed by hand.
+
+#include "check_support.h"
+#include "database/message_expiry_index.h"
+#include <set>
+#include <vector>
+
+namespace {
+
+std::set<std::string> idsOf(const std::vector<MessageExpiryIndex::Entry>& entries) {
+    std::set<std::string> ids;
+    for (const auto& entry : entries) {
+        ids.insert(entry.messageId);
+    }
+    return ids;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "message_expiry_check\n";
+
+    // Room TTLs and deadlines
+    {
+        MessageExpiryIndex index(60);
+        CHECK(index.deadlineFor("r1", 1000) == 0);
+        index.setRoomTtl("r1", 300);
+        CHECK(index.roomTtl("r1") == 300 && index.deadlineFor("r1", 1000) == 1300);
+        index.setRoomTtl("r1", 0);
+        CHECK(index.roomTtl("r1") == 0 && index.deadlineFor("r1", 1000) == 0);
+    }
+
+    // Entries past the horizon are left for the database load that reaches them
+    {
+        MessageExpiryIndex index(60);
+        CHECK(index.setHorizon(10000) == 0);
+        index.add("near", "r1", 9999);
+        index.add("at", "r1", 10000);
+        index.add("far", "r1", 50000);
+        CHECK(index.size() == 1);
+
+        // The purge job extends the horizon, then loads [previous, new) itself
+        uint64_t previous = index.setHorizon(60000);
+        CHECK(previous == 10000 && index.horizon() == 60000);
+        index.add("at", "r1", 10000);
+        index.add("far", "r1", 50000);
+        CHECK(index.size() == 3);
+
+        // A failed load puts the horizon back, so the window is read again next pass
+        index.setHorizon(previous);
+        CHECK(index.horizon() == 10000);
+    }
+
+    // takeDue: only what is due, across buckets and inside a straddling bucket
+    {
+        MessageExpiryIndex index(60);
+        index.setHorizon(100000);
+        index.add("a", "r1", 1000);   // Bucket 960
+        index.add("b", "r1", 1010);   // Bucket 960
+        index.add("c", "r2", 1030);   // Bucket 1020
+        index.add("d", "r2", 1070);   // Bucket 1020, after `now` below
+        index.add("e", "r3", 5000);
+
+        CHECK(index.takeDue(999, 100).empty());
+        auto due = index.takeDue(1050, 100);
+        CHECK(idsOf(due) == (std::set<std::string>{"a", "b", "c"}));
+        CHECK(index.size() == 2);
+
+        due = index.takeDue(1070, 100);
+        CHECK(idsOf(due) == std::set<std::string>{"d"});
+        CHECK(due.size() == 1 && due[0].roomId == "r2" && due[0].expiresAt == 1070);
+        CHECK(index.takeDue(4999, 100).empty() && index.size() == 1);
+    }
+
+    // Batches: maxEntries per call, nothing lost or repeated across calls
+    {
+        MessageExpiryIndex index(60);
+        index.setHorizon(100000);
+        for (int i = 0; i < 250; ++i) {
+            index.add("m" + std::to_string(i), "r" + std::to_string(i % 4), 1000 + static_cast<uint64_t>(i));
+        }
+        std::set<std::string> taken;
+        size_t batches = 0;
+        while (true) {
+            auto due = index.takeDue(2000, 100);
+            if (due.empty()) {
+                break;
+            }
+            CHECK(due.size() <= 100);
+            for (const auto& entry : due) {
+                taken.insert(entry.messageId);
+            }
+            batches++;
+        }
+        CHECK(batches == 3 && taken.size() == 250 && index.size() == 0);
+    }
+
+    // restore: a failed purge puts entries back and the next pass takes them again
+    {
+        MessageExpiryIndex index(60);
+        index.setHorizon(100000);
+        index.add("x", "r1", 1000);
+        index.add("y", "r1", 1200);
+        auto due = index.takeDue(1500, 10);
+        CHECK(due.size() == 2 && index.size() == 0);
+        index.restore(due);
+        CHECK(index.size() == 2);
+        CHECK(idsOf(index.takeDue(1500, 10)) == (std::set<std::string>{"x", "y"}));
+    }
+
+    return checkResult("message_expiry_check");
+}
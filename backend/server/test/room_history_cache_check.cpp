@@ -0,0 +1,166 @@
+// Room history cache: versioned puts never overwrite newer state, LRU, in-place updates
+//
+// Interleavings of a history load (version() ... database read ... put())
+// with updates from room actors are replayed by hand, then raced on threads.
+
+#include "check_support.h"
+#include "database/room_history_cache.h"
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+Message makeMessage(const std::string& roomId, const std::string& id, const std::string& content = "hi") {
+    Message message{};
+    message.messageId = id;
+    message.roomId = roomId;
+    message.content = content;
+    return message;
+}
+
+std::vector<std::string> idsOf(const std::optional<std::vector<Message>>& messages) {
+    std::vector<std::string> ids;
+    if (messages) {
+        for (const auto& m : *messages) {
+            ids.push_back(m.messageId);
+        }
+    }
+    return ids;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "room_history_cache_check\n";
+
+    // A load that raced an append is dropped; the newer cached state stays
+    {
+        RoomHistoryCache cache(16, 50);
+        CHECK(!cache.get("r1"));
+
+        uint64_t fresh = cache.version("r1");
+        CHECK(cache.put("r1", {makeMessage("r1", "m1")}, fresh));
+
+        uint64_t stale = cache.version("r1");                 // Slow reader starts
+        auto staleRead = std::vector<Message>{makeMessage("r1", "m1")};
+        cache.append(makeMessage("r1", "m2"));                // Actor saves m2 meanwhile
+        CHECK(!cache.put("r1", staleRead, stale));            // Would drop m2
+        CHECK(idsOf(cache.get("r1")) == (std::vector<std::string>{"m1", "m2"}));
+    }
+
+    // Same for a room that is not cached: the update bumps the version anyway
+    {
+        RoomHistoryCache cache(16, 50);
+        uint64_t stale = cache.version("r2");
+        cache.append(makeMessage("r2", "m1"));                // No-op on the cache, but versioned
+        CHECK(!cache.put("r2", {}, stale));
+        CHECK(!cache.get("r2"));
+        CHECK(cache.put("r2", {makeMessage("r2", "m1")}, cache.version("r2")));
+    }
+
+    // Edits, metadata, removals and invalidation all fence out older loads
+    {
+        RoomHistoryCache cache(16, 50);
+        CHECK(cache.put("r3", {makeMessage("r3", "m1"), makeMessage("r3", "m2")}, cache.version("r3")));
+
+        uint64_t v = cache.version("r3");
+        cache.updateContent("r3", "m1", "edited");
+        CHECK(!cache.put("r3", {makeMessage("r3", "m1")}, v));
+        auto messages = cache.get("r3");
+        CHECK(messages && messages->size() == 2 && (*messages)[0].content == "edited");
+
+        v = cache.version("r3");
+        cache.updateMetadata("r3", "m2", "{\"preview\":true}");
+        CHECK(!cache.put("r3", {}, v));
+
+        v = cache.version("r3");
+        cache.removeMessages("r3", {"m1"});
+        CHECK(!cache.put("r3", {makeMessage("r3", "m1"), makeMessage("r3", "m2")}, v));
+        CHECK(idsOf(cache.get("r3")) == std::vector<std::string>{"m2"});
+
+        v = cache.version("r3");
+        cache.recordReply("r3", "m2", 1700000000);
+        CHECK(!cache.put("r3", {}, v));
+        messages = cache.get("r3");
+        CHECK(messages && messages->size() == 1 && (*messages)[0].replyCount == 1);
+
+        v = cache.version("r3");
+        cache.invalidate("r3");
+        CHECK(!cache.get("r3"));
+        CHECK(!cache.put("r3", {makeMessage("r3", "old")}, v));
+    }
+
+    // Window and LRU: newest messages kept, least recently used rooms evicted
+    {
+        RoomHistoryCache cache(2, 3);
+        std::vector<Message> five;
+        for (int i = 0; i < 5; ++i) {
+            five.push_back(makeMessage("a", "m" + std::to_string(i)));
+        }
+        cache.put("a", five);
+        CHECK(idsOf(cache.get("a")) == (std::vector<std::string>{"m2", "m3", "m4"}));
+        cache.append(makeMessage("a", "m5"));
+        CHECK(idsOf(cache.get("a")) == (std::vector<std::string>{"m3", "m4", "m5"}));
+
+        cache.put("b", {makeMessage("b", "x")});
+        cache.get("a");                                       // a is now most recent
+        cache.put("c", {makeMessage("c", "y")});
+        CHECK(cache.size() == 2 && cache.get("a") && !cache.get("b") && cache.get("c"));
+    }
+
+    // Threads: loaders racing appends never leave the cache missing an appended message
+    {
+        RoomHistoryCache cache(16, 1000);
+        std::mutex dbMutex;
+        std::vector<Message> db;                              // Stands in for the messages table
+        std::atomic<bool> done{false};
+
+        std::thread writer([&]() {
+            for (int i = 0; i < 2000; ++i) {
+                auto message = makeMessage("hot", "m" + std::to_string(i));
+                {
+                    std::lock_guard<std::mutex> lock(dbMutex);
+                    db.push_back(message);                    // Saved first, as on the room actor
+                }
+                cache.append(message);
+            }
+            done = true;
+        });
+        std::vector<std::thread> loaders;
+        for (int t = 0; t < 3; ++t) {
+            loaders.emplace_back([&]() {
+                while (!done) {
+                    uint64_t version = cache.version("hot");
+                    std::vector<Message> snapshot;
+                    {
+                        std::lock_guard<std::mutex> lock(dbMutex);
+                        snapshot = db;
+                    }
+                    std::this_thread::yield();
+                    cache.put("hot", snapshot, version);
+                    if (std::rand() % 8 == 0) {
+                        cache.invalidate("hot");
+                    }
+                }
+            });
+        }
+        writer.join();
+        for (auto& loader : loaders) {
+            loader.join();
+        }
+
+        // Whatever is cached must be exactly the tail of the table
+        auto cached = cache.get("hot");
+        bool consistent = true;
+        if (cached) {
+            size_t offset = db.size() - cached->size();
+            for (size_t i = 0; i < cached->size(); ++i) {
+                consistent = consistent && (*cached)[i].messageId == db[offset + i].messageId;
+            }
+            consistent = consistent && !cached->empty() && cached->back().messageId == "m1999";
+        }
+        CHECK(consistent);
+    }
+
+    return checkResult("room_history_cache_check");
+}
@@ -0,0 +1,129 @@
+// Rolling room summaries: block folds, failed folds, catch-up on request
+//
+// The model is a stand-in that records what it was sent and answers with a
+// numbered summary, so every fold can be traced.
+
+#include "check_support.h"
+#include "ai/room_summarizer.h"
+#include "ai/ai_executor.h"
+#include <vector>
+
+namespace {
+
+Message chat(const std::string& roomId, int n) {
+    Message message;
+    message.messageId = roomId + "-m" + std::to_string(n);
+    message.roomId = roomId;
+    message.senderId = "u" + std::to_string(n % 2);
+    message.senderName = n % 2 ? "bob" : "alice";
+    message.content = "message " + std::to_string(n);
+    message.messageType = 0;
+    message.timestamp = 1700000000 + n;
+    return message;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+int main() {
+    std::mutex mutex;
+    std::vector<std::string> sent;   // Every message passed to the model
+    bool failNext = false;
+    int summaries = 0;
+
+    AiExecutor executor(1, 16);
+    executor.start();
+
+    RoomSummarizer::Options options;
+    options.blockSize = 5;
+    options.tailSize = 3;
+    options.retryDelaySeconds = 0;
+    RoomSummarizer summarizer(options, executor, [&](const std::string&, const std::string& message)
+                                                      -> std::optional<std::string> {
+        std::lock_guard<std::mutex> lock(mutex);
+        sent.push_back(message);
+        if (failNext) {
+            failNext = false;
+            return std::nullopt;
+        }
+        return "  summary #" + std::to_string(++summaries) + "\n";
+    });
+
+    std::vector<std::pair<std::string, std::string>> updated;   // (roomId, waiting userId)
+    summarizer.setOnUpdated([&](const std::string& roomId, const std::vector<RoomSummarizer::Waiter>& waiters) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& waiter : waiters) {
+            updated.emplace_back(roomId, waiter.userId);
+        }
+    });
+
+    std::cout << "room_summarizer_check\n";
+
+    // Every blockSize messages are folded into the previous summary
+    for (int i = 0; i < 12; ++i) {
+        summarizer.append(chat("room-a", i));
+    }
+    CHECK(waitFor([&]() { return summarizer.stats().folds == 2; }, 5000));
+    auto snap = summarizer.snapshot("room-a");
+    CHECK(snap.summary == "summary #2");
+    CHECK(snap.summarizedMessages == 10);
+    CHECK(snap.tail.size() == 2 && snap.tail[0].messageId == "room-a-m10" && snap.tail[1].messageId == "room-a-m11");
+    CHECK(!snap.updating);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(sent.size() == 2);
+        CHECK(sent.size() == 2 && contains(sent[0], "(none yet)") && contains(sent[0], "bob: message 1") &&
+              contains(sent[0], "alice: message 4") && !contains(sent[0], "message 5"));
+        CHECK(sent.size() == 2 && contains(sent[1], "summary #1") && contains(sent[1], "bob: message 5") &&
+              contains(sent[1], "alice: message 8") && !contains(sent[1], "message 10"));
+    }
+
+    // A failed fold keeps its block; the next fold carries it
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failNext = true;
+        sent.clear();
+    }
+    for (int i = 0; i < 5; ++i) {
+        summarizer.append(chat("room-b", i));
+    }
+    CHECK(waitFor([&]() { return summarizer.stats().foldFailures == 1; }, 5000));
+    summarizer.append(chat("room-b", 5));
+    CHECK(waitFor([&]() { return summarizer.stats().folds == 3; }, 5000));
+    snap = summarizer.snapshot("room-b");
+    CHECK(snap.summarizedMessages == 5);
+    CHECK(snap.tail.size() == 1 && snap.tail[0].messageId == "room-b-m5");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(sent.size() == 2 && sent[0] == sent[1]);
+    }
+
+    // A request that the tail cannot answer folds early and tells the requester
+    for (int i = 0; i < 4; ++i) {
+        summarizer.append(chat("room-c", i));
+    }
+    snap = summarizer.snapshot("room-c", RoomSummarizer::Waiter{"carol", "room-c"});
+    CHECK(snap.updating);
+    CHECK(snap.tail.size() == 3);
+    CHECK(waitFor([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !updated.empty();
+    }, 5000));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(updated.size() == 1 && updated[0].first == "room-c" && updated[0].second == "carol");
+    }
+    snap = summarizer.snapshot("room-c");
+    CHECK(snap.summarizedMessages == 4 && snap.tail.empty() && !snap.updating);
+
+    auto stats = summarizer.stats();
+    CHECK(stats.folds == 4);
+    CHECK(stats.messagesFolded == 19);
+    CHECK(stats.rooms == 3);
+
+    executor.stop();
+    return checkResult("room_summarizer_check");
+}
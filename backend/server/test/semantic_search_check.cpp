@@ -0,0 +1,261 @@
+// Semantic search: embedding client wire format and the HNSW index round trip
+//
+// A local stand-in for batchEmbedContents hashes words into buckets, so
+// texts that share words get similar vectors. Messages on a few topics are
+// embedded through EmbeddingClient, indexed, searched (with and without a
+// room filter, against exact search), then the index file is reopened.
+
+#include "check_support.h"
+#include "ai/embedding_client.h"
+#include "search/hnsw_index.h"
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <set>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr uint32_t DIMENSIONS = 64;
+
+std::vector<float> bagOfWords(const std::string& text) {
+    std::vector<float> vector(DIMENSIONS, 0.0f);
+    std::istringstream words(text);
+    for (std::string word; words >> word;) {
+        vector[std::hash<std::string>{}(word) % DIMENSIONS] += 1.0f;
+    }
+    return vector;
+}
+
+float dot(const std::vector<float>& a, const std::vector<float>& b) {
+    float sum = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+std::vector<std::string> exactTop(const std::vector<std::vector<float>>& vectors, const std::vector<float>& query,
+                                  size_t k) {
+    std::vector<std::pair<float, size_t>> scored;
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        scored.emplace_back(dot(vectors[i], query), i);
+    }
+    std::partial_sort(scored.begin(), scored.begin() + k, scored.end(), std::greater<>());
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < k; ++i) {
+        ids.push_back("msg-" + std::to_string(scored[i].second));
+    }
+    return ids;
+}
+
+} // namespace
+
+int main() {
+    LocalHttpServer embedder([](const LocalHttpServer::Request& request) {
+        LocalHttpServer::Response response;
+        response.contentType = "application/json";
+        json body = json::parse(request.body, nullptr, false);
+        if (body.is_discarded() || !body.contains("requests")) {
+            response.status = 400;
+            return response;
+        }
+        json embeddings = json::array();
+        for (const auto& item : body["requests"]) {
+            embeddings.push_back({{"values", bagOfWords(item["content"]["parts"][0]["text"].get<std::string>())}});
+        }
+        if (request.path.rfind("/short", 0) == 0) {
+            embeddings.erase(embeddings.size() - 1);   // One vector missing
+        }
+        response.body = json({{"embeddings", embeddings}}).dump();
+        return response;
+    });
+    if (!embedder.start()) {
+        std::cout << "could not start the local embedding stand-in\n";
+        return 1;
+    }
+
+    std::cout << "semantic_search_check\n";
+
+    EmbeddingClient::Options clientOptions;
+    clientOptions.apiKey = "test";
+    clientOptions.endpoint = embedder.url("/embed");
+    clientOptions.dimensions = DIMENSIONS;
+    EmbeddingClient client(clientOptions);
+
+    // Client: one unit vector per text, and a reply missing one is refused
+    auto probe = client.embed({"release moves to friday", "pizza for lunch"}, EmbeddingClient::DOCUMENT);
+    CHECK(probe && probe->size() == 2 && (*probe)[0].size() == DIMENSIONS);
+    CHECK(probe && std::abs(dot((*probe)[0], (*probe)[0]) - 1.0f) < 1e-4f);
+    clientOptions.endpoint = embedder.url("/short");
+    CHECK(!EmbeddingClient(clientOptions).embed({"a b", "c d"}, EmbeddingClient::DOCUMENT));
+
+    // Corpus: topic words plus filler, spread over three rooms
+    const std::vector<std::vector<std::string>> topics = {
+        {"release", "deploy", "friday", "rollback", "staging"},
+        {"lunch", "pizza", "order", "vegetarian", "delivery"},
+        {"invoice", "budget", "quarter", "finance", "approval"},
+        {"bug", "crash", "stacktrace", "reproduce", "ticket"},
+    };
+    const std::vector<std::string> filler = {"the", "we", "should", "maybe", "today", "team", "please", "ok"};
+    std::mt19937 rng(42);
+    std::vector<std::string> texts;
+    std::vector<size_t> topicOf;
+    for (size_t i = 0; i < 400; ++i) {
+        size_t topic = i % topics.size();
+        std::string text;
+        for (int w = 0; w < 4; ++w) {
+            text += topics[topic][rng() % topics[topic].size()] + " ";
+            text += filler[rng() % filler.size()] + " ";
+        }
+        texts.push_back(text);
+        topicOf.push_back(topic);
+    }
+
+    std::vector<std::vector<float>> vectors;
+    for (size_t start = 0; start < texts.size(); start += 32) {
+        std::vector<std::string> batch(texts.begin() + start, texts.begin() + std::min(start + 32, texts.size()));
+        auto embedded = client.embed(batch, EmbeddingClient::DOCUMENT);
+        if (!embedded) {
+            break;
+        }
+        vectors.insert(vectors.end(), embedded->begin(), embedded->end());
+    }
+    CHECK(vectors.size() == texts.size());
+    if (vectors.size() != texts.size()) {
+        return checkResult("semantic_search_check");
+    }
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "chatbox_semantic_check";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::string path = (dir / "shard-0.hnsw").string();
+    HnswIndex::Params params;
+    params.dimensions = DIMENSIONS;
+    params.M = 8;
+    params.efConstruction = 64;
+
+    auto query = client.embed({"when is the release deploy", "pizza order for lunch"}, EmbeddingClient::QUERY);
+    CHECK(query && query->size() == 2);
+    if (!query || query->size() != 2) {
+        return checkResult("semantic_search_check");
+    }
+    auto anyRoom = [](uint64_t) { return true; };
+    std::vector<std::string> firstHits;
+
+    {
+        HnswIndex index(path, params);
+        CHECK(index.open());
+        bool added = true;
+        for (size_t i = 0; i < vectors.size(); ++i) {
+            added = index.add("msg-" + std::to_string(i), i % 3, 1700000000 + i, vectors[i]) && added;
+        }
+        CHECK(added);
+        CHECK(index.size() == 400);
+        CHECK(!index.add("msg-x", 0, 0, std::vector<float>(DIMENSIONS + 1, 0.1f)));
+
+        // Nearest messages share the query's topic
+        auto hits = index.search((*query)[0], 10, 64, anyRoom, 20000);
+        size_t onTopic = 0;
+        for (const auto& hit : hits) {
+            onTopic += topicOf[std::stoul(hit.messageId.substr(4))] == 0;
+        }
+        // Hashed words collide now and then, so a stray hit or two is allowed
+        CHECK(hits.size() == 10 && topicOf[std::stoul(hits[0].messageId.substr(4))] == 0 && onTopic >= 8);
+
+        // Room filter applies inside the walk
+        auto roomHits = index.search((*query)[1], 10, 64, [](uint64_t room) { return room == 2; }, 20000);
+        bool allInRoom = roomHits.size() == 10;
+        for (const auto& hit : roomHits) {
+            allInRoom = allInRoom && hit.roomKey == 2;
+        }
+        CHECK(allInRoom);
+
+        // Recall against exact search
+        size_t found = 0;
+        size_t wanted = 0;
+        for (size_t q = 0; q < 40; ++q) {
+            const auto& probeVector = vectors[(q * 37) % vectors.size()];
+            auto exact = exactTop(vectors, probeVector, 10);
+            std::set<std::string> approx;
+            for (const auto& hit : index.search(probeVector, 10, 64, anyRoom, 20000)) {
+                approx.insert(hit.messageId);
+            }
+            for (const auto& id : exact) {
+                found += approx.count(id);
+            }
+            wanted += exact.size();
+        }
+        double recall = static_cast<double>(found) / static_cast<double>(wanted);
+        std::cout << "  recall@10 = " << recall << "\n";
+        CHECK(recall >= 0.9);
+
+        CHECK(index.remove("msg-0"));
+        CHECK(!index.contains("msg-0"));
+        index.advanceWatermark(1700000399);
+        index.flush();
+        for (const auto& hit : index.search((*query)[0], 10, 64, anyRoom, 20000)) {
+            firstHits.push_back(hit.messageId);
+        }
+    }
+
+    // Reopen: same vectors, same answers, removal and watermark kept
+    {
+        HnswIndex index(path, params);
+        CHECK(index.open());
+        CHECK(index.size() == 399);
+        CHECK(index.nodes() == 400);
+        CHECK(!index.contains("msg-0") && index.contains("msg-1"));
+        CHECK(index.watermark() == 1700000399);
+        std::vector<std::string> hits;
+        for (const auto& hit : index.search((*query)[0], 10, 64, anyRoom, 20000)) {
+            hits.push_back(hit.messageId);
+        }
+        CHECK(!firstHits.empty() && hits == firstHits);
+        CHECK(std::find(hits.begin(), hits.end(), "msg-0") == hits.end());
+    }
+
+    // Compaction: removed vectors leave the file, the rest still answer
+    {
+        HnswIndex index(path, params);
+        CHECK(index.open());
+        for (size_t i = 1; i < 200; ++i) {
+            index.remove("msg-" + std::to_string(i));
+        }
+        CHECK(index.tombstones() == 200);
+        CHECK(index.compact() == 200);
+        CHECK(index.nodes() == 200 && index.size() == 200 && index.tombstones() == 0);
+        CHECK(!index.contains("msg-1") && index.contains("msg-200"));
+        CHECK(index.watermark() == 1700000399);
+        CHECK(!std::filesystem::exists(path + ".compact"));
+        auto hits = index.search((*query)[0], 10, 64, anyRoom, 20000);
+        bool liveOnly = hits.size() == 10;
+        for (const auto& hit : hits) {
+            liveOnly = liveOnly && std::stoul(hit.messageId.substr(4)) >= 200;
+        }
+        CHECK(liveOnly);
+        CHECK(index.add("msg-0", 0, 1700000400, vectors[0]) && index.size() == 201);
+    }
+    {
+        HnswIndex index(path, params);
+        CHECK(index.open());
+        CHECK(index.size() == 201 && index.nodes() == 201 && index.contains("msg-0"));
+    }
+
+    // Other settings: the file is rebuilt empty instead of misread
+    {
+        HnswIndex::Params other = params;
+        other.dimensions = DIMENSIONS * 2;
+        HnswIndex index(path, other);
+        CHECK(index.open());
+        CHECK(index.size() == 0);
+    }
+
+    embedder.stop();
+    std::filesystem::remove_all(dir);
+    return checkResult("semantic_search_check");
+}
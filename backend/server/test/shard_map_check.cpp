@@ -0,0 +1,96 @@
+// Shard map: ring balance, minimal movement when a shard is added, stable hashing, parsing
+//
+// 100k synthetic room IDs in the shapes the server stores (group rooms and
+// DM conversation IDs).
+
+#include "check_support.h"
+#include "database/shard_map.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> roomIds(size_t n) {
+    std::vector<std::string> ids;
+    ids.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        ids.push_back(i % 2 == 0 ? "room-" + std::to_string(i) : "conv_" + std::to_string(i * 7919));
+    }
+    return ids;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "shard_map_check\n";
+    const auto rooms = roomIds(100000);
+
+    // Balance: with 128 points per shard every shard stays within 25% of its fair share
+    for (size_t shards : {2, 4, 8}) {
+        ShardRing ring(shards);
+        std::vector<size_t> counts(shards, 0);
+        for (const auto& room : rooms) {
+            counts[ring.shardFor(room)]++;
+        }
+        double fair = static_cast<double>(rooms.size()) / static_cast<double>(shards);
+        double worst = 0;
+        for (size_t c : counts) {
+            worst = std::max(worst, std::fabs(static_cast<double>(c) - fair) / fair);
+        }
+        std::cout << "  " << shards << " shards: worst deviation " << worst << "\n";
+        CHECK(worst <= 0.25);
+    }
+
+    // Adding a shard moves only rooms onto the new shard, about 1/N of them
+    for (size_t shards : {1, 3, 4, 7}) {
+        ShardRing before(shards);
+        ShardRing after(shards + 1);
+        size_t moved = 0;
+        bool onlyToNew = true;
+        for (const auto& room : rooms) {
+            size_t from = before.shardFor(room);
+            size_t to = after.shardFor(room);
+            if (from != to) {
+                moved++;
+                onlyToNew = onlyToNew && to == shards;
+            }
+        }
+        double share = static_cast<double>(moved) / static_cast<double>(rooms.size());
+        double expected = 1.0 / static_cast<double>(shards + 1);
+        std::cout << "  " << shards << " -> " << shards + 1 << ": moved " << share << " (ideal " << expected << ")\n";
+        CHECK(onlyToNew);
+        CHECK(std::fabs(share - expected) <= expected * 0.3);
+    }
+
+    // Placement is a pure function of the room ID and the shard count
+    {
+        ShardRing a(5);
+        ShardRing b(5);
+        bool same = true;
+        for (size_t i = 0; i < 1000; ++i) {
+            same = same && a.shardFor(rooms[i]) == b.shardFor(rooms[i]);
+        }
+        CHECK(same);
+        // Pinned values: placement must survive rebuilds and upgrades (std::hash would not)
+        CHECK(ShardRing::hash("room-1") == 9264668102485646988ULL);
+        CHECK(ShardRing::hash("global") == 6752098026808631225ULL);
+        CHECK(ShardRing::hash("room-1") != ShardRing::hash("room-2"));
+        CHECK(ShardRing(0).shardFor("room-1") == 0);
+        CHECK(ShardRing(1).shardFor("anything") == 0);
+    }
+
+    // MESSAGE_SHARDS parsing
+    {
+        auto shards = parseShardList(" db1:33061/chat_a, db2 ,db3/chat_c ", 33060, "chatbox_db");
+        CHECK(shards.size() == 3);
+        CHECK(shards.size() == 3 && shards[0].host == "db1" && shards[0].port == 33061 && shards[0].database == "chat_a");
+        CHECK(shards.size() == 3 && shards[1].port == 33060 && shards[1].database == "chatbox_db");
+        CHECK(shards.size() == 3 && shards[2].label() == "db3:33060/chat_c");
+        CHECK(parseShardList("db1:notaport", 33060, "chatbox_db").empty());
+        CHECK(parseShardList("db1:70000", 33060, "chatbox_db").empty());
+        CHECK(parseShardList(":33060/x", 33060, "chatbox_db").empty());
+        CHECK(parseShardList("", 33060, "chatbox_db").empty());
+    }
+
+    return checkResult("shard_map_check");
+}
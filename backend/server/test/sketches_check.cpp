@@ -0,0 +1,152 @@
+// Activity sketches: HyperLogLog error bounds, count-min, top-k, sliding windows
+//
+// Keys are synthetic ("user-<n>"), so every bound is checked against the
+// exact answer.
+
+#include "check_support.h"
+#include "analytics/sketches.h"
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace sketch;
+
+namespace {
+
+double relativeError(double estimate, double exact) {
+    return std::fabs(estimate - exact) / exact;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "sketches_check\n";
+
+    // HyperLogLog: over 8 key sets per scale, no bias and an RMS error near the
+    // standard error (1.04 / sqrt(4096) ~ 1.6%), including around 2.5m where the
+    // classic estimate switches to linear counting
+    {
+        const double standardError = 1.04 / std::sqrt(4096.0);
+        for (size_t n : {100, 1000, 5000, 10000, 20000, 100000, 1000000}) {
+            const int sets = n >= 1000000 ? 2 : 8;
+            double sum = 0;
+            double squares = 0;
+            for (int set = 0; set < sets; ++set) {
+                HyperLogLog hll(12);
+                std::string prefix = "user" + std::to_string(set) + "-";
+                for (size_t i = 0; i < n; ++i) {
+                    hll.add(hashKey(prefix + std::to_string(i)));
+                    hll.add(hashKey(prefix + std::to_string(i / 2)));  // Repeats do not count
+                }
+                double error = (hll.estimate() - static_cast<double>(n)) / static_cast<double>(n);
+                sum += error;
+                squares += error * error;
+            }
+            double mean = sum / sets;
+            double rms = std::sqrt(squares / sets);
+            std::cout << "  n=" << n << " mean=" << mean << " rms=" << rms << "\n";
+            CHECK(std::fabs(mean) <= standardError && rms <= 2 * standardError);
+        }
+        const double bound = 3 * standardError;
+
+        HyperLogLog empty(12);
+        CHECK(empty.estimate() == 0);
+
+        // Union of overlapping sketches counts the overlap once
+        HyperLogLog a(12);
+        HyperLogLog b(12);
+        for (size_t i = 0; i < 60000; ++i) {
+            a.add(hashKey("user-" + std::to_string(i)));
+            b.add(hashKey("user-" + std::to_string(i + 30000)));
+        }
+        CHECK(relativeError(HyperLogLog::estimateUnion({&a, &b}), 90000) <= bound);
+
+        a.clear();
+        CHECK(a.estimate() == 0);
+    }
+
+    // Count-min: never under, over by at most ~e/width of the total with high probability
+    {
+        CountMinSketch cms(2048, 4);
+        std::map<std::string, uint64_t> exact;
+        uint64_t total = 0;
+        for (size_t i = 0; i < 50000; ++i) {
+            // Zipf-like: a few heavy keys, a long tail
+            std::string key = "room-" + std::to_string(i % 7 == 0 ? i % 5 : i % 3000);
+            cms.add(hashKey(key));
+            exact[key]++;
+            total++;
+        }
+        bool neverUnder = true;
+        size_t withinBound = 0;
+        const double bound = 2.72 / 2048 * static_cast<double>(total);
+        for (const auto& [key, count] : exact) {
+            uint64_t estimate = cms.estimate(hashKey(key));
+            neverUnder = neverUnder && estimate >= count;
+            withinBound += static_cast<double>(estimate - std::min(estimate, count)) <= bound;
+        }
+        CHECK(neverUnder);
+        CHECK(withinBound >= exact.size() * 98 / 100);
+        CHECK(cms.add(hashKey("room-new"), 5) >= 5);
+        cms.clear();
+        CHECK(cms.estimate(hashKey("room-0")) == 0);
+    }
+
+    // Top-k: the heaviest keys come out highest first; the floor only rises
+    {
+        TopK top(3);
+        for (int i = 1; i <= 10; ++i) {
+            top.offer("key-" + std::to_string(i), static_cast<uint64_t>(i * 10));
+        }
+        top.offer("key-2", 5);      // Below the floor
+        top.offer("key-9", 95);     // Existing key, higher count
+        auto items = top.items();
+        CHECK(items.size() == 3);
+        CHECK(items.size() == 3 && items[0].first == "key-10" && items[0].second == 100);
+        CHECK(items.size() == 3 && items[1].first == "key-9" && items[1].second == 95);
+        CHECK(items.size() == 3 && items[2].first == "key-8");
+        top.clear();
+        CHECK(top.items().empty());
+    }
+
+    // Count-min feeding top-k, as ActivityStats does: heavy hitters are found
+    {
+        CountMinSketch cms(2048, 4);
+        TopK top(5);
+        for (size_t i = 0; i < 100000; ++i) {
+            std::string key = i % 2 == 0 ? "heavy-" + std::to_string(i % 10) : "tail-" + std::to_string(i);
+            top.offer(key, cms.add(hashKey(key)));
+        }
+        auto items = top.items();
+        bool allHeavy = items.size() == 5;
+        for (const auto& [key, count] : items) {
+            allHeavy = allHeavy && key.rfind("heavy-", 0) == 0 && count >= 10000;
+        }
+        CHECK(allHeavy);
+    }
+
+    // Ring series and windowed distinct counts roll over old slots
+    {
+        RingSeries series(5, 60);
+        uint64_t t0 = 1700000000 - 1700000000 % 60;
+        series.add(t0, 2);
+        series.add(t0 + 60, 3);
+        series.add(t0 + 120);
+        CHECK(series.total(t0 + 120, 5) == 6);
+        CHECK(series.total(t0 + 120, 2) == 4);
+        auto snapshot = series.snapshot(t0 + 120);
+        CHECK(snapshot.size() == 5 && snapshot.back().first == t0 + 120 && snapshot.back().second == 1);
+        CHECK(series.total(t0 + 120 + 5 * 60, 5) == 0);  // Everything aged out
+
+        WindowedHyperLogLog window(5, 60, 12);
+        for (size_t i = 0; i < 1000; ++i) {
+            window.add(t0, hashKey("user-" + std::to_string(i)));
+            window.add(t0 + 60, hashKey("user-" + std::to_string(i + 500)));
+        }
+        CHECK(relativeError(window.estimate(t0 + 60, 2), 1500) <= 0.05);
+        CHECK(relativeError(window.estimate(t0 + 60, 1), 1000) <= 0.05);
+        CHECK(relativeError(window.estimate(t0 + 5 * 60, 5), 1000) <= 0.05);  // First slot gone
+    }
+
+    return checkResult("sketches_check");
+}
@@ -0,0 +1,144 @@
+// Upload admission: FIFO queue, per-user limits, bandwidth round-robin, held-data caps
+//
+// Pure bookkeeping, so times are passed in and every step is deterministic.
+
+#include "check_support.h"
+#include "storage/upload_admission.h"
+#include <vector>
+
+using Decision = UploadAdmission::Decision;
+
+int main() {
+    std::cout << "upload_admission_check\n";
+
+    // FIFO admission, queue positions, rejection when the queue is full
+    {
+        UploadAdmission::Limits limits;
+        limits.maxActive = 2;
+        limits.maxPerUser = 2;
+        limits.maxQueued = 2;
+        UploadAdmission uploads(limits);
+
+        std::vector<std::string> admitted;
+        auto a = uploads.request("u1", [&]() { admitted.push_back("a"); });
+        auto b = uploads.request("u2", [&]() { admitted.push_back("b"); });
+        auto c = uploads.request("u3", [&]() { admitted.push_back("c"); });
+        auto d = uploads.request("u4", [&]() { admitted.push_back("d"); });
+        auto e = uploads.request("u5", [&]() { admitted.push_back("e"); });
+        CHECK(a.decision == Decision::Admitted && b.decision == Decision::Admitted);
+        CHECK(c.decision == Decision::Queued && c.queuePosition == 1);
+        CHECK(d.decision == Decision::Queued && d.queuePosition == 2);
+        CHECK(e.decision == Decision::Rejected && e.id == 0 && e.retryAfterSeconds >= 5);
+        CHECK(uploads.isActive(a.id) && !uploads.isActive(c.id));
+
+        uploads.release(a.id);
+        CHECK(admitted == std::vector<std::string>{"c"});
+        CHECK(uploads.isActive(c.id) && uploads.queuedCount() == 1);
+
+        // A queued upload that gives up never gets its callback
+        uploads.release(d.id);
+        uploads.release(b.id);
+        CHECK(admitted == std::vector<std::string>{"c"});
+        CHECK(uploads.activeCount() == 1 && uploads.queuedCount() == 0);
+    }
+
+    // Per-user limit: other users are not held behind it, the user's own uploads stay in order
+    {
+        UploadAdmission::Limits limits;
+        limits.maxActive = 3;
+        limits.maxPerUser = 1;
+        UploadAdmission uploads(limits);
+
+        std::vector<std::string> admitted;
+        auto first = uploads.request("u1", [&]() { admitted.push_back("first"); });
+        auto second = uploads.request("u1", [&]() { admitted.push_back("second"); });
+        auto other = uploads.request("u2", [&]() { admitted.push_back("other"); });
+        auto third = uploads.request("u1", [&]() { admitted.push_back("third"); });
+        CHECK(first.decision == Decision::Admitted);
+        CHECK(second.decision == Decision::Queued && second.queuePosition == 1);
+        CHECK(other.decision == Decision::Admitted);
+        CHECK(third.decision == Decision::Queued && third.queuePosition == 2);
+
+        uploads.release(first.id);
+        CHECK(admitted == std::vector<std::string>{"second"});
+        uploads.release(second.id);
+        CHECK(admitted == (std::vector<std::string>{"second", "third"}));
+    }
+
+    // Bandwidth: overdrawn uploads resume round-robin as tokens refill; queued ones never do
+    {
+        UploadAdmission::Limits limits;
+        limits.maxActive = 2;
+        limits.diskBytesPerSecond = 1000 * 1000;  // 1000 bytes per ms
+        limits.burstBytes = 100 * 1000;
+        UploadAdmission uploads(limits);
+
+        auto a = uploads.request("u1", nullptr);
+        auto b = uploads.request("u2", nullptr);
+        auto queued = uploads.request("u3", nullptr);
+        CHECK(queued.decision == Decision::Queued);
+
+        std::vector<std::string> resumed;
+        uint64_t t = 1000;
+        CHECK(!uploads.consume(a.id, 150 * 1000, t));   // 100K - 150K
+        uploads.waitForBandwidth(a.id, [&]() { resumed.push_back("a"); });
+        CHECK(!uploads.consume(b.id, 150 * 1000, t));   // -50K - 150K
+        uploads.waitForBandwidth(b.id, [&]() { resumed.push_back("b"); });
+
+        CHECK(uploads.consume(queued.id, 10 * 1000 * 1000, t));  // Not charged
+        uploads.waitForBandwidth(queued.id, [&]() { resumed.push_back("queued"); });
+
+        uploads.refill(t + 100);   // -200K + 100K: still overdrawn
+        CHECK(resumed.empty() && uploads.hasBandwidthWaiters());
+        uploads.refill(t + 300);   // +200K = 100K: a resumes (64K reserve), then b
+        CHECK(resumed == (std::vector<std::string>{"a", "b"}));
+        CHECK(!uploads.hasBandwidthWaiters());
+    }
+
+    // Release refunds the resume reserve an upload never used
+    {
+        UploadAdmission::Limits limits;
+        limits.maxActive = 2;
+        limits.diskBytesPerSecond = 1000 * 1000;
+        limits.burstBytes = 100 * 1000;
+        UploadAdmission uploads(limits);
+
+        auto a = uploads.request("u1", nullptr);
+        auto c = uploads.request("u2", nullptr);
+        uint64_t t = 1000;
+        CHECK(!uploads.consume(a.id, 100 * 1000 + 1, t));   // -1
+        bool resumed = false;
+        uploads.waitForBandwidth(a.id, [&]() { resumed = true; });
+        uploads.refill(t + 65);                              // 64999, then the 65536 reserve
+        CHECK(resumed);
+        uploads.release(a.id);                               // Reserve back: 64999
+        CHECK(uploads.consume(c.id, 60 * 1000, t + 65));
+    }
+
+    // Held data: per-upload and total caps, returned on unhold and release
+    {
+        UploadAdmission::Limits limits;
+        limits.maxHeldPerUpload = 1000;
+        limits.maxHeldBytes = 1500;
+        UploadAdmission uploads(limits);
+
+        auto a = uploads.request("u1", nullptr);
+        auto b = uploads.request("u2", nullptr);
+        CHECK(uploads.hold(a.id, 800));
+        CHECK(!uploads.hold(a.id, 300));   // Over the per-upload cap
+        CHECK(uploads.hold(b.id, 600));
+        CHECK(!uploads.hold(b.id, 200));   // Over the total cap
+        CHECK(uploads.heldBytes() == 1400);
+        CHECK(uploads.retryAfterHeld() >= 1);
+
+        uploads.unhold(a.id, 800);
+        CHECK(uploads.hold(b.id, 200));
+        uploads.release(b.id);
+        CHECK(uploads.heldBytes() == 0);
+        uploads.unhold(b.id, 800);          // Already returned by release
+        CHECK(uploads.heldBytes() == 0);
+        CHECK(!uploads.hold(12345, 1));     // Unknown upload
+    }
+
+    return checkResult("upload_admission_check");
+}
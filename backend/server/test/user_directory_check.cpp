@@ -0,0 +1,135 @@
+// User directory: Bloom filter false positives, username checks, search ranking, paging
+//
+// The Bloom filter may only err towards "maybe taken"; the measured
+// false-positive rate must stay near the configured 1%.
+
+#include "check_support.h"
+#include "database/user_directory.h"
+#include "utils/bloom_filter.h"
+#include <set>
+#include <vector>
+
+namespace {
+
+User makeUser(const std::string& id, const std::string& username, const std::string& displayName = "") {
+    User user{};
+    user.userId = id;
+    user.username = username;
+    user.displayName = displayName;
+    return user;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "user_directory_check\n";
+
+    // Bloom filter: no false negatives, false positives near the configured rate
+    {
+        BloomFilter filter(10000, 0.01);
+        for (int i = 0; i < 10000; ++i) {
+            filter.add("member-" + std::to_string(i));
+        }
+        bool noFalseNegatives = true;
+        for (int i = 0; i < 10000; ++i) {
+            noFalseNegatives = noFalseNegatives && filter.mightContain("member-" + std::to_string(i));
+        }
+        CHECK(noFalseNegatives);
+
+        int falsePositives = 0;
+        const int probes = 100000;
+        for (int i = 0; i < probes; ++i) {
+            falsePositives += filter.mightContain("stranger-" + std::to_string(i));
+        }
+        double rate = static_cast<double>(falsePositives) / probes;
+        std::cout << "  false-positive rate = " << rate << "\n";
+        CHECK(rate <= 0.015);
+
+        filter.clear();
+        CHECK(!filter.mightContain("member-1"));
+    }
+
+    // Username checks: taken names always "maybe", unused names almost always "no"
+    {
+        UserDirectory directory;
+        CHECK(directory.mayHaveUsername("anyone"));   // Not loaded yet: assume taken
+
+        std::vector<User> users;
+        for (int i = 0; i < 5000; ++i) {
+            users.push_back(makeUser("u" + std::to_string(i), "User" + std::to_string(i)));
+        }
+        directory.load(users);
+        CHECK(directory.isLoaded() && directory.size() == 5000);
+        CHECK(directory.mayHaveUsername("user42") && directory.mayHaveUsername("USER4999"));
+
+        int falsePositives = 0;
+        for (int i = 0; i < 20000; ++i) {
+            falsePositives += directory.mayHaveUsername("free-name-" + std::to_string(i));
+        }
+        CHECK(falsePositives <= 20000 / 100);
+
+        directory.addUser(makeUser("u-new", "Newcomer"));
+        CHECK(directory.mayHaveUsername("newcomer") && directory.size() == 5001);
+    }
+
+    // Search: exact username, then online, then shorter names; display names match too
+    {
+        UserDirectory directory;
+        directory.load({
+            makeUser("1", "anna"),
+            makeUser("2", "annabel"),
+            makeUser("3", "annie", "Ann Lee"),
+            makeUser("4", "bob", "Annette"),
+            makeUser("5", "ann"),
+            makeUser("6", "carl"),
+        });
+        auto online = [](const std::string& userId) { return userId == "2"; };
+
+        auto hits = directory.search("Ann", 10, "", online);
+        std::vector<std::string> ids;
+        for (const auto& hit : hits) {
+            ids.push_back(hit.userId);
+        }
+        // ann (exact), annabel (online), then by username length: bob (display name
+        // "Annette"), anna, annie
+        CHECK(ids == (std::vector<std::string>{"5", "2", "4", "1", "3"}));
+        CHECK(!hits.empty() && hits[1].online && !hits[0].online);
+
+        auto limited = directory.search("ann", 2, "5", online);
+        CHECK(limited.size() == 2 && limited[0].userId == "2" && limited[1].userId == "4");
+        CHECK(directory.search("zed", 10, "", online).empty());
+
+        directory.updateProfile("6", "Annika", "", "busy");
+        auto renamed = directory.search("annik", 10, "", nullptr);
+        CHECK(renamed.size() == 1 && renamed[0].userId == "6" && renamed[0].statusMessage == "busy");
+        CHECK(directory.search("bob", 10, "", nullptr).size() == 1);
+    }
+
+    // Listing: cursor pages cover every user once, in username order
+    {
+        UserDirectory directory;
+        std::vector<User> users;
+        for (int i = 0; i < 95; ++i) {
+            users.push_back(makeUser("id" + std::to_string(i), "name" + std::to_string(1000 + i)));
+        }
+        directory.load(users);
+
+        std::vector<std::string> seen;
+        std::string cursor;
+        int pages = 0;
+        do {
+            auto page = directory.list(cursor, 10, nullptr);
+            for (const auto& entry : page.users) {
+                seen.push_back(entry.username);
+            }
+            cursor = page.nextCursor;
+            pages++;
+        } while (!cursor.empty() && pages < 20);
+        CHECK(pages == 10 && seen.size() == 95);
+        CHECK(std::is_sorted(seen.begin(), seen.end()));
+        CHECK(std::set<std::string>(seen.begin(), seen.end()).size() == 95);
+        CHECK(directory.list("", 0, nullptr).users.empty());
+    }
+
+    return checkResult("user_directory_check");
+}
@@ -0,0 +1,153 @@
+// Webhook delivery: batching, retry with backoff, dead-lettering, address guard
+//
+// A local receiver plays four endpoints: one that fails twice and then
+// accepts, one that always fails (retryable 5xx), one that rejects the
+// request (non-retryable 4xx) and one that redirects. A second dispatcher
+// without allowPrivateHosts must not reach the receiver at all.
+
+#include "check_support.h"
+#include "integrations/webhook_dispatcher.h"
+#include "integrations/address_guard.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <vector>
+
+using json = nlohmann::json;
+
+int main() {
+    std::mutex mutex;
+    int flakyCalls = 0;
+    std::vector<std::string> deliveryIds;   // X-ChatBox-Delivery of every /flaky attempt
+    std::string acceptedBody;
+    bool signed_ = false;
+
+    LocalHttpServer receiver([&](const LocalHttpServer::Request& request) {
+        LocalHttpServer::Response response;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (request.path == "/flaky") {
+            deliveryIds.push_back(request.headers.count("x-chatbox-delivery") ? request.headers.at("x-chatbox-delivery") : "");
+            signed_ = request.headers.count("x-chatbox-signature") > 0;
+            if (++flakyCalls <= 2) {
+                response.status = 503;
+            } else {
+                acceptedBody = request.body;
+            }
+        } else if (request.path == "/gone") {
+            response.status = 500;
+        } else if (request.path == "/moved") {
+            response.status = 302;
+        } else {
+            response.status = 400;
+        }
+        return response;
+    });
+    if (!receiver.start()) {
+        std::cout << "could not start the local receiver\n";
+        return 1;
+    }
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "chatbox_webhook_check";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    WebhookDispatcher::Options options;
+    options.maxBatchEvents = 10;
+    options.maxBatchDelayMs = 50;
+    options.maxAttempts = 3;
+    options.baseBackoffMs = 50;
+    options.maxBackoffMs = 200;
+    options.requestTimeoutMs = 3000;
+    options.deadLetterPath = (dir / "dead-letter.jsonl").string();
+    options.allowPrivateHosts = true;  // The receiver is on loopback
+
+    WebhookDispatcher dispatcher(options);
+    dispatcher.setSubscriptions({
+        {"wh-flaky", "room-a", receiver.url("/flaky"), "s3cret", "tester"},
+        {"wh-gone", "room-b", receiver.url("/gone"), "", "tester"},
+        {"wh-bad", "room-c", receiver.url("/bad"), "", "tester"},
+        {"wh-moved", "room-d", receiver.url("/moved"), "", "tester"},
+    });
+    dispatcher.start();
+
+    for (int i = 0; i < 5; ++i) {
+        dispatcher.publish("room-a", json({{"event", "message.created"}, {"n", i}}).dump());
+    }
+    dispatcher.publish("room-b", R"({"event":"message.created","n":100})");
+    dispatcher.publish("room-c", R"({"event":"message.created","n":200})");
+    dispatcher.publish("room-d", R"({"event":"message.created","n":300})");
+    dispatcher.publish("room-without-webhooks", R"({"event":"message.created"})");
+
+    bool settled = waitFor([&]() {
+        auto stats = dispatcher.stats();
+        return stats.eventsDelivered == 5 && stats.eventsDeadLettered == 3;
+    }, 10000);
+    dispatcher.stop();
+    size_t receiverRequests = receiver.requests();
+
+    // Default options: loopback is refused at connect time, after the usual retries
+    WebhookDispatcher::Options guarded = options;
+    guarded.allowPrivateHosts = false;
+    guarded.deadLetterPath = (dir / "guarded-dead-letter.jsonl").string();
+    WebhookDispatcher guardedDispatcher(guarded);
+    guardedDispatcher.setSubscriptions({{"wh-local", "room-a", receiver.url("/flaky"), "", "tester"}});
+    guardedDispatcher.start();
+    guardedDispatcher.publish("room-a", R"({"event":"message.created","n":400})");
+    bool refused = waitFor([&]() { return guardedDispatcher.stats().eventsDeadLettered == 1; }, 10000);
+    guardedDispatcher.stop();
+    bool receiverUntouched = receiver.requests() == receiverRequests;
+    receiver.stop();
+
+    std::cout << "webhook_dispatcher_check\n";
+    auto stats = dispatcher.stats();
+    CHECK(settled);
+    CHECK(stats.eventsDelivered == 5);
+    CHECK(stats.batchesDelivered == 1);
+    CHECK(stats.retries >= 2);
+    CHECK(stats.eventsDeadLettered == 3);
+    CHECK(stats.eventsPending == 0);
+
+    // The batch is fixed across retries: same delivery ID, all five events in order
+    CHECK(flakyCalls == 3);
+    CHECK(std::set<std::string>(deliveryIds.begin(), deliveryIds.end()).size() == 1);
+    CHECK(signed_);
+    json accepted = json::parse(acceptedBody, nullptr, false);
+    CHECK(accepted.is_object() && accepted["events"].size() == 5);
+    CHECK(accepted.is_object() && accepted["events"][0]["n"] == 0 && accepted["events"][4]["n"] == 4);
+
+    // Dead letters: the 5xx endpoint after maxAttempts, the 4xx one after one attempt
+    std::ifstream in(options.deadLetterPath);
+    std::unordered_map<std::string, json> dead;
+    for (std::string line; std::getline(in, line);) {
+        json entry = json::parse(line, nullptr, false);
+        if (entry.is_object()) {
+            dead[entry.value("webhookId", "")] = entry;
+        }
+    }
+    CHECK(dead.size() == 3);
+    CHECK(dead.count("wh-gone") && dead["wh-gone"]["attempts"] == 3 && dead["wh-gone"]["error"] == "HTTP 500");
+    CHECK(dead.count("wh-bad") && dead["wh-bad"]["attempts"] == 1 && dead["wh-bad"]["error"] == "HTTP 400");
+    CHECK(dead.count("wh-gone") && dead["wh-gone"]["request"]["events"][0]["n"] == 100);
+    // Redirects are not followed
+    CHECK(dead.count("wh-moved") && dead["wh-moved"]["attempts"] == 1 && dead["wh-moved"]["error"] == "HTTP 302");
+
+    // Address guard
+    CHECK(refused);
+    CHECK(receiverUntouched);
+    CHECK(guardedDispatcher.stats().retries == 2);
+    CHECK(address_guard::hostOf("https://user@Example.COM:8443/hook?x=1") == "example.com");
+    CHECK(address_guard::hostOf("http://[::1]:8080/") == "::1");
+    CHECK(!address_guard::isPrivateHost("example.com") && !address_guard::isPrivateHost("93.184.216.34"));
+    CHECK(address_guard::isPrivateHost("localhost") && address_guard::isPrivateHost("api.localhost."));
+    CHECK(address_guard::isPrivateHost("127.0.0.1") && address_guard::isPrivateHost("10.1.2.3") &&
+          address_guard::isPrivateHost("192.168.0.10") && address_guard::isPrivateHost("172.31.255.1"));
+    CHECK(address_guard::isPrivateHost("169.254.169.254") && address_guard::isPrivateHost("::1") &&
+          address_guard::isPrivateHost("fd00::1") && address_guard::isPrivateHost("::ffff:127.0.0.1"));
+    CHECK(address_guard::isPrivateHost("2130706433") && address_guard::isPrivateHost("0x7f.1") &&
+          address_guard::isPrivateHost("0177.0.0.1"));
+    CHECK(!address_guard::isPrivateHost("9cafe.de") && !address_guard::isPrivateHost("123.example"));
+
+    std::filesystem::remove_all(dir);
+    return checkResult("webhook_dispatcher_check");
+}
@@ -1,5 +1,5 @@
 import { useState, useEffect } from 'react'
-import { X, Plus, Hash, Lock, Users, Loader2, LogOut, Settings, MessageCircle } from 'lucide-react'
+import { X, Plus, Hash, Lock, Users, Loader2, LogOut, Settings, MessageCircle, Megaphone } from 'lucide-react'
 import { useWebSocket } from '@/contexts/WebSocketContext'
 import { useChatStore } from '@/stores/chatStore'
 
@@ -58,7 +58,7 @@ export function RoomManager({ isOpen, onClose, onRoomSelect }: RoomManagerProps)
     
     // Create room state
     const [newRoomName, setNewRoomName] = useState('')
-    const [newRoomType, setNewRoomType] = useState<'public' | 'private' | 'group'>('public')
+    const [newRoomType, setNewRoomType] = useState<'public' | 'private' | 'group' | 'channel'>('public')
     const [creating, setCreating] = useState(false)
 
     // Join room state
@@ -319,7 +319,7 @@ export function RoomManager({ isOpen, onClose, onRoomSelect }: RoomManagerProps)
                                         className="w-full px-4 py-2 bg-slate-900 text-white rounded-lg border border-slate-700 focus:border-purple-500 focus:outline-none"
                                     />
                                     <div className="flex gap-2">
-                                        {(['public', 'private'] as const).map((type) => (
+                                        {(['public', 'private', 'channel'] as const).map((type) => (
                                             <button
                                                 key={type}
                                                 type="button"
@@ -332,6 +332,7 @@ export function RoomManager({ isOpen, onClose, onRoomSelect }: RoomManagerProps)
                                             >
                                                 {type === 'public' && <Hash className="w-4 h-4" />}
                                                 {type === 'private' && <Lock className="w-4 h-4" />}
+                                                {type === 'channel' && <Megaphone className="w-4 h-4" />}
                                                 <span className="capitalize text-sm">{type}</span>
                                             </button>
                                         ))}
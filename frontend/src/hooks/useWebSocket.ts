@@ -293,9 +293,11 @@ export function useWebSocket() {
                     const newMessages = { ...prev };
                     for (const roomId in newMessages) {
                         newMessages[roomId] = newMessages[roomId].map(m =>
-                            m.id === data.messageId
-                                ? { ...m, content: data.newContent, isEdited: true }
-                                : m
+                            m.id !== data.messageId
+                                ? m
+                                : data.newContent !== undefined
+                                    ? { ...m, content: data.newContent, isEdited: true, metadata: data.metadata ?? m.metadata }
+                                    : { ...m, metadata: { ...m.metadata, ...data.metadata } }
                         );
                     }
                     return newMessages;
@@ -419,7 +421,7 @@ export function useWebSocket() {
                 break;
 
             case 'room_joined':
-                console.log('✅ Joined room:', data.roomId, 'with history:', data.history?.length || 0, 'polls:', data.polls?.length || 0);
+                console.log('✅ Joined room:', data.roomId, 'with history:', data.history?.length || 0);
                 console.log('📜 History data:', JSON.stringify(data.history?.slice(0, 2)));
                 // Load history from room_joined response
                 if (data.history && Array.isArray(data.history)) {
@@ -442,25 +444,31 @@ export function useWebSocket() {
                         return newState;
                     });
                 }
-                // Load room members
+                // Member list is paged separately (room_joined only carries counts)
+                wsRef.current?.send(JSON.stringify({ type: 'get_members', roomId: data.roomId, limit: 100 }));
+                break;
+
+            // Progressive join: members and polls arrive after room_joined
+            case 'room_members':
                 if (data.members && Array.isArray(data.members)) {
-                    console.log('👥 Loading room members:', data.members.length, 'for room:', data.roomId);
+                    console.log('👥 Loading room members:', data.members.length, 'of', data.memberCount, 'for room:', data.roomId);
                     setRoomMembers(prev => ({
                         ...prev,
-                        [data.roomId]: data.members
+                        // Follow-up pages (cursor set) append to the list
+                        [data.roomId]: data.cursor ? [...(prev[data.roomId] || []), ...data.members] : data.members
                     }));
                 }
-                // Load polls from room_joined response
+                break;
+
+            case 'room_polls':
                 if (data.polls && Array.isArray(data.polls)) {
-                    console.log('📊 Loading polls from room_joined:', data.polls.length, 'for room:', data.roomId);
-                    console.log('📊 Polls data:', JSON.stringify(data.polls));
+                    console.log('📊 Loading polls:', data.polls.length, 'for room:', data.roomId);
                     setPolls(prev => {
                         const newPolls: Record<string, any> = { ...prev };
                         data.polls.forEach((poll: any) => {
                             // Ensure roomId is set correctly
                             newPolls[poll.id] = { ...poll, roomId: data.roomId };
                         });
-                        console.log('📊 Updated polls state:', Object.keys(newPolls));
                         return newPolls;
                     });
                 }
@@ -897,6 +905,16 @@ export function useWebSocket() {
         });
     }, [send]);
 
+    const getMembers = useCallback((roomId: string, cursor?: string, prefix?: string) => {
+        send({
+            type: 'get_members',
+            roomId,
+            cursor: cursor || '',
+            prefix: prefix || '',
+            limit: 100
+        });
+    }, [send]);
+
     const leaveRoom = useCallback((roomId: string) => {
         send({
             type: 'leave_room',
@@ -928,7 +946,7 @@ export function useWebSocket() {
         });
     }, [send]);
 
-    const createRoom = useCallback((name: string, roomType?: 'public' | 'private' | 'group') => {
+    const createRoom = useCallback((name: string, roomType?: 'public' | 'private' | 'group' | 'channel') => {
         send({
             type: 'create_room',
             name,
@@ -1162,6 +1180,7 @@ export function useWebSocket() {
         // New features
         typingUsers,
         roomMembers,
+        getMembers,
         // Message Actions
         pinMessage,
         unpinMessage,
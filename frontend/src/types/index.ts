@@ -34,6 +34,15 @@ export interface MessageMetadata {
     thumbnailUrl?: string;
     latitude?: number;
     longitude?: number;
+    linkPreview?: LinkPreview;
+}
+
+export interface LinkPreview {
+    url: string;
+    title: string;
+    description?: string;
+    image?: string;
+    siteName?: string;
 }
 
 // ============================================================================
@@ -225,9 +234,10 @@ export interface ErrorResponse {
 export interface MessageEditedResponse {
     type: 'message_edited';
     messageId: string;
-    newContent: string;
-    editedAt: number;
-    userId: string;
+    newContent?: string;  // Absent when only metadata changed (e.g. a link preview was attached)
+    editedAt?: number;
+    userId?: string;
+    metadata?: MessageMetadata;
 }
 
 export interface MessageDeletedResponse {
@@ -248,6 +258,20 @@ export interface RoomJoinedResponse {
     roomId: string;
     userId: string;
     username: string;
+    memberCount: number;
+    onlineCount: number;
+}
+
+export interface RoomMembersResponse {
+    type: 'room_members';
+    roomId: string;
+    memberCount: number;
+    onlineCount: number;
+    members: { userId: string; username: string; avatar: string; online: boolean }[];
+    cursor: string;
+    prefix: string;
+    hasMore: boolean;
+    nextCursor?: string;
 }
 
 export interface RoomListResponse {
@@ -0,0 +1,128 @@
+import WebSocket from 'ws';
+import { performance } from 'perf_hooks';
+
+/**
+ * Join Latency Test - time-to-first-message for a large room
+ *
+ * Fills a room with MEMBERS users, then measures how long a fresh join takes
+ * until room_joined (history) arrives, then until the first room_members page
+ * answers the get_members sent right after it.
+ *
+ * Servers from before the staged join frames send every member inside
+ * room_joined; there both timings are the room_joined time, so the same script
+ * gives the baseline. Run it against both builds with the same MEMBERS and
+ * JOINS before quoting a difference.
+ *
+ *   MEMBERS=5000 JOINS=20 node performance/join-latency-test.js
+ */
+
+const WS_URL = process.env.WS_URL || 'ws://localhost:8080';
+const MEMBERS = parseInt(process.env.MEMBERS || '5000', 10);
+const JOINS = parseInt(process.env.JOINS || '20', 10);
+const ROOM_ID = process.env.ROOM_ID || `latency-room-${Date.now()}`;
+const PASSWORD = 'latency123';
+
+function connectAndLogin(username) {
+    return new Promise((resolve, reject) => {
+        const ws = new WebSocket(WS_URL);
+        let loginSent = false;
+
+        const login = () => {
+            loginSent = true;
+            ws.send(JSON.stringify({ type: 'login', username, password: PASSWORD }));
+        };
+
+        ws.on('open', () => {
+            ws.send(JSON.stringify({ type: 'register', username, password: PASSWORD }));
+        });
+
+        ws.on('message', (data) => {
+            const msg = JSON.parse(data.toString());
+            if (!loginSent && (msg.type === 'register_response' || msg.type === 'register_success' || msg.type === 'error')) {
+                login();
+            } else if (msg.type === 'login_response') {
+                msg.success ? resolve(ws) : reject(new Error(`Login failed for ${username}`));
+            }
+        });
+
+        ws.on('error', reject);
+        setTimeout(() => reject(new Error(`Timeout logging in ${username}`)), 10000);
+    });
+}
+
+function joinRoom(ws) {
+    return new Promise((resolve, reject) => {
+        const start = performance.now();
+        const result = {};
+
+        const onMessage = (data) => {
+            const msg = JSON.parse(data.toString());
+            if (msg.roomId !== ROOM_ID) return;
+
+            if (msg.type === 'room_joined') {
+                result.firstMessageMs = performance.now() - start;
+                result.history = msg.history?.length || 0;
+                if (Array.isArray(msg.members)) {
+                    // Single-frame join: the members came with the history
+                    result.membersMs = result.firstMessageMs;
+                    result.members = msg.memberCount ?? msg.members.length;
+                    ws.off('message', onMessage);
+                    resolve(result);
+                    return;
+                }
+                // Members are paged on request, as the client does after room_joined
+                ws.send(JSON.stringify({ type: 'get_members', roomId: ROOM_ID, limit: 100 }));
+            } else if (msg.type === 'room_members') {
+                result.membersMs = performance.now() - start;
+                result.members = msg.memberCount;
+                ws.off('message', onMessage);
+                resolve(result);
+            }
+        };
+
+        ws.on('message', onMessage);
+        ws.send(JSON.stringify({ type: 'join_room', roomId: ROOM_ID }));
+        setTimeout(() => reject(new Error('Timeout waiting for join')), 30000);
+    });
+}
+
+function percentile(values, p) {
+    const sorted = [...values].sort((a, b) => a - b);
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function run() {
+    console.log('⏱️  Join Latency Test');
+    console.log(`Target: ${WS_URL}, room: ${ROOM_ID}, members: ${MEMBERS}, joins: ${JOINS}`);
+    console.log('='.repeat(60));
+
+    // Phase 1: populate membership (one connection at a time, leave socket closed afterwards)
+    for (let i = 0; i < MEMBERS; i++) {
+        const ws = await connectAndLogin(`latency_member_${i}`);
+        await joinRoom(ws).catch(() => {});
+        ws.close();
+        if ((i + 1) % 500 === 0) {
+            console.log(`✅ Members joined: ${i + 1}/${MEMBERS}`);
+        }
+    }
+
+    // Phase 2: measure fresh joins
+    const ws = await connectAndLogin('latency_probe');
+    const firstMessage = [];
+    const members = [];
+    for (let i = 0; i < JOINS; i++) {
+        const r = await joinRoom(ws);
+        firstMessage.push(r.firstMessageMs);
+        members.push(r.membersMs);
+    }
+    ws.close();
+
+    console.log('\n📈 RESULTS');
+    console.log(`  Time-to-first-message p50: ${percentile(firstMessage, 0.5).toFixed(1)}ms, p95: ${percentile(firstMessage, 0.95).toFixed(1)}ms`);
+    console.log(`  Time-to-members       p50: ${percentile(members, 0.5).toFixed(1)}ms, p95: ${percentile(members, 0.95).toFixed(1)}ms`);
+}
+
+run().catch((err) => {
+    console.error('❌ Join latency test failed:', err.message);
+    process.exit(1);
+});